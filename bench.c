@@ -0,0 +1,726 @@
+/*
+    reliable.io reference implementation
+
+    Copyright © 2017, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// the benchmarks reach into the sequence buffer and packet header functions directly, so include the implementation like test.cpp does
+
+#include "reliable.c"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined( _WIN32 )
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define BENCH_PACKET_BYTES_SMALL 64
+#define BENCH_PACKET_BYTES_FRAGMENTED ( 8 * 1024 )
+#define BENCH_MIN_TIME 0.25
+#define BENCH_SIMULATED_PAIRS 1000
+#define BENCH_SIMULATED_TICK 0.01
+#define BENCH_CONGESTION_PACKET_BYTES 1000
+#define BENCH_CONGESTION_TICK 0.001
+#define BENCH_CONGESTION_SECONDS 20
+#define BENCH_CONGESTION_LATENCY 0.025f
+#define BENCH_CONGESTION_BANDWIDTH_KBPS 2000.0f
+#define BENCH_CONGESTION_MAX_QUEUE_DELAY 0.5f
+
+double bench_time()
+{
+#if defined( _WIN32 )
+    static LARGE_INTEGER frequency;
+    if ( frequency.QuadPart == 0 )
+        QueryPerformanceFrequency( &frequency );
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter( &counter );
+    return ( (double) counter.QuadPart ) / ( (double) frequency.QuadPart );
+#else
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ( (double) ts.tv_nsec ) / 1000000000.0;
+#endif
+}
+
+static uint64_t bench_num_allocations = 0;
+
+void * bench_allocate_function( void * context, uint64_t bytes )
+{
+    (void) context;
+    bench_num_allocations++;
+    return malloc( bytes );
+}
+
+void bench_free_function( void * context, void * pointer )
+{
+    (void) context;
+    free( pointer );
+}
+
+volatile uint64_t bench_sink;
+
+// ---------------------------------------------------------------
+
+struct bench_state_t
+{
+    struct reliable_endpoint_t * sender;
+    struct reliable_endpoint_t * receiver;
+    struct reliable_sequence_buffer_t * sequence_buffer;
+    uint16_t sequence;
+    uint8_t packet_data[BENCH_PACKET_BYTES_FRAGMENTED];
+    double time;
+    struct reliable_network_simulator_t * network_simulator;
+    struct reliable_endpoint_t ** endpoints;
+    uint64_t payload_bytes_received;
+};
+
+static struct bench_state_t bench;
+
+void bench_transmit_packet_function( void * context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) sequence;
+    if ( index == 0 )
+        reliable_endpoint_receive_packet( bench.receiver, packet_data, packet_bytes );
+    else
+        reliable_endpoint_receive_packet( bench.sender, packet_data, packet_bytes );
+}
+
+void bench_discard_packet_function( void * context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) index;
+    (void) sequence;
+    bench_sink += packet_data[0] + packet_bytes;
+}
+
+int bench_process_packet_function( void * context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) index;
+    (void) sequence;
+    bench_sink += packet_data[0] + packet_bytes;
+    return 1;
+}
+
+void bench_create_endpoints( int fragment_above, void (*transmit_packet_function)(void*,int,uint16_t,uint8_t*,int) )
+{
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.fragment_above = fragment_above;
+    config.transmit_packet_function = transmit_packet_function;
+    config.process_packet_function = &bench_process_packet_function;
+    config.allocate_function = &bench_allocate_function;
+    config.free_function = &bench_free_function;
+
+    bench.time = 100.0;
+    config.index = 0;
+    bench.sender = reliable_endpoint_create( &config, bench.time );
+    config.index = 1;
+    bench.receiver = reliable_endpoint_create( &config, bench.time );
+}
+
+void bench_destroy_endpoints()
+{
+    reliable_endpoint_destroy( bench.sender );
+    reliable_endpoint_destroy( bench.receiver );
+    bench.sender = NULL;
+    bench.receiver = NULL;
+}
+
+// ---------------------------------------------------------------
+
+void bench_packet_header_setup()
+{
+}
+
+void bench_packet_header_teardown()
+{
+}
+
+void bench_packet_header_run( int iterations )
+{
+    uint8_t packet_data[RELIABLE_MAX_PACKET_HEADER_BYTES];
+    int i;
+    for ( i = 0; i < iterations; ++i )
+    {
+        uint16_t write_sequence = (uint16_t) i;
+        uint16_t write_ack = (uint16_t) ( i - 1 - ( i & 7 ) );
+        uint32_t write_ack_bits = 0xFFFFFFFF ^ ( 1U << ( i & 31 ) );
+        int bytes_written = reliable_write_packet_header( packet_data, write_sequence, write_ack, write_ack_bits );
+        uint16_t sequence, ack;
+        uint32_t ack_bits;
+        int bytes_read = reliable_read_packet_header( "bench", packet_data, bytes_written, &sequence, &ack, &ack_bits );
+        bench_sink += bytes_read + sequence + ack + ack_bits;
+    }
+}
+
+void bench_sequence_buffer_setup()
+{
+    bench.sequence = 0;
+    bench.sequence_buffer = reliable_sequence_buffer_create( 256, sizeof( struct reliable_sent_packet_data_t ), NULL, &bench_allocate_function, &bench_free_function );
+}
+
+void bench_sequence_buffer_teardown()
+{
+    reliable_sequence_buffer_destroy( bench.sequence_buffer );
+    bench.sequence_buffer = NULL;
+}
+
+void bench_sequence_buffer_insert_run( int iterations )
+{
+    int i;
+    for ( i = 0; i < iterations; ++i )
+    {
+        struct reliable_sent_packet_data_t * entry = (struct reliable_sent_packet_data_t*) reliable_sequence_buffer_insert( bench.sequence_buffer, bench.sequence++ );
+        entry->time = (double) i;
+    }
+}
+
+void bench_sequence_buffer_find_run( int iterations )
+{
+    int i;
+    for ( i = 0; i < iterations; ++i )
+    {
+        uint16_t sequence = (uint16_t) ( bench.sequence_buffer->sequence - 1 - ( i & 255 ) );
+        bench_sink += reliable_sequence_buffer_find( bench.sequence_buffer, sequence ) != NULL;
+    }
+}
+
+void bench_sequence_buffer_find_setup()
+{
+    bench_sequence_buffer_setup();
+    bench_sequence_buffer_insert_run( 1000 );
+}
+
+void bench_generate_ack_bits_run( int iterations )
+{
+    int i;
+    for ( i = 0; i < iterations; ++i )
+    {
+        uint16_t ack;
+        uint32_t ack_bits;
+        reliable_sequence_buffer_generate_ack_bits( bench.sequence_buffer, &ack, &ack_bits );
+        bench_sink += ack + ack_bits;
+    }
+}
+
+void bench_send_small_setup()
+{
+    bench_create_endpoints( 1024, &bench_discard_packet_function );
+}
+
+void bench_send_receive_small_setup()
+{
+    bench_create_endpoints( 1024, &bench_transmit_packet_function );
+}
+
+void bench_send_receive_fragmented_setup()
+{
+    bench_create_endpoints( 1024, &bench_transmit_packet_function );
+}
+
+void bench_send_small_run( int iterations )
+{
+    int i;
+    for ( i = 0; i < iterations; ++i )
+    {
+        reliable_endpoint_send_packet( bench.sender, bench.packet_data, BENCH_PACKET_BYTES_SMALL );
+        reliable_endpoint_clear_acks( bench.sender );
+    }
+}
+
+void bench_send_receive_small_run( int iterations )
+{
+    int i;
+    for ( i = 0; i < iterations; ++i )
+    {
+        reliable_endpoint_send_packet( bench.sender, bench.packet_data, BENCH_PACKET_BYTES_SMALL );
+        reliable_endpoint_send_packet( bench.receiver, bench.packet_data, BENCH_PACKET_BYTES_SMALL );
+        reliable_endpoint_clear_acks( bench.sender );
+        reliable_endpoint_clear_acks( bench.receiver );
+    }
+}
+
+void bench_send_receive_fragmented_run( int iterations )
+{
+    int i;
+    for ( i = 0; i < iterations; ++i )
+    {
+        reliable_endpoint_send_packet( bench.sender, bench.packet_data, BENCH_PACKET_BYTES_FRAGMENTED );
+        reliable_endpoint_clear_acks( bench.receiver );
+    }
+}
+
+void bench_endpoint_update_setup()
+{
+    bench_create_endpoints( 1024, &bench_transmit_packet_function );
+    bench_send_receive_small_run( 1000 );
+}
+
+void bench_endpoint_update_run( int iterations )
+{
+    int i;
+    for ( i = 0; i < iterations; ++i )
+    {
+        bench.time += 0.01;
+        reliable_endpoint_update( bench.sender, bench.time );
+    }
+}
+
+// pairs of endpoints talking through the network simulator. one op is a 10ms tick of every pair, so ns_per_op under 10ms is faster than real time
+
+void bench_simulated_transmit_packet_function( void * context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) sequence;
+    reliable_network_simulator_send_packet( bench.network_simulator, index, index ^ 1, packet_data, packet_bytes );
+}
+
+void bench_simulated_deliver_packet_function( void * context, int from, int to, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) from;
+    reliable_endpoint_receive_packet( bench.endpoints[to], packet_data, packet_bytes );
+}
+
+void bench_simulated_pairs_setup()
+{
+    bench.time = 100.0;
+
+    struct reliable_network_simulator_config_t network_simulator_config;
+    reliable_network_simulator_default_config( &network_simulator_config );
+    network_simulator_config.max_endpoints = BENCH_SIMULATED_PAIRS * 2;
+    network_simulator_config.max_packets = BENCH_SIMULATED_PAIRS * 64;
+    network_simulator_config.link.latency = 0.05f;
+    network_simulator_config.link.jitter = 0.01f;
+    network_simulator_config.link.packet_loss = 1.0f;
+    network_simulator_config.link.duplicate = 0.5f;
+    network_simulator_config.link.reorder = 0.5f;
+    network_simulator_config.link.bandwidth_kbps = 1000.0f;
+    network_simulator_config.deliver_packet_function = &bench_simulated_deliver_packet_function;
+    bench.network_simulator = reliable_network_simulator_create( &network_simulator_config, bench.time );
+
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.transmit_packet_function = &bench_simulated_transmit_packet_function;
+    config.process_packet_function = &bench_process_packet_function;
+
+    bench.endpoints = (struct reliable_endpoint_t**) malloc( BENCH_SIMULATED_PAIRS * 2 * sizeof( struct reliable_endpoint_t* ) );
+
+    int i;
+    for ( i = 0; i < BENCH_SIMULATED_PAIRS * 2; ++i )
+    {
+        config.index = i;
+        bench.endpoints[i] = reliable_endpoint_create( &config, bench.time );
+    }
+}
+
+void bench_simulated_pairs_run( int iterations )
+{
+    int i, j;
+    for ( i = 0; i < iterations; ++i )
+    {
+        for ( j = 0; j < BENCH_SIMULATED_PAIRS * 2; ++j )
+        {
+            reliable_endpoint_send_packet( bench.endpoints[j], bench.packet_data, BENCH_PACKET_BYTES_SMALL );
+        }
+
+        bench.time += BENCH_SIMULATED_TICK;
+
+        reliable_network_simulator_update( bench.network_simulator, bench.time );
+
+        for ( j = 0; j < BENCH_SIMULATED_PAIRS * 2; ++j )
+        {
+            reliable_endpoint_update( bench.endpoints[j], bench.time );
+            reliable_endpoint_clear_acks( bench.endpoints[j] );
+        }
+    }
+}
+
+void bench_simulated_pairs_teardown()
+{
+    int i;
+    for ( i = 0; i < BENCH_SIMULATED_PAIRS * 2; ++i )
+    {
+        reliable_endpoint_destroy( bench.endpoints[i] );
+    }
+    free( bench.endpoints );
+    bench.endpoints = NULL;
+    reliable_network_simulator_destroy( bench.network_simulator );
+    bench.network_simulator = NULL;
+}
+
+// ---------------------------------------------------------------
+
+struct bench_scenario_t
+{
+    const char * name;
+    int packets_per_op;
+    void (*setup_function)();
+    void (*run_function)(int);
+    void (*teardown_function)();
+};
+
+static struct bench_scenario_t bench_scenarios[] = 
+{
+    { "packet_header_write_read",       0, bench_packet_header_setup,               bench_packet_header_run,                bench_packet_header_teardown },
+    { "sequence_buffer_insert",         0, bench_sequence_buffer_setup,             bench_sequence_buffer_insert_run,       bench_sequence_buffer_teardown },
+    { "sequence_buffer_find",           0, bench_sequence_buffer_find_setup,        bench_sequence_buffer_find_run,         bench_sequence_buffer_teardown },
+    { "sequence_buffer_ack_bits",       0, bench_sequence_buffer_find_setup,        bench_generate_ack_bits_run,            bench_sequence_buffer_teardown },
+    { "send_small",                     1, bench_send_small_setup,                  bench_send_small_run,                   bench_destroy_endpoints },
+    { "send_receive_small",             2, bench_send_receive_small_setup,          bench_send_receive_small_run,           bench_destroy_endpoints },
+    { "send_receive_fragmented",        1, bench_send_receive_fragmented_setup,     bench_send_receive_fragmented_run,      bench_destroy_endpoints },
+    { "endpoint_update",                0, bench_endpoint_update_setup,             bench_endpoint_update_run,              bench_destroy_endpoints },
+    { "simulated_pairs",                BENCH_SIMULATED_PAIRS * 2, bench_simulated_pairs_setup, bench_simulated_pairs_run,  bench_simulated_pairs_teardown },
+};
+
+#define BENCH_NUM_SCENARIOS ( (int) ( sizeof( bench_scenarios ) / sizeof( bench_scenarios[0] ) ) )
+
+void bench_run_scenario( struct bench_scenario_t * scenario, double min_time, int first )
+{
+    scenario->setup_function();
+
+    // warm up, then double the iteration count until a single timed run is long enough to trust
+
+    scenario->run_function( 100 );
+
+    int iterations = 1000;
+    double elapsed = 0.0;
+    uint64_t num_allocations = 0;
+    while ( 1 )
+    {
+        uint64_t allocations_before = bench_num_allocations;
+        double start_time = bench_time();
+        scenario->run_function( iterations );
+        elapsed = bench_time() - start_time;
+        num_allocations = bench_num_allocations - allocations_before;
+        if ( elapsed >= min_time || iterations >= ( 1 << 28 ) )
+            break;
+        iterations *= 2;
+    }
+
+    scenario->teardown_function();
+
+    double ns_per_op = elapsed * 1000000000.0 / iterations;
+
+    printf( "%s    {\n", first ? "" : ",\n" );
+    printf( "      \"name\": \"%s\",\n", scenario->name );
+    printf( "      \"iterations\": %d,\n", iterations );
+    printf( "      \"ns_per_op\": %.2f,\n", ns_per_op );
+    printf( "      \"ops_per_sec\": %.0f,\n", iterations / elapsed );
+    if ( scenario->packets_per_op > 0 )
+    {
+        printf( "      \"packets_per_sec\": %.0f,\n", iterations * scenario->packets_per_op / elapsed );
+    }
+    printf( "      \"allocations_per_op\": %.3f\n", ( (double) num_allocations ) / iterations );
+    printf( "    }" );
+    fflush( stdout );
+}
+
+// ---------------------------------------------------------------
+
+// one sender saturating a bottleneck through the network simulator, once per congestion controller. the sender sends whatever the
+// controller allows every millisecond, or a fixed 8mbps with no controller. results are measured over the second half of the run.
+// the sent packets buffer is widened so the uncontrolled sender still gets acks back through a full bottleneck queue
+
+struct bench_congestion_controller_t
+{
+    const char * name;
+    void (*control_function)(struct reliable_congestion_control_t*);
+};
+
+static struct bench_congestion_controller_t bench_congestion_controllers[] = 
+{
+    { "congestion_none",                NULL },
+    { "congestion_aimd",                reliable_congestion_control_aimd },
+    { "congestion_delay",               reliable_congestion_control_delay },
+};
+
+#define BENCH_NUM_CONGESTION_CONTROLLERS ( (int) ( sizeof( bench_congestion_controllers ) / sizeof( bench_congestion_controllers[0] ) ) )
+
+int bench_congestion_process_packet_function( void * context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) sequence;
+    (void) packet_data;
+    if ( index == 1 )
+        bench.payload_bytes_received += packet_bytes;
+    return 1;
+}
+
+void bench_run_congestion_controller( struct bench_congestion_controller_t * controller, int first )
+{
+    bench.time = 100.0;
+    bench.payload_bytes_received = 0;
+
+    struct reliable_network_simulator_config_t network_simulator_config;
+    reliable_network_simulator_default_config( &network_simulator_config );
+    network_simulator_config.link.latency = BENCH_CONGESTION_LATENCY;
+    network_simulator_config.deliver_packet_function = &bench_simulated_deliver_packet_function;
+    bench.network_simulator = reliable_network_simulator_create( &network_simulator_config, bench.time );
+
+    struct reliable_network_simulator_link_t link = network_simulator_config.link;
+    link.bandwidth_kbps = BENCH_CONGESTION_BANDWIDTH_KBPS;
+    link.max_queue_delay = BENCH_CONGESTION_MAX_QUEUE_DELAY;
+    reliable_network_simulator_set_link( bench.network_simulator, 0, &link );
+
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.transmit_packet_function = &bench_simulated_transmit_packet_function;
+    config.process_packet_function = &bench_congestion_process_packet_function;
+    config.sent_packets_buffer_size = 1024;
+    config.received_packets_buffer_size = 1024;
+
+    bench.endpoints = (struct reliable_endpoint_t**) malloc( 2 * sizeof( struct reliable_endpoint_t* ) );
+    config.index = 1;
+    bench.endpoints[1] = reliable_endpoint_create( &config, bench.time );
+    config.index = 0;
+    if ( controller->control_function )
+        controller->control_function( &config.congestion_control );
+    bench.endpoints[0] = reliable_endpoint_create( &config, bench.time );
+
+    const int num_ticks = (int) ( BENCH_CONGESTION_SECONDS / BENCH_CONGESTION_TICK );
+    double rtt_sum = 0.0;
+    float max_rtt = 0.0f;
+    int num_rtt_samples = 0;
+    struct reliable_network_simulator_stats_t stats_before;
+    memset( &stats_before, 0, sizeof( stats_before ) );
+
+    int i, j;
+    for ( i = 0; i < num_ticks; ++i )
+    {
+        if ( i == num_ticks / 2 )
+        {
+            bench.payload_bytes_received = 0;
+            reliable_network_simulator_stats( bench.network_simulator, &stats_before );
+        }
+
+        if ( controller->control_function )
+        {
+            for ( j = 0; j < 8 && reliable_endpoint_can_send( bench.endpoints[0], BENCH_CONGESTION_PACKET_BYTES ); ++j )
+                reliable_endpoint_send_packet( bench.endpoints[0], bench.packet_data, BENCH_CONGESTION_PACKET_BYTES );
+        }
+        else
+        {
+            reliable_endpoint_send_packet( bench.endpoints[0], bench.packet_data, BENCH_CONGESTION_PACKET_BYTES );
+        }
+
+        reliable_endpoint_send_packet( bench.endpoints[1], bench.packet_data, BENCH_PACKET_BYTES_SMALL );
+
+        bench.time += BENCH_CONGESTION_TICK;
+
+        reliable_network_simulator_update( bench.network_simulator, bench.time );
+        reliable_endpoint_update( bench.endpoints[0], bench.time );
+        reliable_endpoint_update( bench.endpoints[1], bench.time );
+
+        int num_acks;
+        struct reliable_ack_t * acks = reliable_endpoint_get_ack_records( bench.endpoints[0], &num_acks );
+        if ( i >= num_ticks / 2 )
+        {
+            for ( j = 0; j < num_acks; ++j )
+            {
+                rtt_sum += acks[j].rtt;
+                if ( acks[j].rtt > max_rtt )
+                    max_rtt = acks[j].rtt;
+            }
+            num_rtt_samples += num_acks;
+        }
+        reliable_endpoint_clear_acks( bench.endpoints[0] );
+        reliable_endpoint_clear_acks( bench.endpoints[1] );
+    }
+
+    struct reliable_network_simulator_stats_t stats;
+    reliable_network_simulator_stats( bench.network_simulator, &stats );
+
+    struct reliable_congestion_state_t congestion;
+    reliable_endpoint_congestion( bench.endpoints[0], &congestion );
+
+    double measured_seconds = BENCH_CONGESTION_SECONDS * 0.5;
+    double base_rtt = BENCH_CONGESTION_LATENCY * 2.0 * 1000.0;
+    uint64_t num_sent = stats.num_packets_sent - stats_before.num_packets_sent;
+    uint64_t num_dropped = stats.num_packets_dropped - stats_before.num_packets_dropped;
+
+    printf( "%s    {\n", first ? "" : ",\n" );
+    printf( "      \"name\": \"%s\",\n", controller->name );
+    printf( "      \"bottleneck_kbps\": %.0f,\n", BENCH_CONGESTION_BANDWIDTH_KBPS );
+    printf( "      \"goodput_kbps\": %.1f,\n", bench.payload_bytes_received * 8.0 / measured_seconds / 1000.0 );
+    printf( "      \"average_queueing_delay_ms\": %.1f,\n", num_rtt_samples > 0 ? rtt_sum / num_rtt_samples - base_rtt : 0.0 );
+    printf( "      \"max_queueing_delay_ms\": %.1f,\n", num_rtt_samples > 0 ? max_rtt - base_rtt : 0.0 );
+    printf( "      \"dropped_percent\": %.2f,\n", num_sent > 0 ? num_dropped * 100.0 / num_sent : 0.0 );
+    printf( "      \"congestion_window\": %d,\n", congestion.congestion_window );
+    printf( "      \"send_rate_kbps\": %.1f\n", congestion.send_rate_kbps );
+    printf( "    }" );
+    fflush( stdout );
+
+    reliable_endpoint_destroy( bench.endpoints[0] );
+    reliable_endpoint_destroy( bench.endpoints[1] );
+    free( bench.endpoints );
+    bench.endpoints = NULL;
+    reliable_network_simulator_destroy( bench.network_simulator );
+    bench.network_simulator = NULL;
+}
+
+// ---------------------------------------------------------------
+
+// steady state allocation budgets. these only ever go down: lower them as allocations are removed from the send and receive paths
+
+struct bench_allocation_budget_t
+{
+    const char * name;
+    int packet_bytes;
+    double sent_budget;
+    double received_budget;
+};
+
+static struct bench_allocation_budget_t bench_allocation_budgets[] = 
+{
+    { "allocations_small",              BENCH_PACKET_BYTES_SMALL,                   1.0,            0.0 },
+    { "allocations_fragmented",         BENCH_PACKET_BYTES_FRAGMENTED,              1.0,            1.0 },
+};
+
+#define BENCH_NUM_ALLOCATION_BUDGETS ( (int) ( sizeof( bench_allocation_budgets ) / sizeof( bench_allocation_budgets[0] ) ) )
+
+#define BENCH_ALLOCATION_PACKETS 1000
+
+int bench_check_allocation_budget( struct bench_allocation_budget_t * budget, int first )
+{
+    bench_create_endpoints( 1024, &bench_transmit_packet_function );
+
+    int i;
+    for ( i = 0; i < 100; ++i )
+    {
+        reliable_endpoint_send_packet( bench.sender, bench.packet_data, budget->packet_bytes );
+        reliable_endpoint_update( bench.sender, bench.time );
+        reliable_endpoint_update( bench.receiver, bench.time );
+        bench.time += 0.01;
+    }
+
+    struct reliable_allocation_stats_t sender_before, receiver_before;
+    reliable_endpoint_allocation_stats( bench.sender, &sender_before );
+    reliable_endpoint_allocation_stats( bench.receiver, &receiver_before );
+
+    for ( i = 0; i < BENCH_ALLOCATION_PACKETS; ++i )
+    {
+        reliable_endpoint_send_packet( bench.sender, bench.packet_data, budget->packet_bytes );
+        reliable_endpoint_update( bench.sender, bench.time );
+        reliable_endpoint_update( bench.receiver, bench.time );
+        bench.time += 0.01;
+    }
+
+    struct reliable_allocation_stats_t sender_after, receiver_after;
+    reliable_endpoint_allocation_stats( bench.sender, &sender_after );
+    reliable_endpoint_allocation_stats( bench.receiver, &receiver_after );
+
+    RELIABLE_CONST uint64_t * counters = reliable_endpoint_counters( bench.receiver );
+    uint64_t num_received = counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED];
+
+    bench_destroy_endpoints();
+
+    double sent_allocations = ( (double) ( sender_after.num_allocations - sender_before.num_allocations ) ) / BENCH_ALLOCATION_PACKETS;
+    double received_allocations = ( (double) ( receiver_after.num_allocations - receiver_before.num_allocations ) ) / BENCH_ALLOCATION_PACKETS;
+    double sent_bytes = ( (double) ( sender_after.bytes_allocated - sender_before.bytes_allocated ) ) / BENCH_ALLOCATION_PACKETS;
+    double received_bytes = ( (double) ( receiver_after.bytes_allocated - receiver_before.bytes_allocated ) ) / BENCH_ALLOCATION_PACKETS;
+
+    int ok = num_received > 0 && sent_allocations <= budget->sent_budget && received_allocations <= budget->received_budget;
+
+    printf( "%s    {\n", first ? "" : ",\n" );
+    printf( "      \"name\": \"%s\",\n", budget->name );
+    printf( "      \"allocations_per_packet_sent\": %.3f,\n", sent_allocations );
+    printf( "      \"allocations_per_packet_received\": %.3f,\n", received_allocations );
+    printf( "      \"bytes_allocated_per_packet_sent\": %.1f,\n", sent_bytes );
+    printf( "      \"bytes_allocated_per_packet_received\": %.1f,\n", received_bytes );
+    printf( "      \"peak_live_bytes\": %" PRIu64 ",\n", sender_after.peak_live_bytes + receiver_after.peak_live_bytes );
+    printf( "      \"sent_budget\": %.3f,\n", budget->sent_budget );
+    printf( "      \"received_budget\": %.3f,\n", budget->received_budget );
+    printf( "      \"ok\": %s\n", ok ? "true" : "false" );
+    printf( "    }" );
+    fflush( stdout );
+
+    return ok;
+}
+
+int main( int argc, char ** argv )
+{
+    const char * filter = NULL;
+    double min_time = BENCH_MIN_TIME;
+
+    if ( argc >= 2 )
+        filter = argv[1];
+
+    if ( argc >= 3 )
+        min_time = atof( argv[2] );
+
+    reliable_init();
+
+    memset( &bench, 0, sizeof( bench ) );
+
+    printf( "{\n  \"benchmarks\": [\n" );
+
+    int first = 1;
+    int i;
+    for ( i = 0; i < BENCH_NUM_SCENARIOS; ++i )
+    {
+        if ( filter && strstr( bench_scenarios[i].name, filter ) == NULL )
+            continue;
+        bench_run_scenario( &bench_scenarios[i], min_time, first );
+        first = 0;
+    }
+
+    printf( "\n  ],\n  \"congestion_control\": [\n" );
+
+    first = 1;
+    for ( i = 0; i < BENCH_NUM_CONGESTION_CONTROLLERS; ++i )
+    {
+        if ( filter && strstr( bench_congestion_controllers[i].name, filter ) == NULL )
+            continue;
+        bench_run_congestion_controller( &bench_congestion_controllers[i], first );
+        first = 0;
+    }
+
+    printf( "\n  ],\n  \"allocation_budgets\": [\n" );
+
+    int all_ok = 1;
+    first = 1;
+    for ( i = 0; i < BENCH_NUM_ALLOCATION_BUDGETS; ++i )
+    {
+        if ( filter && strstr( bench_allocation_budgets[i].name, filter ) == NULL )
+            continue;
+        if ( !bench_check_allocation_budget( &bench_allocation_budgets[i], first ) )
+            all_ok = 0;
+        first = 0;
+    }
+
+    printf( "\n  ]\n}\n" );
+
+    reliable_term();
+
+    if ( !all_ok )
+    {
+        fprintf( stderr, "error: steady state allocations exceeded budget\n" );
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,356 @@
+/*
+    reliable.io reference implementation
+
+    Copyright © 2017, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "reliable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define NUM_ENDPOINTS 16
+#define RING_CAPACITY ( 256 * 1024 )
+#define PACKET_BYTES 64
+#define MAX_SAMPLES ( 1024 * 1024 )
+#define MAX_RECORD_BYTES 4096
+
+#define MODE_MUTEX 0
+#define MODE_HANDOFF 1
+
+double time_now()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ( (double) ts.tv_nsec ) / 1000000000.0;
+}
+
+struct connection_t
+{
+    struct reliable_endpoint_t * client;            // remote peer, driven by the network thread
+    struct reliable_endpoint_t * server;            // simulation side endpoint
+    struct reliable_ring_t * receive_ring;          // network thread -> simulation thread
+    struct reliable_ring_t * send_ring;             // simulation thread -> network thread
+};
+
+struct benchmark_t
+{
+    int mode;
+    volatile int quit;
+    pthread_mutex_t mutex;
+    struct connection_t connections[NUM_ENDPOINTS];
+    double * samples;
+    int num_samples;
+    uint64_t num_sent;
+    uint64_t num_acks;
+};
+
+static struct benchmark_t benchmark;
+
+// mutex mode moves datagrams through the same rings as handoff, but takes one shared lock around every push and pop, the way a
+// locked queue between the threads would. the only difference between the two modes is the lock
+
+void locked_push( struct reliable_ring_t * ring, int type, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    pthread_mutex_lock( &benchmark.mutex );
+    reliable_ring_push( ring, type, sequence, packet_data, packet_bytes );
+    pthread_mutex_unlock( &benchmark.mutex );
+}
+
+int locked_pop( struct reliable_ring_t * ring, int * type, uint8_t * buffer )
+{
+    pthread_mutex_lock( &benchmark.mutex );
+    int packet_bytes = 0;
+    uint8_t * packet_data = reliable_ring_peek( ring, type, NULL, &packet_bytes );
+    if ( packet_data )
+    {
+        assert( packet_bytes <= MAX_RECORD_BYTES );
+        memcpy( buffer, packet_data, packet_bytes );
+        reliable_ring_pop( ring );
+    }
+    pthread_mutex_unlock( &benchmark.mutex );
+    return packet_data ? packet_bytes : -1;
+}
+
+void client_transmit_packet_function( void * context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    locked_push( benchmark.connections[index].receive_ring, RELIABLE_RING_RECORD_PACKET, sequence, packet_data, packet_bytes );
+}
+
+void server_transmit_packet_function( void * context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    locked_push( benchmark.connections[index].send_ring, RELIABLE_RING_RECORD_PACKET, sequence, packet_data, packet_bytes );
+}
+
+int client_process_packet_function( void * context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) index;
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+    return 1;
+}
+
+int server_process_packet_function( void * context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) index;
+    (void) sequence;
+
+    assert( packet_bytes == PACKET_BYTES );
+    (void) packet_bytes;
+
+    double send_time;
+    memcpy( &send_time, packet_data, sizeof( double ) );
+
+    if ( benchmark.num_samples < MAX_SAMPLES )
+    {
+        benchmark.samples[benchmark.num_samples++] = ( time_now() - send_time ) * 1000000.0;
+    }
+
+    return 1;
+}
+
+void network_send( int index, double send_time )
+{
+    uint8_t packet_data[PACKET_BYTES];
+    memset( packet_data, 0, sizeof( packet_data ) );
+    memcpy( packet_data, &send_time, sizeof( double ) );
+    reliable_endpoint_send_packet( benchmark.connections[index].client, packet_data, PACKET_BYTES );
+    benchmark.num_sent++;
+}
+
+void * network_thread_function( void * data )
+{
+    (void) data;
+
+    while ( !benchmark.quit )
+    {
+        int i;
+        for ( i = 0; i < NUM_ENDPOINTS; ++i )
+        {
+            struct connection_t * connection = &benchmark.connections[i];
+
+            // the timestamp is taken when the datagram is in hand, so time spent waiting for the lock counts as latency
+
+            double send_time = time_now();
+
+            network_send( i, send_time );
+
+            while ( 1 )
+            {
+                int type;
+                int packet_bytes;
+                uint8_t * packet_data;
+                uint8_t buffer[MAX_RECORD_BYTES];
+                if ( benchmark.mode == MODE_MUTEX )
+                {
+                    packet_bytes = locked_pop( connection->send_ring, &type, buffer );
+                    packet_data = ( packet_bytes >= 0 ) ? buffer : NULL;
+                }
+                else
+                {
+                    packet_data = reliable_ring_peek( connection->send_ring, &type, NULL, &packet_bytes );
+                }
+                if ( !packet_data )
+                    break;
+                if ( type == RELIABLE_RING_RECORD_PACKET )
+                {
+                    reliable_endpoint_receive_packet( connection->client, packet_data, packet_bytes );
+                }
+                else if ( type == RELIABLE_RING_RECORD_ACKS )
+                {
+                    benchmark.num_acks += packet_bytes / 2;
+                }
+                if ( benchmark.mode == MODE_HANDOFF )
+                {
+                    reliable_ring_pop( connection->send_ring );
+                }
+            }
+        }
+
+        sched_yield();
+    }
+
+    return NULL;
+}
+
+void simulation_receive( struct connection_t * connection )
+{
+    if ( benchmark.mode == MODE_HANDOFF )
+    {
+        reliable_endpoint_receive_packets_from_ring( connection->server, connection->receive_ring, 0 );
+        return;
+    }
+
+    while ( 1 )
+    {
+        int type;
+        uint8_t buffer[MAX_RECORD_BYTES];
+        int packet_bytes = locked_pop( connection->receive_ring, &type, buffer );
+        if ( packet_bytes < 0 )
+            break;
+        if ( type == RELIABLE_RING_RECORD_PACKET )
+        {
+            reliable_endpoint_receive_packet( connection->server, buffer, packet_bytes );
+        }
+    }
+}
+
+void simulation_tick( double time )
+{
+    uint8_t packet_data[PACKET_BYTES];
+    memset( packet_data, 0, sizeof( packet_data ) );
+
+    int i;
+    for ( i = 0; i < NUM_ENDPOINTS; ++i )
+    {
+        struct connection_t * connection = &benchmark.connections[i];
+
+        simulation_receive( connection );
+        reliable_endpoint_send_packet( connection->server, packet_data, PACKET_BYTES );
+        reliable_endpoint_update( connection->server, time );
+
+        if ( benchmark.mode == MODE_MUTEX )
+        {
+            pthread_mutex_lock( &benchmark.mutex );
+            reliable_endpoint_publish_acks( connection->server, connection->send_ring );
+            pthread_mutex_unlock( &benchmark.mutex );
+        }
+        else
+        {
+            reliable_endpoint_publish_acks( connection->server, connection->send_ring );
+        }
+    }
+}
+
+int compare_doubles( const void * a, const void * b )
+{
+    double x = *(const double*) a;
+    double y = *(const double*) b;
+    return ( x > y ) - ( x < y );
+}
+
+void run_benchmark( int mode, double duration )
+{
+    memset( &benchmark, 0, sizeof( benchmark ) );
+    benchmark.mode = mode;
+    benchmark.samples = (double*) malloc( MAX_SAMPLES * sizeof( double ) );
+    pthread_mutex_init( &benchmark.mutex, NULL );
+
+    double time = 100.0;
+
+    int i;
+    for ( i = 0; i < NUM_ENDPOINTS; ++i )
+    {
+        struct connection_t * connection = &benchmark.connections[i];
+
+        struct reliable_config_t config;
+        reliable_default_config( &config );
+        config.index = i;
+
+        connection->receive_ring = reliable_ring_init( malloc( reliable_ring_bytes( RING_CAPACITY ) ), RING_CAPACITY );
+        connection->send_ring = reliable_ring_init( malloc( reliable_ring_bytes( RING_CAPACITY ) ), RING_CAPACITY );
+
+        config.transmit_packet_function = &client_transmit_packet_function;
+        config.transmit_ring = ( mode == MODE_HANDOFF ) ? connection->receive_ring : NULL;
+        config.process_packet_function = &client_process_packet_function;
+        connection->client = reliable_endpoint_create( &config, time );
+
+        config.transmit_packet_function = &server_transmit_packet_function;
+        config.transmit_ring = ( mode == MODE_HANDOFF ) ? connection->send_ring : NULL;
+        config.process_packet_function = &server_process_packet_function;
+        connection->server = reliable_endpoint_create( &config, time );
+    }
+
+    pthread_t network_thread;
+    pthread_create( &network_thread, NULL, network_thread_function, NULL );
+
+    double start_time = time_now();
+    int num_ticks = 0;
+    while ( time_now() - start_time < duration )
+    {
+        simulation_tick( time + ( time_now() - start_time ) );
+        num_ticks++;
+        sched_yield();
+    }
+
+    benchmark.quit = 1;
+    pthread_join( network_thread, NULL );
+
+    // drain whatever is still in flight so every sample is accounted for
+
+    for ( i = 0; i < NUM_ENDPOINTS; ++i )
+    {
+        simulation_receive( &benchmark.connections[i] );
+    }
+
+    const char * name = ( mode == MODE_MUTEX ) ? "mutex" : "handoff";
+
+    int n = benchmark.num_samples;
+    if ( n > 0 )
+    {
+        qsort( benchmark.samples, n, sizeof( double ), compare_doubles );
+        printf( "%s: %d ticks | %" PRIu64 " sent | %d received | %" PRIu64 " acks | latency p50 = %.2fus | p90 = %.2fus | p99 = %.2fus | p99.9 = %.2fus | max = %.2fus\n",
+            name, num_ticks, benchmark.num_sent, n, benchmark.num_acks,
+            benchmark.samples[n/2], benchmark.samples[(int)(n*0.9)], benchmark.samples[(int)(n*0.99)], benchmark.samples[(int)(n*0.999)], benchmark.samples[n-1] );
+    }
+
+    for ( i = 0; i < NUM_ENDPOINTS; ++i )
+    {
+        struct connection_t * connection = &benchmark.connections[i];
+        reliable_endpoint_destroy( connection->client );
+        reliable_endpoint_destroy( connection->server );
+        free( connection->receive_ring );
+        free( connection->send_ring );
+    }
+
+    pthread_mutex_destroy( &benchmark.mutex );
+    free( benchmark.samples );
+}
+
+int main( int argc, char ** argv )
+{
+    double duration = 1.0;
+
+    if ( argc == 2 )
+        duration = atof( argv[1] );
+
+    printf( "[handoff]\n" );
+
+    reliable_init();
+
+    run_benchmark( MODE_MUTEX, duration );
+    run_benchmark( MODE_HANDOFF, duration );
+
+    reliable_term();
+
+    return 0;
+}
@@ -0,0 +1,148 @@
+/*
+    reliable.io reference implementation
+
+    Copyright © 2017, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "reliable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// reads the metrics file written by an exporting process (eg. stats <iterations> <file>) and prints it once a second
+
+static volatile int quit = 0;
+
+void interrupt_handler( int signal )
+{
+    (void) signal;
+    quit = 1;
+}
+
+void monitor_print( struct reliable_metrics_header_t * metrics )
+{
+    printf( "%-16s %10s %8s %7s %8s %10s %10s %10s %10s %10s %10s\n", 
+        "endpoint", "time", "rtt", "loss", "jitter", "sent kbps", "recv kbps", "ack kbps", "sent", "received", "acked" );
+
+    int num_in_use = 0;
+    int i;
+    for ( i = 0; i < (int) metrics->max_endpoints; ++i )
+    {
+        char name[RELIABLE_METRICS_NAME_BYTES];
+        struct reliable_endpoint_stats_t stats;
+        int result = reliable_metrics_read( metrics, i, name, &stats );
+        if ( result < 0 )
+        {
+            printf( "record %d is stuck mid-write. its process may have died\n", i );
+            continue;
+        }
+        if ( result == 0 )
+            continue;
+
+        printf( "%-16s %10.2f %6.1fms %6.1f%% %6.1fms %10.1f %10.1f %10.1f %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n", 
+            name, 
+            stats.time, 
+            stats.rtt, 
+            stats.packet_loss, 
+            stats.jitter, 
+            stats.sent_bandwidth_kbps, 
+            stats.received_bandwidth_kbps, 
+            stats.acked_bandwidth_kbps, 
+            stats.counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT], 
+            stats.counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED], 
+            stats.counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_ACKED] );
+
+        num_in_use++;
+    }
+
+    if ( num_in_use == 0 )
+    {
+        printf( "(no endpoints)\n" );
+    }
+
+    printf( "\n" );
+    fflush( stdout );
+}
+
+int main( int argc, char ** argv )
+{
+    if ( argc < 2 )
+    {
+        printf( "usage: monitor <metrics file> [refreshes]\n" );
+        return 1;
+    }
+
+    int num_refreshes = -1;
+    if ( argc >= 3 )
+        num_refreshes = atoi( argv[2] );
+
+    int fd = open( argv[1], O_RDONLY );
+    if ( fd < 0 )
+    {
+        printf( "error: could not open metrics file %s\n", argv[1] );
+        return 1;
+    }
+
+    struct stat file_stat;
+    if ( fstat( fd, &file_stat ) != 0 || file_stat.st_size == 0 )
+    {
+        printf( "error: metrics file %s is empty\n", argv[1] );
+        close( fd );
+        return 1;
+    }
+
+    uint64_t bytes = (uint64_t) file_stat.st_size;
+    void * memory = mmap( NULL, bytes, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( memory == MAP_FAILED )
+    {
+        printf( "error: could not map metrics file %s\n", argv[1] );
+        return 1;
+    }
+
+    struct reliable_metrics_header_t * metrics = reliable_metrics_attach( memory, bytes );
+    if ( !metrics )
+    {
+        printf( "error: %s is not a reliable.io metrics file, or was written by an incompatible version\n", argv[1] );
+        munmap( memory, bytes );
+        return 1;
+    }
+
+    signal( SIGINT, interrupt_handler );
+
+    int i;
+    for ( i = 0; !quit && ( num_refreshes < 0 || i < num_refreshes ); ++i )
+    {
+        if ( i > 0 )
+            sleep( 1 );
+        monitor_print( metrics );
+    }
+
+    munmap( memory, bytes );
+
+    return 0;
+}
@@ -0,0 +1,263 @@
+/*
+    reliable.io reference implementation
+
+    Copyright © 2017, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "reliable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define DEFAULT_NUM_ENDPOINTS 20000
+#define MAX_THREADS 64
+#define NUM_TICKS 20
+#define PACKET_BYTES 64
+
+double time_now()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ( (double) ts.tv_nsec ) / 1000000000.0;
+}
+
+struct thread_pool_t
+{
+    int num_threads;
+    pthread_t threads[MAX_THREADS];
+    pthread_mutex_t mutex;
+    pthread_cond_t work_condition;
+    pthread_cond_t done_condition;
+    uint64_t generation;
+    int num_running;
+    int quit;
+    void (*task_function)(void*);
+    void * task_data;
+};
+
+void * worker_thread_function( void * data )
+{
+    struct thread_pool_t * pool = (struct thread_pool_t*) data;
+    uint64_t generation = 0;
+    while ( 1 )
+    {
+        pthread_mutex_lock( &pool->mutex );
+        while ( pool->generation == generation && !pool->quit )
+        {
+            pthread_cond_wait( &pool->work_condition, &pool->mutex );
+        }
+        if ( pool->quit )
+        {
+            pthread_mutex_unlock( &pool->mutex );
+            break;
+        }
+        generation = pool->generation;
+        pthread_mutex_unlock( &pool->mutex );
+
+        pool->task_function( pool->task_data );
+
+        pthread_mutex_lock( &pool->mutex );
+        if ( --pool->num_running == 0 )
+        {
+            pthread_cond_signal( &pool->done_condition );
+        }
+        pthread_mutex_unlock( &pool->mutex );
+    }
+    return NULL;
+}
+
+void thread_pool_run_function( void * context, void (*task_function)(void*), void * task_data )
+{
+    struct thread_pool_t * pool = (struct thread_pool_t*) context;
+
+    // wake the workers once per call, then the calling thread joins in as the last worker
+
+    pthread_mutex_lock( &pool->mutex );
+    pool->task_function = task_function;
+    pool->task_data = task_data;
+    pool->num_running = pool->num_threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast( &pool->work_condition );
+    pthread_mutex_unlock( &pool->mutex );
+
+    task_function( task_data );
+
+    pthread_mutex_lock( &pool->mutex );
+    while ( pool->num_running > 0 )
+    {
+        pthread_cond_wait( &pool->done_condition, &pool->mutex );
+    }
+    pthread_mutex_unlock( &pool->mutex );
+}
+
+void thread_pool_create( struct thread_pool_t * pool, int num_threads )
+{
+    memset( pool, 0, sizeof( *pool ) );
+    pool->num_threads = num_threads;
+    pthread_mutex_init( &pool->mutex, NULL );
+    pthread_cond_init( &pool->work_condition, NULL );
+    pthread_cond_init( &pool->done_condition, NULL );
+    int i;
+    for ( i = 0; i < num_threads - 1; ++i )
+    {
+        pthread_create( &pool->threads[i], NULL, worker_thread_function, pool );
+    }
+}
+
+void thread_pool_destroy( struct thread_pool_t * pool )
+{
+    pthread_mutex_lock( &pool->mutex );
+    pool->quit = 1;
+    pthread_cond_broadcast( &pool->work_condition );
+    pthread_mutex_unlock( &pool->mutex );
+    int i;
+    for ( i = 0; i < pool->num_threads - 1; ++i )
+    {
+        pthread_join( pool->threads[i], NULL );
+    }
+    pthread_mutex_destroy( &pool->mutex );
+    pthread_cond_destroy( &pool->work_condition );
+    pthread_cond_destroy( &pool->done_condition );
+}
+
+void transmit_packet_function( void * context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    struct reliable_endpoint_t ** endpoints = (struct reliable_endpoint_t**) context;
+    (void) sequence;
+    // endpoints are created in pairs. every other packet is lost so the stats passes have real work to do
+    if ( sequence % 2 )
+        return;
+    reliable_endpoint_receive_packet( endpoints[index^1], packet_data, packet_bytes );
+}
+
+int process_packet_function( void * context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) index;
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+    return 1;
+}
+
+int main( int argc, char ** argv )
+{
+    int num_endpoints = DEFAULT_NUM_ENDPOINTS;
+    int max_threads = (int) sysconf( _SC_NPROCESSORS_ONLN );
+
+    if ( argc >= 2 )
+        num_endpoints = atoi( argv[1] ) & ~1;
+
+    if ( argc >= 3 )
+        max_threads = atoi( argv[2] );
+
+    if ( max_threads < 1 )
+        max_threads = 1;
+
+    if ( max_threads > MAX_THREADS )
+        max_threads = MAX_THREADS;
+
+    printf( "[parallel]\n" );
+
+    reliable_init();
+
+    double time = 100.0;
+
+    struct reliable_endpoint_t ** endpoints = (struct reliable_endpoint_t**) malloc( num_endpoints * sizeof( struct reliable_endpoint_t* ) );
+
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.context = endpoints;
+    config.transmit_packet_function = &transmit_packet_function;
+    config.process_packet_function = &process_packet_function;
+
+    int i;
+    for ( i = 0; i < num_endpoints; ++i )
+    {
+        config.index = i;
+        endpoints[i] = reliable_endpoint_create( &config, time );
+    }
+
+    // fill the sent and received packet windows so update has the same amount of work as a busy server
+
+    uint8_t packet_data[PACKET_BYTES];
+    memset( packet_data, 0, sizeof( packet_data ) );
+
+    int j;
+    for ( j = 0; j < 256; ++j )
+    {
+        for ( i = 0; i < num_endpoints; ++i )
+        {
+            reliable_endpoint_send_packet( endpoints[i], packet_data, PACKET_BYTES );
+        }
+        time += 1.0 / 60.0;
+    }
+
+    printf( "%d endpoints, %d ticks per measurement\n", num_endpoints, NUM_TICKS );
+
+    double baseline = 0.0;
+
+    int num_threads;
+    for ( num_threads = 1; num_threads <= max_threads; ++num_threads )
+    {
+        struct thread_pool_t pool;
+        thread_pool_create( &pool, num_threads );
+
+        struct reliable_thread_pool_t thread_pool;
+        thread_pool.context = &pool;
+        thread_pool.num_threads = num_threads;
+        thread_pool.run_function = &thread_pool_run_function;
+
+        double start_time = time_now();
+        int tick;
+        for ( tick = 0; tick < NUM_TICKS; ++tick )
+        {
+            reliable_update_parallel( endpoints, num_endpoints, time, &thread_pool );
+            time += 1.0 / 60.0;
+        }
+        double tick_time = ( time_now() - start_time ) / NUM_TICKS;
+
+        if ( num_threads == 1 )
+            baseline = tick_time;
+
+        printf( "%2d threads: %.3fms per tick | %.1fns per endpoint | speedup %.2fx\n", 
+            num_threads, tick_time * 1000.0, tick_time * 1000000000.0 / num_endpoints, baseline / tick_time );
+
+        thread_pool_destroy( &pool );
+    }
+
+    for ( i = 0; i < num_endpoints; ++i )
+    {
+        reliable_endpoint_destroy( endpoints[i] );
+    }
+
+    free( endpoints );
+
+    reliable_term();
+
+    return 0;
+}
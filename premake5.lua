@@ -33,6 +33,34 @@ project "stats"
 project "fuzz"
     files { "fuzz.c", "reliable.c" }
 
+project "bench"
+    files { "bench.c" }
+
+project "trace"
+    files { "trace.c", "reliable.c" }
+
+if not os.is "windows" then
+
+    project "shm"
+        files { "shm.c", "reliable.c" }
+        links { "pthread" }
+
+    project "handoff"
+        files { "handoff.c", "reliable.c" }
+        links { "pthread" }
+
+    project "parallel"
+        files { "parallel.c", "reliable.c" }
+        links { "pthread" }
+
+    project "monitor"
+        files { "monitor.c", "reliable.c" }
+
+    project "replay"
+        files { "replay.c", "reliable.c" }
+
+end
+
 if os.is "windows" then
 
     -- Windows
@@ -89,6 +117,18 @@ else
         end
     }
 
+    newaction
+    {
+        trigger     = "scale",
+        description = "Build and run the scale soak with up to 50k endpoint pairs on a virtual clock",
+        execute = function ()
+            os.execute "test ! -e Makefile && premake5 gmake"
+            if os.execute "make -j32 soak config=release_x64" == 0 then
+                os.execute "./bin/soak scale"
+            end
+        end
+    }
+
     newaction
     {
         trigger     = "fuzz",
@@ -101,6 +141,90 @@ else
         end
     }
 
+    newaction
+    {
+        trigger     = "bench",
+        description = "Build and run microbenchmarks",
+        execute = function ()
+            os.execute "test ! -e Makefile && premake5 gmake"
+            if os.execute "make -j32 bench config=release_x64" == 0 then
+                os.execute "./bin/bench"
+            end
+        end
+    }
+
+    newaction
+    {
+        trigger     = "shm",
+        description = "Build and run shared memory transport benchmark",
+        execute = function ()
+            os.execute "test ! -e Makefile && premake5 gmake"
+            if os.execute "make -j32 shm" == 0 then
+                os.execute "./bin/shm"
+            end
+        end
+    }
+
+    newaction
+    {
+        trigger     = "handoff",
+        description = "Build and run network thread to simulation thread handoff benchmark",
+        execute = function ()
+            os.execute "test ! -e Makefile && premake5 gmake"
+            if os.execute "make -j32 handoff" == 0 then
+                os.execute "./bin/handoff"
+            end
+        end
+    }
+
+    newaction
+    {
+        trigger     = "parallel",
+        description = "Build and run parallel endpoint update scaling benchmark",
+        execute = function ()
+            os.execute "test ! -e Makefile && premake5 gmake"
+            if os.execute "make -j32 parallel" == 0 then
+                os.execute "./bin/parallel"
+            end
+        end
+    }
+
+    newaction
+    {
+        trigger     = "monitor",
+        description = "Build and run stats exporting to a metrics file, with the monitor reading it",
+        execute = function ()
+            os.execute "test ! -e Makefile && premake5 gmake"
+            if os.execute "make -j32 stats monitor" == 0 then
+                os.execute "(./bin/stats -1 /tmp/reliable.metrics > /dev/null &) && sleep 1 && ./bin/monitor /tmp/reliable.metrics; pkill -INT -f 'bin/stats -1 /tmp/reliable.metrics'"
+            end
+        end
+    }
+
+    newaction
+    {
+        trigger     = "trace",
+        description = "Build and run soak writing a packet trace, then analyze it",
+        execute = function ()
+            os.execute "test ! -e Makefile && premake5 gmake"
+            if os.execute "make -j32 soak trace" == 0 then
+                os.execute "./bin/soak 10000 /tmp/reliable.trace > /dev/null && ./bin/trace /tmp/reliable.trace"
+            end
+        end
+    }
+
+    newaction
+    {
+        trigger     = "replay",
+        description = "Build and run soak capturing server datagrams, then replay the capture into a fresh endpoint",
+        execute = function ()
+            os.execute "test ! -e Makefile && premake5 gmake"
+            if os.execute "make -j32 soak replay config=release_x64" == 0 then
+                os.execute "./bin/soak 10000 - /tmp/reliable.pcapng > /dev/null && ./bin/replay /tmp/reliable.pcapng"
+            end
+        end
+    }
+
     newaction
     {
         trigger     = "cppcheck",
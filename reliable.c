@@ -41,6 +41,18 @@
 #define RELIABLE_ENABLE_LOGGING 1
 #endif // #ifndef RELIABLE_ENABLE_LOGGING
 
+#ifndef RELIABLE_LOG_LEVEL_MAX
+#if RELIABLE_ENABLE_LOGGING
+#define RELIABLE_LOG_LEVEL_MAX RELIABLE_LOG_LEVEL_DEBUG
+#else // #if RELIABLE_ENABLE_LOGGING
+#define RELIABLE_LOG_LEVEL_MAX RELIABLE_LOG_LEVEL_NONE
+#endif // #if RELIABLE_ENABLE_LOGGING
+#endif // #ifndef RELIABLE_LOG_LEVEL_MAX
+
+#ifndef RELIABLE_ENABLE_PROFILING
+#define RELIABLE_ENABLE_PROFILING 0
+#endif // #ifndef RELIABLE_ENABLE_PROFILING
+
 // ------------------------------------------------------------------
 
 static void default_assert_handler( RELIABLE_CONST char * condition, RELIABLE_CONST char * function, RELIABLE_CONST char * file, int line )
@@ -76,20 +88,31 @@ void reliable_set_assert_function( void (*function)( RELIABLE_CONST char *, RELI
 
 #if RELIABLE_ENABLE_LOGGING
 
+static void reliable_vprintf( RELIABLE_CONST char * format, va_list args )
+{
+    char buffer[4*1024];
+    vsprintf( buffer, format, args );
+    printf_function( "%s", buffer );
+}
+
 void reliable_printf( int level, RELIABLE_CONST char * format, ... ) 
 {
     if ( level > log_level )
         return;
     va_list args;
     va_start( args, format );
-    char buffer[4*1024];
-    vsprintf( buffer, format, args );
-    printf_function( "%s", buffer );
+    reliable_vprintf( format, args );
     va_end( args );
 }
 
 #else // #if RELIABLE_ENABLE_LOGGING
 
+static void reliable_vprintf( RELIABLE_CONST char * format, va_list args )
+{
+    (void) format;
+    (void) args;
+}
+
 void reliable_printf( int level, RELIABLE_CONST char * format, ... ) 
 {
     (void) level;
@@ -98,6 +121,58 @@ void reliable_printf( int level, RELIABLE_CONST char * format, ... )
 
 #endif // #if RELIABLE_ENABLE_LOGGING
 
+// calls above RELIABLE_LOG_LEVEL_MAX compile away entirely. the rest check the runtime level before paying for varargs and formatting
+
+#define reliable_printf( level, ... )                                                               \
+    do                                                                                              \
+    {                                                                                               \
+        if ( (level) <= RELIABLE_LOG_LEVEL_MAX && (level) <= log_level )                            \
+        {                                                                                           \
+            (reliable_printf)( (level), __VA_ARGS__ );                                              \
+        }                                                                                           \
+    } while (0)
+
+// endpoint logs use the endpoint's own level and sink when configured, falling back to the globals.
+// a log function receives structured events with no formatting or shared state, so each thread can feed its own ring.
+// calls above RELIABLE_LOG_LEVEL_MAX compile away for both sinks. errors go through a per-endpoint token bucket whichever
+// sink they go to, so a flood of bad packets cannot become a flood of logs. a compiled out error still spends a token,
+// so the suppressed counter means the same thing in every build
+
+#define reliable_endpoint_log_level( endpoint ) ( (endpoint)->config.log_level >= 0 ? (endpoint)->config.log_level : log_level )
+
+#define reliable_endpoint_printf( endpoint, level, event, sequence, ... )                           \
+    do                                                                                              \
+    {                                                                                               \
+        if ( (level) <= RELIABLE_LOG_LEVEL_MAX )                                                    \
+        {                                                                                           \
+            const int log_allowed = (level) != RELIABLE_LOG_LEVEL_ERROR || reliable_endpoint_error_log_allowed( endpoint ); \
+            if ( log_allowed && (level) <= reliable_endpoint_log_level( endpoint ) )                \
+            {                                                                                       \
+                if ( (endpoint)->config.log_function )                                              \
+                {                                                                                   \
+                    (endpoint)->config.log_function( (endpoint)->config.context, (endpoint)->config.index, (level), (event), (uint16_t) (sequence) ); \
+                }                                                                                   \
+                else                                                                                \
+                {                                                                                   \
+                    reliable_endpoint_report_suppressed_error_logs( endpoint );                     \
+                    reliable_log_output( __VA_ARGS__ );                                             \
+                }                                                                                   \
+            }                                                                                       \
+        }                                                                                           \
+        else if ( (level) == RELIABLE_LOG_LEVEL_ERROR )                                             \
+        {                                                                                           \
+            reliable_endpoint_error_log_allowed( endpoint );                                        \
+        }                                                                                           \
+    } while (0)
+
+static void reliable_log_output( RELIABLE_CONST char * format, ... )
+{
+    va_list args;
+    va_start( args, format );
+    reliable_vprintf( format, args );
+    va_end( args );
+}
+
 void * reliable_default_allocate_function( void * context, uint64_t bytes )
 {
     (void) context;
@@ -112,6 +187,196 @@ void reliable_default_free_function( void * context, void * pointer )
 
 // ------------------------------------------------------------------
 
+#if defined( _MSC_VER )
+
+#include <intrin.h>
+
+// _ReadWriteBarrier only stops the compiler reordering. that is enough on x86 and x64 where the hardware keeps loads and stores
+// in order, but arm needs a real dmb on each side of the access to get acquire and release ordering
+
+#if defined( _M_ARM64 )
+#define reliable_hardware_barrier() __dmb( _ARM64_BARRIER_ISH )
+#elif defined( _M_ARM )
+#define reliable_hardware_barrier() __dmb( _ARM_BARRIER_ISH )
+#else // #if defined( _M_ARM64 )
+#define reliable_hardware_barrier() _ReadWriteBarrier()
+#endif // #if defined( _M_ARM64 )
+
+static uint32_t reliable_atomic_load_acquire( volatile uint32_t * pointer )
+{
+    uint32_t value = (uint32_t) __iso_volatile_load32( (volatile __int32*) pointer );
+    reliable_hardware_barrier();
+    return value;
+}
+
+static void reliable_atomic_store_release( volatile uint32_t * pointer, uint32_t value )
+{
+    reliable_hardware_barrier();
+    __iso_volatile_store32( (volatile __int32*) pointer, (__int32) value );
+}
+
+static uint32_t reliable_atomic_fetch_add( volatile uint32_t * pointer, uint32_t value )
+{
+    return (uint32_t) _InterlockedExchangeAdd( (volatile long*) pointer, (long) value );
+}
+
+static void reliable_atomic_fence_acquire()
+{
+    reliable_hardware_barrier();
+}
+
+static void reliable_atomic_fence_release()
+{
+    reliable_hardware_barrier();
+}
+
+static uint64_t reliable_atomic_load64( volatile uint64_t * pointer )
+{
+    uint64_t value = (uint64_t) __iso_volatile_load64( (volatile __int64*) pointer );
+    reliable_hardware_barrier();
+    return value;
+}
+
+static void reliable_atomic_add64( volatile uint64_t * pointer, int64_t value )
+{
+    _InterlockedExchangeAdd64( (volatile __int64*) pointer, (__int64) value );
+}
+
+static void reliable_atomic_max64( volatile uint64_t * pointer, uint64_t value )
+{
+    uint64_t current = *pointer;
+    while ( value > current )
+    {
+        uint64_t previous = (uint64_t) _InterlockedCompareExchange64( (volatile __int64*) pointer, (__int64) value, (__int64) current );
+        if ( previous == current )
+            break;
+        current = previous;
+    }
+}
+
+#else // #if defined( _MSC_VER )
+
+static uint32_t reliable_atomic_load_acquire( volatile uint32_t * pointer )
+{
+    return __atomic_load_n( pointer, __ATOMIC_ACQUIRE );
+}
+
+static void reliable_atomic_store_release( volatile uint32_t * pointer, uint32_t value )
+{
+    __atomic_store_n( pointer, value, __ATOMIC_RELEASE );
+}
+
+static uint32_t reliable_atomic_fetch_add( volatile uint32_t * pointer, uint32_t value )
+{
+    return __atomic_fetch_add( pointer, value, __ATOMIC_ACQ_REL );
+}
+
+static void reliable_atomic_fence_acquire()
+{
+    __atomic_thread_fence( __ATOMIC_ACQUIRE );
+}
+
+static void reliable_atomic_fence_release()
+{
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+}
+
+static uint64_t reliable_atomic_load64( volatile uint64_t * pointer )
+{
+    return __atomic_load_n( pointer, __ATOMIC_ACQUIRE );
+}
+
+static void reliable_atomic_add64( volatile uint64_t * pointer, int64_t value )
+{
+    __atomic_fetch_add( pointer, (uint64_t) value, __ATOMIC_RELAXED );
+}
+
+static void reliable_atomic_max64( volatile uint64_t * pointer, uint64_t value )
+{
+    uint64_t current = __atomic_load_n( pointer, __ATOMIC_RELAXED );
+    while ( value > current && !__atomic_compare_exchange_n( pointer, &current, value, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) ) {}
+}
+
+#endif // #if defined( _MSC_VER )
+
+// ------------------------------------------------------------------
+
+#if RELIABLE_ENABLE_PROFILING
+
+#if defined( _MSC_VER ) && ( defined( _M_X64 ) || defined( _M_IX86 ) )
+
+#include <intrin.h>
+
+static uint64_t reliable_profile_ticks()
+{
+    return __rdtsc();
+}
+
+#elif defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+
+#include <x86intrin.h>
+
+static uint64_t reliable_profile_ticks()
+{
+    return __rdtsc();
+}
+
+#elif defined( _WIN32 )
+
+#include <windows.h>
+
+static uint64_t reliable_profile_ticks()
+{
+    static LARGE_INTEGER frequency;
+    if ( frequency.QuadPart == 0 )
+        QueryPerformanceFrequency( &frequency );
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter( &counter );
+    return (uint64_t) ( counter.QuadPart * 1000000000.0 / frequency.QuadPart );
+}
+
+#else
+
+#include <time.h>
+
+static uint64_t reliable_profile_ticks()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( (uint64_t) ts.tv_sec ) * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+#endif
+
+#define RELIABLE_PROFILE_BEGIN( name ) uint64_t reliable_profile_start_##name = reliable_profile_ticks()
+
+#define RELIABLE_PROFILE_END( endpoint, span, name ) reliable_profile_record( (endpoint)->profile + (span), reliable_profile_ticks() - reliable_profile_start_##name )
+
+static void reliable_profile_record( struct reliable_profile_histogram_t * histogram, uint64_t ticks )
+{
+    int bucket = 0;
+    uint64_t value = ticks;
+    while ( value >>= 1 )
+        bucket++;
+    if ( bucket >= RELIABLE_PROFILE_NUM_BUCKETS )
+        bucket = RELIABLE_PROFILE_NUM_BUCKETS - 1;
+    histogram->buckets[bucket]++;
+    histogram->count++;
+    histogram->total_ticks += ticks;
+    if ( ticks > histogram->max_ticks )
+        histogram->max_ticks = ticks;
+}
+
+#else // #if RELIABLE_ENABLE_PROFILING
+
+#define RELIABLE_PROFILE_BEGIN( name ) do {} while (0)
+
+#define RELIABLE_PROFILE_END( endpoint, span, name ) do {} while (0)
+
+#endif // #if RELIABLE_ENABLE_PROFILING
+
+// ------------------------------------------------------------------
+
 int reliable_init()
 {
     return RELIABLE_OK;
@@ -479,40 +744,367 @@ void reliable_fragment_reassembly_data_cleanup( void * data, void * allocator_co
 
 // ---------------------------------------------------------------
 
+#define RELIABLE_CLOCK_WINDOW_SECONDS 8
+
+struct reliable_stats_slot_t
+{
+    volatile uint32_t sequence;
+    struct reliable_endpoint_stats_t stats;
+};
+
+struct reliable_clock_sample_t
+{
+    int used;
+    int64_t second;
+    uint32_t rtt;
+    int32_t offset;
+};
+
 struct reliable_endpoint_t
 {
     void * allocator_context;
     void * (*allocate_function)(void*,uint64_t);
     void (*free_function)(void*,void*);
+    void * user_allocator_context;
+    void * (*user_allocate_function)(void*,uint64_t);
+    void (*user_free_function)(void*,void*);
+    uint64_t live_bytes;
+    uint64_t peak_live_bytes;
+    struct reliable_allocation_stats_t folded_allocation_stats;
+#if RELIABLE_ENABLE_PROFILING
+    struct reliable_profile_histogram_t profile[RELIABLE_PROFILE_NUM_SPANS];
+#endif // #if RELIABLE_ENABLE_PROFILING
     struct reliable_config_t config;
     double time;
     float rtt;
+    float loss_rtt;
+    float rtt_variance;
+    struct reliable_rtt_histogram_t rtt_histogram;
     float packet_loss;
+    float average_loss_burst;
+    int max_loss_burst;
+    float jitter;
+    uint32_t last_transit;
+    int has_transit;
+    uint32_t echo_time;
+    double echo_receive_time;
+    int has_echo;
+    float clock_offset;
+    float outbound_delay;
+    float inbound_delay;
+    int num_clock_samples;
+    struct reliable_clock_sample_t clock_samples[RELIABLE_CLOCK_WINDOW_SECONDS];
+    volatile uint32_t stats_published;
+    struct reliable_stats_slot_t stats_slots[2];
+    struct reliable_metrics_record_t * metrics_record;
+    float error_log_tokens;
+    double error_log_time;
+    uint32_t num_suppressed_error_logs;
+    struct reliable_trace_event_t * trace;
+    uint32_t trace_mask;
+    uint64_t trace_index;
+    FILE * capture_file;
+    uint16_t capture_ip_id;
+    uint8_t * message_packet;
+    int message_packet_bytes;
+    int num_queued_messages;
+    uint16_t message_id;
+    uint16_t * message_acks;
+    int num_message_acks;
+    uint8_t * reliable_message_packet;
+    struct reliable_sequence_buffer_t * message_send_queue;
+    struct reliable_sequence_buffer_t * message_receive_queue;
+    struct reliable_sequence_buffer_t * message_sent_packets;
+    uint16_t send_message_id;
+    uint16_t oldest_unacked_message_id;
+    uint16_t receive_message_id;
+    int num_unacked_reliable_messages;
     float sent_bandwidth_kbps;
     float received_bandwidth_kbps;
     float acked_bandwidth_kbps;
     int num_acks;
     uint16_t * acks;
+    struct reliable_ack_t * ack_records;
     uint16_t sequence;
+    uint16_t loss_sequence;
+    uint16_t peer_ack;
+    int has_peer_ack;
+    void * congestion_control_state;
+    struct reliable_congestion_state_t congestion;
     struct reliable_sequence_buffer_t * sent_packets;
     struct reliable_sequence_buffer_t * received_packets;
     struct reliable_sequence_buffer_t * fragment_reassembly;
     uint64_t counters[RELIABLE_ENDPOINT_NUM_COUNTERS];
+    int update_pending;
+    int stats_changed;
+    struct reliable_timer_wheel_t * timer_wheel;
+    struct reliable_endpoint_t * timer_next;
+    struct reliable_endpoint_t ** timer_link;
+    uint64_t timer_tick;
+};
+
+// ---------------------------------------------------------------
+
+// note: every allocation an endpoint makes goes through these trampolines, which prefix
+// the block with its size so frees can be accounted without a lookup table.
+// the trampolines only touch the endpoint's own counters. each endpoint folds what changed into the process wide totals when it
+// publishes its stats and when it is destroyed, so threads updating different endpoints never contend on the packet path.
+// the global totals trail each endpoint by at most one update, and the global peak is sampled at those points
+
+#define RELIABLE_ALLOCATION_HEADER_BYTES 16
+
+struct reliable_global_allocation_stats_t
+{
+    volatile uint64_t num_allocations;
+    volatile uint64_t num_frees;
+    volatile uint64_t bytes_allocated;
+    volatile uint64_t live_bytes;
+    volatile uint64_t peak_live_bytes;
 };
 
+static struct reliable_global_allocation_stats_t reliable_global_allocation_stats;
+
+static void reliable_endpoint_track_allocation( struct reliable_endpoint_t * endpoint, uint64_t bytes )
+{
+    endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_ALLOCATIONS]++;
+    endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_BYTES_ALLOCATED] += bytes;
+    endpoint->live_bytes += bytes;
+    if ( endpoint->live_bytes > endpoint->peak_live_bytes )
+    {
+        endpoint->peak_live_bytes = endpoint->live_bytes;
+    }
+}
+
+static void reliable_endpoint_track_free( struct reliable_endpoint_t * endpoint, uint64_t bytes )
+{
+    reliable_assert( endpoint->live_bytes >= bytes );
+    endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_FREES]++;
+    endpoint->live_bytes -= bytes;
+}
+
+static void reliable_endpoint_fold_allocation_stats( struct reliable_endpoint_t * endpoint )
+{
+    struct reliable_allocation_stats_t * folded = &endpoint->folded_allocation_stats;
+
+    const uint64_t num_allocations = endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_ALLOCATIONS];
+    const uint64_t num_frees = endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_FREES];
+    const uint64_t bytes_allocated = endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_BYTES_ALLOCATED];
+
+    if ( num_allocations == folded->num_allocations && num_frees == folded->num_frees )
+        return;
+
+    reliable_atomic_add64( &reliable_global_allocation_stats.num_allocations, (int64_t) ( num_allocations - folded->num_allocations ) );
+    reliable_atomic_add64( &reliable_global_allocation_stats.num_frees, (int64_t) ( num_frees - folded->num_frees ) );
+    reliable_atomic_add64( &reliable_global_allocation_stats.bytes_allocated, (int64_t) ( bytes_allocated - folded->bytes_allocated ) );
+    reliable_atomic_add64( &reliable_global_allocation_stats.live_bytes, (int64_t) endpoint->live_bytes - (int64_t) folded->live_bytes );
+    reliable_atomic_max64( &reliable_global_allocation_stats.peak_live_bytes, reliable_atomic_load64( &reliable_global_allocation_stats.live_bytes ) );
+
+    folded->num_allocations = num_allocations;
+    folded->num_frees = num_frees;
+    folded->bytes_allocated = bytes_allocated;
+    folded->live_bytes = endpoint->live_bytes;
+}
+
+static void * reliable_endpoint_allocate( void * context, uint64_t bytes )
+{
+    struct reliable_endpoint_t * endpoint = (struct reliable_endpoint_t*) context;
+    reliable_assert( endpoint );
+    uint8_t * block = (uint8_t*) endpoint->user_allocate_function( endpoint->user_allocator_context, bytes + RELIABLE_ALLOCATION_HEADER_BYTES );
+    if ( !block )
+        return NULL;
+    *( (uint64_t*) block ) = bytes;
+    reliable_endpoint_track_allocation( endpoint, bytes );
+    return block + RELIABLE_ALLOCATION_HEADER_BYTES;
+}
+
+static void reliable_endpoint_free( void * context, void * pointer )
+{
+    struct reliable_endpoint_t * endpoint = (struct reliable_endpoint_t*) context;
+    reliable_assert( endpoint );
+    if ( !pointer )
+        return;
+    uint8_t * block = ( (uint8_t*) pointer ) - RELIABLE_ALLOCATION_HEADER_BYTES;
+    reliable_endpoint_track_free( endpoint, *( (uint64_t*) block ) );
+    endpoint->user_free_function( endpoint->user_allocator_context, block );
+}
+
+// ---------------------------------------------------------------
+
+static void reliable_endpoint_refill_error_log_tokens( struct reliable_endpoint_t * endpoint )
+{
+    if ( endpoint->time > endpoint->error_log_time )
+    {
+        endpoint->error_log_tokens += (float) ( ( endpoint->time - endpoint->error_log_time ) * endpoint->config.max_error_logs_per_second );
+        if ( endpoint->error_log_tokens > (float) endpoint->config.error_log_burst )
+            endpoint->error_log_tokens = (float) endpoint->config.error_log_burst;
+    }
+    endpoint->error_log_time = endpoint->time;
+}
+
+static void reliable_endpoint_report_suppressed_error_logs( struct reliable_endpoint_t * endpoint )
+{
+    if ( endpoint->num_suppressed_error_logs > 0 && endpoint->error_log_tokens >= 1.0f )
+    {
+        endpoint->error_log_tokens -= 1.0f;
+        reliable_log_output( "[%s] suppressed %d error messages\n", endpoint->config.name, (int) endpoint->num_suppressed_error_logs );
+        endpoint->num_suppressed_error_logs = 0;
+    }
+}
+
+static int reliable_endpoint_error_log_allowed( struct reliable_endpoint_t * endpoint )
+{
+    if ( endpoint->config.max_error_logs_per_second <= 0.0f )
+        return 1;
+
+    reliable_endpoint_refill_error_log_tokens( endpoint );
+
+    if ( endpoint->error_log_tokens < 1.0f )
+    {
+        endpoint->num_suppressed_error_logs++;
+        endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_ERROR_LOGS_SUPPRESSED]++;
+        return 0;
+    }
+
+    endpoint->error_log_tokens -= 1.0f;
+
+    return 1;
+}
+
+// ---------------------------------------------------------------
+
+static void reliable_endpoint_publish_stats( struct reliable_endpoint_t * endpoint )
+{
+    reliable_endpoint_fold_allocation_stats( endpoint );
+
+    // double buffered seqlock. the single writer fills the slot readers are not pointed at, then flips to it. a reader only retries
+    // if the writer has come all the way around to the slot it is copying, which takes two full updates.
+
+    uint32_t published = endpoint->stats_published;
+    struct reliable_stats_slot_t * slot = endpoint->stats_slots + ( ( published + 1 ) & 1 );
+
+    uint32_t sequence = slot->sequence;
+    reliable_atomic_store_release( &slot->sequence, sequence + 1 );
+    reliable_atomic_fence_release();
+
+    slot->stats.time = endpoint->time;
+    slot->stats.rtt = endpoint->rtt;
+    slot->stats.packet_loss = endpoint->packet_loss;
+    slot->stats.jitter = endpoint->jitter;
+    slot->stats.sent_bandwidth_kbps = endpoint->sent_bandwidth_kbps;
+    slot->stats.received_bandwidth_kbps = endpoint->received_bandwidth_kbps;
+    slot->stats.acked_bandwidth_kbps = endpoint->acked_bandwidth_kbps;
+    memcpy( slot->stats.counters, endpoint->counters, sizeof( endpoint->counters ) );
+
+    reliable_atomic_store_release( &slot->sequence, sequence + 2 );
+    reliable_atomic_store_release( &endpoint->stats_published, published + 1 );
+
+    struct reliable_metrics_record_t * record = endpoint->metrics_record;
+    if ( record )
+    {
+        uint32_t record_sequence = record->sequence;
+        reliable_atomic_store_release( &record->sequence, record_sequence + 1 );
+        reliable_atomic_fence_release();
+        record->stats = slot->stats;
+        reliable_atomic_store_release( &record->sequence, record_sequence + 2 );
+    }
+}
+
+// ---------------------------------------------------------------
+
 struct reliable_sent_packet_data_t
 {
     double time;
     uint32_t acked : 1;
-    uint32_t packet_bytes : 31;
+    uint32_t lost : 1;
+    uint32_t packet_bytes : 30;
+    uint16_t first_message_id;
+    uint16_t num_messages;
+    uint64_t cookie;
 };
 
 struct reliable_received_packet_data_t
 {
     double time;
     uint32_t packet_bytes;
+    uint32_t send_time;
 };
 
+static uint32_t reliable_timestamp( double time )
+{
+    return (uint32_t) (uint64_t) ( time * 1000000.0 );
+}
+
+static void reliable_endpoint_update_jitter( struct reliable_endpoint_t * endpoint, uint32_t receive_time, uint32_t send_time )
+{
+    // RFC 3550 interarrival jitter. transit times are only compared with each other, so the two clocks need not agree
+
+    uint32_t transit = receive_time - send_time;
+    if ( endpoint->has_transit )
+    {
+        int32_t difference = (int32_t) ( transit - endpoint->last_transit );
+        float d = (float) ( difference < 0 ? -(int64_t) difference : difference ) / 1000.0f;
+        endpoint->jitter += ( d - endpoint->jitter ) / 16.0f;
+    }
+    endpoint->last_transit = transit;
+    endpoint->has_transit = 1;
+}
+
+static void reliable_endpoint_update_clock( struct reliable_endpoint_t * endpoint, uint32_t t1, uint32_t hold_time, uint32_t t3, uint32_t t4 )
+{
+    // NTP style exchange. t1 is our send time echoed back, t2 = t3 - hold_time when the peer received it, t3 when the peer sent this packet
+    // and t4 now. the offset is taken from the lowest rtt sample of the last few seconds (one slot per second), where queueing is least
+    // likely to have skewed one direction.
+    // one-way delays are measured against that offset on every sample, so asymmetric queueing shows up as a difference between them.
+    // all times wrap at 32 bits, so offsets are only meaningful when the two clocks are within ~35 minutes of each other
+
+    int64_t rtt = (int64_t) (int32_t) ( t4 - t1 ) - (int64_t) hold_time;
+    if ( rtt < 0 )
+        return;
+
+    uint32_t t2 = t3 - hold_time;
+    int64_t offset = ( (int64_t) (int32_t) ( t2 - t1 ) + (int64_t) (int32_t) ( t3 - t4 ) ) / 2;
+
+    int64_t second = (int64_t) floor( endpoint->time );
+    struct reliable_clock_sample_t * sample = endpoint->clock_samples + ( ( second % RELIABLE_CLOCK_WINDOW_SECONDS ) + RELIABLE_CLOCK_WINDOW_SECONDS ) % RELIABLE_CLOCK_WINDOW_SECONDS;
+    if ( !sample->used || sample->second != second || (uint32_t) rtt <= sample->rtt )
+    {
+        sample->used = 1;
+        sample->second = second;
+        sample->rtt = (uint32_t) ( rtt < 0xFFFFFFFF ? rtt : 0xFFFFFFFF );
+        sample->offset = (int32_t) offset;
+    }
+    endpoint->num_clock_samples++;
+
+    int best = -1;
+    int i;
+    for ( i = 0; i < RELIABLE_CLOCK_WINDOW_SECONDS; ++i )
+    {
+        struct reliable_clock_sample_t * candidate = endpoint->clock_samples + i;
+        if ( !candidate->used || candidate->second <= second - RELIABLE_CLOCK_WINDOW_SECONDS )
+            continue;
+        if ( best < 0 || candidate->rtt < endpoint->clock_samples[best].rtt )
+            best = i;
+    }
+    reliable_assert( best >= 0 );
+
+    int32_t best_offset = endpoint->clock_samples[best].offset;
+    endpoint->clock_offset = best_offset / 1000.0f;
+
+    float outbound_delay = ( (int32_t) ( t2 - t1 ) - best_offset ) / 1000.0f;
+    float inbound_delay = ( (int32_t) ( t4 - t3 ) + best_offset ) / 1000.0f;
+
+    if ( endpoint->num_clock_samples == 1 )
+    {
+        endpoint->outbound_delay = outbound_delay;
+        endpoint->inbound_delay = inbound_delay;
+    }
+    else
+    {
+        endpoint->outbound_delay += ( outbound_delay - endpoint->outbound_delay ) * 0.125f;
+        endpoint->inbound_delay += ( inbound_delay - endpoint->inbound_delay ) * 0.125f;
+    }
+}
+
 void reliable_default_config( struct reliable_config_t * config )
 {
     reliable_assert( config );
@@ -536,8 +1128,18 @@ void reliable_default_config( struct reliable_config_t * config )
     config->fragment_reassembly_buffer_size = 64;
     config->rtt_smoothing_factor = 0.0025f;
     config->packet_loss_smoothing_factor = 0.1f;
+    config->packet_loss_window = 0.0f;
+    config->packet_loss_rttvar_factor = 4.0f;
     config->bandwidth_smoothing_factor = 0.1f;
     config->packet_header_size = 28;        // note: UDP over IPv4 = 20 + 8 bytes, UDP over IPv6 = 40 + 8 bytes
+    config->max_error_logs_per_second = 10.0f;
+    config->error_log_burst = 20;
+    config->log_level = -1;
+    config->max_message_packet_bytes = 1024;
+    config->message_ack_buffer_size = 1024;
+    config->reliable_message_window = 256;
+    config->reliable_message_min_resend_time = 0.05f;
+    config->packet_lost_min_timeout = 0.1f;
 }
 
 struct reliable_endpoint_t * reliable_endpoint_create( struct reliable_config_t * config, double time )
@@ -551,8 +1153,10 @@ struct reliable_endpoint_t * reliable_endpoint_create( struct reliable_config_t
     reliable_assert( config->ack_buffer_size > 0 );
     reliable_assert( config->sent_packets_buffer_size > 0 );
     reliable_assert( config->received_packets_buffer_size > 0 );
-    reliable_assert( config->transmit_packet_function != NULL );
+    reliable_assert( config->transmit_packet_function != NULL || config->transmit_ring != NULL );
     reliable_assert( config->process_packet_function != NULL );
+    reliable_assert( config->max_message_packet_bytes > 0 );
+    reliable_assert( config->max_message_packet_bytes <= config->max_packet_size );
 
     void * allocator_context = config->allocator_context;
     void * (*allocate_function)(void*,uint64_t) = config->allocate_function;
@@ -574,41 +1178,82 @@ struct reliable_endpoint_t * reliable_endpoint_create( struct reliable_config_t
 
     memset( endpoint, 0, sizeof( struct reliable_endpoint_t ) );
 
-    endpoint->allocator_context = allocator_context;
-    endpoint->allocate_function = allocate_function;
-    endpoint->free_function = free_function;
+    endpoint->user_allocator_context = allocator_context;
+    endpoint->user_allocate_function = allocate_function;
+    endpoint->user_free_function = free_function;
+    endpoint->allocator_context = endpoint;
+    endpoint->allocate_function = reliable_endpoint_allocate;
+    endpoint->free_function = reliable_endpoint_free;
     endpoint->config = *config;
     endpoint->time = time;
+    endpoint->error_log_tokens = (float) config->error_log_burst;
+    endpoint->error_log_time = time;
 
-    endpoint->acks = (uint16_t*) allocate_function( allocator_context, config->ack_buffer_size * sizeof( uint16_t ) );
+    reliable_endpoint_track_allocation( endpoint, sizeof( struct reliable_endpoint_t ) );
+
+    endpoint->acks = (uint16_t*) endpoint->allocate_function( endpoint->allocator_context, config->ack_buffer_size * sizeof( uint16_t ) );
+    endpoint->ack_records = (struct reliable_ack_t*) endpoint->allocate_function( endpoint->allocator_context, config->ack_buffer_size * sizeof( struct reliable_ack_t ) );
     
     endpoint->sent_packets = reliable_sequence_buffer_create( config->sent_packets_buffer_size, 
                                                               sizeof( struct reliable_sent_packet_data_t ), 
-                                                              allocator_context, 
-                                                              allocate_function, 
-                                                              free_function );
+                                                              endpoint->allocator_context, 
+                                                              endpoint->allocate_function, 
+                                                              endpoint->free_function );
 
     endpoint->received_packets = reliable_sequence_buffer_create( config->received_packets_buffer_size, 
                                                                   sizeof( struct reliable_received_packet_data_t ), 
-                                                                  allocator_context, 
-                                                                  allocate_function, 
-                                                                  free_function );
+                                                                  endpoint->allocator_context, 
+                                                                  endpoint->allocate_function, 
+                                                                  endpoint->free_function );
     
     endpoint->fragment_reassembly = reliable_sequence_buffer_create( config->fragment_reassembly_buffer_size, 
                                                                      sizeof( struct reliable_fragment_reassembly_data_t ), 
-                                                                     allocator_context, 
-                                                                     allocate_function, 
-                                                                     free_function );
+                                                                     endpoint->allocator_context, 
+                                                                     endpoint->allocate_function, 
+                                                                     endpoint->free_function );
 
     memset( endpoint->acks, 0, config->ack_buffer_size * sizeof( uint16_t ) );
+    memset( endpoint->ack_records, 0, config->ack_buffer_size * sizeof( struct reliable_ack_t ) );
+
+    if ( config->trace_events > 0 )
+    {
+        uint32_t trace_events = 1;
+        while ( trace_events < (uint32_t) config->trace_events )
+            trace_events <<= 1;
+        endpoint->trace = (struct reliable_trace_event_t*) endpoint->allocate_function( endpoint->allocator_context, trace_events * sizeof( struct reliable_trace_event_t ) );
+        endpoint->trace_mask = trace_events - 1;
+    }
+
+    if ( config->congestion_control.init_function )
+    {
+        int state_bytes = config->congestion_control.state_bytes > 0 ? config->congestion_control.state_bytes : 1;
+        endpoint->congestion_control_state = endpoint->allocate_function( endpoint->allocator_context, state_bytes );
+        memset( endpoint->congestion_control_state, 0, state_bytes );
+        config->congestion_control.init_function( endpoint->congestion_control_state, &endpoint->congestion, time );
+    }
+
+    reliable_endpoint_publish_stats( endpoint );
 
     return endpoint;
 }
 
+static void reliable_endpoint_reset_message_channel( struct reliable_endpoint_t * endpoint );
+
 void reliable_endpoint_destroy( struct reliable_endpoint_t * endpoint )
 {
     reliable_assert( endpoint );
     reliable_assert( endpoint->acks );
+
+    if ( endpoint->timer_wheel )
+    {
+        reliable_timer_wheel_remove( endpoint->timer_wheel, endpoint );
+    }
+
+    if ( endpoint->metrics_record )
+    {
+        endpoint->metrics_record->in_use = 0;
+    }
+
     reliable_assert( endpoint->sent_packets );
     reliable_assert( endpoint->received_packets );
 
@@ -626,13 +1271,47 @@ void reliable_endpoint_destroy( struct reliable_endpoint_t * endpoint )
     }
 
     endpoint->free_function( endpoint->allocator_context, endpoint->acks );
+    endpoint->free_function( endpoint->allocator_context, endpoint->ack_records );
+
+    if ( endpoint->trace )
+    {
+        endpoint->free_function( endpoint->allocator_context, endpoint->trace );
+    }
+
+    if ( endpoint->congestion_control_state )
+    {
+        endpoint->free_function( endpoint->allocator_context, endpoint->congestion_control_state );
+    }
+
+    if ( endpoint->message_packet )
+    {
+        endpoint->free_function( endpoint->allocator_context, endpoint->message_packet );
+        endpoint->free_function( endpoint->allocator_context, endpoint->message_acks );
+    }
+
+    if ( endpoint->message_send_queue )
+    {
+        reliable_endpoint_reset_message_channel( endpoint );
+        reliable_sequence_buffer_destroy( endpoint->message_send_queue );
+        reliable_sequence_buffer_destroy( endpoint->message_receive_queue );
+        reliable_sequence_buffer_destroy( endpoint->message_sent_packets );
+        endpoint->free_function( endpoint->allocator_context, endpoint->reliable_message_packet );
+    }
+
+    reliable_endpoint_stop_capture( endpoint );
 
     reliable_sequence_buffer_destroy( endpoint->sent_packets );
     reliable_sequence_buffer_destroy( endpoint->received_packets );
     reliable_sequence_buffer_destroy( endpoint->fragment_reassembly );
 
-    endpoint->free_function( endpoint->allocator_context, endpoint );
-}
+    reliable_endpoint_track_free( endpoint, sizeof( struct reliable_endpoint_t ) );
+
+    reliable_assert( endpoint->live_bytes == 0 );
+
+    reliable_endpoint_fold_allocation_stats( endpoint );
+
+    endpoint->user_free_function( endpoint->user_allocator_context, endpoint );
+}
 
 uint16_t reliable_endpoint_next_packet_sequence( struct reliable_endpoint_t * endpoint )
 {
@@ -640,12 +1319,216 @@ uint16_t reliable_endpoint_next_packet_sequence( struct reliable_endpoint_t * en
     return endpoint->sequence;
 }
 
-int reliable_write_packet_header( uint8_t * packet_data, uint16_t sequence, uint16_t ack, uint32_t ack_bits )
+static void reliable_endpoint_timer_activity( struct reliable_endpoint_t * endpoint );
+
+// ---------------------------------------------------------------
+
+#define RELIABLE_PCAPNG_SECTION_HEADER_BLOCK        0x0A0D0D0A
+#define RELIABLE_PCAPNG_INTERFACE_DESCRIPTION_BLOCK 1
+#define RELIABLE_PCAPNG_ENHANCED_PACKET_BLOCK       6
+#define RELIABLE_PCAPNG_BYTE_ORDER_MAGIC            0x1A2B3C4D
+#define RELIABLE_PCAPNG_LINKTYPE_IPV4               228
+#define RELIABLE_PCAPNG_OPTION_EPB_FLAGS            2
+#define RELIABLE_PCAPNG_INBOUND                     1
+#define RELIABLE_PCAPNG_OUTBOUND                    2
+
+#define RELIABLE_CAPTURE_HEADER_BYTES               28
+#define RELIABLE_CAPTURE_MAX_PACKET_BYTES           ( 65535 - RELIABLE_CAPTURE_HEADER_BYTES )
+#define RELIABLE_CAPTURE_LOCAL_ADDRESS              0x0A000001
+#define RELIABLE_CAPTURE_PEER_ADDRESS               0x0A000002
+
+// pcapng blocks are written in host byte order (the section header byte order magic tells readers which), the ip and udp headers in network order
+
+static void reliable_capture_write_uint16( FILE * file, uint16_t value )
+{
+    fwrite( &value, sizeof( value ), 1, file );
+}
+
+static void reliable_capture_write_uint32( FILE * file, uint32_t value )
+{
+    fwrite( &value, sizeof( value ), 1, file );
+}
+
+static void reliable_capture_write_uint16_network( uint8_t * p, uint16_t value )
+{
+    p[0] = (uint8_t) ( value >> 8 );
+    p[1] = (uint8_t) ( value & 0xFF );
+}
+
+static void reliable_capture_write_uint32_network( uint8_t * p, uint32_t value )
+{
+    p[0] = (uint8_t) ( value >> 24 );
+    p[1] = (uint8_t) ( ( value >> 16 ) & 0xFF );
+    p[2] = (uint8_t) ( ( value >> 8 ) & 0xFF );
+    p[3] = (uint8_t) ( value & 0xFF );
+}
+
+int reliable_endpoint_start_capture( struct reliable_endpoint_t * endpoint, RELIABLE_CONST char * filename )
+{
+    reliable_assert( endpoint );
+    reliable_assert( filename );
+
+    reliable_endpoint_stop_capture( endpoint );
+
+    FILE * file = fopen( filename, "wb" );
+    if ( !file )
+    {
+        reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] could not open capture file %s\n", endpoint->config.name, filename );
+        return 0;
+    }
+
+    // section header: byte order magic, version 1.0, unknown section length
+
+    reliable_capture_write_uint32( file, RELIABLE_PCAPNG_SECTION_HEADER_BLOCK );
+    reliable_capture_write_uint32( file, 28 );
+    reliable_capture_write_uint32( file, RELIABLE_PCAPNG_BYTE_ORDER_MAGIC );
+    reliable_capture_write_uint16( file, 1 );
+    reliable_capture_write_uint16( file, 0 );
+    reliable_capture_write_uint32( file, 0xFFFFFFFF );
+    reliable_capture_write_uint32( file, 0xFFFFFFFF );
+    reliable_capture_write_uint32( file, 28 );
+
+    // one raw ipv4 interface with the default microsecond timestamp resolution and no snap length
+
+    reliable_capture_write_uint32( file, RELIABLE_PCAPNG_INTERFACE_DESCRIPTION_BLOCK );
+    reliable_capture_write_uint32( file, 20 );
+    reliable_capture_write_uint32( file, RELIABLE_PCAPNG_LINKTYPE_IPV4 );
+    reliable_capture_write_uint32( file, 0 );
+    reliable_capture_write_uint32( file, 20 );
+
+    if ( ferror( file ) )
+    {
+        reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] failed to write capture file %s\n", endpoint->config.name, filename );
+        fclose( file );
+        return 0;
+    }
+
+    endpoint->capture_file = file;
+
+    return 1;
+}
+
+void reliable_endpoint_stop_capture( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+
+    if ( endpoint->capture_file )
+    {
+        fclose( endpoint->capture_file );
+        endpoint->capture_file = NULL;
+    }
+}
+
+static void reliable_endpoint_capture_packet( struct reliable_endpoint_t * endpoint, uint32_t direction, uint8_t * packet_data, int packet_bytes )
+{
+    reliable_assert( endpoint->capture_file );
+
+    if ( packet_bytes > RELIABLE_CAPTURE_MAX_PACKET_BYTES )
+        return;
+
+    uint8_t header[RELIABLE_CAPTURE_HEADER_BYTES];
+    memset( header, 0, sizeof( header ) );
+
+    uint32_t source = direction == RELIABLE_PCAPNG_OUTBOUND ? RELIABLE_CAPTURE_LOCAL_ADDRESS : RELIABLE_CAPTURE_PEER_ADDRESS;
+    uint32_t destination = direction == RELIABLE_PCAPNG_OUTBOUND ? RELIABLE_CAPTURE_PEER_ADDRESS : RELIABLE_CAPTURE_LOCAL_ADDRESS;
+
+    header[0] = 0x45;
+    reliable_capture_write_uint16_network( header + 2, (uint16_t) ( RELIABLE_CAPTURE_HEADER_BYTES + packet_bytes ) );
+    reliable_capture_write_uint16_network( header + 4, endpoint->capture_ip_id++ );
+    reliable_capture_write_uint16_network( header + 6, 0x4000 );
+    header[8] = 64;
+    header[9] = 17;
+    reliable_capture_write_uint32_network( header + 12, source );
+    reliable_capture_write_uint32_network( header + 16, destination );
+
+    uint32_t checksum = 0;
+    int i;
+    for ( i = 0; i < 20; i += 2 )
+        checksum += ( ( (uint32_t) header[i] ) << 8 ) | header[i+1];
+    while ( checksum >> 16 )
+        checksum = ( checksum & 0xFFFF ) + ( checksum >> 16 );
+    reliable_capture_write_uint16_network( header + 10, (uint16_t) ~checksum );
+
+    // udp checksum is left zero, which ipv4 allows
+
+    reliable_capture_write_uint16_network( header + 20, RELIABLE_CAPTURE_PORT );
+    reliable_capture_write_uint16_network( header + 22, RELIABLE_CAPTURE_PORT );
+    reliable_capture_write_uint16_network( header + 24, (uint16_t) ( 8 + packet_bytes ) );
+
+    uint32_t captured_bytes = RELIABLE_CAPTURE_HEADER_BYTES + packet_bytes;
+    uint32_t padding = ( 4 - ( captured_bytes & 3 ) ) & 3;
+    uint32_t block_bytes = 28 + captured_bytes + padding + 12 + 4;
+    uint64_t timestamp = (uint64_t) ( endpoint->time * 1000000.0 );
+    const uint8_t zeros[4] = { 0, 0, 0, 0 };
+
+    FILE * file = endpoint->capture_file;
+    reliable_capture_write_uint32( file, RELIABLE_PCAPNG_ENHANCED_PACKET_BLOCK );
+    reliable_capture_write_uint32( file, block_bytes );
+    reliable_capture_write_uint32( file, 0 );
+    reliable_capture_write_uint32( file, (uint32_t) ( timestamp >> 32 ) );
+    reliable_capture_write_uint32( file, (uint32_t) ( timestamp & 0xFFFFFFFF ) );
+    reliable_capture_write_uint32( file, captured_bytes );
+    reliable_capture_write_uint32( file, captured_bytes );
+    fwrite( header, 1, sizeof( header ), file );
+    fwrite( packet_data, 1, packet_bytes, file );
+    fwrite( zeros, 1, padding, file );
+    reliable_capture_write_uint32( file, RELIABLE_PCAPNG_OPTION_EPB_FLAGS | ( 4 << 16 ) );
+    reliable_capture_write_uint32( file, direction );
+    reliable_capture_write_uint32( file, 0 );
+    reliable_capture_write_uint32( file, block_bytes );
+}
+
+// ---------------------------------------------------------------
+
+static void reliable_endpoint_transmit_packet( struct reliable_endpoint_t * endpoint, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    if ( endpoint->capture_file )
+    {
+        reliable_endpoint_capture_packet( endpoint, RELIABLE_PCAPNG_OUTBOUND, packet_data, packet_bytes );
+    }
+
+    if ( endpoint->config.transmit_ring )
+    {
+        // handoff to the network thread. like a full socket buffer, a full ring drops the datagram
+        if ( reliable_ring_push( endpoint->config.transmit_ring, RELIABLE_RING_RECORD_PACKET, sequence, packet_data, packet_bytes ) != RELIABLE_OK )
+        {
+            reliable_endpoint_printf( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_TRANSMIT_RING_FULL, sequence, "[%s] transmit ring full. dropped packet %d\n", endpoint->config.name, sequence );
+            endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_TRANSMIT_RING_FULL]++;
+        }
+        return;
+    }
+
+    endpoint->config.transmit_packet_function( endpoint->config.context, endpoint->config.index, sequence, packet_data, packet_bytes );
+}
+
+// optional header fields. when any are present, prefix bit 6 is set and a flags byte follows the ack bits, then each field in flag order
+
+#define RELIABLE_HEADER_EXTENSION_SEND_TIME         (1<<0)
+#define RELIABLE_HEADER_EXTENSION_TIMESTAMP_ECHO    (1<<1)
+#define RELIABLE_HEADER_EXTENSION_MESSAGES          (1<<2)      // no field of its own, but costs the flags byte. the payload is aggregated messages
+#define RELIABLE_HEADER_EXTENSION_RELIABLE_MESSAGES (1<<3)      // no field of its own, but costs the flags byte. the payload starts with reliable messages
+
+#define RELIABLE_HEADER_EXTENSION_ALL_FLAGS         ( RELIABLE_HEADER_EXTENSION_SEND_TIME | RELIABLE_HEADER_EXTENSION_TIMESTAMP_ECHO | RELIABLE_HEADER_EXTENSION_MESSAGES | RELIABLE_HEADER_EXTENSION_RELIABLE_MESSAGES )
+
+struct reliable_header_extension_t
+{
+    uint8_t flags;
+    uint32_t send_time;                             // microseconds, sender clock. wraps
+    uint32_t echo_time;                             // the most recent send time received from the peer, peer clock
+    uint32_t hold_time;                             // microseconds between receiving echo_time and sending this packet
+};
+
+int reliable_write_packet_header_extended( uint8_t * packet_data, uint16_t sequence, uint16_t ack, uint32_t ack_bits, RELIABLE_CONST struct reliable_header_extension_t * extension )
 {
     uint8_t * p = packet_data;
 
     uint8_t prefix_byte = 0;
 
+    if ( extension && extension->flags )
+    {
+        prefix_byte |= (1<<6);
+    }
+
     if ( ( ack_bits & 0x000000FF ) != 0x000000FF )
     {
         prefix_byte |= (1<<1);
@@ -705,12 +1588,138 @@ int reliable_write_packet_header( uint8_t * packet_data, uint16_t sequence, uint
         reliable_write_uint8( &p, (uint8_t) ( ( ack_bits & 0xFF000000 ) >> 24 ) );
     }
 
+    if ( prefix_byte & (1<<6) )
+    {
+        reliable_assert( ( extension->flags & ~RELIABLE_HEADER_EXTENSION_ALL_FLAGS ) == 0 );
+
+        reliable_write_uint8( &p, extension->flags );
+
+        if ( extension->flags & RELIABLE_HEADER_EXTENSION_SEND_TIME )
+        {
+            reliable_write_uint32( &p, extension->send_time );
+        }
+
+        if ( extension->flags & RELIABLE_HEADER_EXTENSION_TIMESTAMP_ECHO )
+        {
+            reliable_write_uint32( &p, extension->echo_time );
+            reliable_write_uint32( &p, extension->hold_time );
+        }
+    }
+
     reliable_assert( p - packet_data <= RELIABLE_MAX_PACKET_HEADER_BYTES );
 
     return (int) ( p - packet_data );
 }
 
-void reliable_endpoint_send_packet( struct reliable_endpoint_t * endpoint, uint8_t * packet_data, int packet_bytes )
+int reliable_write_packet_header( uint8_t * packet_data, uint16_t sequence, uint16_t ack, uint32_t ack_bits )
+{
+    return reliable_write_packet_header_extended( packet_data, sequence, ack, ack_bits, NULL );
+}
+
+static void reliable_endpoint_trace_event( struct reliable_endpoint_t * endpoint, int type, uint16_t sequence, int fragment_id, int bytes )
+{
+    if ( !endpoint->trace )
+        return;
+    struct reliable_trace_event_t * event = endpoint->trace + ( endpoint->trace_index & endpoint->trace_mask );
+    event->time = endpoint->time;
+    event->bytes = (uint32_t) bytes;
+    event->sequence = sequence;
+    event->type = (uint8_t) type;
+    event->fragment_id = (uint8_t) fragment_id;
+    endpoint->trace_index++;
+}
+
+// with a lost callback or congestion control set, every sent packet is resolved exactly once: acked, or lost when it falls behind the peer's ack window,
+// times out, or is about to be overwritten in sent_packets. packets are resolved oldest first, so the scan stops at the first one still in flight
+
+// loss timing keeps its own smoothed rtt with the rfc 6298 gains of 1/8 and 1/4. the endpoint rtt is smoothed far more heavily for
+// reporting, and pairing that with a fast variance would put the threshold well below a lagging rtt
+
+#define RELIABLE_LOSS_RTT_SMOOTHING_FACTOR 0.125f
+#define RELIABLE_RTT_VARIANCE_SMOOTHING_FACTOR 0.25f
+
+// on a steady link the variance decays towards zero, so the margin over srtt never drops below srtt / 8, as quic does
+
+static double reliable_endpoint_loss_threshold( struct reliable_endpoint_t * endpoint )
+{
+    float margin = endpoint->config.packet_loss_rttvar_factor * endpoint->rtt_variance;
+    if ( margin < endpoint->loss_rtt * 0.125f )
+    {
+        margin = endpoint->loss_rtt * 0.125f;
+    }
+    return ( endpoint->loss_rtt + margin ) / 1000.0;
+}
+
+// declaring a packet lost cannot be undone, a late ack for it is ignored, so never time out sooner than two rtts
+
+static double reliable_endpoint_loss_timeout( struct reliable_endpoint_t * endpoint )
+{
+    double timeout = reliable_endpoint_loss_threshold( endpoint );
+    if ( timeout < endpoint->rtt * 2.0 / 1000.0 )
+    {
+        timeout = endpoint->rtt * 2.0 / 1000.0;
+    }
+    if ( timeout < endpoint->config.packet_lost_min_timeout )
+    {
+        timeout = endpoint->config.packet_lost_min_timeout;
+    }
+    return timeout;
+}
+
+static void reliable_endpoint_detect_lost_packets( struct reliable_endpoint_t * endpoint )
+{
+    double timeout = reliable_endpoint_loss_timeout( endpoint );
+
+    while ( endpoint->loss_sequence != endpoint->sequence )
+    {
+        uint16_t sequence = endpoint->loss_sequence;
+
+        struct reliable_sent_packet_data_t * sent_packet_data = (struct reliable_sent_packet_data_t*) 
+            reliable_sequence_buffer_find( endpoint->sent_packets, sequence );
+
+        if ( sent_packet_data && !sent_packet_data->acked && !sent_packet_data->lost )
+        {
+            int out_of_window = endpoint->has_peer_ack && reliable_sequence_less_than( sequence, (uint16_t) ( endpoint->peer_ack - 31 ) );
+            int timed_out = endpoint->time - sent_packet_data->time >= timeout;
+            int overwritten = (uint16_t) ( endpoint->sequence - sequence ) >= endpoint->config.sent_packets_buffer_size;
+            if ( !out_of_window && !timed_out && !overwritten )
+                break;
+
+            sent_packet_data->lost = 1;
+            endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_LOST]++;
+
+            if ( endpoint->congestion_control_state )
+            {
+                endpoint->congestion.bytes_in_flight -= sent_packet_data->packet_bytes;
+                if ( endpoint->config.congestion_control.packet_lost_function )
+                {
+                    endpoint->config.congestion_control.packet_lost_function( endpoint->congestion_control_state, 
+                                                                              &endpoint->congestion, 
+                                                                              endpoint->time, 
+                                                                              sent_packet_data->packet_bytes, 
+                                                                              sent_packet_data->time );
+                }
+            }
+
+            if ( endpoint->config.packet_lost_function )
+            {
+                endpoint->config.packet_lost_function( endpoint->config.context, endpoint->config.index, sequence, sent_packet_data->cookie );
+            }
+        }
+
+        endpoint->loss_sequence++;
+    }
+}
+
+// returns 0 when the packet is rejected before it takes a sequence number
+
+static int reliable_endpoint_send_packet_internal( struct reliable_endpoint_t * endpoint, 
+                                                   uint8_t * packet_data, 
+                                                   int packet_bytes, 
+                                                   uint8_t extension_flags, 
+                                                   uint16_t first_message_id, 
+                                                   int num_messages, 
+                                                   uint64_t cookie )
 {
     reliable_assert( endpoint );
     reliable_assert( packet_data );
@@ -718,10 +1727,17 @@ void reliable_endpoint_send_packet( struct reliable_endpoint_t * endpoint, uint8
 
     if ( packet_bytes > endpoint->config.max_packet_size )
     {
-        reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] packet too large to send. packet is %d bytes, maximum is %d\n", 
+        reliable_endpoint_printf( endpoint, RELIABLE_LOG_LEVEL_ERROR, RELIABLE_LOG_EVENT_PACKET_TOO_LARGE_TO_SEND, endpoint->sequence, "[%s] packet too large to send. packet is %d bytes, maximum is %d\n", 
             endpoint->config.name, packet_bytes, endpoint->config.max_packet_size );
         endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_TOO_LARGE_TO_SEND]++;
-        return;
+        return 0;
+    }
+
+    reliable_endpoint_timer_activity( endpoint );
+
+    if ( endpoint->config.packet_lost_function || endpoint->congestion_control_state )
+    {
+        reliable_endpoint_detect_lost_packets( endpoint );
     }
 
     uint16_t sequence = endpoint->sequence++;
@@ -730,7 +1746,22 @@ void reliable_endpoint_send_packet( struct reliable_endpoint_t * endpoint, uint8
 
     reliable_sequence_buffer_generate_ack_bits( endpoint->received_packets, &ack, &ack_bits );
 
-    reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] sending packet %d\n", endpoint->config.name, sequence );
+    struct reliable_header_extension_t extension;
+    memset( &extension, 0, sizeof( extension ) );
+    extension.flags = extension_flags;
+    if ( endpoint->config.send_timestamps )
+    {
+        extension.flags |= RELIABLE_HEADER_EXTENSION_SEND_TIME;
+        extension.send_time = reliable_timestamp( endpoint->time );
+        if ( endpoint->has_echo )
+        {
+            extension.flags |= RELIABLE_HEADER_EXTENSION_TIMESTAMP_ECHO;
+            extension.echo_time = endpoint->echo_time;
+            extension.hold_time = extension.send_time - reliable_timestamp( endpoint->echo_receive_time );
+        }
+    }
+
+    reliable_endpoint_printf( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_SEND_PACKET, sequence, "[%s] sending packet %d\n", endpoint->config.name, sequence );
 
     struct reliable_sent_packet_data_t * sent_packet_data = (struct reliable_sent_packet_data_t*) reliable_sequence_buffer_insert( endpoint->sent_packets, sequence );
 
@@ -739,20 +1770,39 @@ void reliable_endpoint_send_packet( struct reliable_endpoint_t * endpoint, uint8
     sent_packet_data->time = endpoint->time;
     sent_packet_data->packet_bytes = endpoint->config.packet_header_size + packet_bytes;
     sent_packet_data->acked = 0;
+    sent_packet_data->lost = 0;
+    sent_packet_data->first_message_id = first_message_id;
+    sent_packet_data->num_messages = (uint16_t) num_messages;
+    sent_packet_data->cookie = cookie;
+
+    if ( endpoint->congestion_control_state )
+    {
+        endpoint->congestion.bytes_in_flight += sent_packet_data->packet_bytes;
+        if ( endpoint->config.congestion_control.packet_sent_function )
+        {
+            endpoint->config.congestion_control.packet_sent_function( endpoint->congestion_control_state, &endpoint->congestion, endpoint->time, sent_packet_data->packet_bytes );
+        }
+    }
+
+    reliable_endpoint_trace_event( endpoint, RELIABLE_TRACE_SEND, sequence, 0, packet_bytes );
 
     if ( packet_bytes <= endpoint->config.fragment_above )
     {
         // regular packet
 
-        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] sending packet %d without fragmentation\n", endpoint->config.name, sequence );
+        reliable_endpoint_printf( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_SEND_PACKET_UNFRAGMENTED, sequence, "[%s] sending packet %d without fragmentation\n", endpoint->config.name, sequence );
 
         uint8_t * transmit_packet_data = (uint8_t*) endpoint->allocate_function( endpoint->allocator_context, packet_bytes + RELIABLE_MAX_PACKET_HEADER_BYTES );
 
-        int packet_header_bytes = reliable_write_packet_header( transmit_packet_data, sequence, ack, ack_bits );
+        RELIABLE_PROFILE_BEGIN( header_write );
+
+        int packet_header_bytes = reliable_write_packet_header_extended( transmit_packet_data, sequence, ack, ack_bits, &extension );
+
+        RELIABLE_PROFILE_END( endpoint, RELIABLE_PROFILE_HEADER_WRITE, header_write );
 
         memcpy( transmit_packet_data + packet_header_bytes, packet_data, packet_bytes );
 
-        endpoint->config.transmit_packet_function( endpoint->config.context, endpoint->config.index, sequence, transmit_packet_data, packet_header_bytes + packet_bytes );
+        reliable_endpoint_transmit_packet( endpoint, sequence, transmit_packet_data, packet_header_bytes + packet_bytes );
 
         endpoint->free_function( endpoint->allocator_context, transmit_packet_data );
     }
@@ -764,11 +1814,15 @@ void reliable_endpoint_send_packet( struct reliable_endpoint_t * endpoint, uint8
 
         memset( packet_header, 0, RELIABLE_MAX_PACKET_HEADER_BYTES );
 
-        int packet_header_bytes = reliable_write_packet_header( packet_header, sequence, ack, ack_bits );        
+        RELIABLE_PROFILE_BEGIN( header_write );
+
+        int packet_header_bytes = reliable_write_packet_header_extended( packet_header, sequence, ack, ack_bits, &extension );
+
+        RELIABLE_PROFILE_END( endpoint, RELIABLE_PROFILE_HEADER_WRITE, header_write );
 
         int num_fragments = ( packet_bytes / endpoint->config.fragment_size ) + ( ( packet_bytes % endpoint->config.fragment_size ) != 0 ? 1 : 0 );
 
-        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] sending packet %d as %d fragments\n", endpoint->config.name, sequence, num_fragments );
+        reliable_endpoint_printf( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_SEND_PACKET_FRAGMENTED, sequence, "[%s] sending packet %d as %d fragments\n", endpoint->config.name, sequence, num_fragments );
 
         reliable_assert( num_fragments >= 1 );
         reliable_assert( num_fragments <= endpoint->config.max_fragments );
@@ -784,6 +1838,8 @@ void reliable_endpoint_send_packet( struct reliable_endpoint_t * endpoint, uint8
         int fragment_id;
         for ( fragment_id = 0; fragment_id < num_fragments; ++fragment_id )
         {
+            RELIABLE_PROFILE_BEGIN( fragment_split );
+
             uint8_t * p = fragment_packet_data;
 
             reliable_write_uint8( &p, 1 );
@@ -810,7 +1866,11 @@ void reliable_endpoint_send_packet( struct reliable_endpoint_t * endpoint, uint8
 
             int fragment_packet_bytes = (int) ( p - fragment_packet_data );
 
-            endpoint->config.transmit_packet_function( endpoint->config.context, endpoint->config.index, sequence, fragment_packet_data, fragment_packet_bytes );
+            RELIABLE_PROFILE_END( endpoint, RELIABLE_PROFILE_FRAGMENT_SPLIT, fragment_split );
+
+            reliable_endpoint_trace_event( endpoint, RELIABLE_TRACE_SEND_FRAGMENT, sequence, fragment_id, fragment_packet_bytes );
+
+            reliable_endpoint_transmit_packet( endpoint, sequence, fragment_packet_data, fragment_packet_bytes );
 
             endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_SENT]++;
         }
@@ -819,1024 +1879,5809 @@ void reliable_endpoint_send_packet( struct reliable_endpoint_t * endpoint, uint8
     }
 
     endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT]++;
+
+    return 1;
 }
 
-int reliable_read_packet_header( RELIABLE_CONST char * name, uint8_t * packet_data, int packet_bytes, uint16_t * sequence, uint16_t * ack, uint32_t * ack_bits )
+void reliable_endpoint_send_packet( struct reliable_endpoint_t * endpoint, uint8_t * packet_data, int packet_bytes )
 {
-    if ( packet_bytes < 3 )
-    {
-        reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] packet too small for packet header (1)\n", name );
-        return -1;
-    }
+    reliable_endpoint_send_packet_internal( endpoint, packet_data, packet_bytes, 0, 0, 0, 0 );
+}
 
-    uint8_t * p = packet_data;
+void reliable_endpoint_send_packet_with_cookie( struct reliable_endpoint_t * endpoint, uint8_t * packet_data, int packet_bytes, uint64_t cookie )
+{
+    reliable_endpoint_send_packet_internal( endpoint, packet_data, packet_bytes, 0, 0, 0, cookie );
+}
 
-    uint8_t prefix_byte = reliable_read_uint8( &p );
+// aggregated payload: first message id (uint16), then per message a length (one byte below 128, otherwise two bytes with the top bit set) and the data
 
-    if ( ( prefix_byte & 1 ) != 0 )
-    {
-        reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] prefix byte does not indicate a regular packet\n", name );
-        return -1;
-    }
+#define RELIABLE_MESSAGE_PACKET_HEADER_BYTES 2
+#define RELIABLE_MAX_MESSAGE_BYTES 0x7FFF
 
-    *sequence = reliable_read_uint16( &p );
+static int reliable_message_length_bytes( int message_bytes )
+{
+    return message_bytes < 128 ? 1 : 2;
+}
 
-    if ( prefix_byte & (1<<5) )
+static void reliable_write_message_length( uint8_t ** p, int message_bytes )
+{
+    if ( message_bytes < 128 )
     {
-        if ( packet_bytes < 3 + 1 )
-        {
-            reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] packet too small for packet header (2)\n", name );
-            return -1;
-        }
-        uint8_t sequence_difference = reliable_read_uint8( &p );
-        *ack = *sequence - sequence_difference;
+        reliable_write_uint8( p, (uint8_t) message_bytes );
     }
     else
     {
-        if ( packet_bytes < 3 + 2 )
-        {
-            reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] packet too small for packet header (3)\n", name );
-            return -1;
-        }
-        *ack = reliable_read_uint16( &p );
+        reliable_write_uint8( p, (uint8_t) ( 0x80 | ( message_bytes >> 8 ) ) );
+        reliable_write_uint8( p, (uint8_t) ( message_bytes & 0xFF ) );
     }
+}
 
-    int expected_bytes = 0;
-    int i;
-    for ( i = 1; i <= 4; ++i )
+// returns -1 if the length or the message it describes runs past the end of the payload
+
+static int reliable_read_message_length( uint8_t ** p, uint8_t * end )
+{
+    if ( *p >= end )
+        return -1;
+    int message_bytes = reliable_read_uint8( p );
+    if ( message_bytes & 0x80 )
     {
-        if ( prefix_byte & (1<<i) )
-        {
-            expected_bytes++;
-        }
+        if ( *p >= end )
+            return -1;
+        message_bytes = ( ( message_bytes & 0x7F ) << 8 ) | reliable_read_uint8( p );
     }
-    if ( packet_bytes < ( p - packet_data ) + expected_bytes )
-    {
-        reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] packet too small for packet header (4)\n", name );
+    if ( message_bytes == 0 || message_bytes > end - *p )
         return -1;
-    }
+    return message_bytes;
+}
 
-    *ack_bits = 0xFFFFFFFF;
+int reliable_endpoint_queue_message( struct reliable_endpoint_t * endpoint, uint8_t * message_data, int message_bytes )
+{
+    reliable_assert( endpoint );
+    reliable_assert( message_data );
+    reliable_assert( message_bytes > 0 );
 
-    if ( prefix_byte & (1<<1) )
+    int length_bytes = reliable_message_length_bytes( message_bytes );
+
+    if ( message_bytes > RELIABLE_MAX_MESSAGE_BYTES || RELIABLE_MESSAGE_PACKET_HEADER_BYTES + length_bytes + message_bytes > endpoint->config.max_message_packet_bytes )
     {
-        *ack_bits &= 0xFFFFFF00;
-        *ack_bits |= (uint32_t) ( reliable_read_uint8( &p ) );
+        reliable_endpoint_printf( endpoint, RELIABLE_LOG_LEVEL_ERROR, RELIABLE_LOG_EVENT_PACKET_TOO_LARGE_TO_SEND, endpoint->sequence, "[%s] message too large to queue. message is %d bytes, maximum message packet is %d\n", 
+            endpoint->config.name, message_bytes, endpoint->config.max_message_packet_bytes );
+        return 0;
     }
 
-    if ( prefix_byte & (1<<2) )
+    if ( !endpoint->message_packet )
     {
-        *ack_bits &= 0xFFFF00FF;
-        *ack_bits |= (uint32_t) ( reliable_read_uint8( &p ) ) << 8;
+        endpoint->message_packet = (uint8_t*) endpoint->allocate_function( endpoint->allocator_context, endpoint->config.max_message_packet_bytes );
+        endpoint->message_acks = (uint16_t*) endpoint->allocate_function( endpoint->allocator_context, endpoint->config.message_ack_buffer_size * sizeof( uint16_t ) );
     }
 
-    if ( prefix_byte & (1<<3) )
+    if ( endpoint->num_queued_messages > 0 && endpoint->message_packet_bytes + length_bytes + message_bytes > endpoint->config.max_message_packet_bytes )
     {
-        *ack_bits &= 0xFF00FFFF;
-        *ack_bits |= (uint32_t) ( reliable_read_uint8( &p ) ) << 16;
+        reliable_endpoint_flush_messages( endpoint );
     }
 
-    if ( prefix_byte & (1<<4) )
+    if ( endpoint->num_queued_messages == 0 )
     {
-        *ack_bits &= 0x00FFFFFF;
-        *ack_bits |= (uint32_t) ( reliable_read_uint8( &p ) ) << 24;
+        uint8_t * p = endpoint->message_packet;
+        reliable_write_uint16( &p, endpoint->message_id );
+        endpoint->message_packet_bytes = RELIABLE_MESSAGE_PACKET_HEADER_BYTES;
     }
 
-    return (int) ( p - packet_data );
+    uint8_t * p = endpoint->message_packet + endpoint->message_packet_bytes;
+    reliable_write_message_length( &p, message_bytes );
+    memcpy( p, message_data, message_bytes );
+
+    endpoint->message_packet_bytes += length_bytes + message_bytes;
+    endpoint->num_queued_messages++;
+    endpoint->message_id++;
+    endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_MESSAGES_SENT]++;
+
+    reliable_endpoint_timer_activity( endpoint );
+
+    return 1;
 }
 
-int reliable_read_fragment_header( char * name, 
-                                   uint8_t * packet_data, 
-                                   int packet_bytes, 
-                                   int max_fragments, 
-                                   int fragment_size, 
-                                   int * fragment_id, 
-                                   int * num_fragments, 
-                                   int * fragment_bytes, 
-                                   uint16_t * sequence, 
-                                   uint16_t * ack, 
-                                   uint32_t * ack_bits )
+// reliable messages are written first: a count, then per message its id, length and data. each message in the send window goes
+// out once and then again every resend interval until acked. the ids written are remembered against the packet sequence
+
+#define RELIABLE_MAX_RELIABLE_MESSAGES_PER_PACKET 64
+#define RELIABLE_RELIABLE_MESSAGE_HEADER_BYTES 1
+
+struct reliable_message_entry_t
 {
-    if ( packet_bytes < RELIABLE_FRAGMENT_HEADER_BYTES )
-    {
-        reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] packet is too small to read fragment header\n", name );
-        return -1;
-    }
+    uint8_t * data;
+    double send_time;
+    int bytes;
+    int num_sends;
+};
 
-    uint8_t * p = packet_data;
+struct reliable_message_sent_packet_t
+{
+    int num_message_ids;
+    uint16_t message_ids[RELIABLE_MAX_RELIABLE_MESSAGES_PER_PACKET];
+};
 
-    uint8_t prefix_byte =reliable_read_uint8( &p );
-    if ( prefix_byte != 1 )
+static void reliable_message_entry_cleanup( void * _entry, void * allocator_context, void (*free_function)(void*,void*) )
+{
+    struct reliable_message_entry_t * entry = (struct reliable_message_entry_t*) _entry;
+    if ( entry->data )
     {
-        reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] prefix byte is not a fragment\n", name );
-        return -1;
+        free_function( allocator_context, entry->data );
+        entry->data = NULL;
     }
-    
-    *sequence = reliable_read_uint16( &p );
-    *fragment_id = (int) reliable_read_uint8( &p );
-    *num_fragments = ( (int) reliable_read_uint8( &p ) ) + 1;
+}
 
-    if ( *num_fragments > max_fragments )
-    {
-        reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] num fragments %d outside of range of max fragments %d\n", name, *num_fragments, max_fragments );
-        return -1;
-    }
+static void reliable_endpoint_create_message_channel( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint->message_send_queue == NULL );
+
+    endpoint->message_send_queue = reliable_sequence_buffer_create( endpoint->config.reliable_message_window, 
+                                                                    sizeof( struct reliable_message_entry_t ), 
+                                                                    endpoint->allocator_context, 
+                                                                    endpoint->allocate_function, 
+                                                                    endpoint->free_function );
+
+    endpoint->message_receive_queue = reliable_sequence_buffer_create( endpoint->config.reliable_message_window, 
+                                                                       sizeof( struct reliable_message_entry_t ), 
+                                                                       endpoint->allocator_context, 
+                                                                       endpoint->allocate_function, 
+                                                                       endpoint->free_function );
+
+    endpoint->message_sent_packets = reliable_sequence_buffer_create( endpoint->config.sent_packets_buffer_size, 
+                                                                      sizeof( struct reliable_message_sent_packet_t ), 
+                                                                      endpoint->allocator_context, 
+                                                                      endpoint->allocate_function, 
+                                                                      endpoint->free_function );
+
+    endpoint->reliable_message_packet = (uint8_t*) endpoint->allocate_function( endpoint->allocator_context, endpoint->config.max_message_packet_bytes );
+}
 
-    if ( *fragment_id >= *num_fragments )
+static void reliable_endpoint_reset_message_channel( struct reliable_endpoint_t * endpoint )
+{
+    int i;
+    for ( i = 0; i < endpoint->config.reliable_message_window; ++i )
     {
-        reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] fragment id %d outside of range of num fragments %d\n", name, *fragment_id, *num_fragments );
-        return -1;
+        reliable_message_entry_cleanup( endpoint->message_send_queue->entry_data + i * sizeof( struct reliable_message_entry_t ), endpoint->allocator_context, endpoint->free_function );
+        reliable_message_entry_cleanup( endpoint->message_receive_queue->entry_data + i * sizeof( struct reliable_message_entry_t ), endpoint->allocator_context, endpoint->free_function );
     }
 
-    *fragment_bytes = packet_bytes - RELIABLE_FRAGMENT_HEADER_BYTES;
-
-    uint16_t packet_sequence = 0;
-    uint16_t packet_ack = 0;
-    uint32_t packet_ack_bits = 0;
-
-    if ( *fragment_id == 0 )
-    {
-        int packet_header_bytes = reliable_read_packet_header( name, 
-                                                               packet_data + RELIABLE_FRAGMENT_HEADER_BYTES, 
-                                                               packet_bytes, 
-                                                               &packet_sequence, 
-                                                               &packet_ack, 
-                                                               &packet_ack_bits );
-
-        if ( packet_header_bytes < 0 )
-        {
-            reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] bad packet header in fragment\n", name );
-            return -1;
-        }
-
-        if ( packet_sequence != *sequence )
-        {
-            reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] bad packet sequence in fragment. expected %d, got %d\n", name, *sequence, packet_sequence );
-            return -1;
-        }
+    reliable_sequence_buffer_reset( endpoint->message_send_queue );
+    reliable_sequence_buffer_reset( endpoint->message_receive_queue );
+    reliable_sequence_buffer_reset( endpoint->message_sent_packets );
 
-        *fragment_bytes = packet_bytes - packet_header_bytes - RELIABLE_FRAGMENT_HEADER_BYTES;
-    }
+    endpoint->send_message_id = 0;
+    endpoint->oldest_unacked_message_id = 0;
+    endpoint->receive_message_id = 0;
+    endpoint->num_unacked_reliable_messages = 0;
+}
 
-    *ack = packet_ack;
-    *ack_bits = packet_ack_bits;
+int reliable_endpoint_send_reliable_message( struct reliable_endpoint_t * endpoint, uint8_t * message_data, int message_bytes )
+{
+    reliable_assert( endpoint );
+    reliable_assert( message_data );
+    reliable_assert( message_bytes > 0 );
 
-    if ( *fragment_bytes > fragment_size )
+    if ( message_bytes > RELIABLE_MAX_MESSAGE_BYTES || 
+         RELIABLE_RELIABLE_MESSAGE_HEADER_BYTES + 2 + reliable_message_length_bytes( message_bytes ) + message_bytes > endpoint->config.max_message_packet_bytes )
     {
-        reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] fragment bytes %d > fragment size %d\n", name, *fragment_bytes, fragment_size );
-        return - 1;
+        reliable_endpoint_printf( endpoint, RELIABLE_LOG_LEVEL_ERROR, RELIABLE_LOG_EVENT_PACKET_TOO_LARGE_TO_SEND, endpoint->sequence, "[%s] reliable message too large to send. message is %d bytes, maximum message packet is %d\n", 
+            endpoint->config.name, message_bytes, endpoint->config.max_message_packet_bytes );
+        return 0;
     }
 
-    if ( *fragment_id != *num_fragments - 1 && *fragment_bytes != fragment_size )
+    if ( !endpoint->message_send_queue )
     {
-        reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] fragment %d is %d bytes, which is not the expected fragment size %d\n", 
-            name, *fragment_id, *fragment_bytes, fragment_size );
-        return -1;
+        reliable_endpoint_create_message_channel( endpoint );
     }
 
-    return (int) ( p - packet_data );
-}
+    // the slot for the next id still holds the message a full window back until that one is acked
 
-void reliable_store_fragment_data( struct reliable_fragment_reassembly_data_t * reassembly_data, 
-                                   uint16_t sequence, 
-                                   uint16_t ack, 
-                                   uint32_t ack_bits, 
-                                   int fragment_id, 
-                                   int fragment_size, 
-                                   uint8_t * fragment_data, 
-                                   int fragment_bytes )
-{
-    if ( fragment_id == 0 )
-    {
-        uint8_t packet_header[RELIABLE_MAX_PACKET_HEADER_BYTES];
+    if ( !reliable_sequence_buffer_available( endpoint->message_send_queue, endpoint->send_message_id ) )
+        return 0;
 
-        memset( packet_header, 0, RELIABLE_MAX_PACKET_HEADER_BYTES );
+    struct reliable_message_entry_t * entry = (struct reliable_message_entry_t*) reliable_sequence_buffer_insert( endpoint->message_send_queue, endpoint->send_message_id );
 
-        reassembly_data->packet_header_bytes = reliable_write_packet_header( packet_header, sequence, ack, ack_bits );
+    reliable_assert( entry );
 
-        memcpy( reassembly_data->packet_data + RELIABLE_MAX_PACKET_HEADER_BYTES - reassembly_data->packet_header_bytes, 
-                packet_header, 
-                reassembly_data->packet_header_bytes );
+    entry->data = (uint8_t*) endpoint->allocate_function( endpoint->allocator_context, message_bytes );
+    entry->bytes = message_bytes;
+    entry->send_time = 0.0;
+    entry->num_sends = 0;
+    memcpy( entry->data, message_data, message_bytes );
 
-        fragment_data += reassembly_data->packet_header_bytes;
-        fragment_bytes -= reassembly_data->packet_header_bytes;
-    }
+    endpoint->send_message_id++;
+    endpoint->num_unacked_reliable_messages++;
+    endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_RELIABLE_MESSAGES_SENT]++;
 
-    if ( fragment_id == reassembly_data->num_fragments_total - 1 )
-    {
-        reassembly_data->packet_bytes = ( reassembly_data->num_fragments_total - 1 ) * fragment_size + fragment_bytes;
-    }
+    reliable_endpoint_timer_activity( endpoint );
 
-    memcpy( reassembly_data->packet_data + RELIABLE_MAX_PACKET_HEADER_BYTES + fragment_id * fragment_size, fragment_data, fragment_bytes );
+    return 1;
 }
 
-void reliable_endpoint_receive_packet( struct reliable_endpoint_t * endpoint, uint8_t * packet_data, int packet_bytes )
+int reliable_endpoint_num_unacked_reliable_messages( struct reliable_endpoint_t * endpoint )
 {
     reliable_assert( endpoint );
-    reliable_assert( packet_data );
-    reliable_assert( packet_bytes > 0 );
+    return endpoint->num_unacked_reliable_messages;
+}
 
-    if ( packet_bytes > endpoint->config.max_packet_size )
+static double reliable_endpoint_reliable_message_resend_time( struct reliable_endpoint_t * endpoint )
+{
+    double resend_time = endpoint->rtt * 1.25 / 1000.0;
+    if ( resend_time < endpoint->config.reliable_message_min_resend_time )
     {
-        reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] packet too large to receive. packet is %d bytes, maximum is %d\n", 
-            endpoint->config.name, packet_bytes, endpoint->config.max_packet_size );
-        endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_TOO_LARGE_TO_RECEIVE]++;
-        return;
+        resend_time = endpoint->config.reliable_message_min_resend_time;
     }
+    return resend_time;
+}
 
-    uint8_t prefix_byte = packet_data[0];
-
-    if ( ( prefix_byte & 1 ) == 0 )
-    {
-        // regular packet
-
-        endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED]++;
+// the earliest time an unacked reliable message is due to be sent or resent
 
-        uint16_t sequence;
-        uint16_t ack;
-        uint32_t ack_bits;
+static double reliable_endpoint_next_reliable_message_time( struct reliable_endpoint_t * endpoint )
+{
+    double resend_time = reliable_endpoint_reliable_message_resend_time( endpoint );
+    double next_time = DBL_MAX;
 
-        int packet_header_bytes = reliable_read_packet_header( endpoint->config.name, packet_data, packet_bytes, &sequence, &ack, &ack_bits );
-        if ( packet_header_bytes < 0 )
+    uint16_t message_id;
+    for ( message_id = endpoint->oldest_unacked_message_id; message_id != endpoint->send_message_id; ++message_id )
+    {
+        struct reliable_message_entry_t * entry = (struct reliable_message_entry_t*) reliable_sequence_buffer_find( endpoint->message_send_queue, message_id );
+        if ( !entry )
+            continue;
+        if ( entry->num_sends == 0 )
+            return endpoint->time;
+        if ( entry->send_time + resend_time < next_time )
         {
-            reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] ignoring invalid packet. could not read packet header\n", endpoint->config.name );
-            endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_INVALID]++;
-            return;
+            next_time = entry->send_time + resend_time;
         }
+    }
 
-        if ( !reliable_sequence_buffer_test_insert( endpoint->received_packets, sequence ) )
-        {
-            reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] ignoring stale packet %d\n", endpoint->config.name, sequence );
-            endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_STALE]++;
-            return;
-        }
+    return next_time;
+}
 
-        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] processing packet %d\n", endpoint->config.name, sequence );
+static int reliable_endpoint_write_reliable_messages( struct reliable_endpoint_t * endpoint, struct reliable_message_sent_packet_t * sent_packet )
+{
+    if ( endpoint->num_unacked_reliable_messages == 0 )
+        return 0;
 
-        if ( endpoint->config.process_packet_function( endpoint->config.context, 
-                                                       endpoint->config.index, 
-                                                       sequence, 
-                                                       packet_data + packet_header_bytes, 
-                                                       packet_bytes - packet_header_bytes ) )
-        {
-            reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] process packet %d successful\n", endpoint->config.name, sequence );
+    double resend_time = reliable_endpoint_reliable_message_resend_time( endpoint );
 
-            struct reliable_received_packet_data_t * received_packet_data = (struct reliable_received_packet_data_t*) 
-                reliable_sequence_buffer_insert( endpoint->received_packets, sequence );
+    uint16_t * message_ids = sent_packet->message_ids;
+    int num_message_ids = 0;
 
-            reliable_assert( received_packet_data );
+    uint8_t * p = endpoint->reliable_message_packet + RELIABLE_RELIABLE_MESSAGE_HEADER_BYTES;
+    uint8_t * end = endpoint->reliable_message_packet + endpoint->config.max_message_packet_bytes;
 
-            received_packet_data->time = endpoint->time;
-            received_packet_data->packet_bytes = endpoint->config.packet_header_size + packet_bytes;
+    uint16_t message_id;
+    for ( message_id = endpoint->oldest_unacked_message_id; message_id != endpoint->send_message_id && num_message_ids < RELIABLE_MAX_RELIABLE_MESSAGES_PER_PACKET; ++message_id )
+    {
+        struct reliable_message_entry_t * entry = (struct reliable_message_entry_t*) reliable_sequence_buffer_find( endpoint->message_send_queue, message_id );
+        if ( !entry || ( entry->num_sends > 0 && entry->send_time + resend_time > endpoint->time ) )
+            continue;
 
-            int i;
-            for ( i = 0; i < 32; ++i )
-            {
-                if ( ack_bits & 1 )
-                {                    
-                    uint16_t ack_sequence = ack - ((uint16_t)i);
-                    
-                    struct reliable_sent_packet_data_t * sent_packet_data = (struct reliable_sent_packet_data_t*) 
-                        reliable_sequence_buffer_find( endpoint->sent_packets, ack_sequence );
+        if ( p + 2 + reliable_message_length_bytes( entry->bytes ) + entry->bytes > end )
+            break;
 
-                    if ( sent_packet_data && !sent_packet_data->acked && endpoint->num_acks < endpoint->config.ack_buffer_size )
-                    {
-                        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] acked packet %d\n", endpoint->config.name, ack_sequence );
-                        endpoint->acks[endpoint->num_acks++] = ack_sequence;
-                        endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_ACKED]++;
-                        sent_packet_data->acked = 1;
+        reliable_write_uint16( &p, message_id );
+        reliable_write_message_length( &p, entry->bytes );
+        memcpy( p, entry->data, entry->bytes );
+        p += entry->bytes;
 
-                        float rtt = (float) ( endpoint->time - sent_packet_data->time ) * 1000.0f;
-                        reliable_assert( rtt >= 0.0 );
-                        if ( ( endpoint->rtt == 0.0f && rtt > 0.0f ) || fabs( endpoint->rtt - rtt ) < 0.00001 )
-                        {
-                            endpoint->rtt = rtt;
-                        }
-                        else
-                        {
-                            endpoint->rtt += ( rtt - endpoint->rtt ) * endpoint->config.rtt_smoothing_factor;
-                        }
-                    }
-                }
-                ack_bits >>= 1;
-            }
-        }
-        else
+        if ( entry->num_sends > 0 )
         {
-            reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] process packet failed\n", endpoint->config.name );
+            endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_RELIABLE_MESSAGES_RESENT]++;
         }
+        entry->send_time = endpoint->time;
+        entry->num_sends++;
+
+        message_ids[num_message_ids++] = message_id;
     }
-    else
-    {
-        // fragment packet
 
-        int fragment_id;
-        int num_fragments;
-        int fragment_bytes;
+    if ( num_message_ids == 0 )
+        return 0;
 
-        uint16_t sequence;
-        uint16_t ack;
-        uint32_t ack_bits;
+    endpoint->reliable_message_packet[0] = (uint8_t) num_message_ids;
+    sent_packet->num_message_ids = num_message_ids;
 
-        int fragment_header_bytes = reliable_read_fragment_header( endpoint->config.name, 
-                                                                   packet_data, 
-                                                                   packet_bytes, 
-                                                                   endpoint->config.max_fragments, 
-                                                                   endpoint->config.fragment_size,
-                                                                   &fragment_id, 
-                                                                   &num_fragments, 
-                                                                   &fragment_bytes, 
-                                                                   &sequence, 
-                                                                   &ack, 
-                                                                   &ack_bits );
+    return (int) ( p - endpoint->reliable_message_packet );
+}
 
-        if ( fragment_header_bytes < 0 )
-        {
-            reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] ignoring invalid fragment. could not read fragment header\n", endpoint->config.name );
-            endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_INVALID]++;
-            return;
-        }
+// messages are mapped to a sequence only once a packet carrying them has gone out with it. a packet rejected before
+// taking a sequence must not hand its messages to whatever unrelated packet takes that sequence next
 
-        struct reliable_fragment_reassembly_data_t * reassembly_data = (struct reliable_fragment_reassembly_data_t*) 
-            reliable_sequence_buffer_find( endpoint->fragment_reassembly, sequence );
+static void reliable_endpoint_send_reliable_messages( struct reliable_endpoint_t * endpoint, 
+                                                      struct reliable_message_sent_packet_t * sent_packet, 
+                                                      int packet_bytes, 
+                                                      uint8_t extension_flags, 
+                                                      uint16_t first_message_id, 
+                                                      int num_messages )
+{
+    uint16_t sequence = endpoint->sequence;
 
-        if ( !reassembly_data )
-        {
-            reassembly_data = (struct reliable_fragment_reassembly_data_t*) 
-                reliable_sequence_buffer_insert_with_cleanup( endpoint->fragment_reassembly, sequence, reliable_fragment_reassembly_data_cleanup );
+    if ( !reliable_endpoint_send_packet_internal( endpoint, endpoint->reliable_message_packet, packet_bytes, extension_flags, first_message_id, num_messages, 0 ) )
+        return;
 
-            if ( !reassembly_data )
-            {
-                reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] ignoring invalid fragment. could not insert in reassembly buffer (stale)\n", endpoint->config.name );
-                endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_INVALID]++;
-                return;
-            }
+    struct reliable_message_sent_packet_t * entry = (struct reliable_message_sent_packet_t*) 
+        reliable_sequence_buffer_insert( endpoint->message_sent_packets, sequence );
 
-            int packet_buffer_size = RELIABLE_MAX_PACKET_HEADER_BYTES + num_fragments * endpoint->config.fragment_size;
+    reliable_assert( entry );
 
-            reassembly_data->sequence = sequence;
-            reassembly_data->ack = 0;
-            reassembly_data->ack_bits = 0;
-            reassembly_data->num_fragments_received = 0;
-            reassembly_data->num_fragments_total = num_fragments;
-            reassembly_data->packet_data = (uint8_t*) endpoint->allocate_function( endpoint->allocator_context, packet_buffer_size );
-            reassembly_data->packet_bytes = 0;
-            memset( reassembly_data->fragment_received, 0, sizeof( reassembly_data->fragment_received ) );
-        }
+    entry->num_message_ids = sent_packet->num_message_ids;
+    memcpy( entry->message_ids, sent_packet->message_ids, sent_packet->num_message_ids * sizeof( uint16_t ) );
+}
 
-        if ( num_fragments != (int) reassembly_data->num_fragments_total )
-        {
-            reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] ignoring invalid fragment. fragment count mismatch. expected %d, got %d\n", 
-                endpoint->config.name, (int) reassembly_data->num_fragments_total, num_fragments );
-            endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_INVALID]++;
-            return;
-        }
+static void reliable_endpoint_ack_reliable_messages( struct reliable_endpoint_t * endpoint, uint16_t ack_sequence )
+{
+    struct reliable_message_sent_packet_t * sent_packet = (struct reliable_message_sent_packet_t*) 
+        reliable_sequence_buffer_find( endpoint->message_sent_packets, ack_sequence );
 
-        if ( reassembly_data->fragment_received[fragment_id] )
+    if ( !sent_packet )
+        return;
+
+    int i;
+    for ( i = 0; i < sent_packet->num_message_ids; ++i )
+    {
+        uint16_t message_id = sent_packet->message_ids[i];
+        if ( reliable_sequence_buffer_exists( endpoint->message_send_queue, message_id ) )
         {
-            reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] ignoring fragment %d of packet %d. fragment already received\n", 
-                endpoint->config.name, fragment_id, sequence );
-            return;
+            reliable_sequence_buffer_remove_with_cleanup( endpoint->message_send_queue, message_id, reliable_message_entry_cleanup );
+            endpoint->num_unacked_reliable_messages--;
         }
+    }
 
-        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] received fragment %d of packet %d (%d/%d)\n", 
-            endpoint->config.name, fragment_id, sequence, reassembly_data->num_fragments_received+1, num_fragments );
+    reliable_sequence_buffer_remove( endpoint->message_sent_packets, ack_sequence );
 
-        reassembly_data->num_fragments_received++;
-        reassembly_data->fragment_received[fragment_id] = 1;
+    while ( endpoint->oldest_unacked_message_id != endpoint->send_message_id && 
+            !reliable_sequence_buffer_exists( endpoint->message_send_queue, endpoint->oldest_unacked_message_id ) )
+    {
+        endpoint->oldest_unacked_message_id++;
+    }
+}
 
-        reliable_store_fragment_data( reassembly_data, 
-                                      sequence, 
-                                      ack, 
-                                      ack_bits, 
-                                      fragment_id, 
-                                      endpoint->config.fragment_size, 
-                                      packet_data + fragment_header_bytes, 
-                                      packet_bytes - fragment_header_bytes );
+void reliable_endpoint_flush_messages( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
 
-        if ( reassembly_data->num_fragments_received == reassembly_data->num_fragments_total )
+    struct reliable_message_sent_packet_t sent_packet;
+    int reliable_bytes = endpoint->message_send_queue ? reliable_endpoint_write_reliable_messages( endpoint, &sent_packet ) : 0;
+
+    if ( endpoint->num_queued_messages == 0 )
+    {
+        if ( reliable_bytes > 0 )
         {
-            reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] completed reassembly of packet %d\n", endpoint->config.name, sequence );
+            reliable_endpoint_send_reliable_messages( endpoint, &sent_packet, reliable_bytes, RELIABLE_HEADER_EXTENSION_RELIABLE_MESSAGES, 0, 0 );
+        }
+        return;
+    }
 
-            reliable_endpoint_receive_packet( endpoint, 
-                                              reassembly_data->packet_data + RELIABLE_MAX_PACKET_HEADER_BYTES - reassembly_data->packet_header_bytes, 
-                                              reassembly_data->packet_header_bytes + reassembly_data->packet_bytes );
+    uint16_t first_message_id = (uint16_t) ( endpoint->message_id - endpoint->num_queued_messages );
+    int num_messages = endpoint->num_queued_messages;
 
-            reliable_sequence_buffer_remove_with_cleanup( endpoint->fragment_reassembly, sequence, reliable_fragment_reassembly_data_cleanup );
-        }
+    endpoint->num_queued_messages = 0;
 
-        endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_RECEIVED]++;
+    // reliable and queued messages share one packet when both fit, otherwise the reliable messages go in a packet of their own
+
+    if ( reliable_bytes > 0 && reliable_bytes + endpoint->message_packet_bytes <= endpoint->config.max_message_packet_bytes )
+    {
+        memcpy( endpoint->reliable_message_packet + reliable_bytes, endpoint->message_packet, endpoint->message_packet_bytes );
+        reliable_endpoint_send_reliable_messages( endpoint, 
+                                                  &sent_packet, 
+                                                  reliable_bytes + endpoint->message_packet_bytes, 
+                                                  RELIABLE_HEADER_EXTENSION_RELIABLE_MESSAGES | RELIABLE_HEADER_EXTENSION_MESSAGES, 
+                                                  first_message_id, 
+                                                  num_messages );
+        return;
     }
-}
 
-void reliable_endpoint_free_packet( struct reliable_endpoint_t * endpoint, void * packet )
-{
-    reliable_assert( endpoint );
-    reliable_assert( packet );
-    endpoint->free_function( endpoint->allocator_context, packet );
+    if ( reliable_bytes > 0 )
+    {
+        reliable_endpoint_send_reliable_messages( endpoint, &sent_packet, reliable_bytes, RELIABLE_HEADER_EXTENSION_RELIABLE_MESSAGES, 0, 0 );
+    }
+
+    reliable_endpoint_send_packet_internal( endpoint, 
+                                            endpoint->message_packet, 
+                                            endpoint->message_packet_bytes, 
+                                            RELIABLE_HEADER_EXTENSION_MESSAGES, 
+                                            first_message_id, 
+                                            num_messages, 
+                                            0 );
 }
 
-uint16_t * reliable_endpoint_get_acks( struct reliable_endpoint_t * endpoint, int * num_acks )
+uint16_t reliable_endpoint_next_message_id( struct reliable_endpoint_t * endpoint )
 {
     reliable_assert( endpoint );
-    reliable_assert( num_acks );
-    *num_acks = endpoint->num_acks;
-    return endpoint->acks;
+    return endpoint->message_id;
 }
 
-void reliable_endpoint_clear_acks( struct reliable_endpoint_t * endpoint )
+uint16_t * reliable_endpoint_get_message_acks( struct reliable_endpoint_t * endpoint, int * num_message_acks )
 {
     reliable_assert( endpoint );
-    endpoint->num_acks = 0;
+    reliable_assert( num_message_acks );
+    *num_message_acks = endpoint->num_message_acks;
+    return endpoint->message_acks;
 }
 
-void reliable_endpoint_reset( struct reliable_endpoint_t * endpoint )
+void reliable_endpoint_clear_message_acks( struct reliable_endpoint_t * endpoint )
 {
     reliable_assert( endpoint );
+    endpoint->num_message_acks = 0;
+}
 
-    endpoint->num_acks = 0;
-    endpoint->sequence = 0;
+// the whole payload is validated before any message is delivered, so a malformed packet delivers nothing
 
-    memset( endpoint->acks, 0, endpoint->config.ack_buffer_size * sizeof( uint16_t ) );
+static int reliable_endpoint_process_messages( struct reliable_endpoint_t * endpoint, uint8_t extension_flags, uint8_t * packet_data, int packet_bytes )
+{
+    uint8_t * end = packet_data + packet_bytes;
+    uint8_t * p = packet_data;
+    uint8_t * reliable_end = packet_data;
+    int num_reliable_messages = 0;
 
-    int i;
-    for ( i = 0; i < endpoint->config.fragment_reassembly_buffer_size; ++i )
+    if ( extension_flags & RELIABLE_HEADER_EXTENSION_RELIABLE_MESSAGES )
     {
-        struct reliable_fragment_reassembly_data_t * reassembly_data = (struct reliable_fragment_reassembly_data_t*) 
-            reliable_sequence_buffer_at_index( endpoint->fragment_reassembly, i );
+        if ( !endpoint->config.process_reliable_message_function || packet_bytes < RELIABLE_RELIABLE_MESSAGE_HEADER_BYTES )
+            return 0;
+        num_reliable_messages = reliable_read_uint8( &p );
+        if ( num_reliable_messages == 0 )
+            return 0;
+        int i;
+        for ( i = 0; i < num_reliable_messages; ++i )
+        {
+            if ( end - p < 2 )
+                return 0;
+            p += 2;
+            int message_bytes = reliable_read_message_length( &p, end );
+            if ( message_bytes < 0 )
+                return 0;
+            p += message_bytes;
+        }
+        reliable_end = p;
+    }
 
-        if ( reassembly_data && reassembly_data->packet_data )
+    if ( extension_flags & RELIABLE_HEADER_EXTENSION_MESSAGES )
+    {
+        if ( !endpoint->config.process_message_function || end - p < RELIABLE_MESSAGE_PACKET_HEADER_BYTES )
+            return 0;
+        p += RELIABLE_MESSAGE_PACKET_HEADER_BYTES;
+        int num_messages = 0;
+        while ( p < end )
         {
-            endpoint->free_function( endpoint->allocator_context, reassembly_data->packet_data );
-            reassembly_data->packet_data = NULL;
+            int message_bytes = reliable_read_message_length( &p, end );
+            if ( message_bytes < 0 )
+                return 0;
+            p += message_bytes;
+            num_messages++;
         }
+        if ( num_messages == 0 )
+            return 0;
+    }
+    else if ( p != end )
+    {
+        return 0;
     }
 
-    reliable_sequence_buffer_reset( endpoint->sent_packets );
-    reliable_sequence_buffer_reset( endpoint->received_packets );
-    reliable_sequence_buffer_reset( endpoint->fragment_reassembly );
-}
+    if ( num_reliable_messages > 0 )
+    {
+        if ( !endpoint->message_send_queue )
+        {
+            reliable_endpoint_create_message_channel( endpoint );
+        }
 
-void reliable_endpoint_update( struct reliable_endpoint_t * endpoint, double time )
-{
-    reliable_assert( endpoint );
+        // messages behind the receive id were delivered already and are resends. anything else waits in the window until the gap before it fills
 
-    endpoint->time = time;
-    
-    // calculate packet loss
-    {
-        uint32_t base_sequence = ( endpoint->sent_packets->sequence - endpoint->config.sent_packets_buffer_size + 1 ) + 0xFFFF;
-        int i;
-        int num_dropped = 0;
-        int num_samples = endpoint->config.sent_packets_buffer_size / 2;
-        for ( i = 0; i < num_samples; ++i )
+        p = packet_data + RELIABLE_RELIABLE_MESSAGE_HEADER_BYTES;
+        while ( p < reliable_end )
         {
-            uint16_t sequence = (uint16_t) ( base_sequence + i );
-            struct reliable_sent_packet_data_t * sent_packet_data = (struct reliable_sent_packet_data_t*) 
-                reliable_sequence_buffer_find( endpoint->sent_packets, sequence );
-            if ( sent_packet_data && !sent_packet_data->acked )
+            uint16_t message_id = reliable_read_uint16( &p );
+            int message_bytes = reliable_read_message_length( &p, reliable_end );
+            if ( !reliable_sequence_less_than( message_id, endpoint->receive_message_id ) && 
+                 reliable_sequence_less_than( message_id, (uint16_t) ( endpoint->receive_message_id + endpoint->config.reliable_message_window ) ) &&
+                 !reliable_sequence_buffer_exists( endpoint->message_receive_queue, message_id ) )
             {
-                num_dropped++;
+                struct reliable_message_entry_t * entry = (struct reliable_message_entry_t*) 
+                    reliable_sequence_buffer_insert_with_cleanup( endpoint->message_receive_queue, message_id, reliable_message_entry_cleanup );
+                reliable_assert( entry );
+                entry->data = (uint8_t*) endpoint->allocate_function( endpoint->allocator_context, message_bytes );
+                entry->bytes = message_bytes;
+                memcpy( entry->data, p, message_bytes );
             }
+            p += message_bytes;
         }
-        float packet_loss = ( (float) num_dropped ) / ( (float) num_samples ) * 100.0f;
-        if ( fabs( endpoint->packet_loss - packet_loss ) > 0.00001 )
+
+        struct reliable_message_entry_t * entry;
+        while ( ( entry = (struct reliable_message_entry_t*) reliable_sequence_buffer_find( endpoint->message_receive_queue, endpoint->receive_message_id ) ) != NULL )
         {
-            endpoint->packet_loss += ( packet_loss - endpoint->packet_loss ) * endpoint->config.packet_loss_smoothing_factor;
+            endpoint->config.process_reliable_message_function( endpoint->config.context, endpoint->config.index, endpoint->receive_message_id, entry->data, entry->bytes );
+            endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_RELIABLE_MESSAGES_RECEIVED]++;
+            reliable_sequence_buffer_remove_with_cleanup( endpoint->message_receive_queue, endpoint->receive_message_id, reliable_message_entry_cleanup );
+            endpoint->receive_message_id++;
         }
-        else
+    }
+
+    if ( extension_flags & RELIABLE_HEADER_EXTENSION_MESSAGES )
+    {
+        p = reliable_end;
+        uint16_t message_id = reliable_read_uint16( &p );
+        while ( p < end )
         {
-            endpoint->packet_loss = packet_loss;
+            int message_bytes = reliable_read_message_length( &p, end );
+            if ( !endpoint->config.process_message_function( endpoint->config.context, endpoint->config.index, message_id, p, message_bytes ) )
+                return 0;
+            endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_MESSAGES_RECEIVED]++;
+            p += message_bytes;
+            message_id++;
         }
     }
 
-    // calculate sent bandwidth
+    return 1;
+}
+
+int reliable_read_packet_header_extended( RELIABLE_CONST char * name, 
+                                         uint8_t * packet_data, 
+                                         int packet_bytes, 
+                                         uint16_t * sequence, 
+                                         uint16_t * ack, 
+                                         uint32_t * ack_bits, 
+                                         struct reliable_header_extension_t * extension )
+{
+    if ( packet_bytes < 3 )
     {
-        uint32_t base_sequence = ( endpoint->sent_packets->sequence - endpoint->config.sent_packets_buffer_size + 1 ) + 0xFFFF;
-        int i;
-        int bytes_sent = 0;
-        double start_time = FLT_MAX;
-        double finish_time = 0.0;
-        int num_samples = endpoint->config.sent_packets_buffer_size / 2;
-        for ( i = 0; i < num_samples; ++i )
+        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] packet too small for packet header (1)\n", name );
+        return -1;
+    }
+
+    uint8_t * p = packet_data;
+
+    uint8_t prefix_byte = reliable_read_uint8( &p );
+
+    if ( ( prefix_byte & 1 ) != 0 )
+    {
+        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] prefix byte does not indicate a regular packet\n", name );
+        return -1;
+    }
+
+    *sequence = reliable_read_uint16( &p );
+
+    if ( prefix_byte & (1<<5) )
+    {
+        if ( packet_bytes < 3 + 1 )
         {
-            uint16_t sequence = (uint16_t) ( base_sequence + i );
-            struct reliable_sent_packet_data_t * sent_packet_data = (struct reliable_sent_packet_data_t*) 
-                reliable_sequence_buffer_find( endpoint->sent_packets, sequence );
-            if ( !sent_packet_data )
-            {
-                continue;
-            }
-            bytes_sent += sent_packet_data->packet_bytes;
-            if ( sent_packet_data->time < start_time )
-            {
-                start_time = sent_packet_data->time;
-            }
-            if ( sent_packet_data->time > finish_time )
-            {
-                finish_time = sent_packet_data->time;
-            }
+            reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] packet too small for packet header (2)\n", name );
+            return -1;
         }
-        if ( start_time != FLT_MAX && finish_time != 0.0 )
+        uint8_t sequence_difference = reliable_read_uint8( &p );
+        *ack = *sequence - sequence_difference;
+    }
+    else
+    {
+        if ( packet_bytes < 3 + 2 )
         {
-            float sent_bandwidth_kbps = (float) ( ( (double) bytes_sent ) / ( finish_time - start_time ) * 8.0f / 1000.0f );
-            if ( fabs( endpoint->sent_bandwidth_kbps - sent_bandwidth_kbps ) > 0.00001 )
-            {
-                endpoint->sent_bandwidth_kbps += ( sent_bandwidth_kbps - endpoint->sent_bandwidth_kbps ) * endpoint->config.bandwidth_smoothing_factor;
-            }
-            else
-            {
-                endpoint->sent_bandwidth_kbps = sent_bandwidth_kbps;
-            }
+            reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] packet too small for packet header (3)\n", name );
+            return -1;
         }
+        *ack = reliable_read_uint16( &p );
     }
 
-    // calculate received bandwidth
+    int expected_bytes = 0;
+    int i;
+    for ( i = 1; i <= 4; ++i )
     {
-        uint32_t base_sequence = ( endpoint->received_packets->sequence - endpoint->config.received_packets_buffer_size + 1 ) + 0xFFFF;
-        int i;
-        int bytes_sent = 0;
-        double start_time = FLT_MAX;
-        double finish_time = 0.0;
-        int num_samples = endpoint->config.received_packets_buffer_size / 2;
-        for ( i = 0; i < num_samples; ++i )
+        if ( prefix_byte & (1<<i) )
         {
-            uint16_t sequence = (uint16_t) ( base_sequence + i );
-            struct reliable_received_packet_data_t * received_packet_data = (struct reliable_received_packet_data_t*) 
-                reliable_sequence_buffer_find( endpoint->received_packets, sequence );
-            if ( !received_packet_data )
-            {
-                continue;
-            }
-            bytes_sent += received_packet_data->packet_bytes;
-            if ( received_packet_data->time < start_time )
-            {
-                start_time = received_packet_data->time;
-            }
-            if ( received_packet_data->time > finish_time )
-            {
-                finish_time = received_packet_data->time;
-            }
+            expected_bytes++;
         }
-        if ( start_time != FLT_MAX && finish_time != 0.0 )
+    }
+    if ( packet_bytes < ( p - packet_data ) + expected_bytes )
+    {
+        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] packet too small for packet header (4)\n", name );
+        return -1;
+    }
+
+    *ack_bits = 0xFFFFFFFF;
+
+    if ( prefix_byte & (1<<1) )
+    {
+        *ack_bits &= 0xFFFFFF00;
+        *ack_bits |= (uint32_t) ( reliable_read_uint8( &p ) );
+    }
+
+    if ( prefix_byte & (1<<2) )
+    {
+        *ack_bits &= 0xFFFF00FF;
+        *ack_bits |= (uint32_t) ( reliable_read_uint8( &p ) ) << 8;
+    }
+
+    if ( prefix_byte & (1<<3) )
+    {
+        *ack_bits &= 0xFF00FFFF;
+        *ack_bits |= (uint32_t) ( reliable_read_uint8( &p ) ) << 16;
+    }
+
+    if ( prefix_byte & (1<<4) )
+    {
+        *ack_bits &= 0x00FFFFFF;
+        *ack_bits |= (uint32_t) ( reliable_read_uint8( &p ) ) << 24;
+    }
+
+    struct reliable_header_extension_t ignored_extension;
+    if ( !extension )
+    {
+        extension = &ignored_extension;
+    }
+
+    memset( extension, 0, sizeof( struct reliable_header_extension_t ) );
+
+    if ( prefix_byte & (1<<6) )
+    {
+        if ( packet_bytes < ( p - packet_data ) + 1 )
         {
-            float received_bandwidth_kbps = (float) ( ( (double) bytes_sent ) / ( finish_time - start_time ) * 8.0f / 1000.0f );
-            if ( fabs( endpoint->received_bandwidth_kbps - received_bandwidth_kbps ) > 0.00001 )
-            {
-                endpoint->received_bandwidth_kbps += ( received_bandwidth_kbps - endpoint->received_bandwidth_kbps ) * endpoint->config.bandwidth_smoothing_factor;
-            }
-            else
-            {
-                endpoint->received_bandwidth_kbps = received_bandwidth_kbps;
-            }
+            reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] packet too small for packet header (5)\n", name );
+            return -1;
+        }
+
+        extension->flags = reliable_read_uint8( &p );
+
+        if ( extension->flags == 0 || ( extension->flags & ~RELIABLE_HEADER_EXTENSION_ALL_FLAGS ) != 0 )
+        {
+            reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] invalid packet header extension flags %x\n", name, extension->flags );
+            return -1;
+        }
+
+        int extension_bytes = 0;
+        if ( extension->flags & RELIABLE_HEADER_EXTENSION_SEND_TIME )
+        {
+            extension_bytes += 4;
+        }
+        if ( extension->flags & RELIABLE_HEADER_EXTENSION_TIMESTAMP_ECHO )
+        {
+            extension_bytes += 8;
+        }
+
+        if ( packet_bytes < ( p - packet_data ) + extension_bytes )
+        {
+            reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] packet too small for packet header (6)\n", name );
+            return -1;
+        }
+
+        if ( extension->flags & RELIABLE_HEADER_EXTENSION_SEND_TIME )
+        {
+            extension->send_time = reliable_read_uint32( &p );
+        }
+
+        if ( extension->flags & RELIABLE_HEADER_EXTENSION_TIMESTAMP_ECHO )
+        {
+            extension->echo_time = reliable_read_uint32( &p );
+            extension->hold_time = reliable_read_uint32( &p );
         }
     }
 
-    // calculate acked bandwidth
+    return (int) ( p - packet_data );
+}
+
+int reliable_read_packet_header( RELIABLE_CONST char * name, uint8_t * packet_data, int packet_bytes, uint16_t * sequence, uint16_t * ack, uint32_t * ack_bits )
+{
+    return reliable_read_packet_header_extended( name, packet_data, packet_bytes, sequence, ack, ack_bits, NULL );
+}
+
+int reliable_read_fragment_header( char * name, 
+                                   uint8_t * packet_data, 
+                                   int packet_bytes, 
+                                   int max_fragments, 
+                                   int fragment_size, 
+                                   int * fragment_id, 
+                                   int * num_fragments, 
+                                   int * fragment_bytes, 
+                                   uint16_t * sequence, 
+                                   uint16_t * ack, 
+                                   uint32_t * ack_bits )
+{
+    if ( packet_bytes < RELIABLE_FRAGMENT_HEADER_BYTES )
+    {
+        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] packet is too small to read fragment header\n", name );
+        return -1;
+    }
+
+    uint8_t * p = packet_data;
+
+    uint8_t prefix_byte =reliable_read_uint8( &p );
+    if ( prefix_byte != 1 )
+    {
+        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] prefix byte is not a fragment\n", name );
+        return -1;
+    }
+    
+    *sequence = reliable_read_uint16( &p );
+    *fragment_id = (int) reliable_read_uint8( &p );
+    *num_fragments = ( (int) reliable_read_uint8( &p ) ) + 1;
+
+    if ( *num_fragments > max_fragments )
+    {
+        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] num fragments %d outside of range of max fragments %d\n", name, *num_fragments, max_fragments );
+        return -1;
+    }
+
+    if ( *fragment_id >= *num_fragments )
+    {
+        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] fragment id %d outside of range of num fragments %d\n", name, *fragment_id, *num_fragments );
+        return -1;
+    }
+
+    *fragment_bytes = packet_bytes - RELIABLE_FRAGMENT_HEADER_BYTES;
+
+    uint16_t packet_sequence = 0;
+    uint16_t packet_ack = 0;
+    uint32_t packet_ack_bits = 0;
+
+    if ( *fragment_id == 0 )
+    {
+        int packet_header_bytes = reliable_read_packet_header( name, 
+                                                               packet_data + RELIABLE_FRAGMENT_HEADER_BYTES, 
+                                                               packet_bytes, 
+                                                               &packet_sequence, 
+                                                               &packet_ack, 
+                                                               &packet_ack_bits );
+
+        if ( packet_header_bytes < 0 )
+        {
+            reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] bad packet header in fragment\n", name );
+            return -1;
+        }
+
+        if ( packet_sequence != *sequence )
+        {
+            reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] bad packet sequence in fragment. expected %d, got %d\n", name, *sequence, packet_sequence );
+            return -1;
+        }
+
+        *fragment_bytes = packet_bytes - packet_header_bytes - RELIABLE_FRAGMENT_HEADER_BYTES;
+    }
+
+    *ack = packet_ack;
+    *ack_bits = packet_ack_bits;
+
+    if ( *fragment_bytes > fragment_size )
+    {
+        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] fragment bytes %d > fragment size %d\n", name, *fragment_bytes, fragment_size );
+        return - 1;
+    }
+
+    if ( *fragment_id != *num_fragments - 1 && *fragment_bytes != fragment_size )
+    {
+        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] fragment %d is %d bytes, which is not the expected fragment size %d\n", 
+            name, *fragment_id, *fragment_bytes, fragment_size );
+        return -1;
+    }
+
+    return (int) ( p - packet_data );
+}
+
+void reliable_store_fragment_data( struct reliable_fragment_reassembly_data_t * reassembly_data, 
+                                   int fragment_id, 
+                                   int fragment_size, 
+                                   int packet_header_bytes, 
+                                   uint8_t * fragment_data, 
+                                   int fragment_bytes )
+{
+    if ( fragment_id == 0 )
+    {
+        // the first fragment carries the packet header. copy it as sent so optional header fields survive reassembly
+
+        reliable_assert( packet_header_bytes > 0 );
+        reliable_assert( packet_header_bytes <= RELIABLE_MAX_PACKET_HEADER_BYTES );
+
+        reassembly_data->packet_header_bytes = packet_header_bytes;
+
+        memcpy( reassembly_data->packet_data + RELIABLE_MAX_PACKET_HEADER_BYTES - reassembly_data->packet_header_bytes, 
+                fragment_data, 
+                reassembly_data->packet_header_bytes );
+
+        fragment_data += reassembly_data->packet_header_bytes;
+        fragment_bytes -= reassembly_data->packet_header_bytes;
+    }
+
+    if ( fragment_id == reassembly_data->num_fragments_total - 1 )
+    {
+        reassembly_data->packet_bytes = ( reassembly_data->num_fragments_total - 1 ) * fragment_size + fragment_bytes;
+    }
+
+    memcpy( reassembly_data->packet_data + RELIABLE_MAX_PACKET_HEADER_BYTES + fragment_id * fragment_size, fragment_data, fragment_bytes );
+}
+
+static void reliable_endpoint_process_datagram( struct reliable_endpoint_t * endpoint, uint8_t * packet_data, int packet_bytes )
+{
+    reliable_assert( endpoint );
+    reliable_assert( packet_data );
+    reliable_assert( packet_bytes > 0 );
+
+    if ( packet_bytes > endpoint->config.max_packet_size )
+    {
+        reliable_endpoint_printf( endpoint, RELIABLE_LOG_LEVEL_ERROR, RELIABLE_LOG_EVENT_PACKET_TOO_LARGE_TO_RECEIVE, 0, "[%s] packet too large to receive. packet is %d bytes, maximum is %d\n", 
+            endpoint->config.name, packet_bytes, endpoint->config.max_packet_size );
+        endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_TOO_LARGE_TO_RECEIVE]++;
+        reliable_endpoint_trace_event( endpoint, RELIABLE_TRACE_INVALID, 0, 0, packet_bytes );
+        return;
+    }
+
+    reliable_endpoint_timer_activity( endpoint );
+
+    uint8_t prefix_byte = packet_data[0];
+
+    if ( ( prefix_byte & 1 ) == 0 )
+    {
+        // regular packet
+
+        endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED]++;
+
+        uint16_t sequence;
+        uint16_t ack;
+        uint32_t ack_bits;
+
+        RELIABLE_PROFILE_BEGIN( header_read );
+
+        struct reliable_header_extension_t extension;
+
+        int packet_header_bytes = reliable_read_packet_header_extended( endpoint->config.name, packet_data, packet_bytes, &sequence, &ack, &ack_bits, &extension );
+
+        RELIABLE_PROFILE_END( endpoint, RELIABLE_PROFILE_HEADER_READ, header_read );
+
+        if ( packet_header_bytes < 0 )
+        {
+            reliable_endpoint_printf( endpoint, RELIABLE_LOG_LEVEL_ERROR, RELIABLE_LOG_EVENT_INVALID_PACKET, 0, "[%s] ignoring invalid packet. could not read packet header\n", endpoint->config.name );
+            endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_INVALID]++;
+            reliable_endpoint_trace_event( endpoint, RELIABLE_TRACE_INVALID, 0, 0, packet_bytes );
+            return;
+        }
+
+        if ( !reliable_sequence_buffer_test_insert( endpoint->received_packets, sequence ) )
+        {
+            reliable_endpoint_printf( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_STALE_PACKET, sequence, "[%s] ignoring stale packet %d\n", endpoint->config.name, sequence );
+            endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_STALE]++;
+            reliable_endpoint_trace_event( endpoint, RELIABLE_TRACE_STALE, sequence, 0, packet_bytes );
+            return;
+        }
+
+        reliable_endpoint_trace_event( endpoint, RELIABLE_TRACE_RECEIVE, sequence, 0, packet_bytes );
+
+        reliable_endpoint_printf( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_PROCESS_PACKET, sequence, "[%s] processing packet %d\n", endpoint->config.name, sequence );
+
+        int processed;
+        if ( extension.flags & ( RELIABLE_HEADER_EXTENSION_MESSAGES | RELIABLE_HEADER_EXTENSION_RELIABLE_MESSAGES ) )
+        {
+            processed = reliable_endpoint_process_messages( endpoint, extension.flags, packet_data + packet_header_bytes, packet_bytes - packet_header_bytes );
+        }
+        else
+        {
+            processed = endpoint->config.process_packet_function( endpoint->config.context, 
+                                                                  endpoint->config.index, 
+                                                                  sequence, 
+                                                                  packet_data + packet_header_bytes, 
+                                                                  packet_bytes - packet_header_bytes );
+        }
+
+        if ( processed )
+        {
+            reliable_endpoint_printf( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_PROCESS_PACKET_SUCCEEDED, sequence, "[%s] process packet %d successful\n", endpoint->config.name, sequence );
+
+            struct reliable_received_packet_data_t * received_packet_data = (struct reliable_received_packet_data_t*) 
+                reliable_sequence_buffer_insert( endpoint->received_packets, sequence );
+
+            reliable_assert( received_packet_data );
+
+            received_packet_data->time = endpoint->time;
+            received_packet_data->packet_bytes = endpoint->config.packet_header_size + packet_bytes;
+            received_packet_data->send_time = extension.send_time;
+
+            if ( extension.flags & RELIABLE_HEADER_EXTENSION_SEND_TIME )
+            {
+                reliable_endpoint_update_jitter( endpoint, reliable_timestamp( received_packet_data->time ), received_packet_data->send_time );
+
+                endpoint->echo_time = extension.send_time;
+                endpoint->echo_receive_time = endpoint->time;
+                endpoint->has_echo = 1;
+
+                if ( extension.flags & RELIABLE_HEADER_EXTENSION_TIMESTAMP_ECHO )
+                {
+                    reliable_endpoint_update_clock( endpoint, extension.echo_time, extension.hold_time, extension.send_time, reliable_timestamp( endpoint->time ) );
+                }
+            }
+
+            RELIABLE_PROFILE_BEGIN( ack_processing );
+
+            if ( !endpoint->has_peer_ack || reliable_sequence_greater_than( ack, endpoint->peer_ack ) )
+            {
+                endpoint->peer_ack = ack;
+                endpoint->has_peer_ack = 1;
+            }
+
+            int i;
+            for ( i = 0; i < 32; ++i )
+            {
+                if ( ack_bits & 1 )
+                {                    
+                    uint16_t ack_sequence = ack - ((uint16_t)i);
+                    
+                    struct reliable_sent_packet_data_t * sent_packet_data = (struct reliable_sent_packet_data_t*) 
+                        reliable_sequence_buffer_find( endpoint->sent_packets, ack_sequence );
+
+                    // reliable messages must not wait on the application draining its acks, so they are acked first
+
+                    if ( endpoint->message_send_queue )
+                    {
+                        reliable_endpoint_ack_reliable_messages( endpoint, ack_sequence );
+                    }
+
+                    // every ack marks the packet acked and feeds rtt and congestion control. only the application facing acks array
+                    // can fill up, and acks past it are dropped and counted. a packet already reported through packet_lost_function
+                    // is not reported again, by callback or acks array, and its late ack is counted apart from the packets acked
+
+                    if ( sent_packet_data && !sent_packet_data->acked )
+                    {
+                        reliable_endpoint_printf( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_PACKET_ACKED, ack_sequence, "[%s] acked packet %d\n", endpoint->config.name, ack_sequence );
+
+                        float rtt = (float) ( endpoint->time - sent_packet_data->time ) * 1000.0f;
+                        reliable_assert( rtt >= 0.0 );
+
+                        const int reported_lost = sent_packet_data->lost && endpoint->config.packet_lost_function;
+
+                        if ( reported_lost )
+                        {
+                            endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_ACKED_AFTER_LOST]++;
+                        }
+                        else if ( endpoint->config.packet_acked_function )
+                        {
+                            endpoint->config.packet_acked_function( endpoint->config.context, endpoint->config.index, ack_sequence, sent_packet_data->cookie, rtt );
+                        }
+                        else if ( endpoint->num_acks < endpoint->config.ack_buffer_size )
+                        {
+                            struct reliable_ack_t * ack_record = endpoint->ack_records + endpoint->num_acks;
+                            ack_record->cookie = sent_packet_data->cookie;
+                            ack_record->rtt = rtt;
+                            ack_record->sequence = ack_sequence;
+
+                            endpoint->acks[endpoint->num_acks++] = ack_sequence;
+                        }
+                        else
+                        {
+                            endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_ACKS_DROPPED]++;
+                        }
+
+                        if ( !reported_lost )
+                        {
+                            endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_ACKED]++;
+                        }
+
+                        sent_packet_data->acked = 1;
+                        reliable_endpoint_trace_event( endpoint, RELIABLE_TRACE_ACK, ack_sequence, 0, 0 );
+
+                        // a full message ack buffer drops message acks, never the packet ack that carried them
+
+                        int j;
+                        for ( j = 0; j < sent_packet_data->num_messages; ++j )
+                        {
+                            if ( endpoint->num_message_acks < endpoint->config.message_ack_buffer_size )
+                            {
+                                endpoint->message_acks[endpoint->num_message_acks++] = (uint16_t) ( sent_packet_data->first_message_id + j );
+                            }
+                            else
+                            {
+                                endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_MESSAGE_ACKS_DROPPED]++;
+                            }
+                        }
+                        endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_MESSAGES_ACKED] += sent_packet_data->num_messages;
+
+                        reliable_rtt_histogram_add( &endpoint->rtt_histogram, rtt );
+
+                        // as in rfc 6298: variance is updated against the smoothed rtt before that takes the new sample
+
+                        if ( endpoint->loss_rtt == 0.0f && rtt > 0.0f )
+                        {
+                            endpoint->loss_rtt = rtt;
+                            endpoint->rtt_variance = rtt * 0.5f;
+                        }
+                        else
+                        {
+                            endpoint->rtt_variance += ( (float) fabs( endpoint->loss_rtt - rtt ) - endpoint->rtt_variance ) * RELIABLE_RTT_VARIANCE_SMOOTHING_FACTOR;
+                            endpoint->loss_rtt += ( rtt - endpoint->loss_rtt ) * RELIABLE_LOSS_RTT_SMOOTHING_FACTOR;
+                        }
+
+                        if ( ( endpoint->rtt == 0.0f && rtt > 0.0f ) || fabs( endpoint->rtt - rtt ) < 0.00001 )
+                        {
+                            endpoint->rtt = rtt;
+                        }
+                        else
+                        {
+                            endpoint->rtt += ( rtt - endpoint->rtt ) * endpoint->config.rtt_smoothing_factor;
+                        }
+
+                        if ( endpoint->congestion_control_state && !sent_packet_data->lost )
+                        {
+                            endpoint->congestion.bytes_in_flight -= sent_packet_data->packet_bytes;
+                            endpoint->congestion.rtt = endpoint->rtt;
+                            if ( endpoint->config.congestion_control.packet_acked_function )
+                            {
+                                endpoint->config.congestion_control.packet_acked_function( endpoint->congestion_control_state, 
+                                                                                           &endpoint->congestion, 
+                                                                                           endpoint->time, 
+                                                                                           sent_packet_data->packet_bytes, 
+                                                                                           rtt );
+                            }
+                        }
+                    }
+                }
+                ack_bits >>= 1;
+            }
+
+            if ( endpoint->config.packet_lost_function || endpoint->congestion_control_state )
+            {
+                reliable_endpoint_detect_lost_packets( endpoint );
+            }
+
+            RELIABLE_PROFILE_END( endpoint, RELIABLE_PROFILE_ACK_PROCESSING, ack_processing );
+        }
+        else
+        {
+            reliable_endpoint_printf( endpoint, RELIABLE_LOG_LEVEL_ERROR, RELIABLE_LOG_EVENT_PROCESS_PACKET_FAILED, sequence, "[%s] process packet failed\n", endpoint->config.name );
+        }
+    }
+    else
+    {
+        // fragment packet
+
+        int fragment_id;
+        int num_fragments;
+        int fragment_bytes;
+
+        uint16_t sequence;
+        uint16_t ack;
+        uint32_t ack_bits;
+
+        RELIABLE_PROFILE_BEGIN( header_read );
+
+        int fragment_header_bytes = reliable_read_fragment_header( endpoint->config.name, 
+                                                                   packet_data, 
+                                                                   packet_bytes, 
+                                                                   endpoint->config.max_fragments, 
+                                                                   endpoint->config.fragment_size,
+                                                                   &fragment_id, 
+                                                                   &num_fragments, 
+                                                                   &fragment_bytes, 
+                                                                   &sequence, 
+                                                                   &ack, 
+                                                                   &ack_bits );
+
+        RELIABLE_PROFILE_END( endpoint, RELIABLE_PROFILE_HEADER_READ, header_read );
+
+        if ( fragment_header_bytes < 0 )
+        {
+            reliable_endpoint_printf( endpoint, RELIABLE_LOG_LEVEL_ERROR, RELIABLE_LOG_EVENT_INVALID_FRAGMENT, 0, "[%s] ignoring invalid fragment. could not read fragment header\n", endpoint->config.name );
+            endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_INVALID]++;
+            reliable_endpoint_trace_event( endpoint, RELIABLE_TRACE_INVALID, 0, 0, packet_bytes );
+            return;
+        }
+
+        RELIABLE_PROFILE_BEGIN( reassembly );
+
+        struct reliable_fragment_reassembly_data_t * reassembly_data = (struct reliable_fragment_reassembly_data_t*) 
+            reliable_sequence_buffer_find( endpoint->fragment_reassembly, sequence );
+
+        if ( !reassembly_data )
+        {
+            reassembly_data = (struct reliable_fragment_reassembly_data_t*) 
+                reliable_sequence_buffer_insert_with_cleanup( endpoint->fragment_reassembly, sequence, reliable_fragment_reassembly_data_cleanup );
+
+            if ( !reassembly_data )
+            {
+                reliable_endpoint_printf( endpoint, RELIABLE_LOG_LEVEL_ERROR, RELIABLE_LOG_EVENT_STALE_FRAGMENT, sequence, "[%s] ignoring invalid fragment. could not insert in reassembly buffer (stale)\n", endpoint->config.name );
+                endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_INVALID]++;
+                reliable_endpoint_trace_event( endpoint, RELIABLE_TRACE_STALE, sequence, fragment_id, packet_bytes );
+                return;
+            }
+
+            int packet_buffer_size = RELIABLE_MAX_PACKET_HEADER_BYTES + num_fragments * endpoint->config.fragment_size;
+
+            reassembly_data->sequence = sequence;
+            reassembly_data->ack = 0;
+            reassembly_data->ack_bits = 0;
+            reassembly_data->num_fragments_received = 0;
+            reassembly_data->num_fragments_total = num_fragments;
+            reassembly_data->packet_data = (uint8_t*) endpoint->allocate_function( endpoint->allocator_context, packet_buffer_size );
+            reassembly_data->packet_bytes = 0;
+            memset( reassembly_data->fragment_received, 0, sizeof( reassembly_data->fragment_received ) );
+        }
+
+        if ( num_fragments != (int) reassembly_data->num_fragments_total )
+        {
+            reliable_endpoint_printf( endpoint, RELIABLE_LOG_LEVEL_ERROR, RELIABLE_LOG_EVENT_FRAGMENT_COUNT_MISMATCH, sequence, "[%s] ignoring invalid fragment. fragment count mismatch. expected %d, got %d\n", 
+                endpoint->config.name, (int) reassembly_data->num_fragments_total, num_fragments );
+            endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_INVALID]++;
+            reliable_endpoint_trace_event( endpoint, RELIABLE_TRACE_INVALID, sequence, fragment_id, packet_bytes );
+            return;
+        }
+
+        if ( reassembly_data->fragment_received[fragment_id] )
+        {
+            reliable_endpoint_printf( endpoint, RELIABLE_LOG_LEVEL_ERROR, RELIABLE_LOG_EVENT_DUPLICATE_FRAGMENT, sequence, "[%s] ignoring fragment %d of packet %d. fragment already received\n", 
+                endpoint->config.name, fragment_id, sequence );
+            reliable_endpoint_trace_event( endpoint, RELIABLE_TRACE_STALE, sequence, fragment_id, packet_bytes );
+            return;
+        }
+
+        reliable_endpoint_printf( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_RECEIVE_FRAGMENT, sequence, "[%s] received fragment %d of packet %d (%d/%d)\n", 
+            endpoint->config.name, fragment_id, sequence, reassembly_data->num_fragments_received+1, num_fragments );
+
+        reliable_endpoint_trace_event( endpoint, RELIABLE_TRACE_RECEIVE_FRAGMENT, sequence, fragment_id, packet_bytes );
+
+        reassembly_data->num_fragments_received++;
+        reassembly_data->fragment_received[fragment_id] = 1;
+
+        reliable_store_fragment_data( reassembly_data, 
+                                      fragment_id, 
+                                      endpoint->config.fragment_size, 
+                                      packet_bytes - fragment_header_bytes - fragment_bytes, 
+                                      packet_data + fragment_header_bytes, 
+                                      packet_bytes - fragment_header_bytes );
+
+        RELIABLE_PROFILE_END( endpoint, RELIABLE_PROFILE_FRAGMENT_REASSEMBLY, reassembly );
+
+        if ( reassembly_data->num_fragments_received == reassembly_data->num_fragments_total )
+        {
+            reliable_endpoint_printf( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_PACKET_REASSEMBLED, sequence, "[%s] completed reassembly of packet %d\n", endpoint->config.name, sequence );
+
+            reliable_endpoint_trace_event( endpoint, RELIABLE_TRACE_REASSEMBLED, sequence, 0, reassembly_data->packet_bytes );
+
+            reliable_endpoint_process_datagram( endpoint, 
+                                                reassembly_data->packet_data + RELIABLE_MAX_PACKET_HEADER_BYTES - reassembly_data->packet_header_bytes, 
+                                                reassembly_data->packet_header_bytes + reassembly_data->packet_bytes );
+
+            reliable_sequence_buffer_remove_with_cleanup( endpoint->fragment_reassembly, sequence, reliable_fragment_reassembly_data_cleanup );
+        }
+
+        endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_RECEIVED]++;
+    }
+}
+
+void reliable_endpoint_receive_packet( struct reliable_endpoint_t * endpoint, uint8_t * packet_data, int packet_bytes )
+{
+    reliable_assert( endpoint );
+
+    // reassembled packets re-enter through process datagram, so only what came off the wire is captured
+
+    if ( endpoint->capture_file )
+    {
+        reliable_endpoint_capture_packet( endpoint, RELIABLE_PCAPNG_INBOUND, packet_data, packet_bytes );
+    }
+
+    reliable_endpoint_process_datagram( endpoint, packet_data, packet_bytes );
+}
+
+void reliable_endpoint_receive_packet_segments( struct reliable_endpoint_t * endpoint, uint8_t * packet_data, int packet_bytes, int segment_bytes )
+{
+    // a coalesced receive (eg. UDP_GRO on linux) is a train of equal sized datagrams back to back, where only the last one may be shorter.
+    // segment_bytes is the segment size reported by the kernel alongside the buffer. each segment is processed in place, without copying.
+    // fragment 0 carries the packet header on top of a full fragment, so it is longer than the fragments after it and the kernel stops
+    // coalescing at it. a fragmented packet arrives as fragment 0 on its own followed by fragments 1..n-1 as one buffer, ie. two receives.
+
+    reliable_assert( endpoint );
+    reliable_assert( packet_data );
+    reliable_assert( packet_bytes > 0 );
+
+    if ( segment_bytes <= 0 || segment_bytes >= packet_bytes )
+    {
+        reliable_endpoint_receive_packet( endpoint, packet_data, packet_bytes );
+        return;
+    }
+
+    uint8_t * p = packet_data;
+    uint8_t * end = packet_data + packet_bytes;
+
+    while ( p < end )
+    {
+        int bytes = segment_bytes;
+        if ( p + bytes > end )
+        {
+            bytes = (int) ( end - p );
+        }
+
+        reliable_endpoint_receive_packet( endpoint, p, bytes );
+
+        p += bytes;
+    }
+}
+
+void reliable_endpoint_free_packet( struct reliable_endpoint_t * endpoint, void * packet )
+{
+    reliable_assert( endpoint );
+    reliable_assert( packet );
+    endpoint->free_function( endpoint->allocator_context, packet );
+}
+
+uint16_t * reliable_endpoint_get_acks( struct reliable_endpoint_t * endpoint, int * num_acks )
+{
+    reliable_assert( endpoint );
+    reliable_assert( num_acks );
+    *num_acks = endpoint->num_acks;
+    return endpoint->acks;
+}
+
+struct reliable_ack_t * reliable_endpoint_get_ack_records( struct reliable_endpoint_t * endpoint, int * num_acks )
+{
+    reliable_assert( endpoint );
+    reliable_assert( num_acks );
+    *num_acks = endpoint->num_acks;
+    return endpoint->ack_records;
+}
+
+void reliable_endpoint_clear_acks( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    endpoint->num_acks = 0;
+}
+
+void reliable_endpoint_reset( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+
+    endpoint->num_acks = 0;
+    endpoint->sequence = 0;
+    endpoint->loss_sequence = 0;
+    endpoint->has_peer_ack = 0;
+
+    memset( endpoint->acks, 0, endpoint->config.ack_buffer_size * sizeof( uint16_t ) );
+    memset( endpoint->ack_records, 0, endpoint->config.ack_buffer_size * sizeof( struct reliable_ack_t ) );
+
+    int i;
+    for ( i = 0; i < endpoint->config.fragment_reassembly_buffer_size; ++i )
+    {
+        struct reliable_fragment_reassembly_data_t * reassembly_data = (struct reliable_fragment_reassembly_data_t*) 
+            reliable_sequence_buffer_at_index( endpoint->fragment_reassembly, i );
+
+        if ( reassembly_data && reassembly_data->packet_data )
+        {
+            endpoint->free_function( endpoint->allocator_context, reassembly_data->packet_data );
+            reassembly_data->packet_data = NULL;
+        }
+    }
+
+    reliable_sequence_buffer_reset( endpoint->sent_packets );
+    reliable_sequence_buffer_reset( endpoint->received_packets );
+    reliable_sequence_buffer_reset( endpoint->fragment_reassembly );
+
+    reliable_rtt_histogram_reset( &endpoint->rtt_histogram );
+
+    endpoint->num_queued_messages = 0;
+    endpoint->message_id = 0;
+    endpoint->num_message_acks = 0;
+
+    if ( endpoint->message_send_queue )
+    {
+        reliable_endpoint_reset_message_channel( endpoint );
+    }
+
+    if ( endpoint->congestion_control_state )
+    {
+        int state_bytes = endpoint->config.congestion_control.state_bytes > 0 ? endpoint->config.congestion_control.state_bytes : 1;
+        memset( endpoint->congestion_control_state, 0, state_bytes );
+        memset( &endpoint->congestion, 0, sizeof( endpoint->congestion ) );
+        endpoint->config.congestion_control.init_function( endpoint->congestion_control_state, &endpoint->congestion, endpoint->time );
+    }
+
+    endpoint->jitter = 0.0f;
+    endpoint->has_transit = 0;
+    endpoint->has_echo = 0;
+    endpoint->clock_offset = 0.0f;
+    endpoint->outbound_delay = 0.0f;
+    endpoint->inbound_delay = 0.0f;
+    endpoint->num_clock_samples = 0;
+    memset( endpoint->clock_samples, 0, sizeof( endpoint->clock_samples ) );
+}
+
+void reliable_endpoint_update( struct reliable_endpoint_t * endpoint, double time )
+{
+    reliable_assert( endpoint );
+
+    endpoint->time = time;
+
+    if ( endpoint->config.packet_lost_function || endpoint->congestion_control_state )
+    {
+        reliable_endpoint_detect_lost_packets( endpoint );
+    }
+
+    if ( endpoint->congestion_control_state )
+    {
+        endpoint->congestion.rtt = endpoint->rtt;
+        if ( endpoint->config.congestion_control.update_function )
+        {
+            endpoint->config.congestion_control.update_function( endpoint->congestion_control_state, &endpoint->congestion, time );
+        }
+    }
+
+    // messages still queued from the last tick go out now rather than waiting for the next flush, along with reliable messages due a resend
+
+    reliable_endpoint_flush_messages( endpoint );
+
+    const float previous_packet_loss = endpoint->packet_loss;
+    const float previous_sent_bandwidth_kbps = endpoint->sent_bandwidth_kbps;
+    const float previous_received_bandwidth_kbps = endpoint->received_bandwidth_kbps;
+    const float previous_acked_bandwidth_kbps = endpoint->acked_bandwidth_kbps;
+    
+    // calculate packet loss
+    {
+        RELIABLE_PROFILE_BEGIN( stats );
+        int num_samples = 0;
+        int num_dropped = 0;
+        int num_bursts = 0;
+        int burst_length = 0;
+        int max_burst_length = 0;
+        if ( endpoint->config.packet_loss_window > 0.0f )
+        {
+            // only packets sent long enough ago that their ack should have arrived count. walking back from the newest sent
+            // packet, skip those still in flight and stop once past the window
+
+            double finish_time = endpoint->time - reliable_endpoint_loss_threshold( endpoint );
+            double start_time = finish_time - endpoint->config.packet_loss_window;
+            int i;
+            for ( i = 0; i < endpoint->config.sent_packets_buffer_size; ++i )
+            {
+                uint16_t sequence = (uint16_t) ( endpoint->sequence - 1 - i );
+                struct reliable_sent_packet_data_t * sent_packet_data = (struct reliable_sent_packet_data_t*) 
+                    reliable_sequence_buffer_find( endpoint->sent_packets, sequence );
+                if ( !sent_packet_data || sent_packet_data->time > finish_time )
+                    continue;
+                if ( sent_packet_data->time < start_time )
+                    break;
+                num_samples++;
+                if ( !sent_packet_data->acked )
+                {
+                    num_dropped++;
+                    if ( burst_length++ == 0 )
+                        num_bursts++;
+                    if ( burst_length > max_burst_length )
+                        max_burst_length = burst_length;
+                }
+                else
+                {
+                    burst_length = 0;
+                }
+            }
+            if ( num_samples > 0 )
+            {
+                endpoint->packet_loss = ( (float) num_dropped ) / ( (float) num_samples ) * 100.0f;
+            }
+        }
+        else
+        {
+            uint32_t base_sequence = ( endpoint->sent_packets->sequence - endpoint->config.sent_packets_buffer_size + 1 ) + 0xFFFF;
+            int i;
+            num_samples = endpoint->config.sent_packets_buffer_size / 2;
+            for ( i = 0; i < num_samples; ++i )
+            {
+                uint16_t sequence = (uint16_t) ( base_sequence + i );
+                struct reliable_sent_packet_data_t * sent_packet_data = (struct reliable_sent_packet_data_t*) 
+                    reliable_sequence_buffer_find( endpoint->sent_packets, sequence );
+                if ( sent_packet_data && !sent_packet_data->acked )
+                {
+                    num_dropped++;
+                    if ( burst_length++ == 0 )
+                        num_bursts++;
+                    if ( burst_length > max_burst_length )
+                        max_burst_length = burst_length;
+                }
+                else
+                {
+                    burst_length = 0;
+                }
+            }
+            float packet_loss = ( (float) num_dropped ) / ( (float) num_samples ) * 100.0f;
+            if ( fabs( endpoint->packet_loss - packet_loss ) > 0.00001 )
+            {
+                endpoint->packet_loss += ( packet_loss - endpoint->packet_loss ) * endpoint->config.packet_loss_smoothing_factor;
+            }
+            else
+            {
+                endpoint->packet_loss = packet_loss;
+            }
+        }
+        endpoint->average_loss_burst = num_bursts > 0 ? ( (float) num_dropped ) / ( (float) num_bursts ) : 0.0f;
+        endpoint->max_loss_burst = max_burst_length;
+        RELIABLE_PROFILE_END( endpoint, RELIABLE_PROFILE_UPDATE_PACKET_LOSS, stats );
+    }
+
+    // calculate sent bandwidth
+    {
+        RELIABLE_PROFILE_BEGIN( stats );
+        uint32_t base_sequence = ( endpoint->sent_packets->sequence - endpoint->config.sent_packets_buffer_size + 1 ) + 0xFFFF;
+        int i;
+        int bytes_sent = 0;
+        double start_time = FLT_MAX;
+        double finish_time = 0.0;
+        int num_samples = endpoint->config.sent_packets_buffer_size / 2;
+        for ( i = 0; i < num_samples; ++i )
+        {
+            uint16_t sequence = (uint16_t) ( base_sequence + i );
+            struct reliable_sent_packet_data_t * sent_packet_data = (struct reliable_sent_packet_data_t*) 
+                reliable_sequence_buffer_find( endpoint->sent_packets, sequence );
+            if ( !sent_packet_data )
+            {
+                continue;
+            }
+            bytes_sent += sent_packet_data->packet_bytes;
+            if ( sent_packet_data->time < start_time )
+            {
+                start_time = sent_packet_data->time;
+            }
+            if ( sent_packet_data->time > finish_time )
+            {
+                finish_time = sent_packet_data->time;
+            }
+        }
+        if ( start_time != FLT_MAX && finish_time != 0.0 )
+        {
+            float sent_bandwidth_kbps = (float) ( ( (double) bytes_sent ) / ( finish_time - start_time ) * 8.0f / 1000.0f );
+            if ( fabs( endpoint->sent_bandwidth_kbps - sent_bandwidth_kbps ) > 0.00001 )
+            {
+                endpoint->sent_bandwidth_kbps += ( sent_bandwidth_kbps - endpoint->sent_bandwidth_kbps ) * endpoint->config.bandwidth_smoothing_factor;
+            }
+            else
+            {
+                endpoint->sent_bandwidth_kbps = sent_bandwidth_kbps;
+            }
+        }
+        RELIABLE_PROFILE_END( endpoint, RELIABLE_PROFILE_UPDATE_SENT_BANDWIDTH, stats );
+    }
+
+    // calculate received bandwidth
+    {
+        RELIABLE_PROFILE_BEGIN( stats );
+        uint32_t base_sequence = ( endpoint->received_packets->sequence - endpoint->config.received_packets_buffer_size + 1 ) + 0xFFFF;
+        int i;
+        int bytes_sent = 0;
+        double start_time = FLT_MAX;
+        double finish_time = 0.0;
+        int num_samples = endpoint->config.received_packets_buffer_size / 2;
+        for ( i = 0; i < num_samples; ++i )
+        {
+            uint16_t sequence = (uint16_t) ( base_sequence + i );
+            struct reliable_received_packet_data_t * received_packet_data = (struct reliable_received_packet_data_t*) 
+                reliable_sequence_buffer_find( endpoint->received_packets, sequence );
+            if ( !received_packet_data )
+            {
+                continue;
+            }
+            bytes_sent += received_packet_data->packet_bytes;
+            if ( received_packet_data->time < start_time )
+            {
+                start_time = received_packet_data->time;
+            }
+            if ( received_packet_data->time > finish_time )
+            {
+                finish_time = received_packet_data->time;
+            }
+        }
+        if ( start_time != FLT_MAX && finish_time != 0.0 )
+        {
+            float received_bandwidth_kbps = (float) ( ( (double) bytes_sent ) / ( finish_time - start_time ) * 8.0f / 1000.0f );
+            if ( fabs( endpoint->received_bandwidth_kbps - received_bandwidth_kbps ) > 0.00001 )
+            {
+                endpoint->received_bandwidth_kbps += ( received_bandwidth_kbps - endpoint->received_bandwidth_kbps ) * endpoint->config.bandwidth_smoothing_factor;
+            }
+            else
+            {
+                endpoint->received_bandwidth_kbps = received_bandwidth_kbps;
+            }
+        }
+        RELIABLE_PROFILE_END( endpoint, RELIABLE_PROFILE_UPDATE_RECEIVED_BANDWIDTH, stats );
+    }
+
+    // calculate acked bandwidth
+    {
+        RELIABLE_PROFILE_BEGIN( stats );
+        uint32_t base_sequence = ( endpoint->sent_packets->sequence - endpoint->config.sent_packets_buffer_size + 1 ) + 0xFFFF;
+        int i;
+        int bytes_sent = 0;
+        double start_time = FLT_MAX;
+        double finish_time = 0.0;
+        int num_samples = endpoint->config.sent_packets_buffer_size / 2;
+        for ( i = 0; i < num_samples; ++i )
+        {
+            uint16_t sequence = (uint16_t) ( base_sequence + i );
+            struct reliable_sent_packet_data_t * sent_packet_data = (struct reliable_sent_packet_data_t*) 
+                reliable_sequence_buffer_find( endpoint->sent_packets, sequence );
+            if ( !sent_packet_data || !sent_packet_data->acked )
+            {
+                continue;
+            }
+            bytes_sent += sent_packet_data->packet_bytes;
+            if ( sent_packet_data->time < start_time )
+            {
+                start_time = sent_packet_data->time;
+            }
+            if ( sent_packet_data->time > finish_time )
+            {
+                finish_time = sent_packet_data->time;
+            }
+        }
+        if ( start_time != FLT_MAX && finish_time != 0.0 )
+        {
+            float acked_bandwidth_kbps = (float) ( ( (double) bytes_sent ) / ( finish_time - start_time ) * 8.0f / 1000.0f );
+            if ( fabs( endpoint->acked_bandwidth_kbps - acked_bandwidth_kbps ) > 0.00001 )
+            {
+                endpoint->acked_bandwidth_kbps += ( acked_bandwidth_kbps - endpoint->acked_bandwidth_kbps ) * endpoint->config.bandwidth_smoothing_factor;
+            }
+            else
+            {
+                endpoint->acked_bandwidth_kbps = acked_bandwidth_kbps;
+            }
+        }
+        RELIABLE_PROFILE_END( endpoint, RELIABLE_PROFILE_UPDATE_ACKED_BANDWIDTH, stats );
+    }
+
+    if ( endpoint->num_suppressed_error_logs > 0 )
+    {
+        if ( RELIABLE_LOG_LEVEL_ERROR <= RELIABLE_LOG_LEVEL_MAX && RELIABLE_LOG_LEVEL_ERROR <= reliable_endpoint_log_level( endpoint ) && !endpoint->config.log_function )
+        {
+            reliable_endpoint_refill_error_log_tokens( endpoint );
+            reliable_endpoint_report_suppressed_error_logs( endpoint );
+        }
+        else
+        {
+            // nobody would have seen the suppressed errors, so there is nothing to summarize
+            endpoint->num_suppressed_error_logs = 0;
+        }
+    }
+
+    endpoint->update_pending = 0;
+    endpoint->stats_changed = endpoint->packet_loss != previous_packet_loss || 
+                              endpoint->sent_bandwidth_kbps != previous_sent_bandwidth_kbps || 
+                              endpoint->received_bandwidth_kbps != previous_received_bandwidth_kbps || 
+                              endpoint->acked_bandwidth_kbps != previous_acked_bandwidth_kbps;
+
+    reliable_endpoint_publish_stats( endpoint );
+}
+
+double reliable_endpoint_next_update_time( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+
+    // once nothing has been sent or received and the smoothed stats have settled, further updates would not change anything
+
+    if ( endpoint->update_pending || endpoint->stats_changed || endpoint->num_queued_messages > 0 )
+        return endpoint->time;
+
+    double next_update_time = DBL_MAX;
+
+    // unacked reliable messages only need the update that resends them
+
+    if ( endpoint->num_unacked_reliable_messages > 0 )
+    {
+        next_update_time = reliable_endpoint_next_reliable_message_time( endpoint );
+    }
+
+    // packets still in flight need the update that times out the oldest of them, or their loss would never be reported.
+    // acks and sends that could declare a loss sooner wake the endpoint anyway
+
+    if ( endpoint->config.packet_lost_function || endpoint->congestion_control_state )
+    {
+        uint16_t sequence;
+        for ( sequence = endpoint->loss_sequence; sequence != endpoint->sequence; ++sequence )
+        {
+            struct reliable_sent_packet_data_t * sent_packet_data = (struct reliable_sent_packet_data_t*) 
+                reliable_sequence_buffer_find( endpoint->sent_packets, sequence );
+
+            if ( sent_packet_data && !sent_packet_data->acked && !sent_packet_data->lost )
+            {
+                double loss_time = sent_packet_data->time + reliable_endpoint_loss_timeout( endpoint );
+                if ( loss_time < next_update_time )
+                {
+                    next_update_time = loss_time;
+                }
+                break;
+            }
+        }
+    }
+
+    return next_update_time;
+}
+
+float reliable_endpoint_rtt( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    return endpoint->rtt;
+}
+
+float reliable_endpoint_rtt_variance( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    return endpoint->rtt_variance;
+}
+
+// ---------------------------------------------------------------
+
+static int reliable_rtt_histogram_bucket( uint32_t value )
+{
+    if ( value < RELIABLE_RTT_HISTOGRAM_SUB_BUCKETS )
+        return (int) value;
+    int exponent = 0;
+    uint32_t v = value;
+    while ( v >>= 1 )
+        exponent++;
+    int index = ( exponent - 3 ) * RELIABLE_RTT_HISTOGRAM_SUB_BUCKETS + (int) ( ( value >> ( exponent - 4 ) ) & ( RELIABLE_RTT_HISTOGRAM_SUB_BUCKETS - 1 ) );
+    return index < RELIABLE_RTT_HISTOGRAM_NUM_BUCKETS ? index : RELIABLE_RTT_HISTOGRAM_NUM_BUCKETS - 1;
+}
+
+static double reliable_rtt_histogram_bucket_value( int index )
+{
+    if ( index < RELIABLE_RTT_HISTOGRAM_SUB_BUCKETS )
+        return (double) index;
+    int exponent = index / RELIABLE_RTT_HISTOGRAM_SUB_BUCKETS + 3;
+    int sub_bucket = index % RELIABLE_RTT_HISTOGRAM_SUB_BUCKETS;
+    double width = (double) ( 1U << ( exponent - 4 ) );
+    return ( RELIABLE_RTT_HISTOGRAM_SUB_BUCKETS + sub_bucket ) * width + width * 0.5;
+}
+
+void reliable_rtt_histogram_reset( struct reliable_rtt_histogram_t * histogram )
+{
+    reliable_assert( histogram );
+    memset( histogram, 0, sizeof( struct reliable_rtt_histogram_t ) );
+}
+
+void reliable_rtt_histogram_add( struct reliable_rtt_histogram_t * histogram, float rtt )
+{
+    reliable_assert( histogram );
+    reliable_assert( rtt >= 0.0f );
+    double microseconds = rtt * 1000.0;
+    uint32_t value = microseconds < 4294967295.0 ? (uint32_t) microseconds : 0xFFFFFFFF;
+    histogram->buckets[reliable_rtt_histogram_bucket( value )]++;
+    histogram->count++;
+    if ( rtt > histogram->max_rtt )
+        histogram->max_rtt = rtt;
+}
+
+void reliable_rtt_histogram_merge( struct reliable_rtt_histogram_t * histogram, RELIABLE_CONST struct reliable_rtt_histogram_t * other )
+{
+    reliable_assert( histogram );
+    reliable_assert( other );
+    int i;
+    for ( i = 0; i < RELIABLE_RTT_HISTOGRAM_NUM_BUCKETS; ++i )
+    {
+        histogram->buckets[i] += other->buckets[i];
+    }
+    histogram->count += other->count;
+    if ( other->max_rtt > histogram->max_rtt )
+        histogram->max_rtt = other->max_rtt;
+}
+
+float reliable_rtt_histogram_percentile( RELIABLE_CONST struct reliable_rtt_histogram_t * histogram, float percentile )
+{
+    reliable_assert( histogram );
+    reliable_assert( percentile >= 0.0f );
+    reliable_assert( percentile <= 100.0f );
+
+    if ( histogram->count == 0 )
+        return 0.0f;
+
+    uint64_t target = (uint64_t) ceil( histogram->count * ( percentile / 100.0 ) );
+    if ( target == 0 )
+        target = 1;
+    if ( target >= histogram->count )
+        return histogram->max_rtt;
+
+    uint64_t total = 0;
+    int i;
+    for ( i = 0; i < RELIABLE_RTT_HISTOGRAM_NUM_BUCKETS; ++i )
+    {
+        total += histogram->buckets[i];
+        if ( total >= target )
+        {
+            float rtt = (float) ( reliable_rtt_histogram_bucket_value( i ) / 1000.0 );
+            return rtt < histogram->max_rtt ? rtt : histogram->max_rtt;
+        }
+    }
+
+    return histogram->max_rtt;
+}
+
+RELIABLE_CONST struct reliable_rtt_histogram_t * reliable_endpoint_rtt_histogram( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    return &endpoint->rtt_histogram;
+}
+
+void reliable_endpoint_reset_rtt_histogram( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    reliable_rtt_histogram_reset( &endpoint->rtt_histogram );
+}
+
+// ---------------------------------------------------------------
+
+float reliable_endpoint_packet_loss( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    return endpoint->packet_loss;
+}
+
+void reliable_endpoint_packet_loss_bursts( struct reliable_endpoint_t * endpoint, float * average_burst_length, int * max_burst_length )
+{
+    reliable_assert( endpoint );
+    reliable_assert( average_burst_length );
+    reliable_assert( max_burst_length );
+    *average_burst_length = endpoint->average_loss_burst;
+    *max_burst_length = endpoint->max_loss_burst;
+}
+
+float reliable_endpoint_jitter( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    return endpoint->jitter;
+}
+
+float reliable_endpoint_clock_offset( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    return endpoint->clock_offset;
+}
+
+void reliable_endpoint_one_way_delay( struct reliable_endpoint_t * endpoint, float * outbound_delay, float * inbound_delay )
+{
+    reliable_assert( endpoint );
+    reliable_assert( outbound_delay );
+    reliable_assert( inbound_delay );
+    *outbound_delay = endpoint->outbound_delay;
+    *inbound_delay = endpoint->inbound_delay;
+}
+
+void reliable_endpoint_congestion( struct reliable_endpoint_t * endpoint, struct reliable_congestion_state_t * congestion )
+{
+    reliable_assert( endpoint );
+    reliable_assert( congestion );
+    *congestion = endpoint->congestion;
+}
+
+int reliable_endpoint_can_send( struct reliable_endpoint_t * endpoint, int packet_bytes )
+{
+    reliable_assert( endpoint );
+    if ( !endpoint->congestion_control_state )
+        return 1;
+    return endpoint->congestion.bytes_in_flight + endpoint->config.packet_header_size + packet_bytes <= endpoint->congestion.congestion_window;
+}
+
+void reliable_endpoint_bandwidth( struct reliable_endpoint_t * endpoint, float * sent_bandwidth_kbps, float * received_bandwidth_kbps, float * acked_bandwidth_kbps )
+{
+    reliable_assert( endpoint );
+    reliable_assert( sent_bandwidth_kbps );
+    reliable_assert( acked_bandwidth_kbps );
+    reliable_assert( received_bandwidth_kbps );
+    *sent_bandwidth_kbps = endpoint->sent_bandwidth_kbps;
+    *received_bandwidth_kbps = endpoint->received_bandwidth_kbps;
+    *acked_bandwidth_kbps = endpoint->acked_bandwidth_kbps;
+}
+
+RELIABLE_CONST uint64_t * reliable_endpoint_counters( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    return endpoint->counters;
+}
+
+void reliable_endpoint_read_stats( struct reliable_endpoint_t * endpoint, struct reliable_endpoint_stats_t * stats )
+{
+    reliable_assert( endpoint );
+    reliable_assert( stats );
+
+    while ( 1 )
+    {
+        uint32_t published = reliable_atomic_load_acquire( &endpoint->stats_published );
+        struct reliable_stats_slot_t * slot = endpoint->stats_slots + ( published & 1 );
+        uint32_t sequence = reliable_atomic_load_acquire( &slot->sequence );
+        if ( sequence & 1 )
+            continue;
+        memcpy( stats, (const void*) &slot->stats, sizeof( struct reliable_endpoint_stats_t ) );
+        reliable_atomic_fence_acquire();
+        if ( slot->sequence == sequence )
+            return;
+    }
+}
+
+void reliable_endpoint_allocation_stats( struct reliable_endpoint_t * endpoint, struct reliable_allocation_stats_t * stats )
+{
+    reliable_assert( endpoint );
+    reliable_assert( stats );
+    stats->num_allocations = endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_ALLOCATIONS];
+    stats->num_frees = endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_FREES];
+    stats->bytes_allocated = endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_BYTES_ALLOCATED];
+    stats->live_bytes = endpoint->live_bytes;
+    stats->peak_live_bytes = endpoint->peak_live_bytes;
+}
+
+void reliable_allocation_stats( struct reliable_allocation_stats_t * stats )
+{
+    reliable_assert( stats );
+    stats->num_allocations = reliable_atomic_load64( &reliable_global_allocation_stats.num_allocations );
+    stats->num_frees = reliable_atomic_load64( &reliable_global_allocation_stats.num_frees );
+    stats->bytes_allocated = reliable_atomic_load64( &reliable_global_allocation_stats.bytes_allocated );
+    stats->live_bytes = reliable_atomic_load64( &reliable_global_allocation_stats.live_bytes );
+    stats->peak_live_bytes = reliable_atomic_load64( &reliable_global_allocation_stats.peak_live_bytes );
+}
+
+void reliable_endpoint_profile( struct reliable_endpoint_t * endpoint, int span, struct reliable_profile_histogram_t * histogram )
+{
+    reliable_assert( endpoint );
+    reliable_assert( span >= 0 );
+    reliable_assert( span < RELIABLE_PROFILE_NUM_SPANS );
+    reliable_assert( histogram );
+#if RELIABLE_ENABLE_PROFILING
+    *histogram = endpoint->profile[span];
+#else // #if RELIABLE_ENABLE_PROFILING
+    (void) endpoint;
+    (void) span;
+    memset( histogram, 0, sizeof( struct reliable_profile_histogram_t ) );
+#endif // #if RELIABLE_ENABLE_PROFILING
+}
+
+void reliable_endpoint_reset_profile( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+#if RELIABLE_ENABLE_PROFILING
+    memset( endpoint->profile, 0, sizeof( endpoint->profile ) );
+#else // #if RELIABLE_ENABLE_PROFILING
+    (void) endpoint;
+#endif // #if RELIABLE_ENABLE_PROFILING
+}
+
+RELIABLE_CONST char * reliable_profile_span_name( int span )
+{
+    switch ( span )
+    {
+        case RELIABLE_PROFILE_HEADER_WRITE:             return "header_write";
+        case RELIABLE_PROFILE_HEADER_READ:              return "header_read";
+        case RELIABLE_PROFILE_FRAGMENT_SPLIT:           return "fragment_split";
+        case RELIABLE_PROFILE_FRAGMENT_REASSEMBLY:      return "fragment_reassembly";
+        case RELIABLE_PROFILE_ACK_PROCESSING:           return "ack_processing";
+        case RELIABLE_PROFILE_UPDATE_PACKET_LOSS:       return "update_packet_loss";
+        case RELIABLE_PROFILE_UPDATE_SENT_BANDWIDTH:    return "update_sent_bandwidth";
+        case RELIABLE_PROFILE_UPDATE_RECEIVED_BANDWIDTH: return "update_received_bandwidth";
+        case RELIABLE_PROFILE_UPDATE_ACKED_BANDWIDTH:   return "update_acked_bandwidth";
+        default:                                        return "unknown";
+    }
+}
+
+RELIABLE_CONST char * reliable_log_event_name( int event )
+{
+    switch ( event )
+    {
+        case RELIABLE_LOG_EVENT_TRANSMIT_RING_FULL:             return "transmit_ring_full";
+        case RELIABLE_LOG_EVENT_PACKET_TOO_LARGE_TO_SEND:       return "packet_too_large_to_send";
+        case RELIABLE_LOG_EVENT_SEND_PACKET:                    return "send_packet";
+        case RELIABLE_LOG_EVENT_SEND_PACKET_UNFRAGMENTED:       return "send_packet_unfragmented";
+        case RELIABLE_LOG_EVENT_SEND_PACKET_FRAGMENTED:         return "send_packet_fragmented";
+        case RELIABLE_LOG_EVENT_PACKET_TOO_LARGE_TO_RECEIVE:    return "packet_too_large_to_receive";
+        case RELIABLE_LOG_EVENT_INVALID_PACKET:                 return "invalid_packet";
+        case RELIABLE_LOG_EVENT_STALE_PACKET:                   return "stale_packet";
+        case RELIABLE_LOG_EVENT_PROCESS_PACKET:                 return "process_packet";
+        case RELIABLE_LOG_EVENT_PROCESS_PACKET_SUCCEEDED:       return "process_packet_succeeded";
+        case RELIABLE_LOG_EVENT_PROCESS_PACKET_FAILED:          return "process_packet_failed";
+        case RELIABLE_LOG_EVENT_PACKET_ACKED:                   return "packet_acked";
+        case RELIABLE_LOG_EVENT_INVALID_FRAGMENT:               return "invalid_fragment";
+        case RELIABLE_LOG_EVENT_STALE_FRAGMENT:                 return "stale_fragment";
+        case RELIABLE_LOG_EVENT_FRAGMENT_COUNT_MISMATCH:        return "fragment_count_mismatch";
+        case RELIABLE_LOG_EVENT_DUPLICATE_FRAGMENT:             return "duplicate_fragment";
+        case RELIABLE_LOG_EVENT_RECEIVE_FRAGMENT:               return "receive_fragment";
+        case RELIABLE_LOG_EVENT_PACKET_REASSEMBLED:             return "packet_reassembled";
+        default:                                                return "unknown";
+    }
+}
+
+// ---------------------------------------------------------------
+
+#define RELIABLE_UPDATE_MIN_CHUNK_SIZE 16
+#define RELIABLE_UPDATE_CHUNKS_PER_THREAD 8
+
+struct reliable_update_job_t
+{
+    struct reliable_endpoint_t ** endpoints;
+    int num_endpoints;
+    int chunk_size;
+    double time;
+    volatile uint32_t next_chunk;
+};
+
+static void reliable_update_parallel_worker( void * data )
+{
+    struct reliable_update_job_t * job = (struct reliable_update_job_t*) data;
+
+    // every worker claims the next chunk until none are left, so a worker that finishes early takes work from the slow ones
+
+    while ( 1 )
+    {
+        int start = (int) reliable_atomic_fetch_add( &job->next_chunk, 1 ) * job->chunk_size;
+        if ( start >= job->num_endpoints )
+            break;
+        int finish = start + job->chunk_size;
+        if ( finish > job->num_endpoints )
+            finish = job->num_endpoints;
+        int i;
+        for ( i = start; i < finish; ++i )
+        {
+            reliable_endpoint_update( job->endpoints[i], job->time );
+        }
+    }
+}
+
+// thread_pool->run_function( context, task, data ) must call task( data ) once on each of num_threads threads (the calling thread may be one of them)
+// and return only when all of those calls have returned. endpoints are independent in update, so no locking is needed between them.
+
+void reliable_update_parallel( struct reliable_endpoint_t ** endpoints, int num_endpoints, double time, struct reliable_thread_pool_t * thread_pool )
+{
+    reliable_assert( endpoints || num_endpoints == 0 );
+    reliable_assert( num_endpoints >= 0 );
+
+    struct reliable_update_job_t job;
+    job.endpoints = endpoints;
+    job.num_endpoints = num_endpoints;
+    job.time = time;
+    job.next_chunk = 0;
+    job.chunk_size = num_endpoints;
+
+    if ( !thread_pool || thread_pool->num_threads <= 1 || num_endpoints <= RELIABLE_UPDATE_MIN_CHUNK_SIZE )
+    {
+        reliable_update_parallel_worker( &job );
+        return;
+    }
+
+    reliable_assert( thread_pool->run_function );
+
+    job.chunk_size = num_endpoints / ( thread_pool->num_threads * RELIABLE_UPDATE_CHUNKS_PER_THREAD );
+    if ( job.chunk_size < RELIABLE_UPDATE_MIN_CHUNK_SIZE )
+    {
+        job.chunk_size = RELIABLE_UPDATE_MIN_CHUNK_SIZE;
+    }
+
+    thread_pool->run_function( thread_pool->context, reliable_update_parallel_worker, &job );
+
+    reliable_assert( (int) job.next_chunk * job.chunk_size >= num_endpoints );
+}
+
+// ---------------------------------------------------------------
+
+#define RELIABLE_TIMER_WHEEL_LEVELS         4
+#define RELIABLE_TIMER_WHEEL_SLOT_BITS      6
+#define RELIABLE_TIMER_WHEEL_SLOTS          ( 1 << RELIABLE_TIMER_WHEEL_SLOT_BITS )
+#define RELIABLE_TIMER_WHEEL_SLOT_MASK      ( RELIABLE_TIMER_WHEEL_SLOTS - 1 )
+#define RELIABLE_TIMER_WHEEL_NEVER          0xFFFFFFFFFFFFFFFFULL
+
+struct reliable_timer_wheel_t
+{
+    void * allocator_context;
+    void * (*allocate_function)(void*,uint64_t);
+    void (*free_function)(void*,void*);
+    double start_time;
+    double tick_time;
+    double time;
+    uint64_t current_tick;
+    int num_endpoints;
+    uint64_t occupied[RELIABLE_TIMER_WHEEL_LEVELS];
+    struct reliable_endpoint_t * slots[RELIABLE_TIMER_WHEEL_LEVELS][RELIABLE_TIMER_WHEEL_SLOTS];
+};
+
+struct reliable_timer_wheel_t * reliable_timer_wheel_create( double time, 
+                                                             double tick_time, 
+                                                             void * allocator_context, 
+                                                             void * (*allocate_function)(void*,uint64_t), 
+                                                             void (*free_function)(void*,void*) )
+{
+    reliable_assert( tick_time > 0.0 );
+
+    if ( allocate_function == NULL )
+    {
+        allocate_function = reliable_default_allocate_function;
+    }
+
+    if ( free_function == NULL )
+    {
+        free_function = reliable_default_free_function;
+    }
+
+    struct reliable_timer_wheel_t * timer_wheel = (struct reliable_timer_wheel_t*) 
+        allocate_function( allocator_context, sizeof( struct reliable_timer_wheel_t ) );
+
+    reliable_assert( timer_wheel );
+
+    memset( timer_wheel, 0, sizeof( struct reliable_timer_wheel_t ) );
+
+    timer_wheel->allocator_context = allocator_context;
+    timer_wheel->allocate_function = allocate_function;
+    timer_wheel->free_function = free_function;
+    timer_wheel->start_time = time;
+    timer_wheel->tick_time = tick_time;
+    timer_wheel->time = time;
+
+    return timer_wheel;
+}
+
+void reliable_timer_wheel_destroy( struct reliable_timer_wheel_t * timer_wheel )
+{
+    reliable_assert( timer_wheel );
+
+    int level, slot;
+    for ( level = 0; level < RELIABLE_TIMER_WHEEL_LEVELS; ++level )
+    {
+        for ( slot = 0; slot < RELIABLE_TIMER_WHEEL_SLOTS; ++slot )
+        {
+            while ( timer_wheel->slots[level][slot] )
+            {
+                reliable_timer_wheel_remove( timer_wheel, timer_wheel->slots[level][slot] );
+            }
+        }
+    }
+
+    timer_wheel->free_function( timer_wheel->allocator_context, timer_wheel );
+}
+
+static int reliable_count_trailing_zeros( uint64_t value )
+{
+    reliable_assert( value != 0 );
+#if defined( __GNUC__ )
+    return __builtin_ctzll( value );
+#else // #if defined( __GNUC__ )
+    int count = 0;
+    while ( ( value & 1 ) == 0 )
+    {
+        value >>= 1;
+        count++;
+    }
+    return count;
+#endif // #if defined( __GNUC__ )
+}
+
+static void reliable_timer_wheel_unlink( struct reliable_timer_wheel_t * timer_wheel, struct reliable_endpoint_t * endpoint )
+{
+    if ( endpoint->timer_link )
+    {
+        *endpoint->timer_link = endpoint->timer_next;
+        if ( endpoint->timer_next )
+        {
+            endpoint->timer_next->timer_link = endpoint->timer_link;
+        }
+
+        // the last endpoint leaving a slot clears its occupied bit. a detached due list links back to a local instead
+
+        struct reliable_endpoint_t ** first_slot = &timer_wheel->slots[0][0];
+        if ( endpoint->timer_link >= first_slot && endpoint->timer_link < first_slot + RELIABLE_TIMER_WHEEL_LEVELS * RELIABLE_TIMER_WHEEL_SLOTS && *endpoint->timer_link == NULL )
+        {
+            int index = (int) ( endpoint->timer_link - first_slot );
+            timer_wheel->occupied[index / RELIABLE_TIMER_WHEEL_SLOTS] &= ~( 1ULL << ( index % RELIABLE_TIMER_WHEEL_SLOTS ) );
+        }
+
+        endpoint->timer_next = NULL;
+        endpoint->timer_link = NULL;
+    }
+    endpoint->timer_tick = RELIABLE_TIMER_WHEEL_NEVER;
+}
+
+static void reliable_timer_wheel_link( struct reliable_timer_wheel_t * timer_wheel, struct reliable_endpoint_t * endpoint, uint64_t tick )
+{
+    reliable_assert( endpoint->timer_link == NULL );
+
+    if ( tick < timer_wheel->current_tick )
+    {
+        tick = timer_wheel->current_tick;
+    }
+
+    // pick the finest level whose span still covers the deadline. the last level clamps anything further out
+
+    uint64_t delta = tick - timer_wheel->current_tick;
+    int level = 0;
+    while ( level < RELIABLE_TIMER_WHEEL_LEVELS - 1 && delta >= ( 1ULL << ( ( level + 1 ) * RELIABLE_TIMER_WHEEL_SLOT_BITS ) ) )
+    {
+        level++;
+    }
+
+    uint64_t max_delta = ( 1ULL << ( RELIABLE_TIMER_WHEEL_LEVELS * RELIABLE_TIMER_WHEEL_SLOT_BITS ) ) - 1;
+    if ( delta > max_delta )
+    {
+        tick = timer_wheel->current_tick + max_delta;
+    }
+
+    int slot = (int) ( ( tick >> ( level * RELIABLE_TIMER_WHEEL_SLOT_BITS ) ) & RELIABLE_TIMER_WHEEL_SLOT_MASK );
+
+    struct reliable_endpoint_t ** head = &timer_wheel->slots[level][slot];
+    timer_wheel->occupied[level] |= 1ULL << slot;
+    endpoint->timer_next = *head;
+    if ( *head )
+    {
+        (*head)->timer_link = &endpoint->timer_next;
+    }
+    *head = endpoint;
+    endpoint->timer_link = head;
+    endpoint->timer_tick = tick;
+}
+
+static void reliable_timer_wheel_schedule( struct reliable_timer_wheel_t * timer_wheel, struct reliable_endpoint_t * endpoint )
+{
+    reliable_timer_wheel_unlink( timer_wheel, endpoint );
+
+    double next_update_time = reliable_endpoint_next_update_time( endpoint );
+    if ( next_update_time == DBL_MAX )
+        return;
+
+    double ticks = ( next_update_time - timer_wheel->start_time ) / timer_wheel->tick_time;
+    uint64_t tick = ticks > 0.0 ? (uint64_t) ceil( ticks ) : 0;
+    if ( tick <= timer_wheel->current_tick )
+    {
+        tick = timer_wheel->current_tick + 1;
+    }
+
+    reliable_timer_wheel_link( timer_wheel, endpoint, tick );
+}
+
+void reliable_timer_wheel_add( struct reliable_timer_wheel_t * timer_wheel, struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( timer_wheel );
+    reliable_assert( endpoint );
+    reliable_assert( endpoint->timer_wheel == NULL );
+
+    endpoint->timer_wheel = timer_wheel;
+    endpoint->timer_next = NULL;
+    endpoint->timer_link = NULL;
+    endpoint->update_pending = 1;
+    timer_wheel->num_endpoints++;
+
+    reliable_timer_wheel_link( timer_wheel, endpoint, timer_wheel->current_tick + 1 );
+}
+
+void reliable_timer_wheel_remove( struct reliable_timer_wheel_t * timer_wheel, struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( timer_wheel );
+    reliable_assert( endpoint );
+    reliable_assert( endpoint->timer_wheel == timer_wheel );
+
+    reliable_timer_wheel_unlink( timer_wheel, endpoint );
+    endpoint->timer_wheel = NULL;
+    timer_wheel->num_endpoints--;
+}
+
+static void reliable_endpoint_timer_activity( struct reliable_endpoint_t * endpoint )
+{
+    endpoint->update_pending = 1;
+
+    struct reliable_timer_wheel_t * timer_wheel = endpoint->timer_wheel;
+    if ( !timer_wheel )
+        return;
+
+    // endpoints asleep in the wheel are not updated every tick, so take the time from the wheel instead
+
+    endpoint->time = timer_wheel->time;
+
+    if ( endpoint->timer_tick > timer_wheel->current_tick + 1 )
+    {
+        reliable_timer_wheel_unlink( timer_wheel, endpoint );
+        reliable_timer_wheel_link( timer_wheel, endpoint, timer_wheel->current_tick + 1 );
+    }
+}
+
+// the next tick with work to do: an occupied level 0 slot, or a level boundary that moves an occupied slot down.
+// empty stretches are skipped a slot at a time on the finest level that holds anything, so a long gap costs a few steps
+
+static uint64_t reliable_timer_wheel_next_tick( struct reliable_timer_wheel_t * timer_wheel, uint64_t target_tick )
+{
+    uint64_t tick = timer_wheel->current_tick + 1;
+
+    while ( tick < target_tick )
+    {
+        if ( timer_wheel->occupied[0] & ( 1ULL << ( tick & RELIABLE_TIMER_WHEEL_SLOT_MASK ) ) )
+            return tick;
+
+        int level;
+        for ( level = 1; level < RELIABLE_TIMER_WHEEL_LEVELS; ++level )
+        {
+            if ( ( tick & ( ( 1ULL << ( level * RELIABLE_TIMER_WHEEL_SLOT_BITS ) ) - 1 ) ) != 0 )
+                break;
+            if ( timer_wheel->occupied[level] & ( 1ULL << ( ( tick >> ( level * RELIABLE_TIMER_WHEEL_SLOT_BITS ) ) & RELIABLE_TIMER_WHEEL_SLOT_MASK ) ) )
+                return tick;
+        }
+
+        level = 0;
+        while ( level < RELIABLE_TIMER_WHEEL_LEVELS - 1 && timer_wheel->occupied[level] == 0 )
+        {
+            level++;
+        }
+
+        const int shift = level * RELIABLE_TIMER_WHEEL_SLOT_BITS;
+        const uint64_t span_mask = ( 1ULL << ( shift + RELIABLE_TIMER_WHEEL_SLOT_BITS ) ) - 1;
+        const int position = (int) ( ( tick >> shift ) & RELIABLE_TIMER_WHEEL_SLOT_MASK );
+        const uint64_t later = position == RELIABLE_TIMER_WHEEL_SLOT_MASK ? 0 : timer_wheel->occupied[level] & ( ~0ULL << ( position + 1 ) );
+
+        if ( later )
+        {
+            tick = ( tick & ~span_mask ) + ( (uint64_t) reliable_count_trailing_zeros( later ) << shift );
+        }
+        else
+        {
+            tick = ( tick | span_mask ) + 1;
+        }
+    }
+
+    return target_tick;
+}
+
+int reliable_timer_wheel_update( struct reliable_timer_wheel_t * timer_wheel, double time )
+{
+    reliable_assert( timer_wheel );
+
+    timer_wheel->time = time;
+
+    double ticks = ( time - timer_wheel->start_time ) / timer_wheel->tick_time;
+    uint64_t target_tick = ticks > 0.0 ? (uint64_t) floor( ticks ) : 0;
+
+    int num_updated = 0;
+
+    while ( timer_wheel->current_tick < target_tick )
+    {
+        uint64_t tick = reliable_timer_wheel_next_tick( timer_wheel, target_tick );
+        timer_wheel->current_tick = tick;
+
+        // when a finer level wraps, move the matching slot of the next level down so its entries land in finer slots
+
+        int level;
+        for ( level = 1; level < RELIABLE_TIMER_WHEEL_LEVELS; ++level )
+        {
+            if ( ( tick & ( ( 1ULL << ( level * RELIABLE_TIMER_WHEEL_SLOT_BITS ) ) - 1 ) ) != 0 )
+                break;
+
+            int slot = (int) ( ( tick >> ( level * RELIABLE_TIMER_WHEEL_SLOT_BITS ) ) & RELIABLE_TIMER_WHEEL_SLOT_MASK );
+
+            struct reliable_endpoint_t * endpoint = timer_wheel->slots[level][slot];
+            timer_wheel->slots[level][slot] = NULL;
+            timer_wheel->occupied[level] &= ~( 1ULL << slot );
+            while ( endpoint )
+            {
+                struct reliable_endpoint_t * next = endpoint->timer_next;
+                uint64_t endpoint_tick = endpoint->timer_tick;
+                endpoint->timer_next = NULL;
+                endpoint->timer_link = NULL;
+                reliable_timer_wheel_link( timer_wheel, endpoint, endpoint_tick );
+                endpoint = next;
+            }
+        }
+
+        // detach the due list before walking it. the head links back to the local, so removing any entry mid-walk stays safe
+
+        int slot = (int) ( tick & RELIABLE_TIMER_WHEEL_SLOT_MASK );
+
+        struct reliable_endpoint_t * due = timer_wheel->slots[0][slot];
+        timer_wheel->slots[0][slot] = NULL;
+        timer_wheel->occupied[0] &= ~( 1ULL << slot );
+        if ( due )
+        {
+            due->timer_link = &due;
+        }
+
+        while ( due )
+        {
+            struct reliable_endpoint_t * endpoint = due;
+            reliable_timer_wheel_unlink( timer_wheel, endpoint );
+            reliable_endpoint_update( endpoint, time );
+            reliable_timer_wheel_schedule( timer_wheel, endpoint );
+            num_updated++;
+        }
+    }
+
+    return num_updated;
+}
+
+// ---------------------------------------------------------------
+
+#define RELIABLE_RING_MAGIC             0x474E4952
+#define RELIABLE_RING_WRAP              0xFFFFFFFF
+#define RELIABLE_RING_RECORD_HEADER     8
+#define RELIABLE_RING_CACHE_LINE        64
+
+struct reliable_ring_t
+{
+    uint32_t magic;
+    uint32_t capacity;
+    uint8_t padding0[RELIABLE_RING_CACHE_LINE - 8];
+    volatile uint32_t write_index;
+    uint32_t producer_read_index;
+    uint8_t padding1[RELIABLE_RING_CACHE_LINE - 8];
+    volatile uint32_t read_index;
+    uint32_t num_corrupt_records;
+    uint8_t padding2[RELIABLE_RING_CACHE_LINE - 8];
+};
+
+// note: the ring holds only offsets, never pointers, so the same memory can be mapped into two processes at different addresses.
+// there must be exactly one producer and one consumer. each record is an 8 byte header (bytes, sequence) followed by the packet data.
+
+uint64_t reliable_ring_bytes( int capacity )
+{
+    reliable_assert( capacity > 0 );
+    reliable_assert( ( capacity & ( capacity - 1 ) ) == 0 );
+    return sizeof( struct reliable_ring_t ) + (uint64_t) capacity;
+}
+
+struct reliable_ring_t * reliable_ring_init( void * memory, int capacity )
+{
+    reliable_assert( memory );
+    reliable_assert( capacity >= 64 );
+    reliable_assert( ( capacity & ( capacity - 1 ) ) == 0 );
+    struct reliable_ring_t * ring = (struct reliable_ring_t*) memory;
+    memset( ring, 0, sizeof( struct reliable_ring_t ) );
+    ring->capacity = (uint32_t) capacity;
+    reliable_atomic_store_release( &ring->write_index, 0 );
+    reliable_atomic_store_release( &ring->read_index, 0 );
+    reliable_atomic_store_release( (volatile uint32_t*) &ring->magic, RELIABLE_RING_MAGIC );
+    return ring;
+}
+
+struct reliable_ring_t * reliable_ring_attach( void * memory )
+{
+    reliable_assert( memory );
+    struct reliable_ring_t * ring = (struct reliable_ring_t*) memory;
+    if ( reliable_atomic_load_acquire( (volatile uint32_t*) &ring->magic ) != RELIABLE_RING_MAGIC )
+    {
+        reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "ring memory is not initialized\n" );
+        return NULL;
+    }
+    return ring;
+}
+
+static uint8_t * reliable_ring_data( struct reliable_ring_t * ring )
+{
+    return ( (uint8_t*) ring ) + sizeof( struct reliable_ring_t );
+}
+
+// reserves a record and writes its header. the caller fills in the returned payload, then publishes it by storing next_write_index
+
+static uint8_t * reliable_ring_reserve( struct reliable_ring_t * ring, int type, uint16_t sequence, int packet_bytes, uint32_t * next_write_index )
+{
+    reliable_assert( ring );
+    reliable_assert( type >= 0 && type <= 0xFFFF );
+    reliable_assert( packet_bytes >= 0 );
+    reliable_assert( next_write_index );
+
+    const uint32_t capacity = ring->capacity;
+    const uint32_t record_bytes = ( RELIABLE_RING_RECORD_HEADER + (uint32_t) packet_bytes + 7 ) & ~7U;
+    const uint32_t write_index = ring->write_index;
+    const uint32_t offset = write_index & ( capacity - 1 );
+    const uint32_t padding_bytes = ( offset + record_bytes > capacity ) ? ( capacity - offset ) : 0;
+    const uint32_t required_bytes = padding_bytes + record_bytes;
+
+    if ( required_bytes > capacity )
+        return NULL;
+
+    if ( write_index + required_bytes - ring->producer_read_index > capacity )
+    {
+        ring->producer_read_index = reliable_atomic_load_acquire( &ring->read_index );
+        if ( write_index + required_bytes - ring->producer_read_index > capacity )
+            return NULL;
+    }
+
+    uint8_t * data = reliable_ring_data( ring );
+
+    if ( padding_bytes )
+    {
+        uint8_t * p = data + offset;
+        reliable_write_uint32( &p, RELIABLE_RING_WRAP );
+    }
+
+    uint8_t * p = data + ( ( write_index + padding_bytes ) & ( capacity - 1 ) );
+    reliable_write_uint32( &p, (uint32_t) packet_bytes );
+    reliable_write_uint16( &p, sequence );
+    reliable_write_uint16( &p, (uint16_t) type );
+
+    *next_write_index = write_index + required_bytes;
+
+    return p;
+}
+
+int reliable_ring_push( struct reliable_ring_t * ring, int type, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    reliable_assert( packet_data || packet_bytes == 0 );
+
+    uint32_t next_write_index;
+    uint8_t * p = reliable_ring_reserve( ring, type, sequence, packet_bytes, &next_write_index );
+    if ( !p )
+        return RELIABLE_ERROR;
+
+    if ( packet_bytes > 0 )
+    {
+        memcpy( p, packet_data, packet_bytes );
+    }
+
+    reliable_atomic_store_release( &ring->write_index, next_write_index );
+
+    return RELIABLE_OK;
+}
+
+// the ring may be shared with another process, so record lengths are never trusted. a record that does not fit in what the producer
+// has published, or that runs off the end of the ring, is corruption: everything published so far is dropped and counted
+
+static void reliable_ring_corrupt( struct reliable_ring_t * ring, uint32_t write_index )
+{
+    ring->num_corrupt_records++;
+    reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "ring record is corrupt. dropping %u published bytes\n", write_index - ring->read_index );
+    reliable_atomic_store_release( &ring->read_index, write_index );
+}
+
+static int reliable_ring_record_valid( struct reliable_ring_t * ring, uint32_t read_index, uint32_t write_index, uint32_t bytes )
+{
+    const uint32_t capacity = ring->capacity;
+    const uint32_t offset = read_index & ( capacity - 1 );
+    return bytes <= capacity && 
+           RELIABLE_RING_RECORD_HEADER + bytes <= write_index - read_index && 
+           offset + RELIABLE_RING_RECORD_HEADER + bytes <= capacity;
+}
+
+uint8_t * reliable_ring_peek( struct reliable_ring_t * ring, int * type, uint16_t * sequence, int * packet_bytes )
+{
+    reliable_assert( ring );
+    reliable_assert( packet_bytes );
+
+    const uint32_t capacity = ring->capacity;
+    const uint32_t write_index = reliable_atomic_load_acquire( &ring->write_index );
+    uint32_t read_index = ring->read_index;
+
+    if ( read_index == write_index )
+        return NULL;
+
+    if ( ( read_index & 7 ) != 0 || write_index - read_index > capacity )
+    {
+        reliable_ring_corrupt( ring, write_index );
+        return NULL;
+    }
+
+    uint8_t * data = reliable_ring_data( ring );
+    uint8_t * p = data + ( read_index & ( capacity - 1 ) );
+    uint32_t bytes = reliable_read_uint32( &p );
+
+    if ( bytes == RELIABLE_RING_WRAP )
+    {
+        const uint32_t padding_bytes = capacity - ( read_index & ( capacity - 1 ) );
+        if ( padding_bytes > write_index - read_index )
+        {
+            reliable_ring_corrupt( ring, write_index );
+            return NULL;
+        }
+        read_index += padding_bytes;
+        reliable_atomic_store_release( &ring->read_index, read_index );
+        if ( read_index == write_index )
+            return NULL;
+        p = data;
+        bytes = reliable_read_uint32( &p );
+    }
+
+    if ( !reliable_ring_record_valid( ring, read_index, write_index, bytes ) )
+    {
+        reliable_ring_corrupt( ring, write_index );
+        return NULL;
+    }
+
+    uint16_t packet_sequence = reliable_read_uint16( &p );
+    uint16_t packet_type = reliable_read_uint16( &p );
+
+    if ( type )
+        *type = (int) packet_type;
+
+    if ( sequence )
+        *sequence = packet_sequence;
+
+    *packet_bytes = (int) bytes;
+
+    return p;
+}
+
+void reliable_ring_pop( struct reliable_ring_t * ring )
+{
+    reliable_assert( ring );
+    const uint32_t write_index = reliable_atomic_load_acquire( &ring->write_index );
+    const uint32_t read_index = ring->read_index;
+    if ( read_index == write_index )
+        return;
+
+    // the length is read again from shared memory, so it is checked again
+
+    uint8_t * p = reliable_ring_data( ring ) + ( read_index & ( ring->capacity - 1 ) );
+    const uint32_t bytes = reliable_read_uint32( &p );
+    if ( bytes == RELIABLE_RING_WRAP || !reliable_ring_record_valid( ring, read_index, write_index, bytes ) )
+    {
+        reliable_ring_corrupt( ring, write_index );
+        return;
+    }
+
+    const uint32_t record_bytes = ( RELIABLE_RING_RECORD_HEADER + bytes + 7 ) & ~7U;
+    reliable_atomic_store_release( &ring->read_index, record_bytes < write_index - read_index ? read_index + record_bytes : write_index );
+}
+
+uint32_t reliable_ring_num_corrupt_records( struct reliable_ring_t * ring )
+{
+    reliable_assert( ring );
+    return ring->num_corrupt_records;
+}
+
+int reliable_endpoint_receive_packets_from_ring( struct reliable_endpoint_t * endpoint, struct reliable_ring_t * ring, int max_packets )
+{
+    reliable_assert( endpoint );
+    reliable_assert( ring );
+    int num_packets = 0;
+    while ( max_packets <= 0 || num_packets < max_packets )
+    {
+        int type;
+        int packet_bytes;
+        uint8_t * packet_data = reliable_ring_peek( ring, &type, NULL, &packet_bytes );
+        if ( !packet_data )
+            break;
+        if ( type == RELIABLE_RING_RECORD_PACKET && packet_bytes > 0 )
+        {
+            reliable_endpoint_receive_packet( endpoint, packet_data, packet_bytes );
+            num_packets++;
+        }
+        reliable_ring_pop( ring );
+    }
+    return num_packets;
+}
+
+int reliable_endpoint_publish_acks( struct reliable_endpoint_t * endpoint, struct reliable_ring_t * ring )
+{
+    reliable_assert( endpoint );
+    reliable_assert( ring );
+
+    if ( endpoint->num_acks == 0 )
+        return RELIABLE_OK;
+
+    // acks are written straight into the ring record, so publishing never touches the allocator
+
+    uint32_t next_write_index;
+    uint8_t * p = reliable_ring_reserve( ring, RELIABLE_RING_RECORD_ACKS, endpoint->sequence, endpoint->num_acks * 2, &next_write_index );
+    if ( !p )
+        return RELIABLE_ERROR;
+
+    int i;
+    for ( i = 0; i < endpoint->num_acks; ++i )
+    {
+        reliable_write_uint16( &p, endpoint->acks[i] );
+    }
+
+    reliable_atomic_store_release( &ring->write_index, next_write_index );
+
+    endpoint->num_acks = 0;
+
+    return RELIABLE_OK;
+}
+
+// ---------------------------------------------------------------
+
+uint64_t reliable_metrics_bytes( int max_endpoints )
+{
+    reliable_assert( max_endpoints > 0 );
+    return sizeof( struct reliable_metrics_header_t ) + ( (uint64_t) max_endpoints ) * sizeof( struct reliable_metrics_record_t );
+}
+
+static struct reliable_metrics_record_t * reliable_metrics_records( struct reliable_metrics_header_t * metrics )
+{
+    return (struct reliable_metrics_record_t*) ( ( (uint8_t*) metrics ) + metrics->header_bytes );
+}
+
+struct reliable_metrics_header_t * reliable_metrics_init( void * memory, int max_endpoints )
+{
+    reliable_assert( memory );
+    reliable_assert( max_endpoints > 0 );
+
+    memset( memory, 0, reliable_metrics_bytes( max_endpoints ) );
+
+    struct reliable_metrics_header_t * metrics = (struct reliable_metrics_header_t*) memory;
+    metrics->version = RELIABLE_METRICS_VERSION;
+    metrics->header_bytes = sizeof( struct reliable_metrics_header_t );
+    metrics->record_bytes = sizeof( struct reliable_metrics_record_t );
+    metrics->num_counters = RELIABLE_ENDPOINT_NUM_COUNTERS;
+    metrics->max_endpoints = max_endpoints;
+
+    // magic goes last, so a reader attaching mid-init rejects the file instead of reading a half written header
+
+    reliable_atomic_fence_release();
+    metrics->magic = RELIABLE_METRICS_MAGIC;
+
+    return metrics;
+}
+
+struct reliable_metrics_header_t * reliable_metrics_attach( void * memory, uint64_t bytes )
+{
+    reliable_assert( memory );
+
+    struct reliable_metrics_header_t * metrics = (struct reliable_metrics_header_t*) memory;
+
+    if ( bytes < sizeof( struct reliable_metrics_header_t ) || metrics->magic != RELIABLE_METRICS_MAGIC )
+    {
+        reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "metrics attach failed. bad magic\n" );
+        return NULL;
+    }
+
+    reliable_atomic_fence_acquire();
+
+    if ( metrics->version != RELIABLE_METRICS_VERSION || 
+         metrics->header_bytes != sizeof( struct reliable_metrics_header_t ) ||
+         metrics->record_bytes != sizeof( struct reliable_metrics_record_t ) ||
+         metrics->num_counters != RELIABLE_ENDPOINT_NUM_COUNTERS )
+    {
+        reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "metrics attach failed. schema mismatch (version %d, record %d bytes, %d counters)\n", 
+            metrics->version, metrics->record_bytes, metrics->num_counters );
+        return NULL;
+    }
+
+    if ( metrics->max_endpoints == 0 || bytes < reliable_metrics_bytes( metrics->max_endpoints ) )
+    {
+        reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "metrics attach failed. %" PRIu64 " bytes is too small for %d endpoints\n", bytes, metrics->max_endpoints );
+        return NULL;
+    }
+
+    return metrics;
+}
+
+// a writer only holds a record odd for a memcpy, so a record that stays odd this long belongs to a writer that is gone
+
+#define RELIABLE_METRICS_MAX_READ_RETRIES 100000
+
+int reliable_metrics_read( struct reliable_metrics_header_t * metrics, int index, char * name, struct reliable_endpoint_stats_t * stats )
+{
+    reliable_assert( metrics );
+    reliable_assert( index >= 0 );
+    reliable_assert( index < (int) metrics->max_endpoints );
+    reliable_assert( stats );
+
+    struct reliable_metrics_record_t * record = reliable_metrics_records( metrics ) + index;
+
+    int retries;
+    for ( retries = 0; retries < RELIABLE_METRICS_MAX_READ_RETRIES; ++retries )
+    {
+        uint32_t sequence = reliable_atomic_load_acquire( &record->sequence );
+        if ( sequence & 1 )
+            continue;
+        int in_use = record->in_use != 0;
+        if ( name )
+        {
+            memcpy( name, record->name, RELIABLE_METRICS_NAME_BYTES );
+            name[RELIABLE_METRICS_NAME_BYTES-1] = '\0';
+        }
+        memcpy( stats, &record->stats, sizeof( struct reliable_endpoint_stats_t ) );
+        reliable_atomic_fence_acquire();
+        if ( record->sequence == sequence )
+            return in_use;
+    }
+
+    return -1;
+}
+
+void reliable_endpoint_export_metrics( struct reliable_endpoint_t * endpoint, struct reliable_metrics_header_t * metrics, int index )
+{
+    reliable_assert( endpoint );
+
+    if ( endpoint->metrics_record )
+    {
+        endpoint->metrics_record->in_use = 0;
+        endpoint->metrics_record = NULL;
+    }
+
+    if ( !metrics )
+        return;
+
+    reliable_assert( index >= 0 );
+    reliable_assert( index < (int) metrics->max_endpoints );
+
+    struct reliable_metrics_record_t * record = reliable_metrics_records( metrics ) + index;
+
+    uint32_t sequence = record->sequence;
+    reliable_atomic_store_release( &record->sequence, sequence + 1 );
+    reliable_atomic_fence_release();
+    size_t name_bytes = strlen( endpoint->config.name );
+    if ( name_bytes > RELIABLE_METRICS_NAME_BYTES - 1 )
+        name_bytes = RELIABLE_METRICS_NAME_BYTES - 1;
+    memset( record->name, 0, RELIABLE_METRICS_NAME_BYTES );
+    memcpy( record->name, endpoint->config.name, name_bytes );
+    record->stats = endpoint->stats_slots[endpoint->stats_published & 1].stats;
+    record->in_use = 1;
+    reliable_atomic_store_release( &record->sequence, sequence + 2 );
+
+    endpoint->metrics_record = record;
+}
+
+// ---------------------------------------------------------------
+
+int reliable_endpoint_trace( struct reliable_endpoint_t * endpoint, struct reliable_trace_event_t * events, int max_events )
+{
+    reliable_assert( endpoint );
+    reliable_assert( events || max_events == 0 );
+
+    if ( !endpoint->trace )
+        return 0;
+
+    uint64_t num_events = endpoint->trace_index;
+    if ( num_events > (uint64_t) endpoint->trace_mask + 1 )
+        num_events = (uint64_t) endpoint->trace_mask + 1;
+    if ( num_events > (uint64_t) max_events )
+        num_events = (uint64_t) max_events;
+
+    uint64_t first = endpoint->trace_index - num_events;
+    uint64_t i;
+    for ( i = 0; i < num_events; ++i )
+    {
+        events[i] = endpoint->trace[( first + i ) & endpoint->trace_mask];
+    }
+
+    return (int) num_events;
+}
+
+int reliable_endpoint_dump_trace( struct reliable_endpoint_t * endpoint, RELIABLE_CONST char * filename )
+{
+    reliable_assert( endpoint );
+    reliable_assert( filename );
+
+    if ( !endpoint->trace )
+        return 0;
+
+    FILE * file = fopen( filename, "wb" );
+    if ( !file )
+    {
+        reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] could not open trace file %s\n", endpoint->config.name, filename );
+        return 0;
+    }
+
+    struct reliable_trace_file_header_t header;
+    memset( &header, 0, sizeof( header ) );
+    header.magic = RELIABLE_TRACE_MAGIC;
+    header.version = RELIABLE_TRACE_VERSION;
+    header.event_bytes = sizeof( struct reliable_trace_event_t );
+    header.num_recorded = endpoint->trace_index;
+    size_t name_bytes = strlen( endpoint->config.name );
+    if ( name_bytes > RELIABLE_METRICS_NAME_BYTES - 1 )
+        name_bytes = RELIABLE_METRICS_NAME_BYTES - 1;
+    memcpy( header.name, endpoint->config.name, name_bytes );
+
+    // write the ring in at most two contiguous runs, oldest first
+
+    uint32_t trace_size = endpoint->trace_mask + 1;
+    uint32_t num_events = endpoint->trace_index < trace_size ? (uint32_t) endpoint->trace_index : trace_size;
+    uint32_t first = (uint32_t) ( ( endpoint->trace_index - num_events ) & endpoint->trace_mask );
+    uint32_t first_run = trace_size - first < num_events ? trace_size - first : num_events;
+    header.num_events = num_events;
+
+    int result = fwrite( &header, sizeof( header ), 1, file ) == 1 &&
+                 fwrite( endpoint->trace + first, sizeof( struct reliable_trace_event_t ), first_run, file ) == first_run &&
+                 fwrite( endpoint->trace, sizeof( struct reliable_trace_event_t ), num_events - first_run, file ) == num_events - first_run;
+
+    if ( fclose( file ) != 0 )
+        result = 0;
+
+    if ( !result )
+    {
+        reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] failed to write trace file %s\n", endpoint->config.name, filename );
+    }
+
+    return result;
+}
+
+RELIABLE_CONST char * reliable_trace_type_name( int type )
+{
+    switch ( type )
+    {
+        case RELIABLE_TRACE_SEND:                       return "send";
+        case RELIABLE_TRACE_SEND_FRAGMENT:              return "send_fragment";
+        case RELIABLE_TRACE_RECEIVE:                    return "receive";
+        case RELIABLE_TRACE_RECEIVE_FRAGMENT:           return "receive_fragment";
+        case RELIABLE_TRACE_STALE:                      return "stale";
+        case RELIABLE_TRACE_INVALID:                    return "invalid";
+        case RELIABLE_TRACE_ACK:                        return "ack";
+        case RELIABLE_TRACE_REASSEMBLED:                return "reassembled";
+        default:                                        return "unknown";
+    }
+}
+
+// ---------------------------------------------------------------
+
+#define RELIABLE_CONGESTION_MSS                     1200
+#define RELIABLE_CONGESTION_INITIAL_WINDOW          ( 10 * RELIABLE_CONGESTION_MSS )
+#define RELIABLE_CONGESTION_MIN_WINDOW              ( 2 * RELIABLE_CONGESTION_MSS )
+#define RELIABLE_CONGESTION_MAX_WINDOW              ( 64 * 1024 * 1024 )
+#define RELIABLE_CONGESTION_DELAY_TARGET            25.0f           // milliseconds of queueing the delay controller aims for
+#define RELIABLE_CONGESTION_BASE_RTT_EPOCH          10.0            // base rtt is the minimum over the current and previous epoch, so route changes age out
+
+static void reliable_congestion_set_window( struct reliable_congestion_state_t * congestion, double * window )
+{
+    if ( *window < RELIABLE_CONGESTION_MIN_WINDOW )
+        *window = RELIABLE_CONGESTION_MIN_WINDOW;
+    if ( *window > RELIABLE_CONGESTION_MAX_WINDOW )
+        *window = RELIABLE_CONGESTION_MAX_WINDOW;
+    congestion->congestion_window = (int) *window;
+}
+
+static void reliable_congestion_update_send_rate( struct reliable_congestion_state_t * congestion )
+{
+    // a window of bytes per rtt in milliseconds is bytes per millisecond, and bits per millisecond is kbps
+
+    congestion->send_rate_kbps = congestion->rtt > 0.0f ? congestion->congestion_window * 8.0f / congestion->rtt : 0.0f;
+}
+
+// aimd is reno without fast retransmit: slow start to the first loss, then one mss per rtt, halving at most once per rtt of losses
+
+struct reliable_congestion_aimd_t
+{
+    double window;
+    double slow_start_threshold;
+    double recovery_time;
+};
+
+static void reliable_congestion_aimd_init( void * _state, struct reliable_congestion_state_t * congestion, double time )
+{
+    struct reliable_congestion_aimd_t * state = (struct reliable_congestion_aimd_t*) _state;
+    state->window = RELIABLE_CONGESTION_INITIAL_WINDOW;
+    state->slow_start_threshold = RELIABLE_CONGESTION_MAX_WINDOW;
+    state->recovery_time = time;
+    reliable_congestion_set_window( congestion, &state->window );
+}
+
+static void reliable_congestion_aimd_packet_acked( void * _state, struct reliable_congestion_state_t * congestion, double time, int packet_bytes, float rtt )
+{
+    (void) time;
+    (void) rtt;
+    struct reliable_congestion_aimd_t * state = (struct reliable_congestion_aimd_t*) _state;
+    if ( state->window < state->slow_start_threshold )
+        state->window += packet_bytes;
+    else
+        state->window += (double) RELIABLE_CONGESTION_MSS * packet_bytes / state->window;
+    reliable_congestion_set_window( congestion, &state->window );
+}
+
+static void reliable_congestion_aimd_packet_lost( void * _state, struct reliable_congestion_state_t * congestion, double time, int packet_bytes, double send_time )
+{
+    (void) packet_bytes;
+    struct reliable_congestion_aimd_t * state = (struct reliable_congestion_aimd_t*) _state;
+    if ( send_time < state->recovery_time )
+        return;
+    state->recovery_time = time;
+    state->window *= 0.5;
+    reliable_congestion_set_window( congestion, &state->window );
+    state->slow_start_threshold = state->window;
+}
+
+static void reliable_congestion_update( void * _state, struct reliable_congestion_state_t * congestion, double time )
+{
+    (void) _state;
+    (void) time;
+    reliable_congestion_update_send_rate( congestion );
+}
+
+void reliable_congestion_control_aimd( struct reliable_congestion_control_t * control )
+{
+    reliable_assert( control );
+    memset( control, 0, sizeof( struct reliable_congestion_control_t ) );
+    control->state_bytes = sizeof( struct reliable_congestion_aimd_t );
+    control->init_function = reliable_congestion_aimd_init;
+    control->packet_acked_function = reliable_congestion_aimd_packet_acked;
+    control->packet_lost_function = reliable_congestion_aimd_packet_lost;
+    control->update_function = reliable_congestion_update;
+}
+
+// the delay controller is ledbat-like: queueing delay is the smallest of the last few rtt samples over the base rtt, and the window
+// grows or shrinks in proportion to how far that is from the target. it slow starts until queueing first passes the target, and
+// still halves on loss
+
+#define RELIABLE_CONGESTION_DELAY_SAMPLES 4
+
+struct reliable_congestion_delay_t
+{
+    double window;
+    double recovery_time;
+    double base_epoch_time;
+    float base_rtt[2];
+    float recent_rtt[RELIABLE_CONGESTION_DELAY_SAMPLES];
+    int num_recent_rtt;
+    int slow_start;
+};
+
+static void reliable_congestion_delay_init( void * _state, struct reliable_congestion_state_t * congestion, double time )
+{
+    struct reliable_congestion_delay_t * state = (struct reliable_congestion_delay_t*) _state;
+    state->window = RELIABLE_CONGESTION_INITIAL_WINDOW;
+    state->recovery_time = time;
+    state->base_epoch_time = time;
+    state->slow_start = 1;
+    reliable_congestion_set_window( congestion, &state->window );
+}
+
+static void reliable_congestion_delay_packet_acked( void * _state, struct reliable_congestion_state_t * congestion, double time, int packet_bytes, float rtt )
+{
+    struct reliable_congestion_delay_t * state = (struct reliable_congestion_delay_t*) _state;
+
+    if ( time - state->base_epoch_time >= RELIABLE_CONGESTION_BASE_RTT_EPOCH )
+    {
+        state->base_rtt[1] = state->base_rtt[0];
+        state->base_rtt[0] = 0.0f;
+        state->base_epoch_time = time;
+    }
+    if ( state->base_rtt[0] == 0.0f || rtt < state->base_rtt[0] )
+        state->base_rtt[0] = rtt;
+    float base_rtt = state->base_rtt[0];
+    if ( state->base_rtt[1] > 0.0f && state->base_rtt[1] < base_rtt )
+        base_rtt = state->base_rtt[1];
+
+    state->recent_rtt[state->num_recent_rtt % RELIABLE_CONGESTION_DELAY_SAMPLES] = rtt;
+    state->num_recent_rtt++;
+    float current_rtt = rtt;
+    int i;
+    for ( i = 0; i < RELIABLE_CONGESTION_DELAY_SAMPLES && i < state->num_recent_rtt; ++i )
+    {
+        if ( state->recent_rtt[i] < current_rtt )
+            current_rtt = state->recent_rtt[i];
+    }
+
+    float queueing_delay = current_rtt - base_rtt;
+
+    if ( state->slow_start && queueing_delay < RELIABLE_CONGESTION_DELAY_TARGET )
+    {
+        state->window += packet_bytes;
+    }
+    else
+    {
+        state->slow_start = 0;
+        float off_target = ( RELIABLE_CONGESTION_DELAY_TARGET - queueing_delay ) / RELIABLE_CONGESTION_DELAY_TARGET;
+        if ( off_target < -1.0f )
+            off_target = -1.0f;
+        state->window += off_target * (double) RELIABLE_CONGESTION_MSS * packet_bytes / state->window;
+    }
+
+    reliable_congestion_set_window( congestion, &state->window );
+}
+
+static void reliable_congestion_delay_packet_lost( void * _state, struct reliable_congestion_state_t * congestion, double time, int packet_bytes, double send_time )
+{
+    (void) packet_bytes;
+    struct reliable_congestion_delay_t * state = (struct reliable_congestion_delay_t*) _state;
+    state->slow_start = 0;
+    if ( send_time < state->recovery_time )
+        return;
+    state->recovery_time = time;
+    state->window *= 0.5;
+    reliable_congestion_set_window( congestion, &state->window );
+}
+
+void reliable_congestion_control_delay( struct reliable_congestion_control_t * control )
+{
+    reliable_assert( control );
+    memset( control, 0, sizeof( struct reliable_congestion_control_t ) );
+    control->state_bytes = sizeof( struct reliable_congestion_delay_t );
+    control->init_function = reliable_congestion_delay_init;
+    control->packet_acked_function = reliable_congestion_delay_packet_acked;
+    control->packet_lost_function = reliable_congestion_delay_packet_lost;
+    control->update_function = reliable_congestion_update;
+}
+
+// ---------------------------------------------------------------
+
+struct reliable_simulator_packet_t
+{
+    double delivery_time;
+    uint64_t order;
+    int from;
+    int to;
+    int packet_bytes;
+    uint8_t * packet_data;
+};
+
+struct reliable_network_simulator_t
+{
+    struct reliable_network_simulator_config_t config;
+    double time;
+    uint64_t random_state;
+    uint64_t next_order;
+    struct reliable_network_simulator_link_t * links;
+    double * link_free_time;
+    int num_packets;
+    struct reliable_simulator_packet_t * packets;          // binary min heap on delivery time, ties broken by send order
+    struct reliable_network_simulator_stats_t stats;
+};
+
+void reliable_network_simulator_default_config( struct reliable_network_simulator_config_t * config )
+{
+    reliable_assert( config );
+    memset( config, 0, sizeof( struct reliable_network_simulator_config_t ) );
+    config->seed = 1;
+    config->max_endpoints = 2;
+    config->max_packets = 4096;
+    config->link.reorder_delay = 0.05f;
+    config->link.max_queue_delay = 1.0f;
+}
+
+struct reliable_network_simulator_t * reliable_network_simulator_create( struct reliable_network_simulator_config_t * config, double time )
+{
+    reliable_assert( config );
+    reliable_assert( config->max_endpoints > 0 );
+    reliable_assert( config->max_packets > 0 );
+    reliable_assert( config->deliver_packet_function );
+
+    void * (*allocate_function)(void*,uint64_t) = config->allocate_function ? config->allocate_function : reliable_default_allocate_function;
+
+    struct reliable_network_simulator_t * simulator = (struct reliable_network_simulator_t*) 
+        allocate_function( config->allocator_context, sizeof( struct reliable_network_simulator_t ) );
+
+    reliable_assert( simulator );
+
+    memset( simulator, 0, sizeof( struct reliable_network_simulator_t ) );
+
+    simulator->config = *config;
+    simulator->config.allocate_function = allocate_function;
+    if ( simulator->config.free_function == NULL )
+    {
+        simulator->config.free_function = reliable_default_free_function;
+    }
+    simulator->time = time;
+    simulator->random_state = config->seed;
+    simulator->links = (struct reliable_network_simulator_link_t*) 
+        allocate_function( config->allocator_context, config->max_endpoints * sizeof( struct reliable_network_simulator_link_t ) );
+    simulator->link_free_time = (double*) allocate_function( config->allocator_context, config->max_endpoints * sizeof( double ) );
+    simulator->packets = (struct reliable_simulator_packet_t*) 
+        allocate_function( config->allocator_context, config->max_packets * sizeof( struct reliable_simulator_packet_t ) );
+
+    int i;
+    for ( i = 0; i < config->max_endpoints; ++i )
+    {
+        simulator->links[i] = config->link;
+        simulator->link_free_time[i] = time;
+    }
+
+    return simulator;
+}
+
+void reliable_network_simulator_destroy( struct reliable_network_simulator_t * simulator )
+{
+    reliable_assert( simulator );
+
+    void * allocator_context = simulator->config.allocator_context;
+    void (*free_function)(void*,void*) = simulator->config.free_function;
+
+    int i;
+    for ( i = 0; i < simulator->num_packets; ++i )
+    {
+        free_function( allocator_context, simulator->packets[i].packet_data );
+    }
+
+    free_function( allocator_context, simulator->packets );
+    free_function( allocator_context, simulator->link_free_time );
+    free_function( allocator_context, simulator->links );
+    free_function( allocator_context, simulator );
+}
+
+void reliable_network_simulator_set_link( struct reliable_network_simulator_t * simulator, int index, struct reliable_network_simulator_link_t * link )
+{
+    reliable_assert( simulator );
+    reliable_assert( index >= 0 );
+    reliable_assert( index < simulator->config.max_endpoints );
+    reliable_assert( link );
+    simulator->links[index] = *link;
+}
+
+static float reliable_network_simulator_random( struct reliable_network_simulator_t * simulator )
+{
+    // splitmix64, returns [0,1)
+    uint64_t z = ( simulator->random_state += 0x9E3779B97F4A7C15ULL );
+    z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+    z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+    z = z ^ ( z >> 31 );
+    return (float) ( z >> 40 ) * ( 1.0f / 16777216.0f );
+}
+
+static int reliable_simulator_packet_before( struct reliable_simulator_packet_t * a, struct reliable_simulator_packet_t * b )
+{
+    return a->delivery_time < b->delivery_time || ( a->delivery_time == b->delivery_time && a->order < b->order );
+}
+
+static void reliable_network_simulator_push( struct reliable_network_simulator_t * simulator, struct reliable_simulator_packet_t * packet )
+{
+    struct reliable_simulator_packet_t * packets = simulator->packets;
+    int i = simulator->num_packets++;
+    while ( i > 0 )
+    {
+        int parent = ( i - 1 ) / 2;
+        if ( !reliable_simulator_packet_before( packet, &packets[parent] ) )
+            break;
+        packets[i] = packets[parent];
+        i = parent;
+    }
+    packets[i] = *packet;
+}
+
+static void reliable_network_simulator_pop( struct reliable_network_simulator_t * simulator )
+{
+    struct reliable_simulator_packet_t * packets = simulator->packets;
+    int num_packets = --simulator->num_packets;
+    struct reliable_simulator_packet_t last = packets[num_packets];
+    int i = 0;
+    while ( 1 )
+    {
+        int child = i * 2 + 1;
+        if ( child >= num_packets )
+            break;
+        if ( child + 1 < num_packets && reliable_simulator_packet_before( &packets[child+1], &packets[child] ) )
+            child++;
+        if ( !reliable_simulator_packet_before( &packets[child], &last ) )
+            break;
+        packets[i] = packets[child];
+        i = child;
+    }
+    packets[i] = last;
+}
+
+static void reliable_network_simulator_queue_packet( struct reliable_network_simulator_t * simulator, int from, int to, uint8_t * packet_data, int packet_bytes, double departure_time )
+{
+    if ( simulator->num_packets == simulator->config.max_packets )
+    {
+        simulator->stats.num_packets_dropped++;
+        return;
+    }
+
+    struct reliable_network_simulator_link_t * link = &simulator->links[from];
+
+    double delay = link->latency + link->jitter * ( reliable_network_simulator_random( simulator ) * 2.0f - 1.0f );
+    if ( delay < 0.0 )
+        delay = 0.0;
+
+    if ( link->reorder > 0.0f && reliable_network_simulator_random( simulator ) * 100.0f < link->reorder )
+    {
+        delay += link->reorder_delay;
+        simulator->stats.num_packets_reordered++;
+    }
+
+    struct reliable_simulator_packet_t packet;
+    packet.delivery_time = departure_time + delay;
+    packet.order = simulator->next_order++;
+    packet.from = from;
+    packet.to = to;
+    packet.packet_bytes = packet_bytes;
+    packet.packet_data = (uint8_t*) simulator->config.allocate_function( simulator->config.allocator_context, packet_bytes );
+    memcpy( packet.packet_data, packet_data, packet_bytes );
+
+    reliable_network_simulator_push( simulator, &packet );
+}
+
+void reliable_network_simulator_send_packet( struct reliable_network_simulator_t * simulator, int from, int to, uint8_t * packet_data, int packet_bytes )
+{
+    reliable_assert( simulator );
+    reliable_assert( from >= 0 && from < simulator->config.max_endpoints );
+    reliable_assert( to >= 0 && to < simulator->config.max_endpoints );
+    reliable_assert( packet_data );
+    reliable_assert( packet_bytes > 0 );
+
+    simulator->stats.num_packets_sent++;
+
+    struct reliable_network_simulator_link_t * link = &simulator->links[from];
+
+    if ( link->packet_loss > 0.0f && reliable_network_simulator_random( simulator ) * 100.0f < link->packet_loss )
+    {
+        simulator->stats.num_packets_lost++;
+        return;
+    }
+
+    // the sender's uplink serializes packets one after another. a packet that would wait too long behind the queue is tail dropped
+
+    double departure_time = simulator->time;
+
+    if ( link->bandwidth_kbps > 0.0f )
+    {
+        if ( simulator->link_free_time[from] > departure_time )
+            departure_time = simulator->link_free_time[from];
+
+        if ( departure_time - simulator->time > link->max_queue_delay )
+        {
+            simulator->stats.num_packets_dropped++;
+            return;
+        }
+
+        simulator->link_free_time[from] = departure_time + packet_bytes * 8.0 / ( link->bandwidth_kbps * 1000.0 );
+    }
+
+    reliable_network_simulator_queue_packet( simulator, from, to, packet_data, packet_bytes, departure_time );
+
+    if ( link->duplicate > 0.0f && reliable_network_simulator_random( simulator ) * 100.0f < link->duplicate )
+    {
+        simulator->stats.num_packets_duplicated++;
+        reliable_network_simulator_queue_packet( simulator, from, to, packet_data, packet_bytes, departure_time );
+    }
+}
+
+void reliable_network_simulator_update( struct reliable_network_simulator_t * simulator, double time )
+{
+    reliable_assert( simulator );
+
+    simulator->time = time;
+
+    // packets sent from inside the deliver callback wait for the next update, so zero latency cannot loop forever
+
+    uint64_t end_order = simulator->next_order;
+
+    while ( simulator->num_packets > 0 && simulator->packets[0].delivery_time <= time && simulator->packets[0].order < end_order )
+    {
+        struct reliable_simulator_packet_t packet = simulator->packets[0];
+        reliable_network_simulator_pop( simulator );
+        simulator->stats.num_packets_delivered++;
+        simulator->config.deliver_packet_function( simulator->config.context, packet.from, packet.to, packet.packet_data, packet.packet_bytes );
+        simulator->config.free_function( simulator->config.allocator_context, packet.packet_data );
+    }
+}
+
+int reliable_network_simulator_num_packets_in_flight( struct reliable_network_simulator_t * simulator )
+{
+    reliable_assert( simulator );
+    return simulator->num_packets;
+}
+
+void reliable_network_simulator_stats( struct reliable_network_simulator_t * simulator, struct reliable_network_simulator_stats_t * stats )
+{
+    reliable_assert( simulator );
+    reliable_assert( stats );
+    *stats = simulator->stats;
+}
+
+// ---------------------------------------------------------------
+
+#if RELIABLE_ENABLE_TESTS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+
+static void check_handler( RELIABLE_CONST char * condition, 
+                           RELIABLE_CONST char * function,
+                           RELIABLE_CONST char * file,
+                           int line )
+{
+    printf( "check failed: ( %s ), function %s, file %s, line %d\n", condition, function, file, line );
+#ifndef NDEBUG
+    #if defined( __GNUC__ )
+        __builtin_trap();
+    #elif defined( _MSC_VER )
+        __debugbreak();
+    #endif
+#endif
+    exit( 1 );
+}
+
+#define check( condition )                                                                                      \
+do                                                                                                              \
+{                                                                                                               \
+    if ( !(condition) )                                                                                         \
+    {                                                                                                           \
+        check_handler( #condition, (RELIABLE_CONST char*) __FUNCTION__, __FILE__, __LINE__ );                   \
+    }                                                                                                           \
+} while(0)
+
+static void test_endian()
+{
+    uint32_t value = 0x11223344;
+
+    char * bytes = (char*) &value;
+
+#if RELIABLE_LITTLE_ENDIAN
+
+    check( bytes[0] == 0x44 );
+    check( bytes[1] == 0x33 );
+    check( bytes[2] == 0x22 );
+    check( bytes[3] == 0x11 );
+
+#else // #if RELIABLE_LITTLE_ENDIAN
+
+    check( bytes[3] == 0x44 );
+    check( bytes[2] == 0x33 );
+    check( bytes[1] == 0x22 );
+    check( bytes[0] == 0x11 );
+
+#endif // #if RELIABLE_LITTLE_ENDIAN
+}
+
+struct test_sequence_data_t
+{
+    uint16_t sequence;
+};
+
+#define TEST_SEQUENCE_BUFFER_SIZE 256
+
+static void test_sequence_buffer()
+{
+    struct reliable_sequence_buffer_t * sequence_buffer = reliable_sequence_buffer_create( TEST_SEQUENCE_BUFFER_SIZE, 
+                                                                                           sizeof( struct test_sequence_data_t ), 
+                                                                                           NULL, 
+                                                                                           NULL, 
+                                                                                           NULL );
+
+    check( sequence_buffer );
+    check( sequence_buffer->sequence == 0 );
+    check( sequence_buffer->num_entries == TEST_SEQUENCE_BUFFER_SIZE );
+    check( sequence_buffer->entry_stride == sizeof( struct test_sequence_data_t ) );
+
+    int i;
+    for ( i = 0; i < TEST_SEQUENCE_BUFFER_SIZE; ++i )
+    {
+        check( reliable_sequence_buffer_find( sequence_buffer, ((uint16_t)i) ) == NULL );
+    }                                                                      
+
+    for ( i = 0; i <= TEST_SEQUENCE_BUFFER_SIZE*4; ++i )
+    {
+        struct test_sequence_data_t * entry = (struct test_sequence_data_t*) reliable_sequence_buffer_insert( sequence_buffer, ((uint16_t)i) );
+        check( entry );
+        entry->sequence = (uint16_t) i;
+        check( sequence_buffer->sequence == i + 1 );
+    }
+
+    for ( i = 0; i <= TEST_SEQUENCE_BUFFER_SIZE; ++i )
+    {
+        struct test_sequence_data_t * entry = (struct test_sequence_data_t*) reliable_sequence_buffer_insert( sequence_buffer, ((uint16_t)i) );
+        check( entry == NULL );
+    }    
+
+    int index = TEST_SEQUENCE_BUFFER_SIZE * 4;
+    for ( i = 0; i < TEST_SEQUENCE_BUFFER_SIZE; ++i )
+    {
+        struct test_sequence_data_t * entry = (struct test_sequence_data_t*) reliable_sequence_buffer_find( sequence_buffer, (uint16_t) index );
+        check( entry );
+        check( entry->sequence == (uint32_t) index );
+        index--;
+    }
+
+    reliable_sequence_buffer_reset( sequence_buffer );
+
+    check( sequence_buffer );
+    check( sequence_buffer->sequence == 0 );
+    check( sequence_buffer->num_entries == TEST_SEQUENCE_BUFFER_SIZE );
+    check( sequence_buffer->entry_stride == sizeof( struct test_sequence_data_t ) );
+
+    for ( i = 0; i < TEST_SEQUENCE_BUFFER_SIZE; ++i )
+    {
+        check( reliable_sequence_buffer_find( sequence_buffer, (uint16_t) i ) == NULL );
+    }
+
+    reliable_sequence_buffer_destroy( sequence_buffer );
+}
+
+static void test_generate_ack_bits()
+{
+    struct reliable_sequence_buffer_t * sequence_buffer = reliable_sequence_buffer_create( TEST_SEQUENCE_BUFFER_SIZE, 
+                                                                                           sizeof( struct test_sequence_data_t ), 
+                                                                                           NULL, 
+                                                                                           NULL, 
+                                                                                           NULL );
+
+    uint16_t ack = 0;
+    uint32_t ack_bits = 0xFFFFFFFF;
+
+    reliable_sequence_buffer_generate_ack_bits( sequence_buffer, &ack, &ack_bits );
+    check( ack == 0xFFFF );
+    check( ack_bits == 0 );
+
+    int i;
+    for ( i = 0; i <= TEST_SEQUENCE_BUFFER_SIZE; ++i )
+    {
+        reliable_sequence_buffer_insert( sequence_buffer, (uint16_t) i );
+    }
+
+    reliable_sequence_buffer_generate_ack_bits( sequence_buffer, &ack, &ack_bits );
+    check( ack == TEST_SEQUENCE_BUFFER_SIZE );
+    check( ack_bits == 0xFFFFFFFF );
+
+    reliable_sequence_buffer_reset( sequence_buffer );
+
+    uint16_t input_acks[] = { 1, 5, 9, 11 };
+    int input_num_acks = sizeof( input_acks ) / sizeof( uint16_t );
+    for ( i = 0; i < input_num_acks; ++i )
+    {
+        reliable_sequence_buffer_insert( sequence_buffer, input_acks[i] );
+    }
+
+    reliable_sequence_buffer_generate_ack_bits( sequence_buffer, &ack, &ack_bits );
+
+    check( ack == 11 );
+    check( ack_bits == ( 1 | (1<<(11-9)) | (1<<(11-5)) | (1<<(11-1)) ) );
+
+    reliable_sequence_buffer_destroy( sequence_buffer );
+}
+
+static void test_packet_header()
+{
+    uint16_t write_sequence;
+    uint16_t write_ack;
+    uint32_t write_ack_bits;
+
+    uint16_t read_sequence;
+    uint16_t read_ack;
+    uint32_t read_ack_bits;
+
+    uint8_t packet_data[RELIABLE_MAX_PACKET_HEADER_BYTES];
+
+    // worst case, sequence and ack are far apart, no packets acked.
+
+    write_sequence = 10000;
+    write_ack = 100;
+    write_ack_bits = 0;
+
+    int bytes_written = reliable_write_packet_header( packet_data, write_sequence, write_ack, write_ack_bits );
+
+    check( bytes_written == RELIABLE_MAX_PACKET_HEADER_BYTES - RELIABLE_MAX_PACKET_HEADER_EXTENSION_BYTES );
+
+    int bytes_read = reliable_read_packet_header( "test_packet_header", packet_data, bytes_written, &read_sequence, &read_ack, &read_ack_bits );
+
+    check( bytes_read == bytes_written );
+
+    check( read_sequence == write_sequence );
+    check( read_ack == write_ack );
+    check( read_ack_bits == write_ack_bits );
+
+    // rare case. sequence and ack are far apart, significant # of acks are missing
+
+    write_sequence = 10000;
+    write_ack = 100;
+    write_ack_bits = 0xFEFEFFFE;
+
+    bytes_written = reliable_write_packet_header( packet_data, write_sequence, write_ack, write_ack_bits );
+
+    check( bytes_written == 1 + 2 + 2 + 3 );
+
+    bytes_read = reliable_read_packet_header( "test_packet_header", packet_data, bytes_written, &read_sequence, &read_ack, &read_ack_bits );
+
+    check( bytes_read == bytes_written );
+
+    check( read_sequence == write_sequence );
+    check( read_ack == write_ack );
+    check( read_ack_bits == write_ack_bits );
+
+    // common case under packet loss. sequence and ack are close together, some acks are missing
+
+    write_sequence = 200;
+    write_ack = 100;
+    write_ack_bits = 0xFFFEFFFF;
+
+    bytes_written = reliable_write_packet_header( packet_data, write_sequence, write_ack, write_ack_bits );
+
+    check( bytes_written == 1 + 2 + 1 + 1 );
+
+    bytes_read = reliable_read_packet_header( "test_packet_header", packet_data, bytes_written, &read_sequence, &read_ack, &read_ack_bits );
+
+    check( bytes_read == bytes_written );
+
+    check( read_sequence == write_sequence );
+    check( read_ack == write_ack );
+    check( read_ack_bits == write_ack_bits );
+
+    // ideal case. no packet loss.
+
+    write_sequence = 200;
+    write_ack = 100;
+    write_ack_bits = 0xFFFFFFFF;
+
+    bytes_written = reliable_write_packet_header( packet_data, write_sequence, write_ack, write_ack_bits );
+
+    check( bytes_written == 1 + 2 + 1 );
+
+    bytes_read = reliable_read_packet_header( "test_packet_header", packet_data, bytes_written, &read_sequence, &read_ack, &read_ack_bits );
+
+    check( bytes_read == bytes_written );
+
+    check( read_sequence == write_sequence );
+    check( read_ack == write_ack );
+    check( read_ack_bits == write_ack_bits );
+
+    // worst case with every optional field present
+
+    struct reliable_header_extension_t write_extension;
+    struct reliable_header_extension_t read_extension;
+
+    write_sequence = 10000;
+    write_ack = 100;
+    write_ack_bits = 0;
+    memset( &write_extension, 0, sizeof( write_extension ) );
+    write_extension.flags = RELIABLE_HEADER_EXTENSION_ALL_FLAGS;
+    write_extension.send_time = 0xDEADBEEF;
+    write_extension.echo_time = 0xCAFEBABE;
+    write_extension.hold_time = 12345;
+
+    bytes_written = reliable_write_packet_header_extended( packet_data, write_sequence, write_ack, write_ack_bits, &write_extension );
+
+    check( bytes_written == RELIABLE_MAX_PACKET_HEADER_BYTES );
+
+    bytes_read = reliable_read_packet_header_extended( "test_packet_header", packet_data, bytes_written, &read_sequence, &read_ack, &read_ack_bits, &read_extension );
+
+    check( bytes_read == bytes_written );
+
+    check( read_sequence == write_sequence );
+    check( read_ack == write_ack );
+    check( read_ack_bits == write_ack_bits );
+    check( read_extension.flags == write_extension.flags );
+    check( read_extension.send_time == write_extension.send_time );
+    check( read_extension.echo_time == write_extension.echo_time );
+    check( read_extension.hold_time == write_extension.hold_time );
+
+    // a truncated extension is rejected
+
+    check( reliable_read_packet_header_extended( "test_packet_header", packet_data, bytes_written - 1, &read_sequence, &read_ack, &read_ack_bits, &read_extension ) < 0 );
+}
+
+struct test_context_t
+{
+    int drop;
+    struct reliable_endpoint_t * sender;
+    struct reliable_endpoint_t * receiver;
+};
+
+static void test_transmit_packet_function( void * _context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) sequence;
+
+    struct test_context_t * context = (struct test_context_t*) _context;
+
+    if ( context->drop )
+    {
+        return;
+    }
+
+    if ( index == 0 )
+    {
+        reliable_endpoint_receive_packet( context->receiver, packet_data, packet_bytes );
+    }
+    else if ( index == 1 )
+    {
+        reliable_endpoint_receive_packet( context->sender, packet_data, packet_bytes );
+    }
+}
+
+static int test_process_packet_function( void * _context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    struct test_context_t * context = (struct test_context_t*) _context;
+
+    (void) context;
+    (void) index;
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+
+    return 1;
+}
+
+#define TEST_ACKS_NUM_ITERATIONS 256
+
+static void test_acks()
+{
+    double time = 100.0;
+
+    struct test_context_t context;
+    memset( &context, 0, sizeof( context ) );
+    
+    struct reliable_config_t sender_config;
+    struct reliable_config_t receiver_config;
+
+    reliable_default_config( &sender_config );
+    reliable_default_config( &receiver_config );
+
+    sender_config.context = &context;
+    sender_config.index = 0;
+    sender_config.transmit_packet_function = &test_transmit_packet_function;
+    sender_config.process_packet_function = &test_process_packet_function;
+
+    receiver_config.context = &context;
+    receiver_config.index = 1;
+    receiver_config.transmit_packet_function = &test_transmit_packet_function;
+    receiver_config.process_packet_function = &test_process_packet_function;
+
+    context.sender = reliable_endpoint_create( &sender_config, time );
+    context.receiver = reliable_endpoint_create( &receiver_config, time );
+
+    double delta_time = 0.01;
+
+    int i;
+    for ( i = 0; i < TEST_ACKS_NUM_ITERATIONS; ++i )
+    {
+        uint8_t dummy_packet[8];
+        memset( dummy_packet, 0, sizeof( dummy_packet ) );
+
+        reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
+        reliable_endpoint_send_packet( context.receiver, dummy_packet, sizeof( dummy_packet ) );
+
+        reliable_endpoint_update( context.sender, time );
+        reliable_endpoint_update( context.receiver, time );
+
+        time += delta_time;
+    }
+
+    uint8_t sender_acked_packet[TEST_ACKS_NUM_ITERATIONS];
+    memset( sender_acked_packet, 0, sizeof( sender_acked_packet ) );
+    int sender_num_acks;
+    uint16_t * sender_acks = reliable_endpoint_get_acks( context.sender, &sender_num_acks );
+    for ( i = 0; i < sender_num_acks; ++i )
+    {
+        if ( sender_acks[i] < TEST_ACKS_NUM_ITERATIONS )
+        {
+            sender_acked_packet[sender_acks[i]] = 1;
+        }
+    }
+    for ( i = 0; i < TEST_ACKS_NUM_ITERATIONS / 2; ++i )
+    {
+        check( sender_acked_packet[i] == 1 );
+    }
+
+    uint8_t receiver_acked_packet[TEST_ACKS_NUM_ITERATIONS];
+    memset( receiver_acked_packet, 0, sizeof( receiver_acked_packet ) );
+    int receiver_num_acks;
+    uint16_t * receiver_acks = reliable_endpoint_get_acks( context.receiver, &receiver_num_acks );
+    for ( i = 0; i < receiver_num_acks; ++i )
+    {
+        if ( receiver_acks[i] < TEST_ACKS_NUM_ITERATIONS )
+            receiver_acked_packet[receiver_acks[i]] = 1;
+    }
+    for ( i = 0; i < TEST_ACKS_NUM_ITERATIONS / 2; ++i )
+    {
+        check( receiver_acked_packet[i] == 1 );
+    }
+
+    reliable_endpoint_destroy( context.sender );
+    reliable_endpoint_destroy( context.receiver );
+}
+
+static void test_acks_packet_loss()
+{
+    double time = 100.0;
+
+    struct test_context_t context;
+    memset( &context, 0, sizeof( context ) );
+    
+    struct reliable_config_t sender_config;
+    struct reliable_config_t receiver_config;
+
+    reliable_default_config( &sender_config );
+    reliable_default_config( &receiver_config );
+
+    sender_config.context = &context;
+    sender_config.index = 0;
+    sender_config.transmit_packet_function = &test_transmit_packet_function;
+    sender_config.process_packet_function = &test_process_packet_function;
+
+    receiver_config.context = &context;
+    receiver_config.index = 1;
+    receiver_config.transmit_packet_function = &test_transmit_packet_function;
+    receiver_config.process_packet_function = &test_process_packet_function;
+
+    context.sender = reliable_endpoint_create( &sender_config, time );
+    context.receiver = reliable_endpoint_create( &receiver_config, time );
+
+    const double delta_time = 0.1f;
+
+    int i;
+    for ( i = 0; i < TEST_ACKS_NUM_ITERATIONS; ++i )
+    {
+        uint8_t dummy_packet[8];
+        memset( dummy_packet, 0, sizeof( dummy_packet ) );
+
+        context.drop = ( i % 2 );
+
+        reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
+        reliable_endpoint_send_packet( context.receiver, dummy_packet, sizeof( dummy_packet ) );
+
+        reliable_endpoint_update( context.sender, time );
+        reliable_endpoint_update( context.receiver, time );
+
+        time += delta_time;
+    }
+
+    uint8_t sender_acked_packet[TEST_ACKS_NUM_ITERATIONS];
+    memset( sender_acked_packet, 0, sizeof( sender_acked_packet ) );
+    int sender_num_acks;
+    uint16_t * sender_acks = reliable_endpoint_get_acks( context.sender, &sender_num_acks );
+    for ( i = 0; i < sender_num_acks; ++i )
+    {
+        if ( sender_acks[i] < TEST_ACKS_NUM_ITERATIONS )
+        {
+            sender_acked_packet[sender_acks[i]] = 1;
+        }
+    }
+    for ( i = 0; i < TEST_ACKS_NUM_ITERATIONS / 2; ++i )
+    {
+        check( sender_acked_packet[i] == (i+1) % 2 );
+    }
+
+    uint8_t receiver_acked_packet[TEST_ACKS_NUM_ITERATIONS];
+    memset( receiver_acked_packet, 0, sizeof( receiver_acked_packet ) );
+    int receiver_num_acks;
+    uint16_t * receiver_acks = reliable_endpoint_get_acks( context.sender, &receiver_num_acks );
+    for ( i = 0; i < receiver_num_acks; ++i )
+    {
+        if ( receiver_acks[i] < TEST_ACKS_NUM_ITERATIONS )
+        {
+            receiver_acked_packet[receiver_acks[i]] = 1;
+        }
+    }
+    for ( i = 0; i < TEST_ACKS_NUM_ITERATIONS / 2; ++i )
+    {
+        check( receiver_acked_packet[i] == (i+1) % 2 );
+    }
+
+    reliable_endpoint_destroy( context.sender );
+    reliable_endpoint_destroy( context.receiver );
+}
+
+#define TEST_MAX_PACKET_BYTES (4*1024)
+
+static int generate_packet_data( uint16_t sequence, uint8_t * packet_data )
+{
+    int packet_bytes = ( ( (int)sequence * 1023 ) % ( TEST_MAX_PACKET_BYTES - 2 ) ) + 2;
+    reliable_assert( packet_bytes >= 2 );
+    reliable_assert( packet_bytes <= TEST_MAX_PACKET_BYTES );
+    packet_data[0] = (uint8_t) ( sequence & 0xFF );
+    packet_data[1] = (uint8_t) ( (sequence>>8) & 0xFF );
+    int i;
+    for ( i = 2; i < packet_bytes; ++i )
+    {
+        packet_data[i] = (uint8_t) ( ( (int)i + sequence ) % 256 );
+    }
+    return packet_bytes;
+}
+
+static void validate_packet_data( uint8_t * packet_data, int packet_bytes )
+{
+    reliable_assert( packet_bytes >= 2 );
+    reliable_assert( packet_bytes <= TEST_MAX_PACKET_BYTES );
+    uint16_t sequence = 0;
+    sequence |= (uint16_t) packet_data[0];
+    sequence |= ( (uint16_t) packet_data[1] ) << 8;
+    check( packet_bytes == ( ( (int)sequence * 1023 ) % ( TEST_MAX_PACKET_BYTES - 2 ) ) + 2 );
+    int i;
+    for ( i = 2; i < packet_bytes; ++i )
+    {
+        check( packet_data[i] == (uint8_t) ( ( (int)i + sequence ) % 256 ) );
+    }
+}
+
+static int test_process_packet_function_validate( void * context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    reliable_assert( packet_data );
+    reliable_assert( packet_bytes > 0 );
+    reliable_assert( packet_bytes <= TEST_MAX_PACKET_BYTES );
+
+    (void) context;
+    (void) index;
+    (void) sequence;
+
+    validate_packet_data( packet_data, packet_bytes );
+
+    return 1;
+}
+
+void test_packets()
+{
+    double time = 100.0;
+
+    struct test_context_t context;
+    memset( &context, 0, sizeof( context ) );
+    
+    struct reliable_config_t sender_config;
+    struct reliable_config_t receiver_config;
+
+    reliable_default_config( &sender_config );
+    reliable_default_config( &receiver_config );
+
+    sender_config.fragment_above = 500;
+    receiver_config.fragment_above = 500;
+
+#if defined(_MSC_VER)
+    strcpy_s( sender_config.name, sizeof( sender_config.name ), "sender" );
+#else
+    strcpy( sender_config.name, "sender" );
+#endif
+    sender_config.context = &context;
+    sender_config.index = 0;
+    sender_config.transmit_packet_function = &test_transmit_packet_function;
+    sender_config.process_packet_function = &test_process_packet_function_validate;
+
+#if defined(_MSC_VER)
+    strcpy_s( receiver_config.name, sizeof( receiver_config.name ), "receiver" );
+#else
+    strcpy( receiver_config.name, "receiver" );
+#endif
+    receiver_config.context = &context;
+    receiver_config.index = 1;
+    receiver_config.transmit_packet_function = &test_transmit_packet_function;
+    receiver_config.process_packet_function = &test_process_packet_function_validate;
+
+    context.sender = reliable_endpoint_create( &sender_config, time );
+    context.receiver = reliable_endpoint_create( &receiver_config, time );
+
+    double delta_time = 0.1;
+
+    int i;
+    for ( i = 0; i < 16; ++i )
+    {
+        {
+            uint8_t packet_data[TEST_MAX_PACKET_BYTES];
+            uint16_t sequence = reliable_endpoint_next_packet_sequence( context.sender );
+            int packet_bytes = generate_packet_data( sequence, packet_data );
+            reliable_endpoint_send_packet( context.sender, packet_data, packet_bytes );
+        }
+
+        {
+            uint8_t packet_data[TEST_MAX_PACKET_BYTES];
+            uint16_t sequence = reliable_endpoint_next_packet_sequence( context.sender );
+            int packet_bytes = generate_packet_data( sequence, packet_data );
+            reliable_endpoint_send_packet( context.sender, packet_data, packet_bytes );
+        }
+
+        reliable_endpoint_update( context.sender, time );
+        reliable_endpoint_update( context.receiver, time );
+
+        reliable_endpoint_clear_acks( context.sender );
+        reliable_endpoint_clear_acks( context.receiver );
+
+        time += delta_time;
+    }
+
+    reliable_endpoint_destroy( context.sender );
+    reliable_endpoint_destroy( context.receiver );
+}
+
+#define TEST_SEGMENTS_MAX_FRAGMENTS 16
+#define TEST_SEGMENTS_FRAGMENT_SIZE 256
+
+struct test_segments_context_t
+{
+    int num_fragments;
+    int fragment_bytes[TEST_SEGMENTS_MAX_FRAGMENTS];
+    uint8_t fragment_data[TEST_SEGMENTS_MAX_FRAGMENTS][RELIABLE_FRAGMENT_HEADER_BYTES + RELIABLE_MAX_PACKET_HEADER_BYTES + TEST_SEGMENTS_FRAGMENT_SIZE];
+    int num_packets_processed;
+};
+
+static void test_segments_transmit_packet_function( void * _context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) index;
+    (void) sequence;
+
+    struct test_segments_context_t * context = (struct test_segments_context_t*) _context;
+
+    reliable_assert( context->num_fragments < TEST_SEGMENTS_MAX_FRAGMENTS );
+    reliable_assert( packet_bytes <= (int) sizeof( context->fragment_data[0] ) );
+
+    memcpy( context->fragment_data[context->num_fragments], packet_data, packet_bytes );
+    context->fragment_bytes[context->num_fragments] = packet_bytes;
+    context->num_fragments++;
+}
+
+static int test_segments_process_packet_function( void * _context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) index;
+    (void) sequence;
+
+    struct test_segments_context_t * context = (struct test_segments_context_t*) _context;
+
+    validate_packet_data( packet_data, packet_bytes );
+
+    context->num_packets_processed++;
+
+    return 1;
+}
+
+static void test_packet_segments()
+{
+    double time = 100.0;
+
+    struct test_segments_context_t context;
+    memset( &context, 0, sizeof( context ) );
+
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.fragment_above = TEST_SEGMENTS_FRAGMENT_SIZE;
+    config.fragment_size = TEST_SEGMENTS_FRAGMENT_SIZE;
+    config.context = &context;
+    config.transmit_packet_function = &test_segments_transmit_packet_function;
+    config.process_packet_function = &test_segments_process_packet_function;
+
+    struct reliable_endpoint_t * sender = reliable_endpoint_create( &config, time );
+    struct reliable_endpoint_t * receiver = reliable_endpoint_create( &config, time );
+
+    // find a packet that splits into several full fragments plus a short last fragment
+
+    uint8_t packet_data[TEST_MAX_PACKET_BYTES];
+    uint16_t sequence = 0;
+    int packet_bytes = 0;
+    while ( 1 )
+    {
+        packet_bytes = generate_packet_data( sequence, packet_data );
+        if ( packet_bytes > TEST_SEGMENTS_FRAGMENT_SIZE * 3 && 
+             packet_bytes < TEST_SEGMENTS_FRAGMENT_SIZE * TEST_SEGMENTS_MAX_FRAGMENTS && 
+             ( packet_bytes % TEST_SEGMENTS_FRAGMENT_SIZE ) != 0 )
+            break;
+        reliable_endpoint_send_packet( sender, packet_data, 1 + ( sequence % 8 ) );
+        context.num_fragments = 0;
+        sequence++;
+    }
+
+    check( reliable_endpoint_next_packet_sequence( sender ) == sequence );
+
+    context.num_fragments = 0;
+
+    reliable_endpoint_send_packet( sender, packet_data, packet_bytes );
+
+    check( context.num_fragments > 3 );
+
+    // fragment 0 is larger than the rest, so GRO coalesces only fragments 1..n-1 and fragment 0 is a receive of its own
+
+    uint8_t coalesced_data[TEST_SEGMENTS_MAX_FRAGMENTS * sizeof( context.fragment_data[0] )];
+    int coalesced_bytes = 0;
+    int segment_bytes = context.fragment_bytes[1];
+    int i;
+    for ( i = 1; i < context.num_fragments; ++i )
+    {
+        check( i == context.num_fragments - 1 ? context.fragment_bytes[i] < segment_bytes : context.fragment_bytes[i] == segment_bytes );
+        memcpy( coalesced_data + coalesced_bytes, context.fragment_data[i], context.fragment_bytes[i] );
+        coalesced_bytes += context.fragment_bytes[i];
+    }
+
+    reliable_endpoint_receive_packet_segments( receiver, context.fragment_data[0], context.fragment_bytes[0], context.fragment_bytes[0] );
+
+    check( context.num_packets_processed == 0 );
+
+    reliable_endpoint_receive_packet_segments( receiver, coalesced_data, coalesced_bytes, segment_bytes );
+
+    check( context.num_packets_processed == 1 );
+
+    RELIABLE_CONST uint64_t * counters = reliable_endpoint_counters( receiver );
+    check( counters[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_RECEIVED] == (uint64_t) context.num_fragments );
+    check( counters[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_INVALID] == 0 );
+    check( counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED] == 1 );
+
+    // a burst of equal sized packets followed by a shorter one is what a single GRO receive hands back
+
+    int full_bytes = 0;
+    int short_bytes = 0;
+    uint16_t full_sequence = 0;
+    uint16_t short_sequence = 0;
+    for ( sequence = 0; full_bytes == 0 || short_bytes == 0; ++sequence )
+    {
+        packet_bytes = generate_packet_data( sequence, packet_data );
+        if ( full_bytes == 0 && packet_bytes > TEST_SEGMENTS_FRAGMENT_SIZE / 2 && packet_bytes <= TEST_SEGMENTS_FRAGMENT_SIZE )
+        {
+            full_bytes = packet_bytes;
+            full_sequence = sequence;
+        }
+        else if ( short_bytes == 0 && packet_bytes < TEST_SEGMENTS_FRAGMENT_SIZE / 2 )
+        {
+            short_bytes = packet_bytes;
+            short_sequence = sequence;
+        }
+    }
+
+    context.num_fragments = 0;
+
+    for ( i = 0; i < TEST_SEGMENTS_MAX_FRAGMENTS - 1; ++i )
+    {
+        generate_packet_data( full_sequence, packet_data );
+        reliable_endpoint_send_packet( sender, packet_data, full_bytes );
+    }
+
+    generate_packet_data( short_sequence, packet_data );
+    reliable_endpoint_send_packet( sender, packet_data, short_bytes );
+
+    check( context.num_fragments == TEST_SEGMENTS_MAX_FRAGMENTS );
+
+    coalesced_bytes = 0;
+    segment_bytes = context.fragment_bytes[0];
+    for ( i = 0; i < context.num_fragments; ++i )
+    {
+        check( i == context.num_fragments - 1 ? context.fragment_bytes[i] < segment_bytes : context.fragment_bytes[i] == segment_bytes );
+        memcpy( coalesced_data + coalesced_bytes, context.fragment_data[i], context.fragment_bytes[i] );
+        coalesced_bytes += context.fragment_bytes[i];
+    }
+
+    reliable_endpoint_receive_packet_segments( receiver, coalesced_data, coalesced_bytes, segment_bytes );
+
+    check( context.num_packets_processed == 1 + TEST_SEGMENTS_MAX_FRAGMENTS );
+    check( counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED] == 1 + TEST_SEGMENTS_MAX_FRAGMENTS );
+    check( counters[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_INVALID] == 0 );
+
+    reliable_endpoint_destroy( sender );
+    reliable_endpoint_destroy( receiver );
+}
+
+#define TEST_RING_CAPACITY 1024
+
+static void test_ring()
+{
+    uint64_t ring_bytes = reliable_ring_bytes( TEST_RING_CAPACITY );
+    void * memory = malloc( ring_bytes );
+
+    struct reliable_ring_t * ring = reliable_ring_init( memory, TEST_RING_CAPACITY );
+    check( ring );
+    check( reliable_ring_attach( memory ) == ring );
+
+    int packet_bytes = 0;
+    check( reliable_ring_peek( ring, NULL, NULL, &packet_bytes ) == NULL );
+
+    // push and pop odd sized records so the ring wraps many times, checking fifo order and contents
+
+    uint8_t packet_data[TEST_MAX_PACKET_BYTES];
+    uint16_t write_sequence = 0;
+    uint16_t read_sequence = 0;
+    int i;
+    for ( i = 0; i < 1000; ++i )
+    {
+        while ( 1 )
+        {
+            int bytes = generate_packet_data( write_sequence, packet_data );
+            if ( bytes > 200 )
+                bytes = 2 + ( bytes % 199 );
+            packet_data[0] = (uint8_t) ( write_sequence & 0xFF );
+            packet_data[1] = (uint8_t) ( ( write_sequence >> 8 ) & 0xFF );
+            if ( reliable_ring_push( ring, RELIABLE_RING_RECORD_PACKET, write_sequence, packet_data, bytes ) != RELIABLE_OK )
+                break;
+            write_sequence++;
+        }
+
+        check( write_sequence != read_sequence );
+
+        int num_pops = 1 + ( i % 5 );
+        while ( num_pops-- && read_sequence != write_sequence )
+        {
+            uint16_t sequence = 0;
+            uint8_t * data = reliable_ring_peek( ring, NULL, &sequence, &packet_bytes );
+            check( data );
+            check( sequence == read_sequence );
+            check( data[0] == (uint8_t) ( read_sequence & 0xFF ) );
+            check( data[1] == (uint8_t) ( ( read_sequence >> 8 ) & 0xFF ) );
+            check( packet_bytes >= 2 && packet_bytes <= 200 );
+            reliable_ring_pop( ring );
+            read_sequence++;
+        }
+    }
+
+    while ( read_sequence != write_sequence )
+    {
+        uint16_t sequence = 0;
+        check( reliable_ring_peek( ring, NULL, &sequence, &packet_bytes ) );
+        check( sequence == read_sequence );
+        reliable_ring_pop( ring );
+        read_sequence++;
+    }
+
+    check( reliable_ring_peek( ring, NULL, NULL, &packet_bytes ) == NULL );
+
+    // a record larger than the ring can never be pushed
+
+    check( reliable_ring_push( ring, RELIABLE_RING_RECORD_PACKET, 0, packet_data, TEST_RING_CAPACITY ) == RELIABLE_ERROR );
+
+    // a record length that runs past what the producer published is corruption. it is dropped and counted, and the ring carries on
+
+    const uint32_t corrupt_lengths[] = { 0x7FFFFFF0, 200, RELIABLE_RING_WRAP - 1 };
+    for ( i = 0; i < (int) ( sizeof( corrupt_lengths ) / sizeof( corrupt_lengths[0] ) ); ++i )
+    {
+        check( reliable_ring_push( ring, RELIABLE_RING_RECORD_PACKET, 0, packet_data, 100 ) == RELIABLE_OK );
+        uint8_t * record = reliable_ring_peek( ring, NULL, NULL, &packet_bytes );
+        check( record );
+        check( packet_bytes == 100 );
+        uint8_t * p = record - RELIABLE_RING_RECORD_HEADER;
+        reliable_write_uint32( &p, corrupt_lengths[i] );
+        check( reliable_ring_peek( ring, NULL, NULL, &packet_bytes ) == NULL );
+        check( reliable_ring_num_corrupt_records( ring ) == (uint32_t) ( i + 1 ) );
+        check( ring->read_index == ring->write_index );
+    }
+
+    check( reliable_ring_push( ring, RELIABLE_RING_RECORD_PACKET, 7, packet_data, 100 ) == RELIABLE_OK );
+    uint16_t sequence = 0;
+    check( reliable_ring_peek( ring, NULL, &sequence, &packet_bytes ) );
+    check( sequence == 7 );
+    check( packet_bytes == 100 );
+
+    // the length is checked again on pop, since the producer can still write to it
+
+    uint8_t * p = reliable_ring_data( ring ) + ( ring->read_index & ( TEST_RING_CAPACITY - 1 ) );
+    reliable_write_uint32( &p, 1000 );
+    reliable_ring_pop( ring );
+    check( reliable_ring_num_corrupt_records( ring ) == 4 );
+    check( reliable_ring_peek( ring, NULL, NULL, &packet_bytes ) == NULL );
+
+    free( memory );
+}
+
+static void test_ring_handoff()
+{
+    double time = 100.0;
+
+    void * sender_memory = malloc( reliable_ring_bytes( TEST_RING_CAPACITY * 16 ) );
+    void * receiver_memory = malloc( reliable_ring_bytes( TEST_RING_CAPACITY * 16 ) );
+
+    struct reliable_ring_t * sender_ring = reliable_ring_init( sender_memory, TEST_RING_CAPACITY * 16 );
+    struct reliable_ring_t * receiver_ring = reliable_ring_init( receiver_memory, TEST_RING_CAPACITY * 16 );
+
+    struct reliable_config_t sender_config;
+    struct reliable_config_t receiver_config;
+
+    reliable_default_config( &sender_config );
+    reliable_default_config( &receiver_config );
+
+    sender_config.fragment_above = 500;
+    sender_config.transmit_ring = sender_ring;
+    sender_config.process_packet_function = &test_process_packet_function_validate;
+
+    receiver_config.fragment_above = 500;
+    receiver_config.transmit_ring = receiver_ring;
+    receiver_config.process_packet_function = &test_process_packet_function_validate;
+
+    struct reliable_endpoint_t * sender = reliable_endpoint_create( &sender_config, time );
+    struct reliable_endpoint_t * receiver = reliable_endpoint_create( &receiver_config, time );
+
+    int i;
+    for ( i = 0; i < 16; ++i )
+    {
+        uint8_t packet_data[TEST_MAX_PACKET_BYTES];
+
+        int packet_bytes = generate_packet_data( reliable_endpoint_next_packet_sequence( sender ), packet_data );
+        reliable_endpoint_send_packet( sender, packet_data, packet_bytes );
+
+        packet_bytes = generate_packet_data( reliable_endpoint_next_packet_sequence( receiver ), packet_data );
+        reliable_endpoint_send_packet( receiver, packet_data, packet_bytes );
+
+        reliable_endpoint_receive_packets_from_ring( receiver, sender_ring, 0 );
+        reliable_endpoint_receive_packets_from_ring( sender, receiver_ring, 0 );
+
+        reliable_endpoint_update( sender, time );
+        reliable_endpoint_update( receiver, time );
+
+        time += 0.1;
+    }
+
+    RELIABLE_CONST uint64_t * counters = reliable_endpoint_counters( receiver );
+    check( counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED] == 16 );
+    check( counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_TRANSMIT_RING_FULL] == 0 );
+
+    // acks are handed back through the ring as a single record and cleared from the endpoint
+
+    int num_acks = 0;
+    reliable_endpoint_get_acks( sender, &num_acks );
+    check( num_acks > 0 );
+
+    struct reliable_allocation_stats_t allocations_before;
+    struct reliable_allocation_stats_t allocations_after;
+    reliable_endpoint_allocation_stats( sender, &allocations_before );
+    check( reliable_endpoint_publish_acks( sender, sender_ring ) == RELIABLE_OK );
+    reliable_endpoint_allocation_stats( sender, &allocations_after );
+    check( allocations_after.num_allocations == allocations_before.num_allocations );
+
+    int type = -1;
+    int ack_bytes = 0;
+    uint8_t * ack_data = reliable_ring_peek( sender_ring, &type, NULL, &ack_bytes );
+    check( ack_data );
+    check( type == RELIABLE_RING_RECORD_ACKS );
+    check( ack_bytes == num_acks * 2 );
+    for ( i = 0; i < num_acks; ++i )
+    {
+        check( reliable_read_uint16( &ack_data ) < 16 );
+    }
+    reliable_ring_pop( sender_ring );
+
+    reliable_endpoint_get_acks( sender, &num_acks );
+    check( num_acks == 0 );
+
+    reliable_endpoint_destroy( sender );
+    reliable_endpoint_destroy( receiver );
+
+    free( sender_memory );
+    free( receiver_memory );
+}
+
+#define TEST_UPDATE_PARALLEL_NUM_ENDPOINTS 100
+#define TEST_UPDATE_PARALLEL_NUM_THREADS 4
+
+static void test_thread_pool_run_function( void * context, void (*task_function)(void*), void * task_data )
+{
+    // runs the task once per "thread" in sequence, which is enough to check that chunks are shared out correctly
+    int * num_runs = (int*) context;
+    int i;
+    for ( i = 0; i < TEST_UPDATE_PARALLEL_NUM_THREADS; ++i )
+    {
+        task_function( task_data );
+        (*num_runs)++;
+    }
+}
+
+static void test_update_parallel()
+{
+    double time = 100.0;
+
+    struct test_context_t context;
+    memset( &context, 0, sizeof( context ) );
+
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.context = &context;
+    config.transmit_packet_function = &test_transmit_packet_function;
+    config.process_packet_function = &test_process_packet_function;
+
+    struct reliable_endpoint_t * endpoints[TEST_UPDATE_PARALLEL_NUM_ENDPOINTS];
+    int i;
+    for ( i = 0; i < TEST_UPDATE_PARALLEL_NUM_ENDPOINTS; ++i )
+    {
+        endpoints[i] = reliable_endpoint_create( &config, time );
+    }
+
+    int num_runs = 0;
+
+    struct reliable_thread_pool_t thread_pool;
+    thread_pool.context = &num_runs;
+    thread_pool.num_threads = TEST_UPDATE_PARALLEL_NUM_THREADS;
+    thread_pool.run_function = &test_thread_pool_run_function;
+
+    reliable_update_parallel( endpoints, TEST_UPDATE_PARALLEL_NUM_ENDPOINTS, time + 1.0, &thread_pool );
+
+    check( num_runs == TEST_UPDATE_PARALLEL_NUM_THREADS );
+
+    for ( i = 0; i < TEST_UPDATE_PARALLEL_NUM_ENDPOINTS; ++i )
+    {
+        check( endpoints[i]->time == time + 1.0 );
+    }
+
+    reliable_update_parallel( endpoints, TEST_UPDATE_PARALLEL_NUM_ENDPOINTS, time + 2.0, NULL );
+
+    for ( i = 0; i < TEST_UPDATE_PARALLEL_NUM_ENDPOINTS; ++i )
+    {
+        check( endpoints[i]->time == time + 2.0 );
+        reliable_endpoint_destroy( endpoints[i] );
+    }
+}
+
+#define TEST_TIMER_WHEEL_NUM_PAIRS 8
+
+static void test_timer_wheel_packet_lost_function( void * context, int index, uint16_t sequence, uint64_t cookie )
+{
+    (void) context;
+    (void) index;
+    (void) sequence;
+    (void) cookie;
+}
+
+static void test_timer_wheel()
+{
+    double time = 100.0;
+    const double delta_time = 0.01;
+
+    struct test_context_t contexts[TEST_TIMER_WHEEL_NUM_PAIRS];
+    memset( contexts, 0, sizeof( contexts ) );
+
+    struct reliable_timer_wheel_t * timer_wheel = reliable_timer_wheel_create( time, delta_time, NULL, NULL, NULL );
+
+    int i;
+    for ( i = 0; i < TEST_TIMER_WHEEL_NUM_PAIRS; ++i )
+    {
+        struct reliable_config_t config;
+        reliable_default_config( &config );
+        config.context = &contexts[i];
+        config.transmit_packet_function = &test_transmit_packet_function;
+        config.process_packet_function = &test_process_packet_function;
+        config.index = 0;
+        contexts[i].sender = reliable_endpoint_create( &config, time );
+        config.index = 1;
+        contexts[i].receiver = reliable_endpoint_create( &config, time );
+        reliable_timer_wheel_add( timer_wheel, contexts[i].sender );
+        reliable_timer_wheel_add( timer_wheel, contexts[i].receiver );
+    }
+
+    // every endpoint starts out due
+
+    time += delta_time;
+    check( reliable_timer_wheel_update( timer_wheel, time ) == TEST_TIMER_WHEEL_NUM_PAIRS * 2 );
+
+    // only the first pair talks. once the others settle they drop out of the wheel
+
+    uint8_t dummy_packet[8];
+    memset( dummy_packet, 0, sizeof( dummy_packet ) );
+
+    int num_updated = 0;
+    for ( i = 0; i < 1000; ++i )
+    {
+        reliable_endpoint_send_packet( contexts[0].sender, dummy_packet, sizeof( dummy_packet ) );
+        reliable_endpoint_send_packet( contexts[0].receiver, dummy_packet, sizeof( dummy_packet ) );
+        time += delta_time;
+        num_updated = reliable_timer_wheel_update( timer_wheel, time );
+    }
+
+    check( num_updated == 2 );
+
+    for ( i = 1; i < TEST_TIMER_WHEEL_NUM_PAIRS; ++i )
+    {
+        check( reliable_endpoint_next_update_time( contexts[i].sender ) == DBL_MAX );
+        check( reliable_endpoint_next_update_time( contexts[i].receiver ) == DBL_MAX );
+    }
+
+    // a sleeping endpoint takes its time from the wheel and is due again as soon as it sends
+
+    reliable_endpoint_send_packet( contexts[1].sender, dummy_packet, sizeof( dummy_packet ) );
+    check( contexts[1].sender->time == time );
+    check( contexts[1].receiver->time == time );
+
+    time += delta_time;
+    check( reliable_timer_wheel_update( timer_wheel, time ) >= 2 );
+    check( contexts[1].sender->time == time );
+    check( contexts[1].receiver->time == time );
+    check( contexts[3].sender->time < time );
+
+    // skipping many ticks at once still updates everything that is due exactly once
+
+    reliable_endpoint_send_packet( contexts[2].sender, dummy_packet, sizeof( dummy_packet ) );
+    time += delta_time * 5000;
+    num_updated = reliable_timer_wheel_update( timer_wheel, time );
+    check( num_updated >= 2 );
+    check( contexts[2].sender->time == time );
+
+    // packets in flight keep an endpoint due only until the oldest of them would time out
+
+    struct test_context_t lossy_context;
+    memset( &lossy_context, 0, sizeof( lossy_context ) );
+    lossy_context.drop = 1;
+
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.context = &lossy_context;
+    config.transmit_packet_function = &test_transmit_packet_function;
+    config.process_packet_function = &test_process_packet_function;
+    config.packet_lost_function = &test_timer_wheel_packet_lost_function;
+    struct reliable_endpoint_t * lossy = reliable_endpoint_create( &config, time );
+
+    reliable_endpoint_send_packet( lossy, dummy_packet, sizeof( dummy_packet ) );
+    reliable_endpoint_update( lossy, time + delta_time );
+    reliable_endpoint_send_packet( lossy, dummy_packet, sizeof( dummy_packet ) );
+    reliable_endpoint_update( lossy, time + delta_time );
+    lossy->stats_changed = 0;
+    check( reliable_endpoint_next_update_time( lossy ) == time + config.packet_lost_min_timeout );
+
+    reliable_endpoint_update( lossy, time + config.packet_lost_min_timeout );
+    lossy->stats_changed = 0;
+    check( reliable_endpoint_next_update_time( lossy ) == time + delta_time + config.packet_lost_min_timeout );
+
+    reliable_endpoint_destroy( lossy );
+
+    for ( i = 0; i < TEST_TIMER_WHEEL_NUM_PAIRS; ++i )
+    {
+        reliable_endpoint_destroy( contexts[i].sender );
+        reliable_endpoint_destroy( contexts[i].receiver );
+    }
+
+    time += delta_time;
+    check( reliable_timer_wheel_update( timer_wheel, time ) == 0 );
+
+    reliable_timer_wheel_destroy( timer_wheel );
+}
+
+void test_allocation_stats()
+{
+    double time = 100.0;
+
+    struct reliable_allocation_stats_t global_before;
+    reliable_allocation_stats( &global_before );
+
+    struct test_context_t context;
+    memset( &context, 0, sizeof( context ) );
+
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.fragment_above = 500;
+    config.context = &context;
+    config.transmit_packet_function = &test_transmit_packet_function;
+    config.process_packet_function = &test_process_packet_function_validate;
+
+    config.index = 0;
+    context.sender = reliable_endpoint_create( &config, time );
+    config.index = 1;
+    context.receiver = reliable_endpoint_create( &config, time );
+
+    // the endpoint itself, acks, ack records and three sequence buffers of three blocks each
+
+    struct reliable_allocation_stats_t stats;
+    reliable_endpoint_allocation_stats( context.sender, &stats );
+    check( stats.num_allocations == 12 );
+    check( stats.num_frees == 0 );
+    check( stats.live_bytes == stats.bytes_allocated );
+    check( stats.peak_live_bytes == stats.live_bytes );
+
+    uint64_t initial_live_bytes = stats.live_bytes;
+
+    int i;
+    for ( i = 0; i < 16; ++i )
+    {
+        uint8_t packet_data[TEST_MAX_PACKET_BYTES];
+        uint16_t sequence = reliable_endpoint_next_packet_sequence( context.sender );
+        int packet_bytes = generate_packet_data( sequence, packet_data );
+        reliable_endpoint_send_packet( context.sender, packet_data, packet_bytes );
+        reliable_endpoint_update( context.sender, time );
+        reliable_endpoint_update( context.receiver, time );
+        time += 0.1;
+    }
+
+    // everything allocated while sending and receiving is freed again
+
+    reliable_endpoint_allocation_stats( context.sender, &stats );
+    check( stats.num_allocations > 12 );
+    check( stats.num_allocations == stats.num_frees + 12 );
+    check( stats.live_bytes == initial_live_bytes );
+    check( stats.peak_live_bytes > stats.live_bytes );
+
+    RELIABLE_CONST uint64_t * counters = reliable_endpoint_counters( context.sender );
+    check( counters[RELIABLE_ENDPOINT_COUNTER_NUM_ALLOCATIONS] == stats.num_allocations );
+    check( counters[RELIABLE_ENDPOINT_COUNTER_NUM_FREES] == stats.num_frees );
+    check( counters[RELIABLE_ENDPOINT_COUNTER_NUM_BYTES_ALLOCATED] == stats.bytes_allocated );
+
+    struct reliable_allocation_stats_t global;
+    reliable_allocation_stats( &global );
+    check( global.live_bytes == global_before.live_bytes + initial_live_bytes * 2 );
+    check( global.peak_live_bytes >= global.live_bytes );
+
+    // sending only touches the endpoint's own counters. the global totals pick them up when the endpoint next publishes its stats
+
+    uint8_t packet_data[TEST_MAX_PACKET_BYTES];
+    uint16_t sequence = reliable_endpoint_next_packet_sequence( context.sender );
+    int packet_bytes = generate_packet_data( sequence, packet_data );
+    const uint64_t sender_allocations = counters[RELIABLE_ENDPOINT_COUNTER_NUM_ALLOCATIONS];
+    reliable_endpoint_send_packet( context.sender, packet_data, packet_bytes );
+    check( counters[RELIABLE_ENDPOINT_COUNTER_NUM_ALLOCATIONS] > sender_allocations );
+
+    struct reliable_allocation_stats_t global_after_send;
+    reliable_allocation_stats( &global_after_send );
+    check( global_after_send.num_allocations == global.num_allocations );
+
+    reliable_endpoint_update( context.sender, time );
+    reliable_endpoint_update( context.receiver, time );
+    reliable_allocation_stats( &global_after_send );
+    check( global_after_send.num_allocations > global.num_allocations );
+
+    reliable_endpoint_destroy( context.sender );
+    reliable_endpoint_destroy( context.receiver );
+
+    reliable_allocation_stats( &global );
+    check( global.live_bytes == global_before.live_bytes );
+    check( global.num_allocations == global.num_frees + ( global_before.num_allocations - global_before.num_frees ) );
+}
+
+void test_profile()
+{
+    double time = 100.0;
+
+    struct test_context_t context;
+    memset( &context, 0, sizeof( context ) );
+
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.fragment_above = 500;
+    config.context = &context;
+    config.transmit_packet_function = &test_transmit_packet_function;
+    config.process_packet_function = &test_process_packet_function_validate;
+
+    config.index = 0;
+    context.sender = reliable_endpoint_create( &config, time );
+    config.index = 1;
+    context.receiver = reliable_endpoint_create( &config, time );
+
+    int i;
+    for ( i = 0; i < 16; ++i )
+    {
+        uint8_t packet_data[TEST_MAX_PACKET_BYTES];
+        uint16_t sequence = reliable_endpoint_next_packet_sequence( context.sender );
+        int packet_bytes = generate_packet_data( sequence, packet_data );
+        reliable_endpoint_send_packet( context.sender, packet_data, packet_bytes );
+        reliable_endpoint_send_packet( context.receiver, packet_data, packet_bytes );
+        reliable_endpoint_update( context.sender, time );
+        reliable_endpoint_update( context.receiver, time );
+        time += 0.1;
+    }
+
+    for ( i = 0; i < RELIABLE_PROFILE_NUM_SPANS; ++i )
+    {
+        struct reliable_profile_histogram_t histogram;
+        reliable_endpoint_profile( context.sender, i, &histogram );
+        check( strcmp( reliable_profile_span_name( i ), "unknown" ) != 0 );
+#if RELIABLE_ENABLE_PROFILING
+        check( histogram.count > 0 );
+        uint64_t total = 0;
+        int j;
+        for ( j = 0; j < RELIABLE_PROFILE_NUM_BUCKETS; ++j )
+        {
+            total += histogram.buckets[j];
+        }
+        check( total == histogram.count );
+        check( histogram.max_ticks <= histogram.total_ticks );
+#else // #if RELIABLE_ENABLE_PROFILING
+        check( histogram.count == 0 );
+#endif // #if RELIABLE_ENABLE_PROFILING
+    }
+
+    reliable_endpoint_reset_profile( context.sender );
+
+    struct reliable_profile_histogram_t histogram;
+    reliable_endpoint_profile( context.sender, RELIABLE_PROFILE_HEADER_WRITE, &histogram );
+    check( histogram.count == 0 );
+
+    reliable_endpoint_destroy( context.sender );
+    reliable_endpoint_destroy( context.receiver );
+}
+
+void test_rtt_histogram()
+{
+    struct reliable_rtt_histogram_t histogram;
+    reliable_rtt_histogram_reset( &histogram );
+    check( reliable_rtt_histogram_percentile( &histogram, 50.0f ) == 0.0f );
+
+    // 1..1000ms uniformly. percentiles should land within the bucket resolution
+
+    int i;
+    for ( i = 1; i <= 1000; ++i )
+    {
+        reliable_rtt_histogram_add( &histogram, (float) i );
+    }
+
+    check( histogram.count == 1000 );
+    check( histogram.max_rtt == 1000.0f );
+    check( fabs( reliable_rtt_histogram_percentile( &histogram, 50.0f ) - 500.0f ) < 500.0f * 0.07f );
+    check( fabs( reliable_rtt_histogram_percentile( &histogram, 90.0f ) - 900.0f ) < 900.0f * 0.07f );
+    check( fabs( reliable_rtt_histogram_percentile( &histogram, 99.0f ) - 990.0f ) < 990.0f * 0.07f );
+    check( reliable_rtt_histogram_percentile( &histogram, 100.0f ) == 1000.0f );
+
+    // sub-millisecond values keep microsecond resolution
+
+    struct reliable_rtt_histogram_t small;
+    reliable_rtt_histogram_reset( &small );
+    reliable_rtt_histogram_add( &small, 0.005f );
+    check( fabs( reliable_rtt_histogram_percentile( &small, 50.0f ) - 0.005f ) < 0.0011f );
+
+    // a merged histogram answers for both
+
+    struct reliable_rtt_histogram_t tail;
+    reliable_rtt_histogram_reset( &tail );
+    for ( i = 0; i < 1000; ++i )
+    {
+        reliable_rtt_histogram_add( &tail, 5000.0f );
+    }
+    reliable_rtt_histogram_merge( &histogram, &tail );
+    check( histogram.count == 2000 );
+    check( histogram.max_rtt == 5000.0f );
+    check( reliable_rtt_histogram_percentile( &histogram, 25.0f ) < 1000.0f );
+    check( fabs( reliable_rtt_histogram_percentile( &histogram, 75.0f ) - 5000.0f ) < 5000.0f * 0.07f );
+
+    // endpoints feed their histogram from acks
+
+    double time = 100.0;
+
+    struct test_context_t context;
+    memset( &context, 0, sizeof( context ) );
+
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.context = &context;
+    config.transmit_packet_function = &test_transmit_packet_function;
+    config.process_packet_function = &test_process_packet_function;
+
+    config.index = 0;
+    context.sender = reliable_endpoint_create( &config, time );
+    config.index = 1;
+    context.receiver = reliable_endpoint_create( &config, time );
+
+    uint8_t dummy_packet[8];
+    memset( dummy_packet, 0, sizeof( dummy_packet ) );
+
+    for ( i = 0; i < 16; ++i )
+    {
+        reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
+        reliable_endpoint_send_packet( context.receiver, dummy_packet, sizeof( dummy_packet ) );
+        reliable_endpoint_update( context.sender, time );
+        reliable_endpoint_update( context.receiver, time );
+        time += 0.01;
+    }
+
+    check( reliable_endpoint_rtt_histogram( context.sender )->count > 0 );
+    reliable_endpoint_reset_rtt_histogram( context.sender );
+    check( reliable_endpoint_rtt_histogram( context.sender )->count == 0 );
+
+    reliable_endpoint_destroy( context.sender );
+    reliable_endpoint_destroy( context.receiver );
+}
+
+#define TEST_JITTER_MAX_QUEUED_PACKETS 32
+
+struct test_jitter_context_t
+{
+    int num_queued;
+    int queued_bytes[TEST_JITTER_MAX_QUEUED_PACKETS];
+    uint8_t queued_data[TEST_JITTER_MAX_QUEUED_PACKETS][TEST_MAX_PACKET_BYTES];
+};
+
+static void test_jitter_transmit_packet_function( void * _context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) index;
+    (void) sequence;
+    struct test_jitter_context_t * context = (struct test_jitter_context_t*) _context;
+    reliable_assert( context->num_queued < TEST_JITTER_MAX_QUEUED_PACKETS );
+    reliable_assert( packet_bytes <= TEST_MAX_PACKET_BYTES );
+    memcpy( context->queued_data[context->num_queued], packet_data, packet_bytes );
+    context->queued_bytes[context->num_queued] = packet_bytes;
+    context->num_queued++;
+}
+
+void test_jitter()
+{
+    struct test_jitter_context_t context;
+    memset( &context, 0, sizeof( context ) );
+
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.fragment_above = 500;
+    config.context = &context;
+    config.transmit_packet_function = &test_jitter_transmit_packet_function;
+    config.process_packet_function = &test_process_packet_function_validate;
+    config.send_timestamps = 1;
+
+    double time = 100.0;
+
+    config.index = 0;
+    struct reliable_endpoint_t * sender = reliable_endpoint_create( &config, time );
+    config.index = 1;
+    struct reliable_endpoint_t * receiver = reliable_endpoint_create( &config, time );
+
+    // constant one way delay means no jitter, however large the delay
+
+    int i, j;
+    for ( i = 0; i < 32; ++i )
+    {
+        uint8_t packet_data[TEST_MAX_PACKET_BYTES];
+        uint16_t sequence = reliable_endpoint_next_packet_sequence( sender );
+        int packet_bytes = generate_packet_data( sequence, packet_data );
+        reliable_endpoint_update( sender, time );
+        reliable_endpoint_send_packet( sender, packet_data, packet_bytes );
+        reliable_endpoint_update( receiver, time + 0.25 );
+        for ( j = 0; j < context.num_queued; ++j )
+        {
+            reliable_endpoint_receive_packet( receiver, context.queued_data[j], context.queued_bytes[j] );
+        }
+        context.num_queued = 0;
+        time += 0.01;
+    }
+
+    check( reliable_endpoint_jitter( receiver ) < 0.01f );
+
+    // delay alternating between 10ms and 20ms converges on 10ms of jitter. fragmented packets keep their timestamp through reassembly
+
+    for ( i = 0; i < 500; ++i )
+    {
+        uint8_t packet_data[TEST_MAX_PACKET_BYTES];
+        uint16_t sequence = reliable_endpoint_next_packet_sequence( sender );
+        int packet_bytes = generate_packet_data( sequence, packet_data );
+        reliable_endpoint_update( sender, time );
+        reliable_endpoint_send_packet( sender, packet_data, packet_bytes );
+        reliable_endpoint_update( receiver, time + ( ( i & 1 ) ? 0.02 : 0.01 ) );
+        for ( j = 0; j < context.num_queued; ++j )
+        {
+            reliable_endpoint_receive_packet( receiver, context.queued_data[j], context.queued_bytes[j] );
+        }
+        context.num_queued = 0;
+        time += 0.01;
+    }
+
+    check( fabs( reliable_endpoint_jitter( receiver ) - 10.0f ) < 0.5f );
+    check( reliable_endpoint_counters( receiver )[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_RECEIVED] > 0 );
+
+    // the sender never received anything with a timestamp
+
+    check( reliable_endpoint_jitter( sender ) == 0.0f );
+
+    reliable_endpoint_destroy( sender );
+    reliable_endpoint_destroy( receiver );
+}
+
+#define TEST_CLOCK_MAX_QUEUED_PACKETS 64
+
+struct test_clock_packet_t
+{
+    double deliver_time;
+    int index;
+    int packet_bytes;
+    uint8_t packet_data[256];
+};
+
+struct test_clock_context_t
+{
+    double time;
+    double delay[2];
+    int num_queued;
+    struct test_clock_packet_t queue[TEST_CLOCK_MAX_QUEUED_PACKETS];
+};
+
+static void test_clock_transmit_packet_function( void * _context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) sequence;
+    struct test_clock_context_t * context = (struct test_clock_context_t*) _context;
+    reliable_assert( context->num_queued < TEST_CLOCK_MAX_QUEUED_PACKETS );
+    reliable_assert( packet_bytes <= 256 );
+    struct test_clock_packet_t * packet = context->queue + context->num_queued++;
+    packet->deliver_time = context->time + context->delay[index];
+    packet->index = index;
+    packet->packet_bytes = packet_bytes;
+    memcpy( packet->packet_data, packet_data, packet_bytes );
+}
+
+static void test_clock_simulate( struct test_clock_context_t * context, struct reliable_endpoint_t ** endpoints, double * clock_base, int num_steps )
+{
+    uint8_t dummy_packet[8];
+    memset( dummy_packet, 0, sizeof( dummy_packet ) );
+
+    int step;
+    for ( step = 0; step < num_steps; ++step )
     {
-        uint32_t base_sequence = ( endpoint->sent_packets->sequence - endpoint->config.sent_packets_buffer_size + 1 ) + 0xFFFF;
+        context->time += 0.001;
+
         int i;
-        int bytes_sent = 0;
-        double start_time = FLT_MAX;
-        double finish_time = 0.0;
-        int num_samples = endpoint->config.sent_packets_buffer_size / 2;
-        for ( i = 0; i < num_samples; ++i )
+        for ( i = 0; i < 2; ++i )
         {
-            uint16_t sequence = (uint16_t) ( base_sequence + i );
-            struct reliable_sent_packet_data_t * sent_packet_data = (struct reliable_sent_packet_data_t*) 
-                reliable_sequence_buffer_find( endpoint->sent_packets, sequence );
-            if ( !sent_packet_data || !sent_packet_data->acked )
-            {
-                continue;
-            }
-            bytes_sent += sent_packet_data->packet_bytes;
-            if ( sent_packet_data->time < start_time )
-            {
-                start_time = sent_packet_data->time;
-            }
-            if ( sent_packet_data->time > finish_time )
-            {
-                finish_time = sent_packet_data->time;
-            }
+            reliable_endpoint_update( endpoints[i], context->time + clock_base[i] );
         }
-        if ( start_time != FLT_MAX && finish_time != 0.0 )
+
+        i = 0;
+        while ( i < context->num_queued )
         {
-            float acked_bandwidth_kbps = (float) ( ( (double) bytes_sent ) / ( finish_time - start_time ) * 8.0f / 1000.0f );
-            if ( fabs( endpoint->acked_bandwidth_kbps - acked_bandwidth_kbps ) > 0.00001 )
+            struct test_clock_packet_t * packet = context->queue + i;
+            if ( packet->deliver_time <= context->time )
             {
-                endpoint->acked_bandwidth_kbps += ( acked_bandwidth_kbps - endpoint->acked_bandwidth_kbps ) * endpoint->config.bandwidth_smoothing_factor;
+                reliable_endpoint_receive_packet( endpoints[packet->index ^ 1], packet->packet_data, packet->packet_bytes );
+                *packet = context->queue[--context->num_queued];
             }
             else
             {
-                endpoint->acked_bandwidth_kbps = acked_bandwidth_kbps;
+                ++i;
             }
         }
+
+        if ( step % 10 == 0 )
+        {
+            reliable_endpoint_send_packet( endpoints[0], dummy_packet, sizeof( dummy_packet ) );
+            reliable_endpoint_send_packet( endpoints[1], dummy_packet, sizeof( dummy_packet ) );
+        }
     }
 }
 
-float reliable_endpoint_rtt( struct reliable_endpoint_t * endpoint )
+void test_clock_offset()
 {
-    reliable_assert( endpoint );
-    return endpoint->rtt;
-}
+    struct test_clock_context_t context;
+    memset( &context, 0, sizeof( context ) );
+    context.time = 100.0;
+    context.delay[0] = 0.02;
+    context.delay[1] = 0.02;
 
-float reliable_endpoint_packet_loss( struct reliable_endpoint_t * endpoint )
-{
-    reliable_assert( endpoint );
-    return endpoint->packet_loss;
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.context = &context;
+    config.transmit_packet_function = &test_clock_transmit_packet_function;
+    config.process_packet_function = &test_process_packet_function;
+    config.send_timestamps = 1;
+
+    // the second endpoint's clock runs 5 seconds ahead
+
+    double clock_base[2] = { 0.0, 5.0 };
+
+    struct reliable_endpoint_t * endpoints[2];
+    config.index = 0;
+    endpoints[0] = reliable_endpoint_create( &config, context.time + clock_base[0] );
+    config.index = 1;
+    endpoints[1] = reliable_endpoint_create( &config, context.time + clock_base[1] );
+
+    test_clock_simulate( &context, endpoints, clock_base, 1000 );
+
+    float outbound_delay, inbound_delay;
+
+    check( fabs( reliable_endpoint_clock_offset( endpoints[0] ) - 5000.0f ) < 2.0f );
+    check( fabs( reliable_endpoint_clock_offset( endpoints[1] ) + 5000.0f ) < 2.0f );
+    reliable_endpoint_one_way_delay( endpoints[0], &outbound_delay, &inbound_delay );
+    check( fabs( outbound_delay - 20.0f ) < 2.0f );
+    check( fabs( inbound_delay - 20.0f ) < 2.0f );
+
+    // queueing in one direction only. the offset holds on to the low rtt samples and the extra delay shows up outbound
+
+    context.delay[0] = 0.06;
+
+    test_clock_simulate( &context, endpoints, clock_base, 2000 );
+
+    check( fabs( reliable_endpoint_clock_offset( endpoints[0] ) - 5000.0f ) < 2.0f );
+    reliable_endpoint_one_way_delay( endpoints[0], &outbound_delay, &inbound_delay );
+    check( fabs( outbound_delay - 60.0f ) < 3.0f );
+    check( fabs( inbound_delay - 20.0f ) < 3.0f );
+    reliable_endpoint_one_way_delay( endpoints[1], &outbound_delay, &inbound_delay );
+    check( fabs( outbound_delay - 20.0f ) < 3.0f );
+    check( fabs( inbound_delay - 60.0f ) < 3.0f );
+
+    reliable_endpoint_destroy( endpoints[0] );
+    reliable_endpoint_destroy( endpoints[1] );
 }
 
-void reliable_endpoint_bandwidth( struct reliable_endpoint_t * endpoint, float * sent_bandwidth_kbps, float * received_bandwidth_kbps, float * acked_bandwidth_kbps )
+void test_read_stats()
 {
-    reliable_assert( endpoint );
-    reliable_assert( sent_bandwidth_kbps );
-    reliable_assert( acked_bandwidth_kbps );
-    reliable_assert( received_bandwidth_kbps );
-    *sent_bandwidth_kbps = endpoint->sent_bandwidth_kbps;
-    *received_bandwidth_kbps = endpoint->received_bandwidth_kbps;
-    *acked_bandwidth_kbps = endpoint->acked_bandwidth_kbps;
+    double time = 100.0;
+
+    struct test_context_t context;
+    memset( &context, 0, sizeof( context ) );
+
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.context = &context;
+    config.transmit_packet_function = &test_transmit_packet_function;
+    config.process_packet_function = &test_process_packet_function;
+
+    config.index = 0;
+    context.sender = reliable_endpoint_create( &config, time );
+    config.index = 1;
+    context.receiver = reliable_endpoint_create( &config, time );
+
+    struct reliable_endpoint_stats_t stats;
+    reliable_endpoint_read_stats( context.sender, &stats );
+    check( stats.time == time );
+    check( stats.counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT] == 0 );
+
+    uint8_t dummy_packet[8];
+    memset( dummy_packet, 0, sizeof( dummy_packet ) );
+
+    int i;
+    for ( i = 0; i < 100; ++i )
+    {
+        reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
+        reliable_endpoint_send_packet( context.receiver, dummy_packet, sizeof( dummy_packet ) );
+        time += 0.01;
+        reliable_endpoint_update( context.sender, time );
+        reliable_endpoint_update( context.receiver, time );
+    }
+
+    // the snapshot matches the endpoint as of its last update, and does not move until the next one
+
+    reliable_endpoint_read_stats( context.sender, &stats );
+    check( stats.time == time );
+    check( stats.rtt == reliable_endpoint_rtt( context.sender ) );
+    check( stats.packet_loss == reliable_endpoint_packet_loss( context.sender ) );
+    float sent_bandwidth_kbps, received_bandwidth_kbps, acked_bandwidth_kbps;
+    reliable_endpoint_bandwidth( context.sender, &sent_bandwidth_kbps, &received_bandwidth_kbps, &acked_bandwidth_kbps );
+    check( stats.sent_bandwidth_kbps == sent_bandwidth_kbps );
+    check( stats.received_bandwidth_kbps == received_bandwidth_kbps );
+    check( stats.acked_bandwidth_kbps == acked_bandwidth_kbps );
+    check( memcmp( stats.counters, reliable_endpoint_counters( context.sender ), sizeof( stats.counters ) ) == 0 );
+    check( stats.counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT] == 100 );
+
+    reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
+    reliable_endpoint_read_stats( context.sender, &stats );
+    check( stats.counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT] == 100 );
+
+    reliable_endpoint_destroy( context.sender );
+    reliable_endpoint_destroy( context.receiver );
 }
 
-RELIABLE_CONST uint64_t * reliable_endpoint_counters( struct reliable_endpoint_t * endpoint )
+void test_metrics()
 {
-    reliable_assert( endpoint );
-    return endpoint->counters;
-}
+    double time = 100.0;
 
-// ---------------------------------------------------------------
+    const int max_endpoints = 4;
+    uint64_t metrics_bytes = reliable_metrics_bytes( max_endpoints );
+    void * memory = malloc( metrics_bytes );
 
-#if RELIABLE_ENABLE_TESTS
+    check( reliable_metrics_attach( memory, 0 ) == NULL );
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <memory.h>
+    struct reliable_metrics_header_t * metrics = reliable_metrics_init( memory, max_endpoints );
+    check( metrics );
+    check( reliable_metrics_attach( memory, metrics_bytes ) == metrics );
+    check( reliable_metrics_attach( memory, metrics_bytes - 1 ) == NULL );
 
-static void check_handler( RELIABLE_CONST char * condition, 
-                           RELIABLE_CONST char * function,
-                           RELIABLE_CONST char * file,
-                           int line )
-{
-    printf( "check failed: ( %s ), function %s, file %s, line %d\n", condition, function, file, line );
-#ifndef NDEBUG
-    #if defined( __GNUC__ )
-        __builtin_trap();
-    #elif defined( _MSC_VER )
-        __debugbreak();
-    #endif
+    struct test_context_t context;
+    memset( &context, 0, sizeof( context ) );
+
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.context = &context;
+    config.transmit_packet_function = &test_transmit_packet_function;
+    config.process_packet_function = &test_process_packet_function;
+
+#if defined(_MSC_VER)
+    strcpy_s( config.name, sizeof( config.name ), "sender" );
+#else
+    strcpy( config.name, "sender" );
 #endif
-    exit( 1 );
-}
+    config.index = 0;
+    context.sender = reliable_endpoint_create( &config, time );
+#if defined(_MSC_VER)
+    strcpy_s( config.name, sizeof( config.name ), "receiver" );
+#else
+    strcpy( config.name, "receiver" );
+#endif
+    config.index = 1;
+    context.receiver = reliable_endpoint_create( &config, time );
 
-#define check( condition )                                                                                      \
-do                                                                                                              \
-{                                                                                                               \
-    if ( !(condition) )                                                                                         \
-    {                                                                                                           \
-        check_handler( #condition, (RELIABLE_CONST char*) __FUNCTION__, __FILE__, __LINE__ );                   \
-    }                                                                                                           \
-} while(0)
+    reliable_endpoint_export_metrics( context.sender, metrics, 0 );
+    reliable_endpoint_export_metrics( context.receiver, metrics, 2 );
 
-static void test_endian()
-{
-    uint32_t value = 0x11223344;
+    uint8_t dummy_packet[8];
+    memset( dummy_packet, 0, sizeof( dummy_packet ) );
 
-    char * bytes = (char*) &value;
+    int i;
+    for ( i = 0; i < 10; ++i )
+    {
+        reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
+        reliable_endpoint_send_packet( context.receiver, dummy_packet, sizeof( dummy_packet ) );
+        time += 0.01;
+        reliable_endpoint_update( context.sender, time );
+        reliable_endpoint_update( context.receiver, time );
+    }
 
-#if RELIABLE_LITTLE_ENDIAN
+    // a reader sees the same thing as the thread safe snapshot
 
-    check( bytes[0] == 0x44 );
-    check( bytes[1] == 0x33 );
-    check( bytes[2] == 0x22 );
-    check( bytes[3] == 0x11 );
+    char name[RELIABLE_METRICS_NAME_BYTES];
+    struct reliable_endpoint_stats_t exported;
+    struct reliable_endpoint_stats_t snapshot;
 
-#else // #if RELIABLE_LITTLE_ENDIAN
+    check( reliable_metrics_read( metrics, 0, name, &exported ) == 1 );
+    check( strcmp( name, "sender" ) == 0 );
+    reliable_endpoint_read_stats( context.sender, &snapshot );
+    check( memcmp( &exported, &snapshot, sizeof( snapshot ) ) == 0 );
+    check( exported.counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT] == 10 );
 
-    check( bytes[3] == 0x44 );
-    check( bytes[2] == 0x33 );
-    check( bytes[1] == 0x22 );
-    check( bytes[0] == 0x11 );
+    check( reliable_metrics_read( metrics, 1, name, &exported ) == 0 );
+    check( reliable_metrics_read( metrics, 2, name, &exported ) == 1 );
+    check( strcmp( name, "receiver" ) == 0 );
 
-#endif // #if RELIABLE_LITTLE_ENDIAN
+    // a record left mid-write by a dead writer fails instead of spinning forever
+
+    struct reliable_metrics_record_t * record = reliable_metrics_records( metrics ) + 2;
+    record->sequence++;
+    check( reliable_metrics_read( metrics, 2, name, &exported ) == -1 );
+    record->sequence++;
+
+    // destroyed endpoints release their record
+
+    reliable_endpoint_destroy( context.sender );
+    reliable_endpoint_destroy( context.receiver );
+
+    check( reliable_metrics_read( metrics, 0, name, &exported ) == 0 );
+    check( reliable_metrics_read( metrics, 2, name, &exported ) == 0 );
+
+    free( memory );
 }
 
-struct test_sequence_data_t
-{
-    uint16_t sequence;
-};
+static int test_num_logs;
+static int test_num_summary_logs;
 
-#define TEST_SEQUENCE_BUFFER_SIZE 256
+static int test_count_printf_function( RELIABLE_CONST char * format, ... )
+{
+    va_list args;
+    va_start( args, format );
+    char buffer[1024];
+    vsnprintf( buffer, sizeof( buffer ), format, args );
+    va_end( args );
+    test_num_logs++;
+    if ( strstr( buffer, "suppressed" ) )
+        test_num_summary_logs++;
+    return 0;
+}
 
-static void test_sequence_buffer()
+void test_error_log_rate_limit()
 {
-    struct reliable_sequence_buffer_t * sequence_buffer = reliable_sequence_buffer_create( TEST_SEQUENCE_BUFFER_SIZE, 
-                                                                                           sizeof( struct test_sequence_data_t ), 
-                                                                                           NULL, 
-                                                                                           NULL, 
-                                                                                           NULL );
+    double time = 100.0;
 
-    check( sequence_buffer );
-    check( sequence_buffer->sequence == 0 );
-    check( sequence_buffer->num_entries == TEST_SEQUENCE_BUFFER_SIZE );
-    check( sequence_buffer->entry_stride == sizeof( struct test_sequence_data_t ) );
+    struct test_context_t context;
+    memset( &context, 0, sizeof( context ) );
 
-    int i;
-    for ( i = 0; i < TEST_SEQUENCE_BUFFER_SIZE; ++i )
-    {
-        check( reliable_sequence_buffer_find( sequence_buffer, ((uint16_t)i) ) == NULL );
-    }                                                                      
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.context = &context;
+    config.transmit_packet_function = &test_transmit_packet_function;
+    config.process_packet_function = &test_process_packet_function;
+    config.max_error_logs_per_second = 10.0f;
+    config.error_log_burst = 5;
+    config.index = 0;
 
-    for ( i = 0; i <= TEST_SEQUENCE_BUFFER_SIZE*4; ++i )
+    struct reliable_endpoint_t * endpoint = reliable_endpoint_create( &config, time );
+
+    reliable_log_level( RELIABLE_LOG_LEVEL_ERROR );
+    reliable_set_printf_function( test_count_printf_function );
+    test_num_logs = 0;
+    test_num_summary_logs = 0;
+
+    // a flood of junk only logs the burst
+
+    uint8_t junk_packet[4] = { 0, 0, 0, 0 };
+
+    int i;
+    for ( i = 0; i < 1000; ++i )
     {
-        struct test_sequence_data_t * entry = (struct test_sequence_data_t*) reliable_sequence_buffer_insert( sequence_buffer, ((uint16_t)i) );
-        check( entry );
-        entry->sequence = (uint16_t) i;
-        check( sequence_buffer->sequence == i + 1 );
+        reliable_endpoint_receive_packet( endpoint, junk_packet, sizeof( junk_packet ) );
     }
 
-    for ( i = 0; i <= TEST_SEQUENCE_BUFFER_SIZE; ++i )
-    {
-        struct test_sequence_data_t * entry = (struct test_sequence_data_t*) reliable_sequence_buffer_insert( sequence_buffer, ((uint16_t)i) );
-        check( entry == NULL );
-    }    
+    check( reliable_endpoint_counters( endpoint )[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_INVALID] == 1000 );
+    check( reliable_endpoint_counters( endpoint )[RELIABLE_ENDPOINT_COUNTER_NUM_ERROR_LOGS_SUPPRESSED] == 995 );
 
-    int index = TEST_SEQUENCE_BUFFER_SIZE * 4;
-    for ( i = 0; i < TEST_SEQUENCE_BUFFER_SIZE; ++i )
+    // once tokens refill, the next update reports how many were dropped
+
+    time += 1.0;
+    reliable_endpoint_update( endpoint, time );
+
+#if RELIABLE_LOG_LEVEL_MAX >= RELIABLE_LOG_LEVEL_ERROR
+    check( test_num_logs == 6 );
+    check( test_num_summary_logs == 1 );
+#else // #if RELIABLE_LOG_LEVEL_MAX >= RELIABLE_LOG_LEVEL_ERROR
+    check( test_num_logs == 0 );
+#endif // #if RELIABLE_LOG_LEVEL_MAX >= RELIABLE_LOG_LEVEL_ERROR
+
+    // suppressions are counted even when error logs are turned off
+
+    reliable_log_level( RELIABLE_LOG_LEVEL_NONE );
+    test_num_logs = 0;
+
+    time += 1.0;
+    reliable_endpoint_update( endpoint, time );
+
+    for ( i = 0; i < 1000; ++i )
     {
-        struct test_sequence_data_t * entry = (struct test_sequence_data_t*) reliable_sequence_buffer_find( sequence_buffer, (uint16_t) index );
-        check( entry );
-        check( entry->sequence == (uint32_t) index );
-        index--;
+        reliable_endpoint_receive_packet( endpoint, junk_packet, sizeof( junk_packet ) );
     }
 
-    reliable_sequence_buffer_reset( sequence_buffer );
+    check( test_num_logs == 0 );
+    check( reliable_endpoint_counters( endpoint )[RELIABLE_ENDPOINT_COUNTER_NUM_ERROR_LOGS_SUPPRESSED] == 995 + 995 );
 
-    check( sequence_buffer );
-    check( sequence_buffer->sequence == 0 );
-    check( sequence_buffer->num_entries == TEST_SEQUENCE_BUFFER_SIZE );
-    check( sequence_buffer->entry_stride == sizeof( struct test_sequence_data_t ) );
+    time += 1.0;
+    reliable_endpoint_update( endpoint, time );
+
+    check( test_num_logs == 0 );
+
+    reliable_set_printf_function( (int (*)( RELIABLE_CONST char *, ... )) printf );
+    reliable_log_level( RELIABLE_LOG_LEVEL_NONE );
+
+    reliable_endpoint_destroy( endpoint );
+}
+
+struct test_log_context_t
+{
+    int num_events;
+    int index;
+    int event_counts[RELIABLE_LOG_NUM_EVENTS];
+    uint16_t last_acked;
+};
+
+static void test_log_function( void * context, int index, int level, int event, uint16_t sequence )
+{
+    struct test_log_context_t * log_context = (struct test_log_context_t*) context;
+    check( level >= RELIABLE_LOG_LEVEL_ERROR && level <= RELIABLE_LOG_LEVEL_DEBUG );
+    check( event >= 0 && event < RELIABLE_LOG_NUM_EVENTS );
+    check( strcmp( reliable_log_event_name( event ), "unknown" ) != 0 );
+    log_context->num_events++;
+    log_context->index = index;
+    log_context->event_counts[event]++;
+    if ( event == RELIABLE_LOG_EVENT_PACKET_ACKED )
+        log_context->last_acked = sequence;
+}
+
+static void test_log_context_transmit_function( void * context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) index;
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+}
+
+static int test_log_context_process_function( void * context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) index;
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+    return 1;
+}
+
+void test_endpoint_log_function()
+{
+    double time = 100.0;
+
+    struct test_log_context_t sender_log;
+    struct test_log_context_t receiver_log;
+    memset( &sender_log, 0, sizeof( sender_log ) );
+    memset( &receiver_log, 0, sizeof( receiver_log ) );
+
+    struct reliable_config_t sender_config;
+    reliable_default_config( &sender_config );
+    sender_config.context = &sender_log;
+    sender_config.index = 7;
+    sender_config.transmit_packet_function = &test_log_context_transmit_function;
+    sender_config.process_packet_function = &test_log_context_process_function;
+    sender_config.log_level = RELIABLE_LOG_LEVEL_DEBUG;
+    sender_config.log_function = &test_log_function;
+
+    struct reliable_config_t receiver_config = sender_config;
+    receiver_config.context = &receiver_log;
+    receiver_config.index = 8;
+    receiver_config.log_level = RELIABLE_LOG_LEVEL_ERROR;
+
+    struct reliable_endpoint_t * sender = reliable_endpoint_create( &sender_config, time );
+    struct reliable_endpoint_t * receiver = reliable_endpoint_create( &receiver_config, time );
+
+    // the global level stays at none, each endpoint logs at its own level
+
+    uint8_t packet_data[8];
+    memset( packet_data, 0, sizeof( packet_data ) );
+    reliable_endpoint_send_packet( sender, packet_data, sizeof( packet_data ) );
+
+#if RELIABLE_LOG_LEVEL_MAX >= RELIABLE_LOG_LEVEL_DEBUG
+    check( sender_log.index == 7 );
+    check( sender_log.event_counts[RELIABLE_LOG_EVENT_SEND_PACKET] == 1 );
+    check( sender_log.event_counts[RELIABLE_LOG_EVENT_SEND_PACKET_UNFRAGMENTED] == 1 );
+#endif // #if RELIABLE_LOG_LEVEL_MAX >= RELIABLE_LOG_LEVEL_DEBUG
+
+    uint8_t ack_packet[RELIABLE_MAX_PACKET_HEADER_BYTES + 8];
+    memset( ack_packet, 0, sizeof( ack_packet ) );
+    int ack_bytes = reliable_write_packet_header( ack_packet, 0, 0, 1 );
+    reliable_endpoint_receive_packet( sender, ack_packet, ack_bytes + 8 );
+
+#if RELIABLE_LOG_LEVEL_MAX >= RELIABLE_LOG_LEVEL_DEBUG
+    check( sender_log.event_counts[RELIABLE_LOG_EVENT_PACKET_ACKED] == 1 );
+    check( sender_log.last_acked == 0 );
+#else // #if RELIABLE_LOG_LEVEL_MAX >= RELIABLE_LOG_LEVEL_DEBUG
+    check( sender_log.num_events == 0 );
+#endif // #if RELIABLE_LOG_LEVEL_MAX >= RELIABLE_LOG_LEVEL_DEBUG
+
+    // debug events are filtered by the receiver's level, errors go through the same rate limit as text logs
 
-    for ( i = 0; i < TEST_SEQUENCE_BUFFER_SIZE; ++i )
+    int i;
+    uint8_t junk_packet[4] = { 0, 0, 0, 0 };
+    reliable_endpoint_receive_packet( receiver, ack_packet, ack_bytes + 8 );
+    for ( i = 0; i < 100; ++i )
     {
-        check( reliable_sequence_buffer_find( sequence_buffer, (uint16_t) i ) == NULL );
+        reliable_endpoint_receive_packet( receiver, junk_packet, sizeof( junk_packet ) );
     }
 
-    reliable_sequence_buffer_destroy( sequence_buffer );
+#if RELIABLE_LOG_LEVEL_MAX >= RELIABLE_LOG_LEVEL_ERROR
+    check( receiver_log.index == 8 );
+    check( receiver_log.event_counts[RELIABLE_LOG_EVENT_PROCESS_PACKET] == 0 );
+    check( receiver_log.event_counts[RELIABLE_LOG_EVENT_INVALID_PACKET] == receiver_config.error_log_burst );
+    check( receiver_log.num_events == receiver_config.error_log_burst );
+#else // #if RELIABLE_LOG_LEVEL_MAX >= RELIABLE_LOG_LEVEL_ERROR
+    check( receiver_log.num_events == 0 );
+#endif // #if RELIABLE_LOG_LEVEL_MAX >= RELIABLE_LOG_LEVEL_ERROR
+    check( reliable_endpoint_counters( receiver )[RELIABLE_ENDPOINT_COUNTER_NUM_ERROR_LOGS_SUPPRESSED] == (uint64_t) ( 100 - receiver_config.error_log_burst ) );
+
+    reliable_endpoint_destroy( sender );
+    reliable_endpoint_destroy( receiver );
 }
 
-static void test_generate_ack_bits()
+void test_trace()
 {
-    struct reliable_sequence_buffer_t * sequence_buffer = reliable_sequence_buffer_create( TEST_SEQUENCE_BUFFER_SIZE, 
-                                                                                           sizeof( struct test_sequence_data_t ), 
-                                                                                           NULL, 
-                                                                                           NULL, 
-                                                                                           NULL );
+    double time = 100.0;
 
-    uint16_t ack = 0;
-    uint32_t ack_bits = 0xFFFFFFFF;
+    struct test_context_t context;
+    memset( &context, 0, sizeof( context ) );
 
-    reliable_sequence_buffer_generate_ack_bits( sequence_buffer, &ack, &ack_bits );
-    check( ack == 0xFFFF );
-    check( ack_bits == 0 );
+    struct reliable_config_t client_config;
+    struct reliable_config_t server_config;
+
+    reliable_default_config( &client_config );
+    reliable_default_config( &server_config );
+
+    client_config.context = &context;
+    client_config.index = 0;
+    client_config.transmit_packet_function = &test_transmit_packet_function;
+    client_config.process_packet_function = &test_process_packet_function;
+    client_config.trace_events = 60;
+
+    server_config.context = &context;
+    server_config.index = 1;
+    server_config.transmit_packet_function = &test_transmit_packet_function;
+    server_config.process_packet_function = &test_process_packet_function;
+    server_config.trace_events = 1000;
+
+    context.sender = reliable_endpoint_create( &client_config, time );
+    context.receiver = reliable_endpoint_create( &server_config, time );
+
+    uint8_t packet_data[2048];
+    memset( packet_data, 0, sizeof( packet_data ) );
+
+    // trace is off unless asked for
+
+    struct reliable_config_t untraced_config = client_config;
+    untraced_config.index = 2;
+    untraced_config.trace_events = 0;
+    struct reliable_endpoint_t * untraced = reliable_endpoint_create( &untraced_config, time );
+    reliable_endpoint_send_packet( untraced, packet_data, 100 );
+    reliable_endpoint_update( untraced, time );
+
+    struct reliable_trace_event_t events[1024];
+    check( reliable_endpoint_trace( untraced, events, 1024 ) == 0 );
+    reliable_endpoint_destroy( untraced );
+
+    const int NumIterations = 100;
 
     int i;
-    for ( i = 0; i <= TEST_SEQUENCE_BUFFER_SIZE; ++i )
+    for ( i = 0; i < NumIterations; ++i )
     {
-        reliable_sequence_buffer_insert( sequence_buffer, (uint16_t) i );
+        reliable_endpoint_send_packet( context.sender, packet_data, 8 );
+        reliable_endpoint_send_packet( context.receiver, packet_data, 8 );
+        time += 0.01;
+        reliable_endpoint_update( context.sender, time );
+        reliable_endpoint_update( context.receiver, time );
     }
 
-    reliable_sequence_buffer_generate_ack_bits( sequence_buffer, &ack, &ack_bits );
-    check( ack == TEST_SEQUENCE_BUFFER_SIZE );
-    check( ack_bits == 0xFFFFFFFF );
-
-    reliable_sequence_buffer_reset( sequence_buffer );
+    // the ring rounds up to 64 entries and keeps only the newest, oldest first
 
-    uint16_t input_acks[] = { 1, 5, 9, 11 };
-    int input_num_acks = sizeof( input_acks ) / sizeof( uint16_t );
-    for ( i = 0; i < input_num_acks; ++i )
+    int num_events = reliable_endpoint_trace( context.sender, events, 1024 );
+    check( num_events == 64 );
+    for ( i = 1; i < num_events; ++i )
     {
-        reliable_sequence_buffer_insert( sequence_buffer, input_acks[i] );
+        check( events[i].time >= events[i-1].time );
     }
+    check( events[num_events-1].time == time - 0.01 );
 
-    reliable_sequence_buffer_generate_ack_bits( sequence_buffer, &ack, &ack_bits );
+    // a fragmented packet shows up as fragments on both sides and a reassembly at the receiver
 
-    check( ack == 11 );
-    check( ack_bits == ( 1 | (1<<(11-9)) | (1<<(11-5)) | (1<<(11-1)) ) );
+    reliable_endpoint_send_packet( context.sender, packet_data, sizeof( packet_data ) );
 
-    reliable_sequence_buffer_destroy( sequence_buffer );
+    num_events = reliable_endpoint_trace( context.receiver, events, 1024 );
+    int num_fragments = ( sizeof( packet_data ) + client_config.fragment_size - 1 ) / client_config.fragment_size;
+    int num_received = 0;
+    int num_acks = 0;
+    int num_fragments_received = 0;
+    int num_reassembled = 0;
+    for ( i = 0; i < num_events; ++i )
+    {
+        check( events[i].type < RELIABLE_TRACE_NUM_TYPES );
+        check( strcmp( reliable_trace_type_name( events[i].type ), "unknown" ) != 0 );
+        if ( events[i].type == RELIABLE_TRACE_RECEIVE )
+            num_received++;
+        if ( events[i].type == RELIABLE_TRACE_ACK )
+            num_acks++;
+        if ( events[i].type == RELIABLE_TRACE_RECEIVE_FRAGMENT )
+            num_fragments_received++;
+        if ( events[i].type == RELIABLE_TRACE_REASSEMBLED )
+        {
+            check( events[i].sequence == NumIterations );
+            num_reassembled++;
+        }
+    }
+    check( num_received == NumIterations + 1 );
+    check( num_acks == NumIterations );
+    check( num_fragments_received == num_fragments );
+    check( num_reassembled == 1 );
+
+    reliable_endpoint_destroy( context.sender );
+    reliable_endpoint_destroy( context.receiver );
 }
 
-static void test_packet_header()
+static uint16_t test_read_capture_uint16( uint8_t * p )
 {
-    uint16_t write_sequence;
-    uint16_t write_ack;
-    uint32_t write_ack_bits;
-
-    uint16_t read_sequence;
-    uint16_t read_ack;
-    uint32_t read_ack_bits;
-
-    uint8_t packet_data[RELIABLE_MAX_PACKET_HEADER_BYTES];
+    uint16_t value;
+    memcpy( &value, p, sizeof( value ) );
+    return value;
+}
 
-    // worst case, sequence and ack are far apart, no packets acked.
+static uint32_t test_read_capture_uint32( uint8_t * p )
+{
+    uint32_t value;
+    memcpy( &value, p, sizeof( value ) );
+    return value;
+}
 
-    write_sequence = 10000;
-    write_ack = 100;
-    write_ack_bits = 0;
+void test_capture()
+{
+    double time = 100.0;
 
-    int bytes_written = reliable_write_packet_header( packet_data, write_sequence, write_ack, write_ack_bits );
+    struct test_context_t context;
+    memset( &context, 0, sizeof( context ) );
 
-    check( bytes_written == RELIABLE_MAX_PACKET_HEADER_BYTES );
+    struct reliable_config_t sender_config;
+    struct reliable_config_t receiver_config;
 
-    int bytes_read = reliable_read_packet_header( "test_packet_header", packet_data, bytes_written, &read_sequence, &read_ack, &read_ack_bits );
+    reliable_default_config( &sender_config );
+    reliable_default_config( &receiver_config );
 
-    check( bytes_read == bytes_written );
+    sender_config.context = &context;
+    sender_config.index = 0;
+    sender_config.transmit_packet_function = &test_transmit_packet_function;
+    sender_config.process_packet_function = &test_process_packet_function;
 
-    check( read_sequence == write_sequence );
-    check( read_ack == write_ack );
-    check( read_ack_bits == write_ack_bits );
+    receiver_config.context = &context;
+    receiver_config.index = 1;
+    receiver_config.transmit_packet_function = &test_transmit_packet_function;
+    receiver_config.process_packet_function = &test_process_packet_function;
 
-    // rare case. sequence and ack are far apart, significant # of acks are missing
+    context.sender = reliable_endpoint_create( &sender_config, time );
+    context.receiver = reliable_endpoint_create( &receiver_config, time );
 
-    write_sequence = 10000;
-    write_ack = 100;
-    write_ack_bits = 0xFEFEFFFE;
+    const char * filename = "reliable_test_capture.pcapng";
 
-    bytes_written = reliable_write_packet_header( packet_data, write_sequence, write_ack, write_ack_bits );
+    check( reliable_endpoint_start_capture( context.receiver, filename ) );
 
-    check( bytes_written == 1 + 2 + 2 + 3 );
+    // one small packet each way, then a fragmented packet to the receiver. only wire datagrams are captured
 
-    bytes_read = reliable_read_packet_header( "test_packet_header", packet_data, bytes_written, &read_sequence, &read_ack, &read_ack_bits );
+    uint8_t packet_data[2048];
+    int i;
+    for ( i = 0; i < (int) sizeof( packet_data ); ++i )
+        packet_data[i] = (uint8_t) i;
+
+    reliable_endpoint_send_packet( context.sender, packet_data, 16 );
+    time += 0.5;
+    reliable_endpoint_update( context.receiver, time );
+    reliable_endpoint_send_packet( context.receiver, packet_data, 16 );
+    reliable_endpoint_send_packet( context.sender, packet_data, sizeof( packet_data ) );
+
+    reliable_endpoint_stop_capture( context.receiver );
+
+    FILE * file = fopen( filename, "rb" );
+    check( file );
+    static uint8_t capture[16*1024];
+    int capture_bytes = (int) fread( capture, 1, sizeof( capture ), file );
+    fclose( file );
+    remove( filename );
+
+    check( capture_bytes > 48 );
+    check( test_read_capture_uint32( capture ) == RELIABLE_PCAPNG_SECTION_HEADER_BLOCK );
+    check( test_read_capture_uint32( capture + 8 ) == RELIABLE_PCAPNG_BYTE_ORDER_MAGIC );
+    check( test_read_capture_uint16( capture + 12 ) == 1 );
+    check( test_read_capture_uint16( capture + 14 ) == 0 );
+    check( test_read_capture_uint32( capture + 28 ) == RELIABLE_PCAPNG_INTERFACE_DESCRIPTION_BLOCK );
+    check( test_read_capture_uint32( capture + 36 ) == RELIABLE_PCAPNG_LINKTYPE_IPV4 );
+
+    int num_inbound = 0;
+    int num_outbound = 0;
+    int offset = 48;
+    while ( offset < capture_bytes )
+    {
+        uint8_t * block = capture + offset;
+        uint32_t block_bytes = test_read_capture_uint32( block + 4 );
+        check( test_read_capture_uint32( block ) == RELIABLE_PCAPNG_ENHANCED_PACKET_BLOCK );
+        check( test_read_capture_uint32( block + block_bytes - 4 ) == block_bytes );
+
+        uint64_t timestamp = ( ( (uint64_t) test_read_capture_uint32( block + 12 ) ) << 32 ) | test_read_capture_uint32( block + 16 );
+        uint32_t captured_bytes = test_read_capture_uint32( block + 20 );
+        uint8_t * ip = block + 28;
+        check( ip[0] == 0x45 );
+        check( ip[9] == 17 );
+        check( ( ( ip[2] << 8 ) | ip[3] ) == (int) captured_bytes );
+
+        uint32_t checksum = 0;
+        for ( i = 0; i < 20; i += 2 )
+            checksum += ( ip[i] << 8 ) | ip[i+1];
+        while ( checksum >> 16 )
+            checksum = ( checksum & 0xFFFF ) + ( checksum >> 16 );
+        check( checksum == 0xFFFF );
+
+        uint32_t flags = test_read_capture_uint32( block + 28 + ( ( captured_bytes + 3 ) & ~3 ) + 4 );
+        if ( flags == RELIABLE_PCAPNG_INBOUND )
+        {
+            check( timestamp == ( num_inbound == 0 ? 100000000 : 100500000 ) );
+            check( ip[19] == 1 );
+            num_inbound++;
+        }
+        else
+        {
+            check( flags == RELIABLE_PCAPNG_OUTBOUND );
+            check( timestamp == 100500000 );
+            check( ip[19] == 2 );
+            num_outbound++;
+        }
 
-    check( bytes_read == bytes_written );
+        offset += block_bytes;
+    }
 
-    check( read_sequence == write_sequence );
-    check( read_ack == write_ack );
-    check( read_ack_bits == write_ack_bits );
+    check( offset == capture_bytes );
+    check( num_inbound == 3 );
+    check( num_outbound == 1 );
 
-    // common case under packet loss. sequence and ack are close together, some acks are missing
+    reliable_endpoint_destroy( context.sender );
+    reliable_endpoint_destroy( context.receiver );
+}
 
-    write_sequence = 200;
-    write_ack = 100;
-    write_ack_bits = 0xFFFEFFFF;
+struct test_simulator_context_t
+{
+    int num_delivered;
+    double last_time;
+    double time;
+    uint64_t checksum;
+    int out_of_order;
+    int last_id;
+};
 
-    bytes_written = reliable_write_packet_header( packet_data, write_sequence, write_ack, write_ack_bits );
+static void test_simulator_deliver_function( void * _context, int from, int to, uint8_t * packet_data, int packet_bytes )
+{
+    struct test_simulator_context_t * context = (struct test_simulator_context_t*) _context;
+    check( from == 0 );
+    check( to == 1 );
+    check( packet_bytes == 100 );
+    int id = packet_data[0] | ( packet_data[1] << 8 );
+    if ( id < context->last_id )
+        context->out_of_order++;
+    context->last_id = id;
+    context->num_delivered++;
+    context->last_time = context->time;
+    context->checksum = context->checksum * 31 + (uint64_t) id + (uint64_t) ( context->time * 1000.0 );
+}
 
-    check( bytes_written == 1 + 2 + 1 + 1 );
+static void test_simulator_run( struct reliable_network_simulator_link_t * link, uint64_t seed, struct test_simulator_context_t * context, struct reliable_network_simulator_stats_t * stats )
+{
+    memset( context, 0, sizeof( struct test_simulator_context_t ) );
 
-    bytes_read = reliable_read_packet_header( "test_packet_header", packet_data, bytes_written, &read_sequence, &read_ack, &read_ack_bits );
+    struct reliable_network_simulator_config_t config;
+    reliable_network_simulator_default_config( &config );
+    config.seed = seed;
+    config.link = *link;
+    config.context = context;
+    config.deliver_packet_function = &test_simulator_deliver_function;
 
-    check( bytes_read == bytes_written );
+    context->time = 100.0;
 
-    check( read_sequence == write_sequence );
-    check( read_ack == write_ack );
-    check( read_ack_bits == write_ack_bits );
+    struct reliable_network_simulator_t * simulator = reliable_network_simulator_create( &config, context->time );
 
-    // ideal case. no packet loss.
+    uint8_t packet_data[100];
+    memset( packet_data, 0, sizeof( packet_data ) );
 
-    write_sequence = 200;
-    write_ack = 100;
-    write_ack_bits = 0xFFFFFFFF;
+    int i;
+    for ( i = 0; i < 1000; ++i )
+    {
+        packet_data[0] = (uint8_t) ( i & 0xFF );
+        packet_data[1] = (uint8_t) ( i >> 8 );
+        reliable_network_simulator_send_packet( simulator, 0, 1, packet_data, sizeof( packet_data ) );
+        context->time += 0.001;
+        reliable_network_simulator_update( simulator, context->time );
+    }
 
-    bytes_written = reliable_write_packet_header( packet_data, write_sequence, write_ack, write_ack_bits );
+    for ( i = 0; i < 10000 && reliable_network_simulator_num_packets_in_flight( simulator ) > 0; ++i )
+    {
+        context->time += 0.001;
+        reliable_network_simulator_update( simulator, context->time );
+    }
 
-    check( bytes_written == 1 + 2 + 1 );
+    check( reliable_network_simulator_num_packets_in_flight( simulator ) == 0 );
 
-    bytes_read = reliable_read_packet_header( "test_packet_header", packet_data, bytes_written, &read_sequence, &read_ack, &read_ack_bits );
+    reliable_network_simulator_stats( simulator, stats );
 
-    check( bytes_read == bytes_written );
+    reliable_network_simulator_destroy( simulator );
+}
 
-    check( read_sequence == write_sequence );
-    check( read_ack == write_ack );
-    check( read_ack_bits == write_ack_bits );
+void test_network_simulator()
+{
+    struct test_simulator_context_t context;
+    struct reliable_network_simulator_stats_t stats;
+
+    // a clean link delivers everything in order after exactly the latency
+
+    struct reliable_network_simulator_link_t link;
+    memset( &link, 0, sizeof( link ) );
+    link.latency = 0.1f;
+
+    test_simulator_run( &link, 1, &context, &stats );
+    check( context.num_delivered == 1000 );
+    check( context.out_of_order == 0 );
+    check( context.last_time > 100.0 + 1.0 + 0.1 - 0.0015 && context.last_time < 100.0 + 1.0 + 0.1 + 0.0015 );
+
+    // loss, duplication and reordering happen at roughly the configured rates, and the same seed gives the same run
+
+    link.jitter = 0.02f;
+    link.packet_loss = 10.0f;
+    link.duplicate = 5.0f;
+    link.reorder = 5.0f;
+    link.reorder_delay = 0.05f;
+
+    test_simulator_run( &link, 12345, &context, &stats );
+    check( stats.num_packets_sent == 1000 );
+    check( stats.num_packets_lost > 50 && stats.num_packets_lost < 150 );
+    check( stats.num_packets_duplicated > 20 && stats.num_packets_duplicated < 80 );
+    check( stats.num_packets_reordered > 20 );
+    check( context.out_of_order > 0 );
+    check( (uint64_t) context.num_delivered == stats.num_packets_delivered );
+    check( stats.num_packets_delivered == stats.num_packets_sent - stats.num_packets_lost + stats.num_packets_duplicated );
+
+    uint64_t checksum = context.checksum;
+    test_simulator_run( &link, 12345, &context, &stats );
+    check( context.checksum == checksum );
+    test_simulator_run( &link, 54321, &context, &stats );
+    check( context.checksum != checksum );
+
+    // 100 byte packets every millisecond is 800kbps. a 400kbps link queues until max queue delay, then drops
+
+    memset( &link, 0, sizeof( link ) );
+    link.bandwidth_kbps = 400.0f;
+    link.max_queue_delay = 0.1f;
+
+    test_simulator_run( &link, 1, &context, &stats );
+    check( stats.num_packets_dropped > 400 && stats.num_packets_dropped < 600 );
+    check( context.last_time > 100.0 + 1.0 + 0.09 );
 }
 
-struct test_context_t
+struct test_message_context_t
 {
-    int drop;
     struct reliable_endpoint_t * sender;
     struct reliable_endpoint_t * receiver;
+    int num_packets;
+    int num_messages;
+    uint16_t next_message_id;
+    int in_order;
 };
 
-static void test_transmit_packet_function( void * _context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+static void test_message_transmit_function( void * _context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
 {
     (void) sequence;
+    struct test_message_context_t * context = (struct test_message_context_t*) _context;
+    context->num_packets++;
+    reliable_endpoint_receive_packet( index == 0 ? context->receiver : context->sender, packet_data, packet_bytes );
+}
 
-    struct test_context_t * context = (struct test_context_t*) _context;
+static int test_process_message_function( void * _context, int index, uint16_t message_id, uint8_t * message_data, int message_bytes )
+{
+    (void) index;
+    struct test_message_context_t * context = (struct test_message_context_t*) _context;
+    if ( message_id != context->next_message_id )
+        context->in_order = 0;
+    context->next_message_id = (uint16_t) ( message_id + 1 );
+    int i;
+    for ( i = 0; i < message_bytes; ++i )
+    {
+        check( message_data[i] == (uint8_t) ( message_id + i ) );
+    }
+    context->num_messages++;
+    return 1;
+}
 
-    if ( context->drop )
+static void test_fill_message( uint8_t * message_data, uint16_t message_id, int message_bytes )
+{
+    int i;
+    for ( i = 0; i < message_bytes; ++i )
+        message_data[i] = (uint8_t) ( message_id + i );
+}
+
+void test_message_aggregation()
+{
+    double time = 100.0;
+
+    struct test_message_context_t context;
+    memset( &context, 0, sizeof( context ) );
+    context.in_order = 1;
+
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.context = &context;
+    config.transmit_packet_function = &test_message_transmit_function;
+    config.process_packet_function = &test_process_packet_function;
+    config.process_message_function = &test_process_message_function;
+
+    config.index = 0;
+    context.sender = reliable_endpoint_create( &config, time );
+    config.index = 1;
+    context.receiver = reliable_endpoint_create( &config, time );
+
+    // 100 small messages of 20-60 bytes plus one large one pack into a handful of packets, in order and intact
+
+    const int NumMessages = 100;
+    uint8_t message_data[300];
+    int message_bytes_total = 0;
+    int i, j;
+    for ( i = 0; i < NumMessages; ++i )
     {
-        return;
+        uint16_t message_id = reliable_endpoint_next_message_id( context.sender );
+        check( message_id == i );
+        int message_bytes = 20 + ( message_id % 41 );
+        test_fill_message( message_data, message_id, message_bytes );
+        check( reliable_endpoint_queue_message( context.sender, message_data, message_bytes ) );
+        message_bytes_total += 1 + message_bytes;
     }
 
-    if ( index == 0 )
+    test_fill_message( message_data, reliable_endpoint_next_message_id( context.sender ), 300 );
+    check( reliable_endpoint_queue_message( context.sender, message_data, 300 ) );
+    message_bytes_total += 2 + 300;
+
+    check( context.num_packets > 0 );
+
+    reliable_endpoint_flush_messages( context.sender );
+
+    const int payload_bytes = config.max_message_packet_bytes - RELIABLE_MESSAGE_PACKET_HEADER_BYTES;
+    check( context.num_packets <= ( message_bytes_total + payload_bytes - 1 ) / payload_bytes + 1 );
+    check( context.num_messages == NumMessages + 1 );
+    check( context.in_order );
+
+    const uint64_t * receiver_counters = reliable_endpoint_counters( context.receiver );
+    check( receiver_counters[RELIABLE_ENDPOINT_COUNTER_NUM_MESSAGES_RECEIVED] == (uint64_t) NumMessages + 1 );
+    check( receiver_counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED] == (uint64_t) context.num_packets );
+
+    // once the receiver replies, every message is acked exactly once
+
+    reliable_endpoint_send_packet( context.receiver, message_data, 8 );
+
+    int num_message_acks;
+    uint16_t * message_acks = reliable_endpoint_get_message_acks( context.sender, &num_message_acks );
+    check( num_message_acks == NumMessages + 1 );
+    for ( i = 0; i < num_message_acks; ++i )
     {
-        reliable_endpoint_receive_packet( context->receiver, packet_data, packet_bytes );
+        check( message_acks[i] <= NumMessages );
+        for ( j = 0; j < i; ++j )
+            check( message_acks[j] != message_acks[i] );
     }
-    else if ( index == 1 )
+    reliable_endpoint_clear_message_acks( context.sender );
+
+    reliable_endpoint_send_packet( context.receiver, message_data, 8 );
+    reliable_endpoint_get_message_acks( context.sender, &num_message_acks );
+    check( num_message_acks == 0 );
+
+    // update flushes anything left queued, and oversize messages are refused
+
+    test_fill_message( message_data, reliable_endpoint_next_message_id( context.sender ), 20 );
+    check( reliable_endpoint_queue_message( context.sender, message_data, 20 ) );
+    check( context.num_messages == NumMessages + 1 );
+    time += 0.01;
+    reliable_endpoint_update( context.sender, time );
+    check( context.num_messages == NumMessages + 2 );
+
+    check( reliable_endpoint_queue_message( context.sender, message_data, config.max_message_packet_bytes ) == 0 );
+
+    reliable_endpoint_destroy( context.sender );
+    reliable_endpoint_destroy( context.receiver );
+
+    // a full message ack buffer drops the message acks that do not fit, but still acks the packet
+
+    config.message_ack_buffer_size = 4;
+    config.index = 0;
+    context.sender = reliable_endpoint_create( &config, time );
+    config.index = 1;
+    context.receiver = reliable_endpoint_create( &config, time );
+
+    for ( i = 0; i < 10; ++i )
     {
-        reliable_endpoint_receive_packet( context->sender, packet_data, packet_bytes );
+        test_fill_message( message_data, reliable_endpoint_next_message_id( context.sender ), 20 );
+        check( reliable_endpoint_queue_message( context.sender, message_data, 20 ) );
     }
+    reliable_endpoint_flush_messages( context.sender );
+    reliable_endpoint_send_packet( context.receiver, message_data, 8 );
+
+    int num_acks;
+    reliable_endpoint_get_acks( context.sender, &num_acks );
+    check( num_acks == 1 );
+    reliable_endpoint_get_message_acks( context.sender, &num_message_acks );
+    check( num_message_acks == 4 );
+    check( reliable_endpoint_counters( context.sender )[RELIABLE_ENDPOINT_COUNTER_NUM_MESSAGE_ACKS_DROPPED] == 6 );
+    check( reliable_endpoint_counters( context.sender )[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_ACKED] == 1 );
+
+    reliable_endpoint_destroy( context.sender );
+    reliable_endpoint_destroy( context.receiver );
 }
 
-static int test_process_packet_function( void * _context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+struct test_reliable_message_context_t
 {
-    struct test_context_t * context = (struct test_context_t*) _context;
+    struct reliable_endpoint_t * sender;
+    struct reliable_endpoint_t * receiver;
+    int num_packets;
+    int num_messages;
+    uint16_t next_message_id;
+    int in_order;
+};
 
-    (void) context;
-    (void) index;
+static void test_reliable_message_transmit_function( void * _context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
     (void) sequence;
-    (void) packet_data;
-    (void) packet_bytes;
-
-    return 1;
+    struct test_reliable_message_context_t * context = (struct test_reliable_message_context_t*) _context;
+    if ( ( context->num_packets++ % 3 ) == 0 )
+        return;
+    reliable_endpoint_receive_packet( index == 0 ? context->receiver : context->sender, packet_data, packet_bytes );
 }
 
-#define TEST_ACKS_NUM_ITERATIONS 256
+static void test_process_reliable_message_function( void * _context, int index, uint16_t message_id, uint8_t * message_data, int message_bytes )
+{
+    (void) index;
+    struct test_reliable_message_context_t * context = (struct test_reliable_message_context_t*) _context;
+    if ( message_id != context->next_message_id )
+        context->in_order = 0;
+    context->next_message_id = (uint16_t) ( message_id + 1 );
+    check( message_bytes == 1 + ( message_id % 200 ) );
+    int i;
+    for ( i = 0; i < message_bytes; ++i )
+    {
+        check( message_data[i] == (uint8_t) ( message_id + i ) );
+    }
+    context->num_messages++;
+}
 
-static void test_acks()
+void test_reliable_messages()
 {
     double time = 100.0;
 
-    struct test_context_t context;
+    struct test_reliable_message_context_t context;
     memset( &context, 0, sizeof( context ) );
-    
-    struct reliable_config_t sender_config;
-    struct reliable_config_t receiver_config;
-
-    reliable_default_config( &sender_config );
-    reliable_default_config( &receiver_config );
-
-    sender_config.context = &context;
-    sender_config.index = 0;
-    sender_config.transmit_packet_function = &test_transmit_packet_function;
-    sender_config.process_packet_function = &test_process_packet_function;
-
-    receiver_config.context = &context;
-    receiver_config.index = 1;
-    receiver_config.transmit_packet_function = &test_transmit_packet_function;
-    receiver_config.process_packet_function = &test_process_packet_function;
-
-    context.sender = reliable_endpoint_create( &sender_config, time );
-    context.receiver = reliable_endpoint_create( &receiver_config, time );
-
-    double delta_time = 0.01;
+    context.in_order = 1;
 
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.context = &context;
+    config.reliable_message_window = 64;
+    config.transmit_packet_function = &test_reliable_message_transmit_function;
+    config.process_packet_function = &test_process_packet_function;
+    config.process_reliable_message_function = &test_process_reliable_message_function;
+
+    config.index = 0;
+    context.sender = reliable_endpoint_create( &config, time );
+    config.index = 1;
+    context.receiver = reliable_endpoint_create( &config, time );
+
+    // a third of all packets are dropped in both directions, yet every message arrives exactly once and in order
+
+    const int NumMessages = 500;
+    uint8_t message_data[256];
+    uint8_t ack_packet[8];
+    memset( ack_packet, 0, sizeof( ack_packet ) );
+    int num_sent = 0;
     int i;
-    for ( i = 0; i < TEST_ACKS_NUM_ITERATIONS; ++i )
+    for ( i = 0; i < 2000; ++i )
     {
-        uint8_t dummy_packet[8];
-        memset( dummy_packet, 0, sizeof( dummy_packet ) );
+        while ( num_sent < NumMessages )
+        {
+            int message_bytes = 1 + ( num_sent % 200 );
+            test_fill_message( message_data, (uint16_t) num_sent, message_bytes );
+            if ( !reliable_endpoint_send_reliable_message( context.sender, message_data, message_bytes ) )
+                break;
+            num_sent++;
+        }
+
+        check( reliable_endpoint_num_unacked_reliable_messages( context.sender ) <= config.reliable_message_window );
 
-        reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
-        reliable_endpoint_send_packet( context.receiver, dummy_packet, sizeof( dummy_packet ) );
+        reliable_endpoint_send_packet( context.receiver, ack_packet, sizeof( ack_packet ) );
 
+        time += 0.01;
         reliable_endpoint_update( context.sender, time );
         reliable_endpoint_update( context.receiver, time );
 
-        time += delta_time;
+        if ( num_sent == NumMessages && reliable_endpoint_num_unacked_reliable_messages( context.sender ) == 0 )
+            break;
     }
 
-    uint8_t sender_acked_packet[TEST_ACKS_NUM_ITERATIONS];
-    memset( sender_acked_packet, 0, sizeof( sender_acked_packet ) );
-    int sender_num_acks;
-    uint16_t * sender_acks = reliable_endpoint_get_acks( context.sender, &sender_num_acks );
-    for ( i = 0; i < sender_num_acks; ++i )
+    check( num_sent == NumMessages );
+    check( context.num_messages == NumMessages );
+    check( context.in_order );
+    check( reliable_endpoint_num_unacked_reliable_messages( context.sender ) == 0 );
+
+    const uint64_t * sender_counters = reliable_endpoint_counters( context.sender );
+    check( sender_counters[RELIABLE_ENDPOINT_COUNTER_NUM_RELIABLE_MESSAGES_SENT] == (uint64_t) NumMessages );
+    check( sender_counters[RELIABLE_ENDPOINT_COUNTER_NUM_RELIABLE_MESSAGES_RESENT] > 0 );
+    check( reliable_endpoint_counters( context.receiver )[RELIABLE_ENDPOINT_COUNTER_NUM_RELIABLE_MESSAGES_RECEIVED] == (uint64_t) NumMessages );
+
+    // a packet rejected before it takes a sequence leaves its messages unmapped, so the ack for the next packet does not ack them
+
+    const int message_bytes = 1 + ( num_sent % 200 );
+    test_fill_message( message_data, (uint16_t) num_sent, message_bytes );
+    check( reliable_endpoint_send_reliable_message( context.sender, message_data, message_bytes ) );
+    context.sender->config.max_packet_size = 64;
+    reliable_endpoint_flush_messages( context.sender );
+    context.sender->config.max_packet_size = config.max_packet_size;
+    check( sender_counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_TOO_LARGE_TO_SEND] == 1 );
+
+    uint8_t packet_data[RELIABLE_MAX_PACKET_HEADER_BYTES + 8];
+    memset( packet_data, 0, sizeof( packet_data ) );
+    int packet_bytes = reliable_write_packet_header( packet_data, reliable_endpoint_next_packet_sequence( context.receiver ), reliable_endpoint_next_packet_sequence( context.sender ), 1 );
+    reliable_endpoint_receive_packet( context.sender, packet_data, packet_bytes + 8 );
+    check( reliable_endpoint_num_unacked_reliable_messages( context.sender ) == 1 );
+
+    for ( i = 0; i < 100 && reliable_endpoint_num_unacked_reliable_messages( context.sender ) > 0; ++i )
     {
-        if ( sender_acks[i] < TEST_ACKS_NUM_ITERATIONS )
-        {
-            sender_acked_packet[sender_acks[i]] = 1;
-        }
-    }
-    for ( i = 0; i < TEST_ACKS_NUM_ITERATIONS / 2; ++i )
-    {
-        check( sender_acked_packet[i] == 1 );
+        reliable_endpoint_send_packet( context.receiver, ack_packet, sizeof( ack_packet ) );
+        time += 0.01;
+        reliable_endpoint_update( context.sender, time );
+        reliable_endpoint_update( context.receiver, time );
     }
 
-    uint8_t receiver_acked_packet[TEST_ACKS_NUM_ITERATIONS];
-    memset( receiver_acked_packet, 0, sizeof( receiver_acked_packet ) );
-    int receiver_num_acks;
-    uint16_t * receiver_acks = reliable_endpoint_get_acks( context.receiver, &receiver_num_acks );
-    for ( i = 0; i < receiver_num_acks; ++i )
-    {
-        if ( receiver_acks[i] < TEST_ACKS_NUM_ITERATIONS )
-            receiver_acked_packet[receiver_acks[i]] = 1;
-    }
-    for ( i = 0; i < TEST_ACKS_NUM_ITERATIONS / 2; ++i )
-    {
-        check( receiver_acked_packet[i] == 1 );
-    }
+    check( reliable_endpoint_num_unacked_reliable_messages( context.sender ) == 0 );
+    check( context.num_messages == NumMessages + 1 );
+
+    // an unacked message is due now until its first send, then only when its resend comes up
+
+    test_fill_message( message_data, (uint16_t) ( num_sent + 1 ), message_bytes + 1 );
+    check( reliable_endpoint_send_reliable_message( context.sender, message_data, message_bytes + 1 ) );
+    check( reliable_endpoint_next_reliable_message_time( context.sender ) == time );
+    reliable_endpoint_flush_messages( context.sender );
+    const double resend_time = reliable_endpoint_reliable_message_resend_time( context.sender );
+    check( resend_time >= config.reliable_message_min_resend_time );
+    check( reliable_endpoint_next_reliable_message_time( context.sender ) == time + resend_time );
 
     reliable_endpoint_destroy( context.sender );
     reliable_endpoint_destroy( context.receiver );
 }
 
-static void test_acks_packet_loss()
+void test_ack_records()
 {
     double time = 100.0;
 
     struct test_context_t context;
     memset( &context, 0, sizeof( context ) );
-    
+
     struct reliable_config_t sender_config;
     struct reliable_config_t receiver_config;
 
@@ -1856,178 +7701,466 @@ static void test_acks_packet_loss()
     context.sender = reliable_endpoint_create( &sender_config, time );
     context.receiver = reliable_endpoint_create( &receiver_config, time );
 
-    const double delta_time = 0.1f;
+    // every ack record carries the cookie its packet was sent with. packets sent without one get zero
 
+    const int NumIterations = 16;
+    uint8_t dummy_packet[8];
+    memset( dummy_packet, 0, sizeof( dummy_packet ) );
     int i;
-    for ( i = 0; i < TEST_ACKS_NUM_ITERATIONS; ++i )
+    for ( i = 0; i < NumIterations; ++i )
     {
-        uint8_t dummy_packet[8];
-        memset( dummy_packet, 0, sizeof( dummy_packet ) );
-
-        context.drop = ( i % 2 );
-
-        reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
-        reliable_endpoint_send_packet( context.receiver, dummy_packet, sizeof( dummy_packet ) );
+        uint16_t sequence = reliable_endpoint_next_packet_sequence( context.sender );
+        if ( i & 1 )
+            reliable_endpoint_send_packet_with_cookie( context.sender, dummy_packet, sizeof( dummy_packet ), 0x1000000000ULL + sequence );
+        else
+            reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
 
+        time += 0.01;
         reliable_endpoint_update( context.sender, time );
+        reliable_endpoint_send_packet( context.receiver, dummy_packet, sizeof( dummy_packet ) );
         reliable_endpoint_update( context.receiver, time );
+    }
 
-        time += delta_time;
+    int num_acks;
+    uint16_t * acks = reliable_endpoint_get_acks( context.sender, &num_acks );
+    int num_ack_records;
+    struct reliable_ack_t * ack_records = reliable_endpoint_get_ack_records( context.sender, &num_ack_records );
+    check( num_acks == NumIterations );
+    check( num_ack_records == num_acks );
+    for ( i = 0; i < num_ack_records; ++i )
+    {
+        check( ack_records[i].sequence == acks[i] );
+        check( ack_records[i].cookie == ( ( acks[i] & 1 ) ? 0x1000000000ULL + acks[i] : 0 ) );
+        check( ack_records[i].rtt >= 9.0f && ack_records[i].rtt <= 11.0f );
     }
 
-    uint8_t sender_acked_packet[TEST_ACKS_NUM_ITERATIONS];
-    memset( sender_acked_packet, 0, sizeof( sender_acked_packet ) );
-    int sender_num_acks;
-    uint16_t * sender_acks = reliable_endpoint_get_acks( context.sender, &sender_num_acks );
-    for ( i = 0; i < sender_num_acks; ++i )
+    reliable_endpoint_clear_acks( context.sender );
+    reliable_endpoint_get_ack_records( context.sender, &num_ack_records );
+    check( num_ack_records == 0 );
+
+    reliable_endpoint_destroy( context.sender );
+    reliable_endpoint_destroy( context.receiver );
+}
+
+#define TEST_PACKET_EVENTS_NUM_PACKETS 1000
+
+struct test_packet_events_context_t
+{
+    struct reliable_endpoint_t * sender;
+    struct reliable_endpoint_t * receiver;
+    int receiver_online;
+    int num_acked[TEST_PACKET_EVENTS_NUM_PACKETS];
+    int num_lost[TEST_PACKET_EVENTS_NUM_PACKETS];
+};
+
+static void test_packet_events_transmit_function( void * _context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    struct test_packet_events_context_t * context = (struct test_packet_events_context_t*) _context;
+    if ( index == 0 )
     {
-        if ( sender_acks[i] < TEST_ACKS_NUM_ITERATIONS )
-        {
-            sender_acked_packet[sender_acks[i]] = 1;
-        }
+        if ( context->receiver_online && ( sequence % 4 ) != 3 )
+            reliable_endpoint_receive_packet( context->receiver, packet_data, packet_bytes );
     }
-    for ( i = 0; i < TEST_ACKS_NUM_ITERATIONS / 2; ++i )
+    else
     {
-        check( sender_acked_packet[i] == (i+1) % 2 );
+        reliable_endpoint_receive_packet( context->sender, packet_data, packet_bytes );
     }
+}
 
-    uint8_t receiver_acked_packet[TEST_ACKS_NUM_ITERATIONS];
-    memset( receiver_acked_packet, 0, sizeof( receiver_acked_packet ) );
-    int receiver_num_acks;
-    uint16_t * receiver_acks = reliable_endpoint_get_acks( context.sender, &receiver_num_acks );
-    for ( i = 0; i < receiver_num_acks; ++i )
+static void test_packet_acked_function( void * _context, int index, uint16_t sequence, uint64_t cookie, float rtt )
+{
+    (void) index;
+    (void) rtt;
+    struct test_packet_events_context_t * context = (struct test_packet_events_context_t*) _context;
+    check( sequence < TEST_PACKET_EVENTS_NUM_PACKETS );
+    check( cookie == (uint64_t) sequence * 3 );
+    context->num_acked[sequence]++;
+}
+
+static void test_packet_lost_function( void * _context, int index, uint16_t sequence, uint64_t cookie )
+{
+    (void) index;
+    struct test_packet_events_context_t * context = (struct test_packet_events_context_t*) _context;
+    check( sequence < TEST_PACKET_EVENTS_NUM_PACKETS );
+    check( cookie == (uint64_t) sequence * 3 );
+    context->num_lost[sequence]++;
+}
+
+void test_packet_events()
+{
+    double time = 100.0;
+
+    struct test_packet_events_context_t context;
+    memset( &context, 0, sizeof( context ) );
+    context.receiver_online = 1;
+
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.context = &context;
+    config.transmit_packet_function = &test_packet_events_transmit_function;
+    config.process_packet_function = &test_process_packet_function;
+
+    config.index = 1;
+    context.receiver = reliable_endpoint_create( &config, time );
+
+    config.index = 0;
+    config.packet_acked_function = &test_packet_acked_function;
+    config.packet_lost_function = &test_packet_lost_function;
+    context.sender = reliable_endpoint_create( &config, time );
+
+    // every fourth packet is dropped, and for a while the receiver goes quiet so more packets pile up than the ack array or sent
+    // packet buffer can hold. every packet still gets exactly one event, and it is the right one
+
+    uint8_t packet_data[8];
+    memset( packet_data, 0, sizeof( packet_data ) );
+    int i;
+    for ( i = 0; i < TEST_PACKET_EVENTS_NUM_PACKETS; ++i )
     {
-        if ( receiver_acks[i] < TEST_ACKS_NUM_ITERATIONS )
-        {
-            receiver_acked_packet[receiver_acks[i]] = 1;
-        }
+        context.receiver_online = i < 300 || i >= 700;
+        uint16_t sequence = reliable_endpoint_next_packet_sequence( context.sender );
+        reliable_endpoint_send_packet_with_cookie( context.sender, packet_data, sizeof( packet_data ), (uint64_t) sequence * 3 );
+        if ( context.receiver_online )
+            reliable_endpoint_send_packet( context.receiver, packet_data, sizeof( packet_data ) );
+        if ( ( i % 10 ) == 0 )
+            time += 0.01;
+        reliable_endpoint_update( context.sender, time );
+        reliable_endpoint_update( context.receiver, time );
     }
-    for ( i = 0; i < TEST_ACKS_NUM_ITERATIONS / 2; ++i )
+
+    for ( i = 0; i < 100; ++i )
     {
-        check( receiver_acked_packet[i] == (i+1) % 2 );
+        time += 0.01;
+        reliable_endpoint_update( context.sender, time );
     }
 
+    int num_acks;
+    reliable_endpoint_get_acks( context.sender, &num_acks );
+    check( num_acks == 0 );
+
+    uint64_t num_lost = 0;
+    for ( i = 0; i < TEST_PACKET_EVENTS_NUM_PACKETS; ++i )
+    {
+        check( context.num_acked[i] + context.num_lost[i] == 1 );
+        if ( ( i % 4 ) == 3 || ( i >= 300 && i < 700 ) )
+            check( context.num_lost[i] == 1 );
+        num_lost += context.num_lost[i];
+    }
+
+    check( reliable_endpoint_counters( context.sender )[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_LOST] == num_lost );
+    check( reliable_endpoint_counters( context.sender )[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_ACKED] + num_lost == TEST_PACKET_EVENTS_NUM_PACKETS );
+
+    // without an acked callback, a packet reported lost stays out of the acks array and the acked counter when its ack arrives late
+
+    reliable_endpoint_destroy( context.sender );
+    config.packet_acked_function = NULL;
+    context.sender = reliable_endpoint_create( &config, time );
+
+    const int num_lost_before = context.num_lost[0];
+    reliable_endpoint_send_packet_with_cookie( context.sender, packet_data, sizeof( packet_data ), 0 );
+    time += 1.0;
+    reliable_endpoint_update( context.sender, time );
+    check( context.num_lost[0] == num_lost_before + 1 );
+
+    uint8_t ack_packet[RELIABLE_MAX_PACKET_HEADER_BYTES + 8];
+    memset( ack_packet, 0, sizeof( ack_packet ) );
+    int ack_bytes = reliable_write_packet_header( ack_packet, 0, 0, 1 );
+    reliable_endpoint_receive_packet( context.sender, ack_packet, ack_bytes + 8 );
+
+    reliable_endpoint_get_acks( context.sender, &num_acks );
+    check( num_acks == 0 );
+    check( reliable_endpoint_counters( context.sender )[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_ACKED] == 0 );
+    check( reliable_endpoint_counters( context.sender )[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_ACKED_AFTER_LOST] == 1 );
+
+    // a packet acked in time still lands in the acks array
+
+    reliable_endpoint_send_packet_with_cookie( context.sender, packet_data, sizeof( packet_data ), 3 );
+    ack_bytes = reliable_write_packet_header( ack_packet, 1, 1, 1 );
+    reliable_endpoint_receive_packet( context.sender, ack_packet, ack_bytes + 8 );
+
+    uint16_t * acks = reliable_endpoint_get_acks( context.sender, &num_acks );
+    check( num_acks == 1 );
+    check( acks[0] == 1 );
+    check( reliable_endpoint_counters( context.sender )[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_ACKED] == 1 );
+
     reliable_endpoint_destroy( context.sender );
     reliable_endpoint_destroy( context.receiver );
 }
 
-#define TEST_MAX_PACKET_BYTES (4*1024)
+struct test_packet_loss_context_t
+{
+    struct reliable_endpoint_t * endpoints[2];
+    struct reliable_network_simulator_t * simulator;
+};
 
-static int generate_packet_data( uint16_t sequence, uint8_t * packet_data )
+static void test_packet_loss_transmit_function( void * _context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
 {
-    int packet_bytes = ( ( (int)sequence * 1023 ) % ( TEST_MAX_PACKET_BYTES - 2 ) ) + 2;
-    reliable_assert( packet_bytes >= 2 );
-    reliable_assert( packet_bytes <= TEST_MAX_PACKET_BYTES );
-    packet_data[0] = (uint8_t) ( sequence & 0xFF );
-    packet_data[1] = (uint8_t) ( (sequence>>8) & 0xFF );
-    int i;
-    for ( i = 2; i < packet_bytes; ++i )
+    struct test_packet_loss_context_t * context = (struct test_packet_loss_context_t*) _context;
+    if ( index == 0 && ( sequence % 20 ) < 3 )
+        return;
+    reliable_network_simulator_send_packet( context->simulator, index, index ^ 1, packet_data, packet_bytes );
+}
+
+static void test_packet_loss_deliver_function( void * _context, int from, int to, uint8_t * packet_data, int packet_bytes )
+{
+    (void) from;
+    struct test_packet_loss_context_t * context = (struct test_packet_loss_context_t*) _context;
+    reliable_endpoint_receive_packet( context->endpoints[to], packet_data, packet_bytes );
+}
+
+static void test_packet_loss_run( float packet_loss_window, float * packet_loss, float * average_burst_length, int * max_burst_length )
+{
+    double time = 100.0;
+
+    struct test_packet_loss_context_t context;
+    memset( &context, 0, sizeof( context ) );
+
+    struct reliable_network_simulator_config_t simulator_config;
+    reliable_network_simulator_default_config( &simulator_config );
+    simulator_config.max_endpoints = 2;
+    simulator_config.max_packets = 4096;
+    simulator_config.link.latency = 0.1f;
+    simulator_config.context = &context;
+    simulator_config.deliver_packet_function = &test_packet_loss_deliver_function;
+    context.simulator = reliable_network_simulator_create( &simulator_config, time );
+
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.context = &context;
+    config.sent_packets_buffer_size = 512;
+    config.packet_loss_window = packet_loss_window;
+    config.transmit_packet_function = &test_packet_loss_transmit_function;
+    config.process_packet_function = &test_process_packet_function;
+
+    int i, j;
+    for ( i = 0; i < 2; ++i )
     {
-        packet_data[i] = (uint8_t) ( ( (int)i + sequence ) % 256 );
+        config.index = i;
+        context.endpoints[i] = reliable_endpoint_create( &config, time );
     }
-    return packet_bytes;
+
+    uint8_t packet_data[32];
+    memset( packet_data, 0, sizeof( packet_data ) );
+    for ( i = 0; i < 300; ++i )
+    {
+        for ( j = 0; j < 15; ++j )
+            reliable_endpoint_send_packet( context.endpoints[0], packet_data, sizeof( packet_data ) );
+        reliable_endpoint_send_packet( context.endpoints[1], packet_data, sizeof( packet_data ) );
+        time += 0.01;
+        reliable_network_simulator_update( context.simulator, time );
+        reliable_endpoint_update( context.endpoints[0], time );
+        reliable_endpoint_update( context.endpoints[1], time );
+        reliable_endpoint_clear_acks( context.endpoints[0] );
+    }
+
+    *packet_loss = reliable_endpoint_packet_loss( context.endpoints[0] );
+    reliable_endpoint_packet_loss_bursts( context.endpoints[0], average_burst_length, max_burst_length );
+
+    for ( i = 0; i < 2; ++i )
+        reliable_endpoint_destroy( context.endpoints[i] );
+    reliable_network_simulator_destroy( context.simulator );
 }
 
-static void validate_packet_data( uint8_t * packet_data, int packet_bytes )
+void test_packet_loss_window()
 {
-    reliable_assert( packet_bytes >= 2 );
-    reliable_assert( packet_bytes <= TEST_MAX_PACKET_BYTES );
-    uint16_t sequence = 0;
-    sequence |= (uint16_t) packet_data[0];
-    sequence |= ( (uint16_t) packet_data[1] ) << 8;
-    check( packet_bytes == ( ( (int)sequence * 1023 ) % ( TEST_MAX_PACKET_BYTES - 2 ) ) + 2 );
-    int i;
-    for ( i = 2; i < packet_bytes; ++i )
+    // 1500 packets a second over a 200ms rtt keeps 300 packets in flight, more than half the sent packet buffer. the default
+    // estimate counts many of those as lost, while the windowed estimate only looks at packets whose acks are due
+
+    float packet_loss;
+    float average_burst_length;
+    int max_burst_length;
+
+    test_packet_loss_run( 0.0f, &packet_loss, &average_burst_length, &max_burst_length );
+    check( packet_loss > 30.0f );
+    check( max_burst_length > 3 );
+
+    // three in every twenty packets are dropped, so loss is 15% in bursts of three
+
+    test_packet_loss_run( 0.1f, &packet_loss, &average_burst_length, &max_burst_length );
+    check( packet_loss > 12.0f && packet_loss < 18.0f );
+    check( average_burst_length == 3.0f );
+    check( max_burst_length == 3 );
+
+    // on a steady 100ms link the variance decays to nothing, but an ack arriving at 1.5 rtt is still in time
+
+    double time = 100.0;
+
+    struct test_packet_events_context_t context;
+    memset( &context, 0, sizeof( context ) );
+
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.context = &context;
+    config.transmit_packet_function = &test_packet_events_transmit_function;
+    config.process_packet_function = &test_process_packet_function;
+    config.packet_acked_function = &test_packet_acked_function;
+    config.packet_lost_function = &test_packet_lost_function;
+    context.sender = reliable_endpoint_create( &config, time );
+
+    uint8_t packet_data[8];
+    memset( packet_data, 0, sizeof( packet_data ) );
+    uint8_t ack_packet[RELIABLE_MAX_PACKET_HEADER_BYTES + 8];
+    memset( ack_packet, 0, sizeof( ack_packet ) );
+
+    int i, j;
+    for ( i = 0; i <= 100; ++i )
     {
-        check( packet_data[i] == (uint8_t) ( ( (int)i + sequence ) % 256 ) );
+        if ( i == 100 )
+            check( reliable_endpoint_rtt_variance( context.sender ) < 1.0f );
+        reliable_endpoint_send_packet_with_cookie( context.sender, packet_data, sizeof( packet_data ), (uint64_t) i * 3 );
+        const int num_steps = ( i < 100 ) ? 10 : 15;
+        for ( j = 0; j < num_steps; ++j )
+        {
+            time += 0.01;
+            reliable_endpoint_update( context.sender, time );
+        }
+        int ack_bytes = reliable_write_packet_header( ack_packet, (uint16_t) i, (uint16_t) i, 1 );
+        reliable_endpoint_receive_packet( context.sender, ack_packet, ack_bytes + 8 );
     }
+
+    check( context.num_acked[100] == 1 );
+    check( reliable_endpoint_counters( context.sender )[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_LOST] == 0 );
+
+    reliable_endpoint_destroy( context.sender );
 }
 
-static int test_process_packet_function_validate( void * context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+struct test_congestion_context_t
 {
-    reliable_assert( packet_data );
-    reliable_assert( packet_bytes > 0 );
-    reliable_assert( packet_bytes <= TEST_MAX_PACKET_BYTES );
+    struct reliable_endpoint_t * endpoints[2];
+    struct reliable_network_simulator_t * simulator;
+    uint64_t bytes_received;
+};
 
-    (void) context;
-    (void) index;
+static void test_congestion_transmit_function( void * _context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
     (void) sequence;
+    struct test_congestion_context_t * context = (struct test_congestion_context_t*) _context;
+    reliable_network_simulator_send_packet( context->simulator, index, index ^ 1, packet_data, packet_bytes );
+}
 
-    validate_packet_data( packet_data, packet_bytes );
-
-    return 1;
+static void test_congestion_deliver_function( void * _context, int from, int to, uint8_t * packet_data, int packet_bytes )
+{
+    (void) from;
+    struct test_congestion_context_t * context = (struct test_congestion_context_t*) _context;
+    if ( to == 1 )
+        context->bytes_received += packet_bytes;
+    reliable_endpoint_receive_packet( context->endpoints[to], packet_data, packet_bytes );
 }
 
-void test_packets()
+// a 2mbps bottleneck with 50ms of base rtt and half a second of buffer. the sender fills whatever window the controller allows
+
+static void test_congestion_run( struct reliable_congestion_control_t * control, int clear_acks, float * throughput_kbps, float * queueing_delay, int * congestion_window )
 {
     double time = 100.0;
 
-    struct test_context_t context;
+    struct test_congestion_context_t context;
     memset( &context, 0, sizeof( context ) );
-    
-    struct reliable_config_t sender_config;
-    struct reliable_config_t receiver_config;
 
-    reliable_default_config( &sender_config );
-    reliable_default_config( &receiver_config );
+    struct reliable_network_simulator_config_t simulator_config;
+    reliable_network_simulator_default_config( &simulator_config );
+    simulator_config.link.latency = 0.025f;
+    simulator_config.context = &context;
+    simulator_config.deliver_packet_function = &test_congestion_deliver_function;
+    context.simulator = reliable_network_simulator_create( &simulator_config, time );
 
-    sender_config.fragment_above = 500;
-    receiver_config.fragment_above = 500;
+    struct reliable_network_simulator_link_t link = simulator_config.link;
+    link.bandwidth_kbps = 2000.0f;
+    link.max_queue_delay = 0.5f;
+    reliable_network_simulator_set_link( context.simulator, 0, &link );
 
-#if defined(_MSC_VER)
-    strcpy_s( sender_config.name, sizeof( sender_config.name ), "sender" );
-#else
-    strcpy( sender_config.name, "sender" );
-#endif
-    sender_config.context = &context;
-    sender_config.index = 0;
-    sender_config.transmit_packet_function = &test_transmit_packet_function;
-    sender_config.process_packet_function = &test_process_packet_function_validate;
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.context = &context;
+    config.transmit_packet_function = &test_congestion_transmit_function;
+    config.process_packet_function = &test_process_packet_function;
+
+    config.index = 1;
+    context.endpoints[1] = reliable_endpoint_create( &config, time );
+    config.index = 0;
+    config.congestion_control = *control;
+    context.endpoints[0] = reliable_endpoint_create( &config, time );
+
+    uint8_t packet_data[1000];
+    memset( packet_data, 0, sizeof( packet_data ) );
+    double rtt_sum = 0.0;
+    int num_rtt_samples = 0;
+    const int NumTicks = 2500;
+    int i, j;
+    for ( i = 0; i < NumTicks; ++i )
+    {
+        if ( i == NumTicks / 2 )
+            context.bytes_received = 0;
 
-#if defined(_MSC_VER)
-    strcpy_s( receiver_config.name, sizeof( receiver_config.name ), "receiver" );
-#else
-    strcpy( receiver_config.name, "receiver" );
-#endif
-    receiver_config.context = &context;
-    receiver_config.index = 1;
-    receiver_config.transmit_packet_function = &test_transmit_packet_function;
-    receiver_config.process_packet_function = &test_process_packet_function_validate;
+        for ( j = 0; j < 8 && reliable_endpoint_can_send( context.endpoints[0], sizeof( packet_data ) ); ++j )
+            reliable_endpoint_send_packet( context.endpoints[0], packet_data, sizeof( packet_data ) );
+        reliable_endpoint_send_packet( context.endpoints[1], packet_data, 16 );
 
-    context.sender = reliable_endpoint_create( &sender_config, time );
-    context.receiver = reliable_endpoint_create( &receiver_config, time );
+        time += 0.002;
+        reliable_network_simulator_update( context.simulator, time );
+        reliable_endpoint_update( context.endpoints[0], time );
+        reliable_endpoint_update( context.endpoints[1], time );
 
-    double delta_time = 0.1;
+        if ( !clear_acks )
+            continue;
 
-    int i;
-    for ( i = 0; i < 16; ++i )
-    {
+        int num_acks;
+        struct reliable_ack_t * acks = reliable_endpoint_get_ack_records( context.endpoints[0], &num_acks );
+        if ( i >= NumTicks / 2 )
         {
-            uint8_t packet_data[TEST_MAX_PACKET_BYTES];
-            uint16_t sequence = reliable_endpoint_next_packet_sequence( context.sender );
-            int packet_bytes = generate_packet_data( sequence, packet_data );
-            reliable_endpoint_send_packet( context.sender, packet_data, packet_bytes );
+            for ( j = 0; j < num_acks; ++j )
+                rtt_sum += acks[j].rtt;
+            num_rtt_samples += num_acks;
         }
+        reliable_endpoint_clear_acks( context.endpoints[0] );
+    }
 
-        {
-            uint8_t packet_data[TEST_MAX_PACKET_BYTES];
-            uint16_t sequence = reliable_endpoint_next_packet_sequence( context.sender );
-            int packet_bytes = generate_packet_data( sequence, packet_data );
-            reliable_endpoint_send_packet( context.sender, packet_data, packet_bytes );
-        }
+    if ( !clear_acks )
+        check( reliable_endpoint_counters( context.endpoints[0] )[RELIABLE_ENDPOINT_COUNTER_NUM_ACKS_DROPPED] > 0 );
 
-        reliable_endpoint_update( context.sender, time );
-        reliable_endpoint_update( context.receiver, time );
+    struct reliable_congestion_state_t congestion;
+    reliable_endpoint_congestion( context.endpoints[0], &congestion );
 
-        reliable_endpoint_clear_acks( context.sender );
-        reliable_endpoint_clear_acks( context.receiver );
+    *throughput_kbps = (float) ( context.bytes_received * 8.0 / ( NumTicks / 2 * 0.002 ) / 1000.0 );
+    *queueing_delay = num_rtt_samples > 0 ? (float) ( rtt_sum / num_rtt_samples ) - 50.0f : 0.0f;
+    *congestion_window = congestion.congestion_window;
 
-        time += delta_time;
-    }
+    reliable_endpoint_destroy( context.endpoints[0] );
+    reliable_endpoint_destroy( context.endpoints[1] );
+    reliable_network_simulator_destroy( context.simulator );
+}
 
-    reliable_endpoint_destroy( context.sender );
-    reliable_endpoint_destroy( context.receiver );
+void test_congestion_control()
+{
+    float throughput_kbps;
+    float queueing_delay;
+    int congestion_window;
+
+    // both controllers fill the link. aimd only backs off on loss, so it also fills the buffer behind it, while the delay
+    // controller holds queueing near its target with a window close to the bandwidth delay product
+
+    struct reliable_congestion_control_t control;
+    reliable_congestion_control_aimd( &control );
+    test_congestion_run( &control, 1, &throughput_kbps, &queueing_delay, &congestion_window );
+    check( throughput_kbps > 1800.0f );
+    check( queueing_delay > 100.0f );
+
+    reliable_congestion_control_delay( &control );
+    test_congestion_run( &control, 1, &throughput_kbps, &queueing_delay, &congestion_window );
+    check( throughput_kbps > 1800.0f );
+    check( queueing_delay < 40.0f );
+    check( congestion_window < 2 * 2000 * 75 / 8 );
+
+    // an application that never clears its acks overflows the acks array, but the controllers still see every ack
+
+    reliable_congestion_control_aimd( &control );
+    test_congestion_run( &control, 0, &throughput_kbps, &queueing_delay, &congestion_window );
+    check( throughput_kbps > 1800.0f );
+
+    reliable_congestion_control_delay( &control );
+    test_congestion_run( &control, 0, &throughput_kbps, &queueing_delay, &congestion_window );
+    check( throughput_kbps > 1800.0f );
+    check( congestion_window > 4 * 1200 );
 }
+
 #define RUN_TEST( test_function )                                           \
     do                                                                      \
     {                                                                       \
@@ -2047,6 +8180,29 @@ void reliable_test()
         RUN_TEST( test_acks );
         RUN_TEST( test_acks_packet_loss );
         RUN_TEST( test_packets );
+        RUN_TEST( test_packet_segments );
+        RUN_TEST( test_ring );
+        RUN_TEST( test_ring_handoff );
+        RUN_TEST( test_update_parallel );
+        RUN_TEST( test_timer_wheel );
+        RUN_TEST( test_allocation_stats );
+        RUN_TEST( test_profile );
+        RUN_TEST( test_rtt_histogram );
+        RUN_TEST( test_jitter );
+        RUN_TEST( test_clock_offset );
+        RUN_TEST( test_read_stats );
+        RUN_TEST( test_metrics );
+        RUN_TEST( test_error_log_rate_limit );
+        RUN_TEST( test_endpoint_log_function );
+        RUN_TEST( test_trace );
+        RUN_TEST( test_capture );
+        RUN_TEST( test_network_simulator );
+        RUN_TEST( test_message_aggregation );
+        RUN_TEST( test_reliable_messages );
+        RUN_TEST( test_ack_records );
+        RUN_TEST( test_packet_events );
+        RUN_TEST( test_packet_loss_window );
+        RUN_TEST( test_congestion_control );
     }
 }
 
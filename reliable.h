@@ -51,9 +51,25 @@
 #define RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_SENT                        7
 #define RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_RECEIVED                    8
 #define RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_INVALID                     9
-#define RELIABLE_ENDPOINT_NUM_COUNTERS                                      10
-
-#define RELIABLE_MAX_PACKET_HEADER_BYTES 9
+#define RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_TRANSMIT_RING_FULL            10
+#define RELIABLE_ENDPOINT_COUNTER_NUM_ALLOCATIONS                           11
+#define RELIABLE_ENDPOINT_COUNTER_NUM_FREES                                 12
+#define RELIABLE_ENDPOINT_COUNTER_NUM_BYTES_ALLOCATED                       13
+#define RELIABLE_ENDPOINT_COUNTER_NUM_ERROR_LOGS_SUPPRESSED                 14
+#define RELIABLE_ENDPOINT_COUNTER_NUM_MESSAGES_SENT                         15
+#define RELIABLE_ENDPOINT_COUNTER_NUM_MESSAGES_RECEIVED                     16
+#define RELIABLE_ENDPOINT_COUNTER_NUM_MESSAGES_ACKED                        17
+#define RELIABLE_ENDPOINT_COUNTER_NUM_RELIABLE_MESSAGES_SENT                18
+#define RELIABLE_ENDPOINT_COUNTER_NUM_RELIABLE_MESSAGES_RESENT              19
+#define RELIABLE_ENDPOINT_COUNTER_NUM_RELIABLE_MESSAGES_RECEIVED            20
+#define RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_LOST                          21
+#define RELIABLE_ENDPOINT_COUNTER_NUM_MESSAGE_ACKS_DROPPED                  22
+#define RELIABLE_ENDPOINT_COUNTER_NUM_ACKS_DROPPED                          23
+#define RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_ACKED_AFTER_LOST              24
+#define RELIABLE_ENDPOINT_NUM_COUNTERS                                      25
+
+#define RELIABLE_MAX_PACKET_HEADER_EXTENSION_BYTES 13
+#define RELIABLE_MAX_PACKET_HEADER_BYTES ( 9 + RELIABLE_MAX_PACKET_HEADER_EXTENSION_BYTES )
 #define RELIABLE_FRAGMENT_HEADER_BYTES 5
 
 #define RELIABLE_LOG_LEVEL_NONE     0
@@ -61,6 +77,29 @@
 #define RELIABLE_LOG_LEVEL_INFO     2
 #define RELIABLE_LOG_LEVEL_DEBUG    3
 
+#define RELIABLE_LOG_EVENT_TRANSMIT_RING_FULL                   0
+#define RELIABLE_LOG_EVENT_PACKET_TOO_LARGE_TO_SEND             1
+#define RELIABLE_LOG_EVENT_SEND_PACKET                          2
+#define RELIABLE_LOG_EVENT_SEND_PACKET_UNFRAGMENTED             3
+#define RELIABLE_LOG_EVENT_SEND_PACKET_FRAGMENTED               4
+#define RELIABLE_LOG_EVENT_PACKET_TOO_LARGE_TO_RECEIVE          5
+#define RELIABLE_LOG_EVENT_INVALID_PACKET                       6
+#define RELIABLE_LOG_EVENT_STALE_PACKET                         7
+#define RELIABLE_LOG_EVENT_PROCESS_PACKET                       8
+#define RELIABLE_LOG_EVENT_PROCESS_PACKET_SUCCEEDED             9
+#define RELIABLE_LOG_EVENT_PROCESS_PACKET_FAILED                10
+#define RELIABLE_LOG_EVENT_PACKET_ACKED                         11
+#define RELIABLE_LOG_EVENT_INVALID_FRAGMENT                     12
+#define RELIABLE_LOG_EVENT_STALE_FRAGMENT                       13
+#define RELIABLE_LOG_EVENT_FRAGMENT_COUNT_MISMATCH              14
+#define RELIABLE_LOG_EVENT_DUPLICATE_FRAGMENT                   15
+#define RELIABLE_LOG_EVENT_RECEIVE_FRAGMENT                     16
+#define RELIABLE_LOG_EVENT_PACKET_REASSEMBLED                   17
+#define RELIABLE_LOG_NUM_EVENTS                                 18
+
+#define RELIABLE_RING_RECORD_PACKET 0
+#define RELIABLE_RING_RECORD_ACKS   1
+
 #define RELIABLE_OK         1
 #define RELIABLE_ERROR      0
 
@@ -79,6 +118,31 @@ int reliable_init();
 
 void reliable_term();
 
+// congestion control. the endpoint tracks bytes in flight and calls the controller as packets are sent, acked and lost. the controller
+// recommends a congestion window and send rate. nothing is enforced: check reliable_endpoint_can_send before sending
+
+struct reliable_congestion_state_t
+{
+    int congestion_window;                          // bytes the controller allows in flight
+    float send_rate_kbps;                           // 0 until there is an rtt estimate
+    int bytes_in_flight;                            // maintained by the endpoint
+    float rtt;                                      // smoothed rtt in milliseconds, maintained by the endpoint
+};
+
+struct reliable_congestion_control_t
+{
+    int state_bytes;                                // per endpoint controller state, allocated and zeroed by the endpoint
+    void (*init_function)(void*,struct reliable_congestion_state_t*,double);                    // state, congestion, time. set to enable
+    void (*packet_sent_function)(void*,struct reliable_congestion_state_t*,double,int);         // state, congestion, time, packet bytes
+    void (*packet_acked_function)(void*,struct reliable_congestion_state_t*,double,int,float);  // state, congestion, time, packet bytes, rtt
+    void (*packet_lost_function)(void*,struct reliable_congestion_state_t*,double,int,double);  // state, congestion, time, packet bytes, send time
+    void (*update_function)(void*,struct reliable_congestion_state_t*,double);                  // state, congestion, time
+};
+
+void reliable_congestion_control_aimd( struct reliable_congestion_control_t * control );
+
+void reliable_congestion_control_delay( struct reliable_congestion_control_t * control );
+
 struct reliable_config_t
 {
     char name[256];
@@ -88,12 +152,15 @@ struct reliable_config_t
     int fragment_above;
     int max_fragments;
     int fragment_size;
-    int ack_buffer_size;
+    int ack_buffer_size;                            // acks past this are dropped from the acks array and counted, but still update rtt and congestion control
     int sent_packets_buffer_size;
     int received_packets_buffer_size;
     int fragment_reassembly_buffer_size;
     float rtt_smoothing_factor;
     float packet_loss_smoothing_factor;
+    float packet_loss_window;                       // seconds. when set, loss is measured over packets sent in this window, once older than srtt + k * rttvar.
+                                                    // only packets still in sent_packets count, so size that buffer for rtt plus window at the send rate
+    float packet_loss_rttvar_factor;                // k in the loss threshold, for both the windowed estimate and lost packet detection
     float bandwidth_smoothing_factor;
     int packet_header_size;
     void (*transmit_packet_function)(void*,int,uint16_t,uint8_t*,int);
@@ -101,6 +168,23 @@ struct reliable_config_t
     void * allocator_context;
     void * (*allocate_function)(void*,uint64_t);
     void (*free_function)(void*,void*);
+    struct reliable_ring_t * transmit_ring;
+    int send_timestamps;
+    float max_error_logs_per_second;
+    int error_log_burst;
+    int log_level;                                  // -1 follows reliable_log_level
+    int trace_events;                               // size of the packet trace ring. 0 disables it, otherwise rounded up to a power of two
+    int max_message_packet_bytes;                   // queued messages are flushed before the aggregated payload would exceed this. must not exceed max_packet_size
+    int message_ack_buffer_size;                    // message acks past this are dropped and counted. the packet ack itself is never dropped
+    int (*process_message_function)(void*,int,uint16_t,uint8_t*,int);     // context, index, message id, message data, message bytes
+    int reliable_message_window;                    // reliable messages in flight. sending more fails until the oldest is acked
+    float reliable_message_min_resend_time;         // unacked reliable messages are resent after 1.25 rtt, but never sooner than this (seconds)
+    void (*process_reliable_message_function)(void*,int,uint16_t,uint8_t*,int);    // context, index, message id, message data, message bytes
+    void (*log_function)(void*,int,int,int,uint16_t);   // context, index, level, event, sequence. replaces text output when set. levels above RELIABLE_LOG_LEVEL_MAX are compiled out for both
+    void (*packet_acked_function)(void*,int,uint16_t,uint64_t,float);  // context, index, sequence, cookie, rtt. replaces the acks array when set
+    void (*packet_lost_function)(void*,int,uint16_t,uint64_t);         // context, index, sequence, cookie
+    float packet_lost_min_timeout;                  // an unacked packet is lost after the larger of 2 * rtt and srtt + k * rttvar, but never sooner than this (seconds)
+    struct reliable_congestion_control_t congestion_control;
 };
 
 void reliable_default_config( struct reliable_config_t * config );
@@ -113,30 +197,353 @@ void reliable_endpoint_send_packet( struct reliable_endpoint_t * endpoint, uint8
 
 void reliable_endpoint_receive_packet( struct reliable_endpoint_t * endpoint, uint8_t * packet_data, int packet_bytes );
 
+void reliable_endpoint_receive_packet_segments( struct reliable_endpoint_t * endpoint, uint8_t * packet_data, int packet_bytes, int segment_bytes );
+
 void reliable_endpoint_free_packet( struct reliable_endpoint_t * endpoint, void * packet );
 
 uint16_t * reliable_endpoint_get_acks( struct reliable_endpoint_t * endpoint, int * num_acks );
 
 void reliable_endpoint_clear_acks( struct reliable_endpoint_t * endpoint );
 
+// the cookie is an opaque value stored with the sent packet and handed back in its ack record, so the application needs no lookup
+// of its own to find what a packet carried. ack records parallel the acks array and are cleared with it
+
+struct reliable_ack_t
+{
+    uint64_t cookie;
+    float rtt;                                      // milliseconds from send to ack for this packet
+    uint16_t sequence;
+};
+
+void reliable_endpoint_send_packet_with_cookie( struct reliable_endpoint_t * endpoint, uint8_t * packet_data, int packet_bytes, uint64_t cookie );
+
+struct reliable_ack_t * reliable_endpoint_get_ack_records( struct reliable_endpoint_t * endpoint, int * num_acks );
+
+// message aggregation. small messages queued during a tick are packed into one packet, split again on the receiver and handed to
+// process_message_function one at a time. a message is acked when the packet carrying it is acked
+
+int reliable_endpoint_queue_message( struct reliable_endpoint_t * endpoint, uint8_t * message_data, int message_bytes );
+
+void reliable_endpoint_flush_messages( struct reliable_endpoint_t * endpoint );
+
+uint16_t reliable_endpoint_next_message_id( struct reliable_endpoint_t * endpoint );
+
+uint16_t * reliable_endpoint_get_message_acks( struct reliable_endpoint_t * endpoint, int * num_message_acks );
+
+void reliable_endpoint_clear_message_acks( struct reliable_endpoint_t * endpoint );
+
+// reliable-ordered messages. they ride in the same packets as queued messages, are resent until a packet carrying them is acked,
+// and are delivered to process_reliable_message_function exactly once, in order
+
+int reliable_endpoint_send_reliable_message( struct reliable_endpoint_t * endpoint, uint8_t * message_data, int message_bytes );
+
+int reliable_endpoint_num_unacked_reliable_messages( struct reliable_endpoint_t * endpoint );
+
 void reliable_endpoint_reset( struct reliable_endpoint_t * endpoint );
 
 void reliable_endpoint_update( struct reliable_endpoint_t * endpoint, double time );
 
+double reliable_endpoint_next_update_time( struct reliable_endpoint_t * endpoint );
+
 float reliable_endpoint_rtt( struct reliable_endpoint_t * endpoint );
 
+float reliable_endpoint_rtt_variance( struct reliable_endpoint_t * endpoint );
+
+#define RELIABLE_RTT_HISTOGRAM_SUB_BUCKETS                                  16
+#define RELIABLE_RTT_HISTOGRAM_NUM_BUCKETS                                  384
+
+// log-linear histogram of rtt samples in microseconds. each power of two is split into 16 linear sub-buckets, so values are within ~6%
+
+struct reliable_rtt_histogram_t
+{
+    uint64_t count;
+    float max_rtt;
+    uint32_t buckets[RELIABLE_RTT_HISTOGRAM_NUM_BUCKETS];
+};
+
+void reliable_rtt_histogram_reset( struct reliable_rtt_histogram_t * histogram );
+
+void reliable_rtt_histogram_add( struct reliable_rtt_histogram_t * histogram, float rtt );
+
+void reliable_rtt_histogram_merge( struct reliable_rtt_histogram_t * histogram, RELIABLE_CONST struct reliable_rtt_histogram_t * other );
+
+float reliable_rtt_histogram_percentile( RELIABLE_CONST struct reliable_rtt_histogram_t * histogram, float percentile );
+
+RELIABLE_CONST struct reliable_rtt_histogram_t * reliable_endpoint_rtt_histogram( struct reliable_endpoint_t * endpoint );
+
+void reliable_endpoint_reset_rtt_histogram( struct reliable_endpoint_t * endpoint );
+
 float reliable_endpoint_packet_loss( struct reliable_endpoint_t * endpoint );
 
+// runs of consecutive lost packets among the packets the last loss estimate looked at
+
+void reliable_endpoint_packet_loss_bursts( struct reliable_endpoint_t * endpoint, float * average_burst_length, int * max_burst_length );
+
+float reliable_endpoint_jitter( struct reliable_endpoint_t * endpoint );
+
+float reliable_endpoint_clock_offset( struct reliable_endpoint_t * endpoint );
+
+void reliable_endpoint_one_way_delay( struct reliable_endpoint_t * endpoint, float * outbound_delay, float * inbound_delay );
+
 void reliable_endpoint_bandwidth( struct reliable_endpoint_t * endpoint, float * sent_bandwidth_kbps, float * received_bandwidth_kbps, float * acked_bandwidth_kpbs );
 
+void reliable_endpoint_congestion( struct reliable_endpoint_t * endpoint, struct reliable_congestion_state_t * congestion );
+
+int reliable_endpoint_can_send( struct reliable_endpoint_t * endpoint, int packet_bytes );
+
 RELIABLE_CONST uint64_t * reliable_endpoint_counters( struct reliable_endpoint_t * endpoint );
 
+struct reliable_allocation_stats_t
+{
+    uint64_t num_allocations;
+    uint64_t num_frees;
+    uint64_t bytes_allocated;
+    uint64_t live_bytes;
+    uint64_t peak_live_bytes;
+};
+
+// a copy of the endpoint stats published at the end of each update. safe to read from any thread while the endpoint is in use
+
+struct reliable_endpoint_stats_t
+{
+    double time;
+    float rtt;
+    float packet_loss;
+    float jitter;
+    float sent_bandwidth_kbps;
+    float received_bandwidth_kbps;
+    float acked_bandwidth_kbps;
+    uint64_t counters[RELIABLE_ENDPOINT_NUM_COUNTERS];
+};
+
+void reliable_endpoint_read_stats( struct reliable_endpoint_t * endpoint, struct reliable_endpoint_stats_t * stats );
+
+void reliable_endpoint_allocation_stats( struct reliable_endpoint_t * endpoint, struct reliable_allocation_stats_t * stats );
+
+// process wide totals. endpoints fold their own counts in when they publish stats at the end of each update, and when destroyed
+
+void reliable_allocation_stats( struct reliable_allocation_stats_t * stats );
+
+#define RELIABLE_PROFILE_HEADER_WRITE                                       0
+#define RELIABLE_PROFILE_HEADER_READ                                        1
+#define RELIABLE_PROFILE_FRAGMENT_SPLIT                                     2
+#define RELIABLE_PROFILE_FRAGMENT_REASSEMBLY                                3
+#define RELIABLE_PROFILE_ACK_PROCESSING                                     4
+#define RELIABLE_PROFILE_UPDATE_PACKET_LOSS                                 5
+#define RELIABLE_PROFILE_UPDATE_SENT_BANDWIDTH                              6
+#define RELIABLE_PROFILE_UPDATE_RECEIVED_BANDWIDTH                          7
+#define RELIABLE_PROFILE_UPDATE_ACKED_BANDWIDTH                             8
+#define RELIABLE_PROFILE_NUM_SPANS                                          9
+
+#define RELIABLE_PROFILE_NUM_BUCKETS                                        32
+
+// spans are only recorded when reliable.c is compiled with RELIABLE_ENABLE_PROFILING 1. ticks are rdtsc cycles on x86, nanoseconds elsewhere
+
+struct reliable_profile_histogram_t
+{
+    uint64_t count;
+    uint64_t total_ticks;
+    uint64_t max_ticks;
+    uint64_t buckets[RELIABLE_PROFILE_NUM_BUCKETS];         // bucket i counts spans that took [2^i,2^(i+1)) ticks
+};
+
+void reliable_endpoint_profile( struct reliable_endpoint_t * endpoint, int span, struct reliable_profile_histogram_t * histogram );
+
+void reliable_endpoint_reset_profile( struct reliable_endpoint_t * endpoint );
+
+RELIABLE_CONST char * reliable_profile_span_name( int span );
+
 void reliable_endpoint_destroy( struct reliable_endpoint_t * endpoint );
 
+struct reliable_thread_pool_t
+{
+    void * context;
+    int num_threads;
+    void (*run_function)(void*,void(*)(void*),void*);
+};
+
+void reliable_update_parallel( struct reliable_endpoint_t ** endpoints, int num_endpoints, double time, struct reliable_thread_pool_t * thread_pool );
+
+struct reliable_timer_wheel_t * reliable_timer_wheel_create( double time, 
+                                                             double tick_time, 
+                                                             void * allocator_context, 
+                                                             void * (*allocate_function)(void*,uint64_t), 
+                                                             void (*free_function)(void*,void*) );
+
+void reliable_timer_wheel_destroy( struct reliable_timer_wheel_t * timer_wheel );
+
+void reliable_timer_wheel_add( struct reliable_timer_wheel_t * timer_wheel, struct reliable_endpoint_t * endpoint );
+
+void reliable_timer_wheel_remove( struct reliable_timer_wheel_t * timer_wheel, struct reliable_endpoint_t * endpoint );
+
+int reliable_timer_wheel_update( struct reliable_timer_wheel_t * timer_wheel, double time );
+
+uint64_t reliable_ring_bytes( int capacity );
+
+struct reliable_ring_t * reliable_ring_init( void * memory, int capacity );
+
+struct reliable_ring_t * reliable_ring_attach( void * memory );
+
+int reliable_ring_push( struct reliable_ring_t * ring, int type, uint16_t sequence, uint8_t * packet_data, int packet_bytes );
+
+uint8_t * reliable_ring_peek( struct reliable_ring_t * ring, int * type, uint16_t * sequence, int * packet_bytes );
+
+void reliable_ring_pop( struct reliable_ring_t * ring );
+
+uint32_t reliable_ring_num_corrupt_records( struct reliable_ring_t * ring );
+
+int reliable_endpoint_receive_packets_from_ring( struct reliable_endpoint_t * endpoint, struct reliable_ring_t * ring, int max_packets );
+
+int reliable_endpoint_publish_acks( struct reliable_endpoint_t * endpoint, struct reliable_ring_t * ring );
+
+// metrics export. a header followed by max_endpoints fixed size records, meant to live in a memory mapped file that other processes read.
+// readers must check magic, version, record_bytes and num_counters before trusting the records.
+
+#define RELIABLE_METRICS_MAGIC                                              0x4D4C4552
+#define RELIABLE_METRICS_VERSION                                            5     // bump whenever the record layout or counters change
+#define RELIABLE_METRICS_NAME_BYTES                                         64
+
+struct reliable_metrics_header_t
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_bytes;
+    uint32_t record_bytes;
+    uint32_t num_counters;
+    uint32_t max_endpoints;
+    uint64_t reserved;
+};
+
+struct reliable_metrics_record_t
+{
+    volatile uint32_t sequence;                     // odd while the record is being written
+    uint32_t in_use;
+    char name[RELIABLE_METRICS_NAME_BYTES];
+    struct reliable_endpoint_stats_t stats;
+};
+
+uint64_t reliable_metrics_bytes( int max_endpoints );
+
+struct reliable_metrics_header_t * reliable_metrics_init( void * memory, int max_endpoints );
+
+struct reliable_metrics_header_t * reliable_metrics_attach( void * memory, uint64_t bytes );
+
+// returns 1 if the record is in use, 0 if it is free, and -1 if it stayed mid-write for too long, eg. the writer died while updating it
+
+int reliable_metrics_read( struct reliable_metrics_header_t * metrics, int index, char * name, struct reliable_endpoint_stats_t * stats );
+
+void reliable_endpoint_export_metrics( struct reliable_endpoint_t * endpoint, struct reliable_metrics_header_t * metrics, int index );
+
+// packet lifecycle trace. a fixed size ring per endpoint that overwrites the oldest events, dumped to a file on demand for offline analysis
+
+#define RELIABLE_TRACE_SEND                                                 0
+#define RELIABLE_TRACE_SEND_FRAGMENT                                        1
+#define RELIABLE_TRACE_RECEIVE                                              2
+#define RELIABLE_TRACE_RECEIVE_FRAGMENT                                     3
+#define RELIABLE_TRACE_STALE                                                4
+#define RELIABLE_TRACE_INVALID                                              5
+#define RELIABLE_TRACE_ACK                                                  6
+#define RELIABLE_TRACE_REASSEMBLED                                          7
+#define RELIABLE_TRACE_NUM_TYPES                                            8
+
+#define RELIABLE_TRACE_MAGIC                                                0x43525452
+#define RELIABLE_TRACE_VERSION                                              1
+
+struct reliable_trace_event_t
+{
+    double time;
+    uint32_t bytes;
+    uint16_t sequence;
+    uint8_t type;
+    uint8_t fragment_id;
+};
+
+struct reliable_trace_file_header_t
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t event_bytes;
+    uint32_t num_events;                            // events that follow the header, oldest first
+    uint64_t num_recorded;                          // events recorded over the endpoint lifetime, including those overwritten
+    char name[RELIABLE_METRICS_NAME_BYTES];
+};
+
+int reliable_endpoint_trace( struct reliable_endpoint_t * endpoint, struct reliable_trace_event_t * events, int max_events );
+
+int reliable_endpoint_dump_trace( struct reliable_endpoint_t * endpoint, RELIABLE_CONST char * filename );
+
+RELIABLE_CONST char * reliable_trace_type_name( int type );
+
+// datagram capture. every datagram handed to transmit_packet_function and every datagram passed to reliable_endpoint_receive_packet is written
+// to a pcapng file with synthetic IPv4/UDP headers, the endpoint time as timestamp, and the direction in the packet flags.
+// the endpoint is 10.0.0.1 and its peer 10.0.0.2, both on port RELIABLE_CAPTURE_PORT
+
+#define RELIABLE_CAPTURE_PORT                                               40000
+
+int reliable_endpoint_start_capture( struct reliable_endpoint_t * endpoint, RELIABLE_CONST char * filename );
+
+void reliable_endpoint_stop_capture( struct reliable_endpoint_t * endpoint );
+
+// deterministic network simulator. packets between endpoint indices are delayed, dropped, duplicated and reordered on a virtual clock,
+// driven by a seeded prng so the same seed and the same calls always produce the same deliveries
+
+struct reliable_network_simulator_link_t
+{
+    float latency;                                  // one way delay in seconds
+    float jitter;                                   // each packet's delay varies uniformly by up to +/- jitter seconds
+    float packet_loss;                              // percent
+    float duplicate;                                // percent of packets delivered twice, each copy with its own delay
+    float reorder;                                  // percent of packets held back an extra reorder_delay seconds so later packets overtake them
+    float reorder_delay;
+    float bandwidth_kbps;                           // sender side serialization rate. 0 is unlimited
+    float max_queue_delay;                          // packets that would wait longer than this behind the bandwidth limit are dropped
+};
+
+struct reliable_network_simulator_config_t
+{
+    uint64_t seed;
+    int max_endpoints;
+    int max_packets;                                // packets in flight beyond this are dropped
+    struct reliable_network_simulator_link_t link;  // initial outbound link for every endpoint index
+    void * context;
+    void (*deliver_packet_function)(void*,int,int,uint8_t*,int);   // context, from index, to index, packet data, packet bytes
+    void * allocator_context;
+    void * (*allocate_function)(void*,uint64_t);
+    void (*free_function)(void*,void*);
+};
+
+struct reliable_network_simulator_stats_t
+{
+    uint64_t num_packets_sent;
+    uint64_t num_packets_delivered;
+    uint64_t num_packets_lost;
+    uint64_t num_packets_duplicated;
+    uint64_t num_packets_reordered;
+    uint64_t num_packets_dropped;                   // bandwidth queue or in flight limit exceeded
+};
+
+void reliable_network_simulator_default_config( struct reliable_network_simulator_config_t * config );
+
+struct reliable_network_simulator_t * reliable_network_simulator_create( struct reliable_network_simulator_config_t * config, double time );
+
+void reliable_network_simulator_destroy( struct reliable_network_simulator_t * simulator );
+
+void reliable_network_simulator_set_link( struct reliable_network_simulator_t * simulator, int index, struct reliable_network_simulator_link_t * link );
+
+void reliable_network_simulator_send_packet( struct reliable_network_simulator_t * simulator, int from, int to, uint8_t * packet_data, int packet_bytes );
+
+void reliable_network_simulator_update( struct reliable_network_simulator_t * simulator, double time );
+
+int reliable_network_simulator_num_packets_in_flight( struct reliable_network_simulator_t * simulator );
+
+void reliable_network_simulator_stats( struct reliable_network_simulator_t * simulator, struct reliable_network_simulator_stats_t * stats );
+
 void reliable_log_level( int level );
 
 void reliable_set_printf_function( int (*function)( RELIABLE_CONST char *, ... ) );
 
+RELIABLE_CONST char * reliable_log_event_name( int event );
+
 extern void (*netcode_assert_function)( RELIABLE_CONST char *, RELIABLE_CONST char *, RELIABLE_CONST char * file, int line );
 
 #ifndef NDEBUG
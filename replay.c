@@ -0,0 +1,330 @@
+/*
+    reliable.io reference implementation
+
+    Copyright © 2017, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "reliable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+
+// feeds the inbound datagrams of a capture written by reliable_endpoint_start_capture into a fresh endpoint, timing every call.
+// the endpoint runs on the virtual time from the capture, so results are the same at any replay speed. speed 0 replays as fast as possible.
+// only inbound datagrams are replayed and the endpoint uses the default config, so it never sent the packets the capture acks and
+// reports acked 0. captures from endpoints with non-default fragment settings may also show fragments as invalid
+
+#define PCAPNG_SECTION_HEADER_BLOCK         0x0A0D0D0A
+#define PCAPNG_ENHANCED_PACKET_BLOCK        6
+#define PCAPNG_BYTE_ORDER_MAGIC             0x1A2B3C4D
+#define PCAPNG_OPTION_END                   0
+#define PCAPNG_OPTION_EPB_FLAGS             2
+#define PCAPNG_DIRECTION_MASK               3
+#define PCAPNG_INBOUND                      1
+
+#define UPDATE_INTERVAL 0.01
+
+struct replay_packet_t
+{
+    double time;
+    uint8_t * packet_data;
+    int packet_bytes;
+};
+
+double replay_time()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ( (double) ts.tv_nsec ) / 1000000000.0;
+}
+
+static uint32_t read_uint32( uint8_t * p )
+{
+    uint32_t value;
+    memcpy( &value, p, sizeof( value ) );
+    return value;
+}
+
+static uint16_t read_uint16( uint8_t * p )
+{
+    uint16_t value;
+    memcpy( &value, p, sizeof( value ) );
+    return value;
+}
+
+static int compare_double( const void * a, const void * b )
+{
+    double x = *(const double*) a;
+    double y = *(const double*) b;
+    return ( x > y ) - ( x < y );
+}
+
+// returns the number of inbound udp payloads found. packet data points into the capture buffer
+
+int replay_parse( uint8_t * capture, size_t capture_bytes, struct replay_packet_t * packets, int max_packets )
+{
+    if ( capture_bytes < 12 || read_uint32( capture ) != PCAPNG_SECTION_HEADER_BLOCK || read_uint32( capture + 8 ) != PCAPNG_BYTE_ORDER_MAGIC )
+    {
+        printf( "error: not a pcapng capture in host byte order\n" );
+        return -1;
+    }
+
+    int num_packets = 0;
+    size_t offset = 0;
+    while ( offset + 12 <= capture_bytes )
+    {
+        uint8_t * block = capture + offset;
+        uint32_t block_type = read_uint32( block );
+        uint32_t block_bytes = read_uint32( block + 4 );
+
+        if ( block_bytes < 12 || ( block_bytes & 3 ) || offset + block_bytes > capture_bytes )
+        {
+            printf( "warning: truncated block at offset %zu\n", offset );
+            break;
+        }
+
+        if ( block_type == PCAPNG_ENHANCED_PACKET_BLOCK && block_bytes >= 32 )
+        {
+            uint64_t timestamp = ( ( (uint64_t) read_uint32( block + 12 ) ) << 32 ) | read_uint32( block + 16 );
+            uint32_t captured_bytes = read_uint32( block + 20 );
+            uint8_t * ip = block + 28;
+
+            if ( 28 + ( ( captured_bytes + 3 ) & ~3u ) + 4 > block_bytes )
+            {
+                offset += block_bytes;
+                continue;
+            }
+
+            // captures without direction flags are treated as inbound
+
+            uint32_t flags = PCAPNG_INBOUND;
+            uint8_t * option = block + 28 + ( ( captured_bytes + 3 ) & ~3u );
+            uint8_t * options_end = block + block_bytes - 4;
+            while ( option + 4 <= options_end )
+            {
+                uint16_t code = read_uint16( option );
+                uint16_t length = read_uint16( option + 2 );
+                if ( code == PCAPNG_OPTION_END )
+                    break;
+                if ( code == PCAPNG_OPTION_EPB_FLAGS && length == 4 && option + 8 <= options_end )
+                    flags = read_uint32( option + 4 );
+                option += 4 + ( ( length + 3 ) & ~3 );
+            }
+
+            int ip_header_bytes = ( ip[0] & 0xF ) * 4;
+
+            if ( ( flags & PCAPNG_DIRECTION_MASK ) == PCAPNG_INBOUND &&
+                 ( ip[0] >> 4 ) == 4 && 
+                 ip[9] == 17 && 
+                 (int) captured_bytes > ip_header_bytes + 8 )
+            {
+                if ( num_packets == max_packets )
+                {
+                    printf( "warning: capture has more than %d inbound packets, ignoring the rest\n", max_packets );
+                    break;
+                }
+                packets[num_packets].time = timestamp / 1000000.0;
+                packets[num_packets].packet_data = ip + ip_header_bytes + 8;
+                packets[num_packets].packet_bytes = (int) captured_bytes - ip_header_bytes - 8;
+                num_packets++;
+            }
+        }
+
+        offset += block_bytes;
+    }
+
+    return num_packets;
+}
+
+static void replay_transmit_packet_function( void * context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) index;
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+}
+
+static int replay_process_packet_function( void * context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) index;
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+    return 1;
+}
+
+static void print_call_times( const char * label, double * values, int count )
+{
+    if ( count == 0 )
+        return;
+
+    double total = 0.0;
+    int i;
+    for ( i = 0; i < count; ++i )
+        total += values[i];
+
+    qsort( values, count, sizeof( double ), compare_double );
+
+    printf( "%-8s %9d calls, %8.3fms total. avg %7.0fns, p50 %7.0fns, p99 %7.0fns, max %7.0fns\n", 
+        label, 
+        count, 
+        total * 1000.0, 
+        total / count * 1000000000.0, 
+        values[count/2] * 1000000000.0, 
+        values[(int)(count*0.99)] * 1000000000.0, 
+        values[count-1] * 1000000000.0 );
+}
+
+int main( int argc, char ** argv )
+{
+    if ( argc < 2 )
+    {
+        printf( "usage: replay <capture file> [speed]\n" );
+        return 1;
+    }
+
+    double speed = argc >= 3 ? atof( argv[2] ) : 0.0;
+
+    FILE * file = fopen( argv[1], "rb" );
+    if ( !file )
+    {
+        printf( "error: could not open %s\n", argv[1] );
+        return 1;
+    }
+
+    fseek( file, 0, SEEK_END );
+    long file_bytes = ftell( file );
+    fseek( file, 0, SEEK_SET );
+    if ( file_bytes <= 0 )
+    {
+        printf( "error: %s is empty\n", argv[1] );
+        fclose( file );
+        return 1;
+    }
+
+    uint8_t * capture = (uint8_t*) malloc( file_bytes );
+    size_t capture_bytes = fread( capture, 1, file_bytes, file );
+    fclose( file );
+
+    int max_packets = (int) ( capture_bytes / 32 ) + 1;
+    struct replay_packet_t * packets = (struct replay_packet_t*) malloc( max_packets * sizeof( struct replay_packet_t ) );
+    int num_packets = replay_parse( capture, capture_bytes, packets, max_packets );
+    if ( num_packets <= 0 )
+    {
+        if ( num_packets == 0 )
+            printf( "error: no inbound packets in %s\n", argv[1] );
+        free( packets );
+        free( capture );
+        return 1;
+    }
+
+    reliable_init();
+
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.transmit_packet_function = &replay_transmit_packet_function;
+    config.process_packet_function = &replay_process_packet_function;
+#ifdef _MSC_VER
+    strcpy_s( config.name, sizeof( config.name ), "replay" );
+#else
+    strcpy( config.name, "replay" );
+#endif
+
+    double start_time = packets[0].time;
+    double end_time = packets[num_packets-1].time;
+
+    struct reliable_endpoint_t * endpoint = reliable_endpoint_create( &config, start_time );
+
+    double * receive_times = (double*) malloc( num_packets * sizeof( double ) );
+    int max_updates = (int) ( ( end_time - start_time ) / UPDATE_INTERVAL ) + num_packets + 2;
+    double * update_times = (double*) malloc( max_updates * sizeof( double ) );
+    int num_updates = 0;
+
+    printf( "replaying %d inbound packets spanning %.3f seconds from %s", num_packets, end_time - start_time, argv[1] );
+    if ( speed > 0.0 )
+        printf( " at %gx speed\n", speed );
+    else
+        printf( " as fast as possible\n" );
+
+    // updates run on a fixed virtual tick between packets, as a game loop would
+
+    double wall_start = replay_time();
+    double next_update = start_time;
+
+    int i;
+    for ( i = 0; i < num_packets; ++i )
+    {
+        double time = packets[i].time;
+
+        while ( next_update <= time && num_updates < max_updates )
+        {
+            double call_start = replay_time();
+            reliable_endpoint_update( endpoint, next_update );
+            update_times[num_updates++] = replay_time() - call_start;
+            next_update += UPDATE_INTERVAL;
+        }
+
+        if ( speed > 0.0 )
+        {
+            double wait = wall_start + ( time - start_time ) / speed - replay_time();
+            if ( wait > 0.0 )
+                usleep( (useconds_t) ( wait * 1000000.0 ) );
+        }
+
+        double call_start = replay_time();
+        reliable_endpoint_receive_packet( endpoint, packets[i].packet_data, packets[i].packet_bytes );
+        receive_times[i] = replay_time() - call_start;
+    }
+
+    double wall_time = replay_time() - wall_start;
+
+    const uint64_t * counters = reliable_endpoint_counters( endpoint );
+
+    printf( "replayed in %.3f seconds (%.0f packets per second)\n\n", wall_time, num_packets / wall_time );
+
+    print_call_times( "receive", receive_times, num_packets );
+    print_call_times( "update", update_times, num_updates );
+
+    printf( "\npackets received %" PRIu64 ", stale %" PRIu64 ", invalid %" PRIu64 ", fragments received %" PRIu64 ", fragments invalid %" PRIu64 ", acked %" PRIu64 "\n", 
+        counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED], 
+        counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_STALE], 
+        counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_INVALID], 
+        counters[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_RECEIVED], 
+        counters[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_INVALID], 
+        counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_ACKED] );
+    printf( "note: the replay endpoint never sent the packets acked in the capture, so acked is always 0\n" );
+
+    reliable_endpoint_destroy( endpoint );
+
+    reliable_term();
+
+    free( update_times );
+    free( receive_times );
+    free( packets );
+    free( capture );
+
+    return 0;
+}
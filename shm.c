@@ -0,0 +1,423 @@
+/*
+    reliable.io reference implementation
+
+    Copyright © 2017, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "reliable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define RING_CAPACITY ( 1024 * 1024 )
+#define PACKET_BYTES 100
+#define DEFAULT_ITERATIONS 100000
+
+#define TRANSPORT_SHM 0
+#define TRANSPORT_UDP 1
+
+double time_now()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ( (double) ts.tv_nsec ) / 1000000000.0;
+}
+
+struct transport_t
+{
+    int type;
+    struct reliable_ring_t * send_ring;
+    struct reliable_ring_t * receive_ring;
+    int socket;
+    struct sockaddr_in peer_address;
+    int loss_percent;
+    uint32_t random_state;
+    uint64_t num_dropped;
+    struct reliable_endpoint_t * endpoint;
+    volatile uint64_t num_processed;
+    volatile double last_processed_time;
+};
+
+uint32_t transport_random( struct transport_t * transport )
+{
+    uint32_t x = transport->random_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    transport->random_state = x;
+    return x;
+}
+
+void transport_transmit_packet_function( void * context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) index;
+
+    struct transport_t * transport = (struct transport_t*) context;
+
+    if ( transport->loss_percent > 0 && (int) ( transport_random( transport ) % 100 ) < transport->loss_percent )
+    {
+        transport->num_dropped++;
+        return;
+    }
+
+    if ( transport->type == TRANSPORT_SHM )
+    {
+        if ( reliable_ring_push( transport->send_ring, RELIABLE_RING_RECORD_PACKET, sequence, packet_data, packet_bytes ) != RELIABLE_OK )
+        {
+            transport->num_dropped++;
+        }
+    }
+    else
+    {
+        if ( sendto( transport->socket, packet_data, packet_bytes, 0, (struct sockaddr*) &transport->peer_address, sizeof( transport->peer_address ) ) != packet_bytes )
+        {
+            transport->num_dropped++;
+        }
+    }
+}
+
+int transport_process_packet_function( void * context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) index;
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+
+    struct transport_t * transport = (struct transport_t*) context;
+
+    transport->num_processed++;
+    transport->last_processed_time = time_now();
+
+    return 1;
+}
+
+void transport_poll( struct transport_t * transport )
+{
+    if ( transport->type == TRANSPORT_SHM )
+    {
+        reliable_endpoint_receive_packets_from_ring( transport->endpoint, transport->receive_ring, 0 );
+    }
+    else
+    {
+        uint8_t packet_data[2048];
+        while ( 1 )
+        {
+            int packet_bytes = (int) recvfrom( transport->socket, packet_data, sizeof( packet_data ), MSG_DONTWAIT, NULL, NULL );
+            if ( packet_bytes <= 0 )
+                break;
+            reliable_endpoint_receive_packet( transport->endpoint, packet_data, packet_bytes );
+        }
+    }
+}
+
+struct reliable_ring_t * create_shared_ring()
+{
+    uint64_t bytes = reliable_ring_bytes( RING_CAPACITY );
+
+    void * memory = MAP_FAILED;
+
+#if defined( __linux__ ) && defined( SYS_memfd_create )
+    // a memfd can be handed to another process over a unix socket and mapped there with reliable_ring_attach
+    int fd = (int) syscall( SYS_memfd_create, "reliable_ring", 0 );
+    if ( fd >= 0 )
+    {
+        if ( ftruncate( fd, (off_t) bytes ) == 0 )
+        {
+            memory = mmap( NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+        }
+        close( fd );
+    }
+#endif
+
+    if ( memory == MAP_FAILED )
+    {
+        memory = mmap( NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+    }
+
+    if ( memory == MAP_FAILED )
+    {
+        printf( "error: could not map shared memory\n" );
+        exit( 1 );
+    }
+
+    return reliable_ring_init( memory, RING_CAPACITY );
+}
+
+void destroy_shared_ring( struct reliable_ring_t * ring )
+{
+    munmap( ring, reliable_ring_bytes( RING_CAPACITY ) );
+}
+
+int create_socket( struct sockaddr_in * address )
+{
+    int s = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+    if ( s < 0 )
+    {
+        printf( "error: could not create socket\n" );
+        exit( 1 );
+    }
+
+    int buffer_size = 4 * 1024 * 1024;
+    setsockopt( s, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof( buffer_size ) );
+    setsockopt( s, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof( buffer_size ) );
+
+    memset( address, 0, sizeof( *address ) );
+    address->sin_family = AF_INET;
+    address->sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    address->sin_port = 0;
+
+    socklen_t length = sizeof( *address );
+    if ( bind( s, (struct sockaddr*) address, length ) != 0 || getsockname( s, (struct sockaddr*) address, &length ) != 0 )
+    {
+        printf( "error: could not bind socket\n" );
+        exit( 1 );
+    }
+
+    return s;
+}
+
+static volatile int server_quit = 0;
+static volatile int server_echo = 0;
+
+void * server_thread_function( void * data )
+{
+    struct transport_t * server = (struct transport_t*) data;
+
+    uint8_t packet_data[PACKET_BYTES];
+    memset( packet_data, 0, sizeof( packet_data ) );
+
+    uint64_t num_replied = 0;
+
+    while ( !server_quit )
+    {
+        uint64_t num_processed = server->num_processed;
+
+        transport_poll( server );
+
+        if ( server->num_processed == num_processed )
+        {
+            // spin politely so the benchmark still runs when both threads share a core
+            sched_yield();
+        }
+
+        if ( server_echo )
+        {
+            while ( num_replied < server->num_processed )
+            {
+                reliable_endpoint_send_packet( server->endpoint, packet_data, PACKET_BYTES );
+                num_replied++;
+            }
+        }
+        else
+        {
+            num_replied = server->num_processed;
+        }
+    }
+
+    return NULL;
+}
+
+int compare_doubles( const void * a, const void * b )
+{
+    double x = *(const double*) a;
+    double y = *(const double*) b;
+    return ( x > y ) - ( x < y );
+}
+
+void run_benchmark( int type, int iterations, int loss_percent )
+{
+    struct transport_t client;
+    struct transport_t server;
+    memset( &client, 0, sizeof( client ) );
+    memset( &server, 0, sizeof( server ) );
+
+    client.type = type;
+    server.type = type;
+    client.loss_percent = loss_percent;
+    server.loss_percent = loss_percent;
+    client.random_state = 0x12345678;
+    server.random_state = 0x87654321;
+
+    if ( type == TRANSPORT_SHM )
+    {
+        client.send_ring = create_shared_ring();
+        server.send_ring = create_shared_ring();
+        client.receive_ring = server.send_ring;
+        server.receive_ring = client.send_ring;
+    }
+    else
+    {
+        struct sockaddr_in client_address;
+        struct sockaddr_in server_address;
+        client.socket = create_socket( &client_address );
+        server.socket = create_socket( &server_address );
+        client.peer_address = server_address;
+        server.peer_address = client_address;
+    }
+
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.transmit_packet_function = &transport_transmit_packet_function;
+    config.process_packet_function = &transport_process_packet_function;
+
+    double time = 100.0;
+
+    config.context = &client;
+    config.index = 0;
+    client.endpoint = reliable_endpoint_create( &config, time );
+
+    config.context = &server;
+    config.index = 1;
+    server.endpoint = reliable_endpoint_create( &config, time );
+
+    const char * name = ( type == TRANSPORT_SHM ) ? "shm" : "udp";
+
+    uint8_t packet_data[PACKET_BYTES];
+    memset( packet_data, 0, sizeof( packet_data ) );
+
+    pthread_t server_thread;
+
+    // round trip latency: send one packet, spin until the echo comes back
+
+    server_quit = 0;
+    server_echo = 1;
+    pthread_create( &server_thread, NULL, server_thread_function, &server );
+
+    double * samples = (double*) malloc( iterations * sizeof( double ) );
+    int num_samples = 0;
+    int i;
+    for ( i = 0; i < iterations; ++i )
+    {
+        uint64_t expected = client.num_processed + 1;
+        double start_time = time_now();
+        double timeout_time = start_time + 0.1;
+        reliable_endpoint_send_packet( client.endpoint, packet_data, PACKET_BYTES );
+        while ( client.num_processed < expected )
+        {
+            transport_poll( &client );
+            if ( client.num_processed < expected )
+                sched_yield();
+            if ( time_now() > timeout_time )
+                break;
+        }
+        if ( client.num_processed >= expected )
+        {
+            samples[num_samples++] = ( time_now() - start_time ) * 1000000.0;
+        }
+    }
+
+    server_quit = 1;
+    pthread_join( server_thread, NULL );
+
+    if ( num_samples > 0 )
+    {
+        qsort( samples, num_samples, sizeof( double ), compare_doubles );
+        printf( "%s: round trip %d/%d | p50 = %.2fus | p90 = %.2fus | p99 = %.2fus | max = %.2fus\n", 
+            name, num_samples, iterations, 
+            samples[num_samples/2], samples[(int)(num_samples*0.9)], samples[(int)(num_samples*0.99)], samples[num_samples-1] );
+    }
+
+    free( samples );
+
+    // throughput: client sends as fast as it can, server only receives
+
+    server_quit = 0;
+    server_echo = 0;
+    server.num_processed = 0;
+    pthread_create( &server_thread, NULL, server_thread_function, &server );
+
+    uint64_t dropped_before = client.num_dropped;
+    double start_time = time_now();
+    for ( i = 0; i < iterations * 10; ++i )
+    {
+        reliable_endpoint_send_packet( client.endpoint, packet_data, PACKET_BYTES );
+    }
+
+    uint64_t num_processed = server.num_processed;
+    double idle_time = time_now();
+    while ( time_now() - idle_time < 0.05 )
+    {
+        sched_yield();
+        if ( server.num_processed != num_processed )
+        {
+            num_processed = server.num_processed;
+            idle_time = time_now();
+        }
+    }
+
+    server_quit = 1;
+    pthread_join( server_thread, NULL );
+
+    double elapsed = server.last_processed_time - start_time;
+    printf( "%s: throughput %" PRIu64 "/%d delivered (%" PRIu64 " dropped) | %.0f packets/sec\n", 
+        name, server.num_processed, iterations * 10, client.num_dropped - dropped_before, 
+        elapsed > 0.0 ? server.num_processed / elapsed : 0.0 );
+
+    reliable_endpoint_destroy( client.endpoint );
+    reliable_endpoint_destroy( server.endpoint );
+
+    if ( type == TRANSPORT_SHM )
+    {
+        destroy_shared_ring( client.send_ring );
+        destroy_shared_ring( server.send_ring );
+    }
+    else
+    {
+        close( client.socket );
+        close( server.socket );
+    }
+}
+
+int main( int argc, char ** argv )
+{
+    int iterations = DEFAULT_ITERATIONS;
+    int loss_percent = 0;
+
+    if ( argc >= 2 )
+        iterations = atoi( argv[1] );
+
+    if ( argc >= 3 )
+        loss_percent = atoi( argv[2] );
+
+    printf( "[shm]\n" );
+
+    reliable_init();
+
+    run_benchmark( TRANSPORT_SHM, iterations, loss_percent );
+    run_benchmark( TRANSPORT_UDP, iterations, loss_percent );
+
+    reliable_term();
+
+    return 0;
+}
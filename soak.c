@@ -31,6 +31,16 @@
 #include <signal.h>
 #include <inttypes.h>
 
+#if defined( _WIN32 )
+#include <windows.h>
+#elif defined( __linux__ )
+#include <time.h>
+#include <unistd.h>
+#else
+#include <time.h>
+#include <sys/resource.h>
+#endif
+
 #define MAX_PACKET_BYTES (16*1024)
 
 static volatile int quit = 0;
@@ -41,41 +51,43 @@ void interrupt_handler( int signal )
     quit = 1;
 }
 
-int random_int( int a, int b )
-{
-    assert( a < b );
-    int result = a + rand() % ( b - a + 1 );
-    assert( result >= a );
-    assert( result <= b );
-    return result;
-}
-
 struct test_context_t
 {
     struct reliable_endpoint_t * client;
     struct reliable_endpoint_t * server;
+    struct reliable_network_simulator_t * network_simulator;
 };
 
 double global_time = 100.0;
 
 struct test_context_t global_context;
 
+const char * trace_filename = NULL;
+
+const char * capture_filename = NULL;
+
 void test_transmit_packet_function( void * _context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
 {
     (void) sequence;
 
     struct test_context_t * context = (struct test_context_t*) _context;
 
-    if ( random_int(0,100) < 5 )
-        return;
+    reliable_network_simulator_send_packet( context->network_simulator, index, index ^ 1, packet_data, packet_bytes );
+}
 
-    if ( index == 0 )
+void test_deliver_packet_function( void * _context, int from, int to, uint8_t * packet_data, int packet_bytes )
+{
+    (void) from;
+
+    struct test_context_t * context = (struct test_context_t*) _context;
+
+    if ( to == 0 )
     {
-        reliable_endpoint_receive_packet( context->server, packet_data, packet_bytes );
+        reliable_endpoint_receive_packet( context->client, packet_data, packet_bytes );
     }
-    else if ( index == 1 )
+    else if ( to == 1 )
     {
-        reliable_endpoint_receive_packet( context->client, packet_data, packet_bytes );
+        reliable_endpoint_receive_packet( context->server, packet_data, packet_bytes );
     }
 }
 
@@ -158,6 +170,20 @@ void soak_initialize()
     reliable_log_level( RELIABLE_LOG_LEVEL_DEBUG );
 
     memset( &global_context, 0, sizeof( global_context ) );
+
+    struct reliable_network_simulator_config_t network_simulator_config;
+    reliable_network_simulator_default_config( &network_simulator_config );
+    network_simulator_config.seed = 42;
+    network_simulator_config.link.latency = 0.05f;
+    network_simulator_config.link.jitter = 0.01f;
+    network_simulator_config.link.packet_loss = 5.0f;
+    network_simulator_config.link.duplicate = 1.0f;
+    network_simulator_config.link.reorder = 1.0f;
+    network_simulator_config.link.bandwidth_kbps = 10000.0f;
+    network_simulator_config.context = &global_context;
+    network_simulator_config.deliver_packet_function = &test_deliver_packet_function;
+
+    global_context.network_simulator = reliable_network_simulator_create( &network_simulator_config, global_time );
     
     struct reliable_config_t client_config;
     struct reliable_config_t server_config;
@@ -177,6 +203,7 @@ void soak_initialize()
     client_config.index = 0;
     client_config.transmit_packet_function = &test_transmit_packet_function;
     client_config.process_packet_function = &test_process_packet_function;
+    client_config.trace_events = trace_filename ? 64 * 1024 : 0;
 
 #ifdef _MSC_VER
     strcpy_s( server_config.name, sizeof( server_config.name ), "server" );
@@ -190,15 +217,27 @@ void soak_initialize()
 
     global_context.client = reliable_endpoint_create( &client_config, global_time );
     global_context.server = reliable_endpoint_create( &server_config, global_time );
+
+    if ( capture_filename && reliable_endpoint_start_capture( global_context.server, capture_filename ) )
+    {
+        printf( "capturing server datagrams to %s\n", capture_filename );
+    }
 }
 
 void soak_shutdown()
 {
     printf( "shutdown\n" );
 
+    if ( trace_filename && reliable_endpoint_dump_trace( global_context.client, trace_filename ) )
+    {
+        printf( "wrote client trace to %s\n", trace_filename );
+    }
+
     reliable_endpoint_destroy( global_context.client );
     reliable_endpoint_destroy( global_context.server );
 
+    reliable_network_simulator_destroy( global_context.network_simulator );
+
     reliable_term();
 }
 
@@ -217,6 +256,8 @@ void soak_iteration( double time )
     packet_bytes = generate_packet_data( sequence, packet_data );
     reliable_endpoint_send_packet( global_context.server, packet_data, packet_bytes );
 
+    reliable_network_simulator_update( global_context.network_simulator, time );
+
     reliable_endpoint_update( global_context.client, time );
     reliable_endpoint_update( global_context.server, time );
 
@@ -224,13 +265,313 @@ void soak_iteration( double time )
     reliable_endpoint_clear_acks( global_context.server );
 }
 
+// ---------------------------------------------------------------
+
+// scale mode: N endpoint pairs through the network simulator on a virtual clock, measured as N grows.
+// most clients send a small input every tick and get small deltas back plus a large fragmented snapshot once a second.
+// every fifth client is idle and only exchanges a keepalive once a second
+
+#define SCALE_DEFAULT_MAX_PAIRS 50000
+#define SCALE_DEFAULT_SECONDS 2.0
+#define SCALE_TICK_RATE 30
+#define SCALE_IDLE_EVERY 5
+#define SCALE_INPUT_BYTES 48
+#define SCALE_DELTA_BYTES 128
+#define SCALE_SNAPSHOT_BYTES 4000
+#define SCALE_KEEPALIVE_BYTES 16
+
+struct scale_context_t
+{
+    struct reliable_endpoint_t ** endpoints;
+    struct reliable_network_simulator_t * network_simulator;
+};
+
+static struct scale_context_t scale;
+
+double scale_time()
+{
+#if defined( _WIN32 )
+    static LARGE_INTEGER frequency;
+    if ( frequency.QuadPart == 0 )
+        QueryPerformanceFrequency( &frequency );
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter( &counter );
+    return ( (double) counter.QuadPart ) / ( (double) frequency.QuadPart );
+#else
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ( (double) ts.tv_nsec ) / 1000000000.0;
+#endif
+}
+
+// resident set size in bytes. current on linux, peak on other unix, unavailable on windows
+
+uint64_t scale_rss()
+{
+#if defined( _WIN32 )
+    return 0;
+#elif defined( __linux__ )
+    FILE * file = fopen( "/proc/self/statm", "r" );
+    if ( !file )
+        return 0;
+    unsigned long pages = 0, resident = 0;
+    int result = fscanf( file, "%lu %lu", &pages, &resident );
+    fclose( file );
+    return result == 2 ? ( (uint64_t) resident ) * (uint64_t) sysconf( _SC_PAGESIZE ) : 0;
+#else
+    struct rusage usage;
+    getrusage( RUSAGE_SELF, &usage );
+#if defined( __APPLE__ )
+    return (uint64_t) usage.ru_maxrss;
+#else
+    return ( (uint64_t) usage.ru_maxrss ) * 1024;
+#endif
+#endif
+}
+
+void scale_transmit_packet_function( void * context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) sequence;
+    reliable_network_simulator_send_packet( scale.network_simulator, index, index ^ 1, packet_data, packet_bytes );
+}
+
+void scale_deliver_packet_function( void * context, int from, int to, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) from;
+    reliable_endpoint_receive_packet( scale.endpoints[to], packet_data, packet_bytes );
+}
+
+int scale_process_packet_function( void * context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) index;
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+    return 1;
+}
+
+int scale_run( int num_pairs, double seconds )
+{
+    int num_endpoints = num_pairs * 2;
+
+    struct reliable_allocation_stats_t allocations_before;
+    reliable_allocation_stats( &allocations_before );
+    uint64_t rss_before = scale_rss();
+
+    double time = 100.0;
+
+    struct reliable_network_simulator_config_t network_simulator_config;
+    reliable_network_simulator_default_config( &network_simulator_config );
+    network_simulator_config.seed = 42;
+    network_simulator_config.max_endpoints = num_endpoints;
+    network_simulator_config.max_packets = num_pairs * 64;
+    network_simulator_config.link.latency = 0.05f;
+    network_simulator_config.link.jitter = 0.01f;
+    network_simulator_config.link.packet_loss = 1.0f;
+    network_simulator_config.link.duplicate = 0.5f;
+    network_simulator_config.link.reorder = 0.5f;
+    network_simulator_config.link.bandwidth_kbps = 2000.0f;
+    network_simulator_config.deliver_packet_function = &scale_deliver_packet_function;
+    scale.network_simulator = reliable_network_simulator_create( &network_simulator_config, time );
+
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.transmit_packet_function = &scale_transmit_packet_function;
+    config.process_packet_function = &scale_process_packet_function;
+
+    scale.endpoints = (struct reliable_endpoint_t**) malloc( num_endpoints * sizeof( struct reliable_endpoint_t* ) );
+
+    int i;
+    for ( i = 0; i < num_endpoints; ++i )
+    {
+        config.index = i;
+        scale.endpoints[i] = reliable_endpoint_create( &config, time );
+    }
+
+    struct reliable_allocation_stats_t allocations_created;
+    reliable_allocation_stats( &allocations_created );
+    uint64_t rss_created = scale_rss();
+
+    static uint8_t packet_data[SCALE_SNAPSHOT_BYTES];
+
+    double send_time = 0.0;
+    double deliver_time = 0.0;
+    double update_time = 0.0;
+    uint64_t num_updates = 0;
+
+    int num_ticks = (int) ( seconds * SCALE_TICK_RATE );
+    int tick;
+    for ( tick = 0; tick < num_ticks && !quit; ++tick )
+    {
+        double start = scale_time();
+
+        int pair;
+        for ( pair = 0; pair < num_pairs; ++pair )
+        {
+            struct reliable_endpoint_t * client = scale.endpoints[pair*2];
+            struct reliable_endpoint_t * server = scale.endpoints[pair*2+1];
+
+            // once a second events are staggered across pairs so no single tick carries them all
+
+            int once_a_second = ( tick + pair ) % SCALE_TICK_RATE == 0;
+
+            if ( pair % SCALE_IDLE_EVERY == 0 )
+            {
+                if ( once_a_second )
+                {
+                    reliable_endpoint_send_packet( client, packet_data, SCALE_KEEPALIVE_BYTES );
+                    reliable_endpoint_send_packet( server, packet_data, SCALE_KEEPALIVE_BYTES );
+                }
+            }
+            else
+            {
+                reliable_endpoint_send_packet( client, packet_data, SCALE_INPUT_BYTES );
+                reliable_endpoint_send_packet( server, packet_data, once_a_second ? SCALE_SNAPSHOT_BYTES : SCALE_DELTA_BYTES );
+            }
+        }
+
+        double sent = scale_time();
+
+        time += 1.0 / SCALE_TICK_RATE;
+
+        reliable_network_simulator_update( scale.network_simulator, time );
+
+        double delivered = scale_time();
+
+        for ( i = 0; i < num_endpoints; ++i )
+        {
+            reliable_endpoint_update( scale.endpoints[i], time );
+            reliable_endpoint_clear_acks( scale.endpoints[i] );
+        }
+
+        double updated = scale_time();
+
+        send_time += sent - start;
+        deliver_time += delivered - sent;
+        update_time += updated - delivered;
+        num_updates += num_endpoints;
+    }
+
+    uint64_t rss_peak = scale_rss();
+
+    uint64_t num_sent = 0;
+    uint64_t num_received = 0;
+    uint64_t num_acked = 0;
+    for ( i = 0; i < num_endpoints; ++i )
+    {
+        const uint64_t * counters = reliable_endpoint_counters( scale.endpoints[i] );
+        num_sent += counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT];
+        num_received += counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED];
+        num_acked += counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_ACKED];
+    }
+
+    struct reliable_network_simulator_stats_t network_stats;
+    reliable_network_simulator_stats( scale.network_simulator, &network_stats );
+
+    for ( i = 0; i < num_endpoints; ++i )
+    {
+        reliable_endpoint_destroy( scale.endpoints[i] );
+    }
+    free( scale.endpoints );
+    scale.endpoints = NULL;
+
+    reliable_network_simulator_destroy( scale.network_simulator );
+    scale.network_simulator = NULL;
+
+    struct reliable_allocation_stats_t allocations_after;
+    reliable_allocation_stats( &allocations_after );
+
+    double wall_time = send_time + deliver_time + update_time;
+    uint64_t num_packets = num_sent + network_stats.num_packets_delivered;
+
+    printf( "%8d %10.0f %12.0f %10.1f %10.1f %10.0f %10.2f %12" PRIu64 " %10.2f\n", 
+        num_pairs, 
+        (double) ( allocations_created.live_bytes - allocations_before.live_bytes ) / num_endpoints, 
+        rss_created > rss_before ? (double) ( rss_created - rss_before ) / num_endpoints : 0.0, 
+        rss_peak / ( 1024.0 * 1024.0 ), 
+        update_time * 1000000000.0 / ( num_updates ? num_updates : 1 ), 
+        ( send_time + deliver_time ) * 1000000000.0 / ( num_packets ? num_packets : 1 ), 
+        seconds / ( wall_time > 0.0 ? wall_time : 1.0 ), 
+        num_received, 
+        100.0 * num_acked / ( num_sent ? num_sent : 1 ) );
+    fflush( stdout );
+
+    // every byte the endpoints allocated must be returned, and traffic must have flowed
+
+    if ( allocations_after.live_bytes != allocations_before.live_bytes )
+    {
+        printf( "error: %" PRIu64 " bytes still allocated after destroying %d endpoints\n", allocations_after.live_bytes - allocations_before.live_bytes, num_endpoints );
+        return 0;
+    }
+
+    if ( num_received == 0 || num_acked == 0 )
+    {
+        printf( "error: no traffic made it between endpoints\n" );
+        return 0;
+    }
+
+    return 1;
+}
+
+int scale_main( int max_pairs, double seconds )
+{
+    printf( "scale soak up to %d pairs, %.1f virtual seconds each at %dHz\n\n", max_pairs, seconds, SCALE_TICK_RATE );
+
+    printf( "%8s %10s %12s %10s %10s %10s %10s %12s %10s\n", 
+        "pairs", "bytes/ep", "rss/ep", "rss mb", "ns/update", "ns/packet", "x realtime", "received", "acked %" );
+
+    reliable_init();
+
+    signal( SIGINT, interrupt_handler );
+
+    int ok = 1;
+    int num_pairs = 100;
+    while ( ok && !quit )
+    {
+        if ( num_pairs > max_pairs )
+            num_pairs = max_pairs;
+
+        ok = scale_run( num_pairs, seconds );
+
+        if ( num_pairs == max_pairs )
+            break;
+
+        num_pairs *= 10;
+    }
+
+    reliable_term();
+
+    return ok ? 0 : 1;
+}
+
 int main( int argc, char ** argv )
 {
+    if ( argc >= 2 && strcmp( argv[1], "scale" ) == 0 )
+    {
+        int max_pairs = argc >= 3 ? atoi( argv[2] ) : SCALE_DEFAULT_MAX_PAIRS;
+        double seconds = argc >= 4 ? atof( argv[3] ) : SCALE_DEFAULT_SECONDS;
+        if ( max_pairs <= 0 || seconds <= 0.0 )
+        {
+            printf( "usage: soak scale [max pairs] [seconds]\n" );
+            return 1;
+        }
+        return scale_main( max_pairs, seconds );
+    }
+
     int num_iterations = -1;
 
-    if ( argc == 2 )
+    if ( argc >= 2 )
         num_iterations = atoi( argv[1] );
 
+    if ( argc >= 3 && strcmp( argv[2], "-" ) != 0 )
+        trace_filename = argv[2];
+
+    if ( argc >= 4 )
+        capture_filename = argv[3];
+
     soak_initialize();
 
     signal( SIGINT, interrupt_handler );
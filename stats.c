@@ -32,7 +32,14 @@
 #include <signal.h>
 #include <inttypes.h>
 
+#if !defined( _WIN32 )
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif // #if !defined( _WIN32 )
+
 #define MAX_PACKET_BYTES 290
+#define STATS_REPORT_INTERVAL 100
 
 static volatile int quit = 0;
 
@@ -61,6 +68,13 @@ double global_time = 100.0;
 
 struct test_context_t global_context;
 
+static int global_report_iterations = 0;
+
+#define STATS_METRICS_MAX_ENDPOINTS 2
+
+struct reliable_metrics_header_t * global_metrics = NULL;
+uint64_t global_metrics_bytes = 0;
+
 void test_transmit_packet_function( void * _context, int index, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
 {
     (void) sequence;
@@ -189,6 +203,42 @@ void stats_initialize()
     global_context.server = reliable_endpoint_create( &server_config, global_time );
 }
 
+int stats_export_metrics( const char * filename )
+{
+#if !defined( _WIN32 )
+    global_metrics_bytes = reliable_metrics_bytes( STATS_METRICS_MAX_ENDPOINTS );
+
+    int fd = open( filename, O_RDWR | O_CREAT | O_TRUNC, 0644 );
+    if ( fd < 0 || ftruncate( fd, (off_t) global_metrics_bytes ) != 0 )
+    {
+        printf( "error: could not create metrics file %s\n", filename );
+        if ( fd >= 0 )
+            close( fd );
+        return 0;
+    }
+
+    void * memory = mmap( NULL, global_metrics_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( memory == MAP_FAILED )
+    {
+        printf( "error: could not map metrics file %s\n", filename );
+        return 0;
+    }
+
+    global_metrics = reliable_metrics_init( memory, STATS_METRICS_MAX_ENDPOINTS );
+
+    reliable_endpoint_export_metrics( global_context.client, global_metrics, 0 );
+    reliable_endpoint_export_metrics( global_context.server, global_metrics, 1 );
+
+    printf( "exporting metrics to %s. run monitor %s to watch\n", filename, filename );
+
+    return 1;
+#else // #if !defined( _WIN32 )
+    printf( "error: metrics export is not supported on windows (%s)\n", filename );
+    return 0;
+#endif // #if !defined( _WIN32 )
+}
+
 void stats_shutdown()
 {
     printf( "shutdown\n" );
@@ -196,6 +246,14 @@ void stats_shutdown()
     reliable_endpoint_destroy( global_context.client );
     reliable_endpoint_destroy( global_context.server );
 
+#if !defined( _WIN32 )
+    if ( global_metrics )
+    {
+        munmap( global_metrics, global_metrics_bytes );
+        global_metrics = NULL;
+    }
+#endif // #if !defined( _WIN32 )
+
     reliable_term();
 }
 
@@ -225,26 +283,60 @@ void stats_iteration( double time )
     float sent_bandwidth_kbps, received_bandwidth_kbps, acked_bandwidth_kbps;
     reliable_endpoint_bandwidth( global_context.client, &sent_bandwidth_kbps, &received_bandwidth_kbps, &acked_bandwidth_kbps );
 
-    printf( "%" PRIi64 " sent | %" PRIi64 " received | %" PRIi64 " acked | rtt = %dms | packet loss = %d%% | sent = %dkbps | recv = %dkbps | acked = %dkbps\n", 
-        counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT],
-        counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED],
-        counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_ACKED],
-        (int) reliable_endpoint_rtt( global_context.client ),
-        (int) floor( reliable_endpoint_packet_loss( global_context.client ) + 0.5f ),
-        (int) sent_bandwidth_kbps,
-        (int) received_bandwidth_kbps,
-        (int) acked_bandwidth_kbps );
+    // rtt percentiles cover both directions over the current reporting interval
+
+    struct reliable_rtt_histogram_t rtt_histogram;
+    reliable_rtt_histogram_reset( &rtt_histogram );
+    reliable_rtt_histogram_merge( &rtt_histogram, reliable_endpoint_rtt_histogram( global_context.client ) );
+    reliable_rtt_histogram_merge( &rtt_histogram, reliable_endpoint_rtt_histogram( global_context.server ) );
+
+    if ( !global_metrics )
+    {
+        printf( "%" PRIi64 " sent | %" PRIi64 " received | %" PRIi64 " acked | rtt p50 = %.1fms p90 = %.1fms p99 = %.1fms max = %.1fms | packet loss = %d%% | sent = %dkbps | recv = %dkbps | acked = %dkbps\n", 
+            counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT],
+            counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED],
+            counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_ACKED],
+            reliable_rtt_histogram_percentile( &rtt_histogram, 50.0f ),
+            reliable_rtt_histogram_percentile( &rtt_histogram, 90.0f ),
+            reliable_rtt_histogram_percentile( &rtt_histogram, 99.0f ),
+            rtt_histogram.max_rtt,
+            (int) floor( reliable_endpoint_packet_loss( global_context.client ) + 0.5f ),
+            (int) sent_bandwidth_kbps,
+            (int) received_bandwidth_kbps,
+            (int) acked_bandwidth_kbps );
+    }
+
+    if ( ++global_report_iterations % STATS_REPORT_INTERVAL == 0 )
+    {
+        reliable_endpoint_reset_rtt_histogram( global_context.client );
+        reliable_endpoint_reset_rtt_histogram( global_context.server );
+    }
+
+#if !defined( _WIN32 )
+    if ( global_metrics )
+    {
+        usleep( 10000 );
+    }
+#endif // #if !defined( _WIN32 )
 }
 
 int main( int argc, char ** argv )
 {
     int num_iterations = -1;
 
-    if ( argc == 2 )
+    if ( argc >= 2 )
         num_iterations = atoi( argv[1] );
 
     stats_initialize();
 
+    // with a metrics file the endpoints publish into shared memory instead of printing, and the loop runs in real time
+
+    if ( argc >= 3 && !stats_export_metrics( argv[2] ) )
+    {
+        stats_shutdown();
+        return 1;
+    }
+
     signal( SIGINT, interrupt_handler );
 
     double delta_time = 0.01;
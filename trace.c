@@ -0,0 +1,308 @@
+/*
+    reliable.io reference implementation
+
+    Copyright © 2017, The Network Protocol Company, Inc.
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "reliable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+// reads a trace written by reliable_endpoint_dump_trace and reconstructs per packet rtt, loss bursts and reassembly delays
+
+#define MAX_BURST_HISTOGRAM 8
+
+struct trace_send_t
+{
+    double time;
+    double rtt;
+    uint16_t sequence;
+    int acked;
+};
+
+static int compare_double( const void * a, const void * b )
+{
+    double x = *(const double*) a;
+    double y = *(const double*) b;
+    return ( x > y ) - ( x < y );
+}
+
+static double percentile( double * values, int count, double p )
+{
+    if ( count == 0 )
+        return 0.0;
+    int index = (int) ( p * ( count - 1 ) + 0.5 );
+    return values[index];
+}
+
+static void print_distribution( const char * label, double * values, int count )
+{
+    if ( count == 0 )
+    {
+        printf( "%-12s (no samples)\n", label );
+        return;
+    }
+
+    qsort( values, count, sizeof( double ), compare_double );
+
+    double sum = 0.0;
+    int i;
+    for ( i = 0; i < count; ++i )
+        sum += values[i];
+
+    printf( "%-12s %8d samples. min %.2fms, avg %.2fms, p50 %.2fms, p90 %.2fms, p99 %.2fms, max %.2fms\n", 
+        label, 
+        count, 
+        values[0] * 1000.0, 
+        sum / count * 1000.0, 
+        percentile( values, count, 0.5 ) * 1000.0, 
+        percentile( values, count, 0.9 ) * 1000.0, 
+        percentile( values, count, 0.99 ) * 1000.0, 
+        values[count-1] * 1000.0 );
+}
+
+int trace_analyze( const char * filename )
+{
+    FILE * file = fopen( filename, "rb" );
+    if ( !file )
+    {
+        printf( "error: could not open %s\n", filename );
+        return 0;
+    }
+
+    struct reliable_trace_file_header_t header;
+    if ( fread( &header, sizeof( header ), 1, file ) != 1 ||
+         header.magic != RELIABLE_TRACE_MAGIC ||
+         header.version != RELIABLE_TRACE_VERSION ||
+         header.event_bytes != sizeof( struct reliable_trace_event_t ) )
+    {
+        printf( "error: %s is not a trace file this build understands\n", filename );
+        fclose( file );
+        return 0;
+    }
+
+    // never trust the event count in the header further than the file actually goes
+
+    long events_start = ftell( file );
+    fseek( file, 0, SEEK_END );
+    long file_bytes = ftell( file );
+    fseek( file, events_start, SEEK_SET );
+
+    if ( events_start < 0 || file_bytes < events_start || (uint64_t) header.num_events > (uint64_t) ( file_bytes - events_start ) / sizeof( struct reliable_trace_event_t ) )
+    {
+        printf( "error: %s is truncated\n", filename );
+        fclose( file );
+        return 0;
+    }
+
+    struct reliable_trace_event_t * events = (struct reliable_trace_event_t*) malloc( ( header.num_events + 1 ) * sizeof( struct reliable_trace_event_t ) );
+    if ( fread( events, sizeof( struct reliable_trace_event_t ), header.num_events, file ) != header.num_events )
+    {
+        printf( "error: %s is truncated\n", filename );
+        free( events );
+        fclose( file );
+        return 0;
+    }
+
+    fclose( file );
+
+    header.name[RELIABLE_METRICS_NAME_BYTES-1] = '\0';
+
+    printf( "%s: endpoint \"%s\", %u events", filename, header.name, header.num_events );
+    if ( header.num_recorded > header.num_events )
+        printf( " (oldest %" PRIu64 " overwritten)", header.num_recorded - header.num_events );
+    printf( "\n" );
+
+    if ( header.num_events > 0 )
+        printf( "time %.3f to %.3f\n\n", events[0].time, events[header.num_events-1].time );
+
+    uint64_t type_counts[RELIABLE_TRACE_NUM_TYPES];
+    memset( type_counts, 0, sizeof( type_counts ) );
+
+    // sequence numbers wrap, so each one maps to its most recent send and fragment arrival
+
+    struct trace_send_t * sends = (struct trace_send_t*) malloc( ( header.num_events + 1 ) * sizeof( struct trace_send_t ) );
+    int * send_index = (int*) malloc( 65536 * sizeof( int ) );
+    double * first_fragment_time = (double*) malloc( 65536 * sizeof( double ) );
+    uint8_t * reassembling = (uint8_t*) calloc( 65536, 1 );
+    double * rtts = (double*) malloc( ( header.num_events + 1 ) * sizeof( double ) );
+    double * reassembly_delays = (double*) malloc( ( header.num_events + 1 ) * sizeof( double ) );
+
+    int i;
+    for ( i = 0; i < 65536; ++i )
+        send_index[i] = -1;
+
+    int num_sends = 0;
+    int num_rtts = 0;
+    int num_reassembly_delays = 0;
+    double last_ack_time = -1.0;
+
+    uint32_t n;
+    for ( n = 0; n < header.num_events; ++n )
+    {
+        struct reliable_trace_event_t * event = events + n;
+
+        if ( event->type < RELIABLE_TRACE_NUM_TYPES )
+            type_counts[event->type]++;
+
+        switch ( event->type )
+        {
+            case RELIABLE_TRACE_SEND:
+            {
+                sends[num_sends].time = event->time;
+                sends[num_sends].rtt = 0.0;
+                sends[num_sends].sequence = event->sequence;
+                sends[num_sends].acked = 0;
+                send_index[event->sequence] = num_sends++;
+            }
+            break;
+
+            case RELIABLE_TRACE_ACK:
+            {
+                int index = send_index[event->sequence];
+                if ( index >= 0 && !sends[index].acked )
+                {
+                    sends[index].acked = 1;
+                    sends[index].rtt = event->time - sends[index].time;
+                    rtts[num_rtts++] = sends[index].rtt;
+                }
+                last_ack_time = event->time;
+            }
+            break;
+
+            case RELIABLE_TRACE_RECEIVE_FRAGMENT:
+            {
+                if ( !reassembling[event->sequence] )
+                {
+                    reassembling[event->sequence] = 1;
+                    first_fragment_time[event->sequence] = event->time;
+                }
+            }
+            break;
+
+            case RELIABLE_TRACE_REASSEMBLED:
+            {
+                if ( reassembling[event->sequence] )
+                {
+                    reassembly_delays[num_reassembly_delays++] = event->time - first_fragment_time[event->sequence];
+                    reassembling[event->sequence] = 0;
+                }
+            }
+            break;
+
+            default:
+                break;
+        }
+    }
+
+    printf( "events:\n" );
+    for ( i = 0; i < RELIABLE_TRACE_NUM_TYPES; ++i )
+    {
+        printf( "    %-18s %10" PRIu64 "\n", reliable_trace_type_name( i ), type_counts[i] );
+    }
+    printf( "\n" );
+
+    print_distribution( "rtt", rtts, num_rtts );
+    print_distribution( "reassembly", reassembly_delays, num_reassembly_delays );
+
+    // sends after the last ack may still be in flight, so they are not counted as lost
+
+    int num_considered = 0;
+    int num_lost = 0;
+    int num_bursts = 0;
+    int max_burst = 0;
+    int current_burst = 0;
+    int burst_histogram[MAX_BURST_HISTOGRAM+1];
+    memset( burst_histogram, 0, sizeof( burst_histogram ) );
+
+    for ( i = 0; i <= num_sends; ++i )
+    {
+        int lost = i < num_sends && sends[i].time <= last_ack_time && !sends[i].acked;
+
+        if ( lost )
+        {
+            current_burst++;
+        }
+        else if ( current_burst > 0 )
+        {
+            num_bursts++;
+            if ( current_burst > max_burst )
+                max_burst = current_burst;
+            burst_histogram[current_burst < MAX_BURST_HISTOGRAM ? current_burst : MAX_BURST_HISTOGRAM]++;
+            current_burst = 0;
+        }
+
+        if ( i < num_sends && sends[i].time <= last_ack_time )
+        {
+            num_considered++;
+            num_lost += lost;
+        }
+    }
+
+    printf( "%-12s %8d of %d sends lost (%.2f%%) in %d bursts, longest %d\n", 
+        "loss", num_lost, num_considered, num_considered > 0 ? 100.0 * num_lost / num_considered : 0.0, num_bursts, max_burst );
+
+    if ( num_bursts > 0 )
+    {
+        printf( "bursts:\n" );
+        for ( i = 1; i <= MAX_BURST_HISTOGRAM; ++i )
+        {
+            if ( burst_histogram[i] == 0 )
+                continue;
+            printf( "    %s%-4d %10d\n", i == MAX_BURST_HISTOGRAM ? ">=" : "  ", i, burst_histogram[i] );
+        }
+    }
+
+    free( events );
+    free( sends );
+    free( send_index );
+    free( first_fragment_time );
+    free( reassembling );
+    free( rtts );
+    free( reassembly_delays );
+
+    return 1;
+}
+
+int main( int argc, char ** argv )
+{
+    if ( argc < 2 )
+    {
+        printf( "usage: trace <trace file> [trace file...]\n" );
+        return 1;
+    }
+
+    int result = 0;
+
+    int i;
+    for ( i = 1; i < argc; ++i )
+    {
+        if ( i > 1 )
+            printf( "\n" );
+
+        if ( !trace_analyze( argv[i] ) )
+            result = 1;
+    }
+
+    return result;
+}